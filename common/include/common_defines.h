@@ -8,7 +8,7 @@
 
 extern bool debug;
 extern uint32_t debug_level;
-extern std::ofstream log_file;
+extern thread_local std::ofstream log_file; /* per thread so that parallel lifting jobs keep separate logs */
 
 extern bool conctree_opt;
 extern bool abstree_opt;
@@ -1,14 +1,20 @@
 #ifndef _EXALGO_IMAGEINFO_H
 #define _EXALGO_IMAGEINFO_H
 
+#ifdef _WIN32
 #include <Windows.h>
+#include <gdiplus.h>
+#endif
 #include <stdint.h>
 #include <string>
-#include <gdiplus.h>
 
 
 typedef unsigned char byte;
 
+#ifndef _WIN32
+typedef uintptr_t ULONG_PTR; /* the image subsystem token; there is nothing to start up outside GDI+ */
+#endif
+
 using namespace std;
 
 struct image_t{
@@ -26,6 +32,25 @@ struct image_t{
 ULONG_PTR initialize_image_subsystem();
 void shutdown_image_subsystem(ULONG_PTR token);
 
+/*
+portable image io - decodes and encodes whole rows at a time.
+ppm / pgm (P2, P3, P5, P6) and uncompressed 24 / 32 bit bmp are handled natively; png goes through libpng
+when built with EXALGO_USE_PNG and other formats fall back to GDI+ on windows.
+the loaded image_t is always 3 planar 8 bit colors (gray images are replicated, alpha is dropped) so that
+image_array has the same layout populate_imageinfo() produces.
+*/
+image_t * load_image(const char * filename);
+bool save_image(image_t * image, const char * filename);
+image_t * create_imageinfo(uint32_t width, uint32_t height);
+void delete_imageinfo(image_t * image);
+
+/* planar (color major) <-> interleaved (pixel major) conversion of 8 bit images */
+void deinterleave(const byte * interleaved, byte * planar, uint32_t pixels, uint32_t colors);
+void interleave(const byte * planar, byte * interleaved, uint32_t pixels, uint32_t colors);
+byte * get_interleaved_buffer(image_t * image); /* caller owns the returned rgb rgb ... buffer */
+void update_from_interleaved(image_t * image, const byte * buffer);
+
+#ifdef _WIN32
 void save_image(Gdiplus::Bitmap * image, const char * file);
 Gdiplus::Bitmap * open_image(const char * filename);
 Gdiplus::Bitmap * create_image(uint32_t width, uint32_t height);
@@ -33,7 +58,8 @@ Gdiplus::Bitmap * create_image(uint32_t width, uint32_t height);
 byte * get_image_buffer(Gdiplus::Bitmap * image);
 void update_image_buffer(Gdiplus::Bitmap * image, byte * buffer);
 image_t * populate_imageinfo(Gdiplus::Bitmap *image);
+#endif
 
 
 
-#endif
\ No newline at end of file
+#endif
@@ -86,6 +86,7 @@ uint32_t get_extents(mem_info_t * mem, uint32_t dim, uint32_t total_dims);
 uint32_t get_number_dimensions(mem_info_t * mem);
 void link_mem_regions_dim(std::vector<pc_mem_region_t *> &pc_mems, uint32_t mode);
 bool link_mem_regions_greedy_dim(std::vector<mem_info_t *> &mem, uint32_t app_pc);
+bool link_mem_regions_dp_dim(std::vector<mem_info_t *> &mem, uint32_t app_pc); /* optimal under a cost model; DYNAMIC_PROG */
 void sort_mem_info(std::vector<mem_info_t *> &mem_info);
 
 std::vector< std::vector< mem_info_t * > > get_merge_opportunities(std::vector<mem_info_t *> mem_info, std::vector<pc_mem_region_t *> pc_mems);
@@ -0,0 +1,25 @@
+#ifndef _EXALGO_PLATFORM_H
+#define _EXALGO_PLATFORM_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/*
+thin platform layer - the only operating system services the analysis tools use. everything else in
+buildex / filter_funcs is platform neutral; image decoding lives behind imageinfo.h
+*/
+
+#ifdef _WIN32
+#define PATH_SEPARATOR	"\\"
+#else
+#define PATH_SEPARATOR	"/"
+#endif
+
+std::string join_path(std::string folder, std::string file);
+std::vector<std::string> get_all_files_in_folder(std::string folder); /* regular files only, names without the folder */
+int64_t get_file_size(std::string filename); /* -1 if the file cannot be found */
+bool create_folder(std::string folder); /* true if the folder exists afterwards */
+
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <stdint.h>
+#include "platform.h"
 
 #define HALIDE_FOLDER_ENV_VAR	"EXALGO_HALIDE_FOLDER"
 #define OUTPUT_FOLDER_ENV_VAR	"EXALGO_OUTPUT_FOLDER"
@@ -21,7 +22,6 @@ struct cmd_args_t{
 
 std::vector<std::string> split(const std::string &s, char delim);
 std::vector<cmd_args_t *> get_command_line_args(int argc, char ** argv);
-std::vector<std::string> get_all_files_in_folder(std::string folder);
 std::string get_standard_folder(std::string type);
 bool is_prefix(std::string str, std::string prefix);
 
@@ -30,6 +30,25 @@ bool is_overlapped(uint64_t start_1, uint64_t end_1, uint64_t start_2, uint64_t
 
 std::vector<double> solve_linear_eq(std::vector< std::vector<double> > A, std::vector<double> b);
 void test_linear_solver();
+
+/* exact solver for over-determined integer systems A x = b where A is reused for many b */
+struct rational_t{
+	int64_t num;
+	int64_t den;
+};
+
+struct linear_solver_t{
+	uint32_t rows;
+	uint32_t cols;
+	uint32_t rank;
+	std::vector< std::vector<int64_t> > A;
+	std::vector<uint32_t> basis;						/* indexes of cols linearly independant rows of A */
+	std::vector< std::vector<rational_t> > inverse;		/* inverse of the square matrix made from the basis rows */
+};
+
+bool factor_linear_system(linear_solver_t * solver, std::vector< std::vector<int64_t> > &A);
+bool solve_linear_system(linear_solver_t * solver, std::vector<int64_t> &b, std::vector<int64_t> &x);
+uint32_t solve_linear_system_batch(linear_solver_t * solver, std::vector< std::vector<int64_t> > &b, std::vector< std::vector<int64_t> > &x);
 void printout_matrices(std::vector<std::vector<double> >  values);
 void printout_vector(std::vector<double> values);
 int double_to_int(double value);
@@ -1,11 +1,582 @@
-#include <Windows.h>
 #include "imageinfo.h"
 #include "common_defines.h"
 #include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#ifdef EXALGO_USE_PNG
+#include <png.h>
+#endif
 
 using namespace std;
 
+#ifdef _WIN32
 int GetEncoderClsid(const WCHAR* format, CLSID* pClsid);
+#endif
+
+static string get_extension(const char * filename);
+
+
+/************************************************************************/
+/*  planar <-> interleaved conversion                                   */
+/************************************************************************/
+
+/*
+c0, c1, c2 receive bytes 0, 1, 2 of every pixel in a stream with stride bytes per pixel. the loops
+are kept free of aliasing and with a constant stride so that the compiler turns them into packed
+shuffles; callers pass the planes in the order the stream stores them (bmp / GDI+ rows are bgr).
+*/
+static void split_channels(const byte * __restrict in, uint32_t stride,
+	byte * __restrict c0, byte * __restrict c1, byte * __restrict c2, uint32_t pixels){
+
+	if (stride == 3){
+		for (uint32_t i = 0; i < pixels; i++){
+			c0[i] = in[3 * i];
+			c1[i] = in[3 * i + 1];
+			c2[i] = in[3 * i + 2];
+		}
+	}
+	else if (stride == 4){
+		for (uint32_t i = 0; i < pixels; i++){
+			c0[i] = in[4 * i];
+			c1[i] = in[4 * i + 1];
+			c2[i] = in[4 * i + 2];
+		}
+	}
+	else{
+		for (uint32_t i = 0; i < pixels; i++){
+			c0[i] = in[stride * i];
+			c1[i] = in[stride * i + 1];
+			c2[i] = in[stride * i + 2];
+		}
+	}
+
+}
+
+/* inverse of split_channels; a fourth byte (alpha) is set to fill when stride is 4 */
+static void merge_channels(byte * __restrict out, uint32_t stride,
+	const byte * __restrict c0, const byte * __restrict c1, const byte * __restrict c2, uint32_t pixels, byte fill){
+
+	if (stride == 3){
+		for (uint32_t i = 0; i < pixels; i++){
+			out[3 * i] = c0[i];
+			out[3 * i + 1] = c1[i];
+			out[3 * i + 2] = c2[i];
+		}
+	}
+	else{
+		ASSERT_MSG(stride == 4, ("ERROR: unsupported pixel stride %u\n", stride));
+		for (uint32_t i = 0; i < pixels; i++){
+			out[4 * i] = c0[i];
+			out[4 * i + 1] = c1[i];
+			out[4 * i + 2] = c2[i];
+			out[4 * i + 3] = fill;
+		}
+	}
+
+}
+
+void deinterleave(const byte * interleaved, byte * planar, uint32_t pixels, uint32_t colors){
+
+	if (colors == 1){
+		memcpy(planar, interleaved, pixels);
+	}
+	else if (colors == 3 || colors == 4){
+		split_channels(interleaved, colors, planar, planar + pixels, planar + 2 * pixels, pixels);
+		if (colors == 4){
+			byte * alpha = planar + 3 * pixels;
+			for (uint32_t i = 0; i < pixels; i++) alpha[i] = interleaved[4 * i + 3];
+		}
+	}
+	else{
+		for (uint32_t c = 0; c < colors; c++){
+			for (uint32_t i = 0; i < pixels; i++){
+				planar[c * pixels + i] = interleaved[i * colors + c];
+			}
+		}
+	}
+
+}
+
+void interleave(const byte * planar, byte * interleaved, uint32_t pixels, uint32_t colors){
+
+	if (colors == 1){
+		memcpy(interleaved, planar, pixels);
+	}
+	else if (colors == 3){
+		merge_channels(interleaved, 3, planar, planar + pixels, planar + 2 * pixels, pixels, 0);
+	}
+	else{
+		for (uint32_t c = 0; c < colors; c++){
+			for (uint32_t i = 0; i < pixels; i++){
+				interleaved[i * colors + c] = planar[c * pixels + i];
+			}
+		}
+	}
+
+}
+
+byte * get_interleaved_buffer(image_t * image){
+
+	uint32_t pixels = image->width * image->height;
+	byte * buffer = new byte[pixels * image->colors];
+	interleave(image->image_array, buffer, pixels, image->colors);
+	return buffer;
+
+}
+
+void update_from_interleaved(image_t * image, const byte * buffer){
+
+	deinterleave(buffer, image->image_array, image->width * image->height, image->colors);
+
+}
+
+
+/************************************************************************/
+/*  image_t management                                                  */
+/************************************************************************/
+
+image_t * create_imageinfo(uint32_t width, uint32_t height){
+
+	image_t * image = new image_t;
+
+	image->width = width;
+	image->height = height;
+	image->colors = 3;
+	image->bits_per_color = 8;
+	image->bits_per_pixel = 24;
+	image->is_alpha = 0;
+	image->image_array = new byte[(size_t)width * height * 3];
+
+	return image;
+
+}
+
+void delete_imageinfo(image_t * image){
+
+	if (image == NULL) return;
+	delete[] image->image_array;
+	delete image;
+
+}
+
+
+/************************************************************************/
+/*  pnm - P2 / P3 (ascii), P5 / P6 (binary)                             */
+/************************************************************************/
+
+/* next header integer, skipping whitespace and # comments */
+static bool read_pnm_value(FILE * file, uint32_t * value){
+
+	int c = fgetc(file);
+	while (c != EOF){
+		if (c == '#'){
+			while (c != EOF && c != '\n') c = fgetc(file);
+		}
+		else if (isspace(c)){
+			c = fgetc(file);
+		}
+		else break;
+	}
+
+	if (c == EOF || !isdigit(c)) return false;
+
+	uint32_t result = 0;
+	while (c != EOF && isdigit(c)){
+		result = result * 10 + (c - '0');
+		c = fgetc(file);
+	}
+
+	/* binary data starts right after the single whitespace that ends the header */
+	*value = result;
+	return true;
+
+}
+
+static image_t * load_pnm(FILE * file){
+
+	char magic[2];
+	if (fread(magic, 1, 2, file) != 2 || magic[0] != 'P') return NULL;
+
+	uint32_t width, height, maxval;
+	bool ascii = (magic[1] == '2' || magic[1] == '3');
+	uint32_t channels = (magic[1] == '3' || magic[1] == '6') ? 3 : 1;
+	if (magic[1] != '2' && magic[1] != '3' && magic[1] != '5' && magic[1] != '6') return NULL;
+
+	if (!read_pnm_value(file, &width) || !read_pnm_value(file, &height) || !read_pnm_value(file, &maxval)) return NULL;
+	if (width == 0 || height == 0 || maxval == 0 || maxval > 65535) return NULL;
+
+	image_t * image = create_imageinfo(width, height);
+	uint32_t plane = width * height;
+	uint32_t sample_bytes = (maxval > 255) ? 2 : 1;
+	uint32_t row_samples = width * channels;
+
+	byte * raw = new byte[row_samples * sample_bytes];
+	byte * row = new byte[row_samples];
+
+	bool ok = true;
+	for (uint32_t y = 0; y < height && ok; y++){
+
+		if (ascii){
+			for (uint32_t i = 0; i < row_samples; i++){
+				uint32_t value;
+				if (!read_pnm_value(file, &value)){ ok = false; break; }
+				row[i] = (maxval == 255) ? (byte)value : (byte)((value * 255 + maxval / 2) / maxval);
+			}
+		}
+		else if (fread(raw, sample_bytes, row_samples, file) != row_samples){
+			ok = false;
+		}
+		else if (sample_bytes == 1 && maxval == 255){
+			memcpy(row, raw, row_samples);
+		}
+		else{
+			for (uint32_t i = 0; i < row_samples; i++){
+				uint32_t value = (sample_bytes == 2) ? ((uint32_t)raw[2 * i] << 8) | raw[2 * i + 1] : raw[i];
+				row[i] = (byte)((value * 255 + maxval / 2) / maxval);
+			}
+		}
+
+		if (!ok) break;
+
+		byte * r = &image->image_array[0 * plane + y * width];
+		byte * g = &image->image_array[1 * plane + y * width];
+		byte * b = &image->image_array[2 * plane + y * width];
+		if (channels == 3){
+			split_channels(row, 3, r, g, b, width);
+		}
+		else{
+			memcpy(r, row, width);
+			memcpy(g, row, width);
+			memcpy(b, row, width);
+		}
+
+	}
+
+	delete[] raw;
+	delete[] row;
+
+	if (!ok){
+		delete_imageinfo(image);
+		return NULL;
+	}
+	return image;
+
+}
+
+static bool save_pnm(image_t * image, FILE * file, bool gray){
+
+	uint32_t width = image->width;
+	uint32_t height = image->height;
+	uint32_t plane = width * height;
+
+	fprintf(file, "%s\n%u %u\n255\n", gray ? "P5" : "P6", width, height);
+
+	byte * row = new byte[width * 3];
+	bool ok = true;
+	for (uint32_t y = 0; y < height && ok; y++){
+
+		const byte * r = &image->image_array[0 * plane + y * width];
+		const byte * g = &image->image_array[1 * plane + y * width];
+		const byte * b = &image->image_array[2 * plane + y * width];
+
+		if (gray){
+			for (uint32_t x = 0; x < width; x++){
+				row[x] = (byte)((77 * r[x] + 150 * g[x] + 29 * b[x] + 128) >> 8);
+			}
+			ok = fwrite(row, 1, width, file) == width;
+		}
+		else{
+			merge_channels(row, 3, r, g, b, width, 0);
+			ok = fwrite(row, 1, width * 3, file) == width * 3;
+		}
+
+	}
+
+	delete[] row;
+	return ok;
+
+}
+
+
+/************************************************************************/
+/*  bmp - uncompressed 8 (palette) / 24 / 32 bit                        */
+/************************************************************************/
+
+static uint32_t read_le32(const byte * data){
+	return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static uint16_t read_le16(const byte * data){
+	return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+static void write_le32(byte * data, uint32_t value){
+	data[0] = value & 0xff; data[1] = (value >> 8) & 0xff; data[2] = (value >> 16) & 0xff; data[3] = (value >> 24) & 0xff;
+}
+
+static void write_le16(byte * data, uint16_t value){
+	data[0] = value & 0xff; data[1] = (value >> 8) & 0xff;
+}
+
+#define BMP_FILE_HEADER 14
+#define BMP_INFO_HEADER 40
+
+static image_t * load_bmp(FILE * file){
+
+	byte header[BMP_FILE_HEADER + BMP_INFO_HEADER];
+	if (fread(header, 1, sizeof(header), file) != sizeof(header)) return NULL;
+	if (header[0] != 'B' || header[1] != 'M') return NULL;
+
+	uint32_t data_offset = read_le32(&header[10]);
+	uint32_t dib_size = read_le32(&header[14]);
+	int32_t width = (int32_t)read_le32(&header[18]);
+	int32_t height = (int32_t)read_le32(&header[22]);
+	uint16_t bpp = read_le16(&header[28]);
+	uint32_t compression = read_le32(&header[30]);
+	uint32_t colors_used = read_le32(&header[46]);
+
+	/* BI_RGB, or BI_BITFIELDS with the usual bgra masks for 32 bit images */
+	if (dib_size < BMP_INFO_HEADER || width <= 0 || height == 0) return NULL;
+	if (compression != 0 && !(compression == 3 && bpp == 32)) return NULL;
+	if (bpp != 8 && bpp != 24 && bpp != 32) return NULL;
+
+	bool top_down = height < 0;
+	uint32_t abs_height = top_down ? (uint32_t)(-height) : (uint32_t)height;
+
+	byte palette[256 * 4];
+	if (bpp == 8){
+		uint32_t entries = (colors_used == 0 || colors_used > 256) ? 256 : colors_used;
+		memset(palette, 0, sizeof(palette));
+		if (fseek(file, BMP_FILE_HEADER + dib_size, SEEK_SET) != 0) return NULL;
+		if (fread(palette, 4, entries, file) != entries) return NULL;
+	}
+
+	if (fseek(file, data_offset, SEEK_SET) != 0) return NULL;
+
+	image_t * image = create_imageinfo(width, abs_height);
+	uint32_t plane = image->width * image->height;
+	uint32_t row_bytes = ((width * bpp + 31) / 32) * 4;
+	byte * row = new byte[row_bytes];
+
+	bool ok = true;
+	for (uint32_t i = 0; i < abs_height; i++){
+
+		if (fread(row, 1, row_bytes, file) != row_bytes){ ok = false; break; }
+
+		uint32_t y = top_down ? i : abs_height - 1 - i;
+		byte * r = &image->image_array[0 * plane + y * width];
+		byte * g = &image->image_array[1 * plane + y * width];
+		byte * b = &image->image_array[2 * plane + y * width];
+
+		if (bpp == 8){
+			for (int32_t x = 0; x < width; x++){
+				const byte * entry = &palette[row[x] * 4];
+				b[x] = entry[0]; g[x] = entry[1]; r[x] = entry[2];
+			}
+		}
+		else{
+			split_channels(row, bpp / 8, b, g, r, width);
+		}
+
+	}
+
+	delete[] row;
+
+	if (!ok){
+		delete_imageinfo(image);
+		return NULL;
+	}
+	return image;
+
+}
+
+static bool save_bmp(image_t * image, FILE * file){
+
+	uint32_t width = image->width;
+	uint32_t height = image->height;
+	uint32_t plane = width * height;
+	uint32_t row_bytes = ((width * 24 + 31) / 32) * 4;
+
+	byte header[BMP_FILE_HEADER + BMP_INFO_HEADER];
+	memset(header, 0, sizeof(header));
+	header[0] = 'B'; header[1] = 'M';
+	write_le32(&header[2], sizeof(header) + row_bytes * height);
+	write_le32(&header[10], sizeof(header));
+	write_le32(&header[14], BMP_INFO_HEADER);
+	write_le32(&header[18], width);
+	write_le32(&header[22], height);
+	write_le16(&header[26], 1);
+	write_le16(&header[28], 24);
+	write_le32(&header[34], row_bytes * height);
+	write_le32(&header[38], 2835); /* 72 dpi */
+	write_le32(&header[42], 2835);
+
+	if (fwrite(header, 1, sizeof(header), file) != sizeof(header)) return false;
+
+	byte * row = new byte[row_bytes];
+	memset(row, 0, row_bytes);
+	bool ok = true;
+	for (uint32_t i = 0; i < height && ok; i++){
+		uint32_t y = height - 1 - i;
+		merge_channels(row, 3, &image->image_array[2 * plane + y * width], &image->image_array[1 * plane + y * width],
+			&image->image_array[0 * plane + y * width], width, 0);
+		ok = fwrite(row, 1, row_bytes, file) == row_bytes;
+	}
+
+	delete[] row;
+	return ok;
+
+}
+
+
+/************************************************************************/
+/*  png - libpng simplified api                                         */
+/************************************************************************/
+
+#ifdef EXALGO_USE_PNG
+
+static image_t * load_png(const char * filename){
+
+	png_image png;
+	memset(&png, 0, sizeof(png));
+	png.version = PNG_IMAGE_VERSION;
+
+	if (!png_image_begin_read_from_file(&png, filename)) return NULL;
+	png.format = PNG_FORMAT_RGB;
+
+	byte * buffer = new byte[PNG_IMAGE_SIZE(png)];
+	if (!png_image_finish_read(&png, NULL, buffer, 0, NULL)){
+		DEBUG_PRINT(("png error - %s\n", png.message), 1);
+		delete[] buffer;
+		png_image_free(&png);
+		return NULL;
+	}
+
+	image_t * image = create_imageinfo(png.width, png.height);
+	update_from_interleaved(image, buffer);
+
+	delete[] buffer;
+	return image;
+
+}
+
+static bool save_png(image_t * image, const char * filename){
+
+	png_image png;
+	memset(&png, 0, sizeof(png));
+	png.version = PNG_IMAGE_VERSION;
+	png.width = image->width;
+	png.height = image->height;
+	png.format = PNG_FORMAT_RGB;
+
+	byte * buffer = get_interleaved_buffer(image);
+	bool ok = png_image_write_to_file(&png, filename, 0, buffer, 0, NULL) != 0;
+	delete[] buffer;
+
+	return ok;
+
+}
+
+#endif
+
+
+/************************************************************************/
+/*  format dispatch                                                     */
+/************************************************************************/
+
+static string get_extension(const char * filename){
+
+	string name(filename);
+	size_t index = name.find_last_of('.');
+	if (index == string::npos) return "";
+
+	string extension = name.substr(index + 1);
+	for (size_t i = 0; i < extension.size(); i++) extension[i] = tolower(extension[i]);
+	return extension;
+
+}
+
+image_t * load_image(const char * filename){
+
+	DEBUG_PRINT(("loading image - %s\n", filename), 3);
+
+	string extension = get_extension(filename);
+	image_t * image = NULL;
+
+	if (extension == "ppm" || extension == "pgm" || extension == "pnm" || extension == "bmp"){
+		FILE * file = fopen(filename, "rb");
+		if (file == NULL){
+			DEBUG_PRINT(("cannot open image - %s\n", filename), 1);
+			return NULL;
+		}
+		image = (extension == "bmp") ? load_bmp(file) : load_pnm(file);
+		fclose(file);
+	}
+#ifdef EXALGO_USE_PNG
+	else if (extension == "png"){
+		image = load_png(filename);
+	}
+#endif
+	else{
+#ifdef _WIN32
+		Gdiplus::Bitmap * bitmap = open_image(filename);
+		if (bitmap != NULL && bitmap->GetLastStatus() == Gdiplus::Ok){
+			image = populate_imageinfo(bitmap);
+		}
+		delete bitmap;
+#else
+		DEBUG_PRINT(("unsupported image type - %s\n", filename), 1);
+#endif
+	}
+
+	if (image == NULL){
+		DEBUG_PRINT(("cannot decode image - %s\n", filename), 1);
+	}
+	else{
+		DEBUG_PRINT(("height - %d, width - %d\n", image->height, image->width), 3);
+	}
+
+	return image;
+
+}
+
+bool save_image(image_t * image, const char * filename){
+
+	string extension = get_extension(filename);
+
+	if (extension == "ppm" || extension == "pgm" || extension == "pnm" || extension == "bmp"){
+		FILE * file = fopen(filename, "wb");
+		if (file == NULL) return false;
+		bool ok = (extension == "bmp") ? save_bmp(image, file) : save_pnm(image, file, extension == "pgm");
+		return (fclose(file) == 0) && ok;
+	}
+#ifdef EXALGO_USE_PNG
+	else if (extension == "png"){
+		return save_png(image, filename);
+	}
+#endif
+
+#ifdef _WIN32
+	Gdiplus::Bitmap * bitmap = create_image(image->width, image->height);
+	update_image_buffer(bitmap, image->image_array);
+	save_image(bitmap, filename);
+	delete bitmap;
+	return true;
+#else
+	DEBUG_PRINT(("unsupported image type - %s\n", filename), 1);
+	return false;
+#endif
+
+}
+
+
+/************************************************************************/
+/*  GDI+                                                                */
+/************************************************************************/
+
+#ifdef _WIN32
 
 ULONG_PTR initialize_image_subsystem(){
 
@@ -28,24 +599,7 @@ void save_image(Gdiplus::Bitmap * image, const char * file){
 	wchar_t * file_wchar = new wchar_t[strlen(file) + 1];;
 	mbstowcs(file_wchar, file, strlen(file) + 1);
 
-	string filename(file);
-
-	string extension = "";
-	int index = -1;
-	for (int i = filename.size() - 1; i >= 0; i--){
-		if (filename[i] == '.'){
-			index = i + 1;
-			break;
-		}
-	}
-
-	if (index != -1){
-
-		for (int i = index; i<filename.size(); i++){
-			extension += filename[i];
-		}
-
-	}
+	string extension = get_extension(file);
 
 	/*image/bmp
 	image/jpeg
@@ -61,10 +615,12 @@ void save_image(Gdiplus::Bitmap * image, const char * file){
 	}
 	else{
 		cout << "error: unknown image type" << endl;
+		delete[] file_wchar;
 		return;
 	}
 
 	image->Save(file_wchar, &clsId);
+	delete[] file_wchar;
 
 }
 
@@ -77,6 +633,7 @@ Gdiplus::Bitmap * open_image(const char * filename){
 	mbstowcs(file_wchar, filename, strlen(filename) + 1);
 
 	Gdiplus::Bitmap *image = Gdiplus::Bitmap::FromFile(file_wchar);
+	delete[] file_wchar;
 
 	return image;
 
@@ -95,6 +652,10 @@ image_t * populate_imageinfo(Gdiplus::Bitmap * image){
 
 	imageinfo->width = image->GetWidth();
 	imageinfo->height = image->GetHeight();
+	imageinfo->colors = 3;
+	imageinfo->bits_per_color = 8;
+	imageinfo->bits_per_pixel = 24;
+	imageinfo->is_alpha = 0;
 	imageinfo->image_array = get_image_buffer(image);
 
 	printf("height - %d, width - %d\n", imageinfo->height, imageinfo->width);
@@ -103,65 +664,57 @@ image_t * populate_imageinfo(Gdiplus::Bitmap * image){
 
 }
 
+/* the bitmap is locked once as 24 bit bgr rows instead of being read through GetPixel */
 byte * get_image_buffer(Gdiplus::Bitmap * image){
 
-	Gdiplus::Status ok;
-
-	byte * buffer = new byte[image->GetHeight() * image->GetWidth() * 3];
-
 	uint32_t height = image->GetHeight();
 	uint32_t width = image->GetWidth();
 	DEBUG_PRINT(("height : %d, width : %d\n", height, width), 3);
-	
-
-	for (int i = 0; i < image->GetWidth(); i++){
-		for (int j = 0; j < image->GetHeight(); j++){
-			Gdiplus::Color color;
-			ok = image->GetPixel(i, j, &color);
-			
-			if (ok != 0){
-				std::cout << "error" << std::endl;
-				exit(-1);
-			}
-			else{
 
-				buffer[(0 * height + j)*width + i] = color.GetR();
-				buffer[(1 * height + j)*width + i] = color.GetG();
-				buffer[(2 * height + j)*width + i] = color.GetB();
+	byte * buffer = new byte[height * width * 3];
 
-			}
+	Gdiplus::Rect rect(0, 0, width, height);
+	Gdiplus::BitmapData data;
+	Gdiplus::Status ok = image->LockBits(&rect, Gdiplus::ImageLockModeRead, PixelFormat24bppRGB, &data);
+	if (ok != Gdiplus::Ok){
+		std::cout << "error" << std::endl;
+		exit(-1);
+	}
 
-		}
+	for (uint32_t j = 0; j < height; j++){
+		const byte * row = (const byte *)data.Scan0 + (INT_PTR)j * data.Stride;
+		split_channels(row, 3, &buffer[(2 * height + j)*width], &buffer[(1 * height + j)*width],
+			&buffer[(0 * height + j)*width], width);
 	}
 
+	image->UnlockBits(&data);
+
 	return buffer;
 
 }
 
 void update_image_buffer(Gdiplus::Bitmap * image, byte * buffer){
 
-	/* update the bitmap image*/
+	/* update the bitmap image - opaque 32 bit bgra rows written through a single lock */
 	uint32_t height = image->GetHeight();
 	uint32_t width = image->GetWidth();
 
-	for (int i = 0; i < image->GetWidth(); i++){
-		for (int j = 0; j < image->GetHeight(); j++){
-			Gdiplus::Color color;
-			Gdiplus::ARGB value = 0;
-
-			value |= ((uint32_t)255) << 24;   /*create opaque images*/
-			value |= (((uint32_t)buffer[(0 * height + j)*width + i]) << 16);
-			value |= (((uint32_t)buffer[(1 * height + j)*width + i]) << 8);
-			value |= (((uint32_t)buffer[(2 * height + j)*width + i]));
-
-			color.SetValue(value);
-
-			image->SetPixel(i, j, color);
-
+	Gdiplus::Rect rect(0, 0, width, height);
+	Gdiplus::BitmapData data;
+	Gdiplus::Status ok = image->LockBits(&rect, Gdiplus::ImageLockModeWrite, PixelFormat32bppARGB, &data);
+	if (ok != Gdiplus::Ok){
+		std::cout << "error" << std::endl;
+		exit(-1);
+	}
 
-		}
+	for (uint32_t j = 0; j < height; j++){
+		byte * row = (byte *)data.Scan0 + (INT_PTR)j * data.Stride;
+		merge_channels(row, 4, &buffer[(2 * height + j)*width], &buffer[(1 * height + j)*width],
+			&buffer[(0 * height + j)*width], width, 255);
 	}
 
+	image->UnlockBits(&data);
+
 }
 
 int GetEncoderClsid(const WCHAR* format, CLSID* pClsid)
@@ -190,12 +743,13 @@ int GetEncoderClsid(const WCHAR* format, CLSID* pClsid)
 	return 0;
 }
 
+#else
 
+ULONG_PTR initialize_image_subsystem(){
+	return 0;
+}
 
+void shutdown_image_subsystem(ULONG_PTR token){
+}
 
-
-
-
-
-
-
+#endif
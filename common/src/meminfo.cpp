@@ -9,6 +9,7 @@
 #include "utilities.h"
 #include <algorithm>
 #include <set>
+#include <climits>
 
 
 using namespace std;
@@ -435,7 +436,7 @@ void link_mem_regions_dim(vector<pc_mem_region_t *> &pc_mems, uint32_t mode){
 	for (int i = 0; i < pc_mems.size(); i++){
 
 		if (mode == DYNAMIC_PROG){
-			link_mem_regions(pc_mems[i]->regions, pc_mems[i]->pc);
+			link_mem_regions_dp_dim(pc_mems[i]->regions, pc_mems[i]->pc);
 		}
 		else if (mode == GREEDY){
 			link_mem_regions_greedy_dim(pc_mems[i]->regions, pc_mems[i]->pc);
@@ -936,6 +937,203 @@ bool link_mem_regions_greedy_dim(vector<mem_info_t *> &mem, uint32_t app_pc){
 }
 
 
+/*
+optimal counterpart of link_mem_regions_greedy_dim. the regions (sorted by start) are partitioned into runs of
+consecutive regions; a run of at least three regions with a common start to start pitch becomes a linked region
+(one more dimension), anything else stays as it is. the interior rows have the size and dimensions of the run's
+reference row (the second); the first and last rows may be smaller (cut by padding) and are widened to it. a run is
+scored as the rows it links beyond the first two minus its disagreement with the reference row
+
+ - contiguity	: an edge row of another size costs LINK_EDGE_WEIGHT
+ - stride		: rows accessed with another most probable element stride (interleaved channels)
+ - accesses	: relative difference of the number of accesses to the reference's, at most 1 a row
+
+the best partition is a dp over the run ends, best[j] = max(best[j - 1], best[i - 1] + score(i, j)). the score of
+(i, j) is memoized from (i, j - 1) so that all the O(n^2) intervals are scored in O(n^2); a run stops growing at the
+first row off the pitch. linking is repeated on the linked regions for the higher dimensions as in the greedy one
+*/
+
+#define LINK_EDGE_WEIGHT	0.25
+
+struct link_run_t {
+	int64_t pitch;
+	uint64_t size;			/* of the reference row */
+	uint32_t dims;			/* of the reference row */
+	uint32_t stride;
+	double accesses;
+	double interior_cost;	/* rows i + 1 .. j - 1 */
+};
+
+static double get_mem_accesses(mem_info_t * mem){
+
+	double accesses = 0;
+	for (int i = 0; i < mem->stride_freqs.size(); i++){
+		accesses += mem->stride_freqs[i].second;
+	}
+	return accesses;
+
+}
+
+static double get_link_row_cost(link_run_t * run, mem_info_t * row){
+
+	double cost = 0;
+	if (row->end - row->start != run->size) cost += 1;
+	if (row->prob_stride != run->stride) cost += 1;
+	if (run->accesses > 0){
+		double diff = get_mem_accesses(row) - run->accesses;
+		cost += min(1.0, (diff < 0 ? -diff : diff) / run->accesses);
+	}
+	return cost;
+
+}
+
+/* an edge row is widened to the reference row, never cut; a linked region is not, its rows would not cover it */
+static bool is_link_edge(link_run_t * run, mem_info_t * row){
+
+	uint64_t size = row->end - row->start;
+	if (get_number_dimensions(row) != run->dims || size > run->size) return false;
+	return size == run->size || row->mem_infos.empty();
+
+}
+
+static double get_link_run_score(link_run_t * run, vector<mem_info_t *> &mem, int first, int last){
+
+	double edges = LINK_EDGE_WEIGHT * (get_link_row_cost(run, mem[first]) + get_link_row_cost(run, mem[last]));
+	return (last - first - 1) - run->interior_cost - edges;
+
+}
+
+static mem_info_t * link_mem_run(vector<mem_info_t *> &mem, int first, int last, int64_t pitch){
+
+	mem_info_t * new_mem_info = new mem_info_t;
+	mem_info_t * reference = mem[first + 1];
+
+	new_mem_info->direction = mem[first]->direction;
+	new_mem_info->prob_stride = mem[first]->prob_stride;
+	new_mem_info->type = mem[first]->type;
+	new_mem_info->stride_freqs = mem[first]->stride_freqs;
+	new_mem_info->padding_merge = false;
+	new_mem_info->start = mem[first]->start;
+	new_mem_info->end = mem[last]->start + pitch;
+	new_mem_info->order = INT_MAX;
+
+	for (int i = first; i <= last; i++){
+		/* edge rows cut by padding are widened to the reference row so that the extents are read off any row */
+		if (mem[i]->end - mem[i]->start < reference->end - reference->start){
+			ASSERT_MSG((i == first || i == last) && mem[i]->mem_infos.empty(), ("ERROR: only unlinked edge rows are widened\n"));
+			mem[i]->end = mem[i]->start + (reference->end - reference->start);
+			new_mem_info->padding_merge = true;
+		}
+		new_mem_info->mem_infos.push_back(mem[i]);
+		if (i != first) merge_info_to_first(new_mem_info, mem[i]);
+		if (new_mem_info->order > mem[i]->order) new_mem_info->order = mem[i]->order;
+	}
+
+	return new_mem_info;
+
+}
+
+/* one level of linking; true if any run was linked */
+static bool link_mem_regions_dp_level(vector<mem_info_t *> &mem, uint32_t app_pc){
+
+	int n = mem.size();
+	if (n < 3) return false;
+
+	/* best[i + 1] - score of the best partition of mem[0 .. i]; from[i + 1] - start of its last run */
+	vector<double> best(n + 1, 0);
+	vector<int> from(n + 1);
+	vector<int64_t> pitches(n + 1, 0);
+	for (int i = 0; i <= n; i++) from[i] = i - 1;
+
+	for (int i = 0; i < n; i++){
+
+		/* mem[i] alone */
+		if (best[i] >= best[i + 1]){
+			best[i + 1] = best[i];
+			from[i + 1] = i;
+		}
+
+		if (i + 2 >= n) continue;
+
+		link_run_t run;
+		run.pitch = (int64_t)mem[i + 1]->start - (int64_t)mem[i]->start;
+		run.size = mem[i + 1]->end - mem[i + 1]->start;
+		run.stride = mem[i + 1]->prob_stride;
+		run.dims = get_number_dimensions(mem[i + 1]);
+		run.accesses = get_mem_accesses(mem[i + 1]);
+		run.interior_cost = 0;
+
+		if (mem[i]->type != mem[i + 1]->type || mem[i]->end > mem[i + 1]->start) continue;
+		if (!is_link_edge(&run, mem[i])) continue;
+
+		for (int j = i + 2; j < n; j++){
+
+			/* the run is extended by mem[j]; rows never overlap and keep to the pitch */
+			if (mem[j]->type != mem[i]->type) break;
+			if ((int64_t)mem[j]->start - (int64_t)mem[j - 1]->start != run.pitch) break;
+			if (mem[j - 1]->end > mem[j]->start) break;
+			/* a row that cannot be an edge cannot be an interior row either */
+			if (!is_link_edge(&run, mem[j])) break;
+			if (mem[j]->end - mem[j]->start < run.size && j + 1 < n && mem[j + 1]->start < mem[j]->start + run.size) break;
+			if (j - 1 > i + 1){
+				if (mem[j - 1]->end - mem[j - 1]->start != run.size) break;
+				run.interior_cost += get_link_row_cost(&run, mem[j - 1]);
+			}
+
+			double score = best[i] + get_link_run_score(&run, mem, i, j);
+			if (score > best[j + 1]){
+				best[j + 1] = score;
+				from[j + 1] = i;
+				pitches[j + 1] = run.pitch;
+			}
+
+		}
+	}
+
+	if (best[n] <= 0) return false;
+
+	/* rebuild from the back so that the indexes of the earlier runs stay valid */
+	for (int j = n; j > 0; j = from[j]){
+
+		int first = from[j];
+		int last = j - 1;
+		if (last - first < 2) continue;
+
+		mem_info_t * linked = link_mem_run(mem, first, last, pitches[j]);
+		mem.erase(mem.begin() + first, mem.begin() + last + 1);
+		mem.insert(mem.begin() + first, linked);
+
+		DEBUG_PRINT(("app_pc %x linked indexes from %d to %d\n", app_pc, first, last), 5);
+		LOG(log_file, "linked infos" << endl);
+		LOG(log_file, linked->start << "  " << linked->end << endl);
+		LOG(log_file, "dims : " << get_number_dimensions(linked) << endl);
+		LOG(log_file, "merged amount : " << linked->mem_infos.size() << endl);
+
+	}
+
+	return true;
+
+}
+
+bool link_mem_regions_dp_dim(vector<mem_info_t *> &mem, uint32_t app_pc){
+
+	DEBUG_PRINT(("link_mem_regions_dp...\n"), 2);
+	LOG(log_file, "link_mem_regions_dp....\n");
+
+	sort(mem.begin(), mem.end(), compare_mem_regions);
+
+	bool linked = false;
+	while (link_mem_regions_dp_level(mem, app_pc)){
+		linked = true;
+	}
+
+	DEBUG_PRINT(("link_mem_regions_dp - done\n"), 2);
+
+	return linked;
+
+}
+
+
 bool link_mem_regions_greedy(vector<mem_info_t *> &mem, uint32_t app_pc){
 	
 	DEBUG_PRINT(("link_mem_regions_greedy...\n"), 4);
@@ -0,0 +1,101 @@
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <dirent.h>
+#endif
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include "platform.h"
+
+using namespace std;
+
+string join_path(string folder, string file){
+
+	if (folder.empty()) return file;
+
+	char last = folder[folder.size() - 1];
+	if (last == '/' || last == '\\') return folder + file;
+	return folder + PATH_SEPARATOR + file;
+
+}
+
+#ifdef _WIN32
+
+vector<string> get_all_files_in_folder(string folder)
+{
+	vector<string> names;
+	char search_path[200];
+	sprintf(search_path, "%s\\*.*", folder.c_str());
+	WIN32_FIND_DATA fd;
+	HANDLE hFind = ::FindFirstFile(search_path, &fd);
+	if (hFind != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			// read all (real) files in current folder, delete '!' read other 2 default folder . and ..
+			if (!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+			{
+				names.push_back(fd.cFileName);
+			}
+		} while (::FindNextFile(hFind, &fd));
+		::FindClose(hFind);
+	}
+
+
+	return names;
+}
+
+int64_t get_file_size(string filename){
+
+	struct _stat64 buf;
+	if (_stat64(filename.c_str(), &buf) != 0) return -1;
+	return buf.st_size;
+
+}
+
+bool create_folder(string folder){
+
+	if (CreateDirectory(folder.c_str(), NULL)) return true;
+	return GetLastError() == ERROR_ALREADY_EXISTS;
+
+}
+
+#else
+
+vector<string> get_all_files_in_folder(string folder)
+{
+	vector<string> names;
+	DIR * dir = opendir(folder.c_str());
+	if (dir == NULL) return names;
+
+	struct dirent * entry;
+	while ((entry = readdir(dir)) != NULL){
+		/* d_type is not filled in by every file system; fall back to stat */
+		struct stat buf;
+		if (stat(join_path(folder, entry->d_name).c_str(), &buf) == 0 && S_ISREG(buf.st_mode)){
+			names.push_back(entry->d_name);
+		}
+	}
+	closedir(dir);
+
+	return names;
+}
+
+int64_t get_file_size(string filename){
+
+	struct stat buf;
+	if (stat(filename.c_str(), &buf) != 0) return -1;
+	return buf.st_size;
+
+}
+
+bool create_folder(string folder){
+
+	if (mkdir(folder.c_str(), 0755) == 0) return true;
+	struct stat buf;
+	return stat(folder.c_str(), &buf) == 0 && S_ISDIR(buf.st_mode);
+
+}
+
+#endif
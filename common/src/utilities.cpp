@@ -1,4 +1,3 @@
-#include <Windows.h>
 #include <stdio.h>
 #include <sstream>
 #include <assert.h>
@@ -53,30 +52,6 @@ std::vector<cmd_args_t *> get_command_line_args(int argc, char ** argv){
 
 }
 
-vector<string> get_all_files_in_folder(string folder)
-{
-	vector<string> names;
-	char search_path[200];
-	sprintf(search_path, "%s\\*.*", folder.c_str());
-	WIN32_FIND_DATA fd;
-	HANDLE hFind = ::FindFirstFile(search_path, &fd);
-	if (hFind != INVALID_HANDLE_VALUE)
-	{
-		do
-		{
-			// read all (real) files in current folder, delete '!' read other 2 default folder . and ..
-			if (!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
-			{
-				names.push_back(fd.cFileName);
-			}
-		} while (::FindNextFile(hFind, &fd));
-		::FindClose(hFind);
-	}
-
-
-	return names;
-}
-
 string get_standard_folder(string type){
 
 
@@ -289,6 +264,290 @@ void test_linear_solver(){
 
 }
 
+/* exact rational arithmetic for the linear solver. the int64 operations are checked - a result that does not fit
+   is marked with a zero denominator and every rational computed from it stays marked (see rational_overflowed) */
+static bool mul_overflows(int64_t a, int64_t b){
+	if (a == 0 || b == 0) return false;
+	if (a > 0){
+		if (b > 0) return a > INT64_MAX / b;
+		return b < INT64_MIN / a;
+	}
+	if (b > 0) return a < INT64_MIN / b;
+	return b < INT64_MAX / a;
+}
+
+static bool add_overflows(int64_t a, int64_t b){
+	if (b > 0) return a > INT64_MAX - b;
+	return a < INT64_MIN - b;
+}
+
+static rational_t overflowed_rational(){
+	rational_t value;
+	value.num = 1;  /* non zero so that an overflowed entry is never taken for an eliminated one */
+	value.den = 0;
+	return value;
+}
+
+static bool rational_overflowed(rational_t value){
+	return value.den == 0;
+}
+
+static int64_t gcd_int(int64_t a, int64_t b){
+	if (a < 0) a = -a;
+	if (b < 0) b = -b;
+	while (b != 0){
+		int64_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+static rational_t make_rational(int64_t num, int64_t den){
+	rational_t value;
+	/* INT64_MIN cannot be negated */
+	if (den == 0 || num == INT64_MIN || den == INT64_MIN) return overflowed_rational();
+	if (den < 0){ num = -num; den = -den; }
+	int64_t g = gcd_int(num, den);
+	if (g > 1){ num /= g; den /= g; }
+	value.num = num;
+	value.den = (num == 0) ? 1 : den;
+	return value;
+}
+
+static rational_t rational_add(rational_t a, rational_t b){
+	if (rational_overflowed(a) || rational_overflowed(b)) return overflowed_rational();
+	int64_t g = gcd_int(a.den, b.den);
+	int64_t a_scale = b.den / g;
+	int64_t b_scale = a.den / g;
+	if (mul_overflows(a.num, a_scale) || mul_overflows(b.num, b_scale) || mul_overflows(b_scale, b.den)){
+		return overflowed_rational();
+	}
+	if (add_overflows(a.num * a_scale, b.num * b_scale)) return overflowed_rational();
+	return make_rational(a.num * a_scale + b.num * b_scale, b_scale * b.den);
+}
+
+static rational_t rational_sub(rational_t a, rational_t b){
+	if (b.num == INT64_MIN) return overflowed_rational();
+	b.num = -b.num;
+	return rational_add(a, b);
+}
+
+static rational_t rational_mul(rational_t a, rational_t b){
+	if (rational_overflowed(a) || rational_overflowed(b)) return overflowed_rational();
+	int64_t g1 = gcd_int(a.num, b.den);
+	int64_t g2 = gcd_int(b.num, a.den);
+	if (g1 == 0) g1 = 1;
+	if (g2 == 0) g2 = 1;
+	if (mul_overflows(a.num / g1, b.num / g2) || mul_overflows(a.den / g2, b.den / g1)) return overflowed_rational();
+	return make_rational((a.num / g1) * (b.num / g2), (a.den / g2) * (b.den / g1));
+}
+
+static rational_t rational_div(rational_t a, rational_t b){
+	if (rational_overflowed(b)) return overflowed_rational();
+	return rational_mul(a, make_rational(b.den, b.num));
+}
+
+static bool row_overflowed(vector<rational_t> &row){
+	for (int j = 0; j < row.size(); j++){
+		if (rational_overflowed(row[j])) return true;
+	}
+	return false;
+}
+
+static void print_integer_system(vector< vector<int64_t> > &A){
+	for (int i = 0; i < A.size(); i++){
+		for (int j = 0; j < A[i].size(); j++){
+			DEBUG_PRINT(("%lld ", (long long)A[i][j]), 2);
+		}
+		DEBUG_PRINT(("\n"), 2);
+	}
+}
+
+/* selects cols linearly independant rows of A and inverts them exactly; the factorization is reused by every
+   solve on the same system. returns false if A is rank deficient or the exact elimination overflows 64 bits */
+bool factor_linear_system(linear_solver_t * solver, vector< vector<int64_t> > &A){
+
+	solver->A = A;
+	solver->rows = A.size();
+	solver->cols = (A.size() > 0) ? A[0].size() : 0;
+	solver->rank = 0;
+	solver->basis.clear();
+	solver->inverse.clear();
+
+	uint32_t N = solver->cols;
+	if (N == 0) return false;
+
+	/* incremental row echelon form - a row is kept in the basis only if it is not spanned by the earlier ones */
+	vector< vector<rational_t> > echelon;
+	vector<uint32_t> pivots;
+
+	for (int i = 0; i < solver->rows && echelon.size() < N; i++){
+
+		vector<rational_t> row;
+		for (int j = 0; j < N; j++){
+			row.push_back(make_rational(A[i][j], 1));
+		}
+
+		for (int k = 0; k < echelon.size(); k++){
+			rational_t factor = row[pivots[k]];
+			if (factor.num == 0) continue;
+			for (int j = 0; j < N; j++){
+				row[j] = rational_sub(row[j], rational_mul(factor, echelon[k][j]));
+			}
+		}
+
+		if (row_overflowed(row)){
+			DEBUG_PRINT(("WARNING: 64 bit overflow while eliminating row %d\n", i), 2);
+			print_integer_system(A);
+			return false;
+		}
+
+		int pivot = -1;
+		for (int j = 0; j < N; j++){
+			if (row[j].num != 0){ pivot = j; break; }
+		}
+		if (pivot == -1) continue;
+
+		rational_t scale = row[pivot];
+		for (int j = 0; j < N; j++){
+			row[j] = rational_div(row[j], scale);
+		}
+		/* keep the echelon rows reduced so that elimination against them stays independant of the order */
+		for (int k = 0; k < echelon.size(); k++){
+			rational_t factor = echelon[k][pivot];
+			if (factor.num == 0) continue;
+			for (int j = 0; j < N; j++){
+				echelon[k][j] = rational_sub(echelon[k][j], rational_mul(factor, row[j]));
+			}
+			if (row_overflowed(echelon[k])){
+				DEBUG_PRINT(("WARNING: 64 bit overflow while reducing the echelon rows\n"), 2);
+				print_integer_system(A);
+				return false;
+			}
+		}
+
+		echelon.push_back(row);
+		pivots.push_back(pivot);
+		solver->basis.push_back(i);
+	}
+
+	solver->rank = solver->basis.size();
+
+	if (solver->rank < N){
+		DEBUG_PRINT(("WARNING: not enough independent equations (rank %d, unknowns %d)\n", solver->rank, N), 2);
+		print_integer_system(A);
+		return false;
+	}
+
+	/* Gauss-Jordan on [S | I] where S is made of the basis rows */
+	vector< vector<rational_t> > S(N, vector<rational_t>(2 * N, make_rational(0, 1)));
+	for (int i = 0; i < N; i++){
+		for (int j = 0; j < N; j++){
+			S[i][j] = make_rational(A[solver->basis[i]][j], 1);
+		}
+		S[i][N + i] = make_rational(1, 1);
+	}
+
+	for (int p = 0; p < N; p++){
+
+		int pivot = p;
+		while (S[pivot][p].num == 0) pivot++;  /* S is non singular by construction */
+		swap(S[p], S[pivot]);
+
+		rational_t scale = S[p][p];
+		for (int j = 0; j < 2 * N; j++){
+			S[p][j] = rational_div(S[p][j], scale);
+		}
+
+		for (int i = 0; i < N; i++){
+			if (i == p || S[i][p].num == 0) continue;
+			rational_t factor = S[i][p];
+			for (int j = 0; j < 2 * N; j++){
+				S[i][j] = rational_sub(S[i][j], rational_mul(factor, S[p][j]));
+			}
+		}
+	}
+
+	for (int i = 0; i < N; i++){
+		if (row_overflowed(S[i])){
+			DEBUG_PRINT(("WARNING: 64 bit overflow while inverting the system\n"), 2);
+			print_integer_system(A);
+			solver->inverse.clear();
+			return false;
+		}
+		solver->inverse.push_back(vector<rational_t>(S[i].begin() + N, S[i].end()));
+	}
+
+	return true;
+
+}
+
+/* x = S^-1 b_basis ; the solution is accepted only if it is integral, satisfies every equation of the system and
+   is computed without overflowing 64 bits */
+bool solve_linear_system(linear_solver_t * solver, vector<int64_t> &b, vector<int64_t> &x){
+
+	uint32_t N = solver->cols;
+	x.clear();
+
+	if (solver->rank < N || b.size() != solver->rows) return false;
+
+	for (int i = 0; i < N; i++){
+		rational_t sum = make_rational(0, 1);
+		for (int j = 0; j < N; j++){
+			sum = rational_add(sum, rational_mul(solver->inverse[i][j], make_rational(b[solver->basis[j]], 1)));
+		}
+		if (rational_overflowed(sum)){
+			DEBUG_PRINT(("WARNING: 64 bit overflow while solving the system\n"), 2);
+			x.clear();
+			return false;
+		}
+		if (sum.den != 1){
+			DEBUG_PRINT(("WARNING: solution of the system is not integral\n"), 2);
+			x.clear();
+			return false;
+		}
+		x.push_back(sum.num);
+	}
+
+	for (int i = 0; i < solver->rows; i++){
+		int64_t value = 0;
+		for (int j = 0; j < N; j++){
+			if (mul_overflows(solver->A[i][j], x[j]) || add_overflows(value, solver->A[i][j] * x[j])){
+				DEBUG_PRINT(("WARNING: 64 bit overflow while checking equation %d\n", i), 2);
+				x.clear();
+				return false;
+			}
+			value += solver->A[i][j] * x[j];
+		}
+		if (value != b[i]){
+			DEBUG_PRINT(("WARNING: equations are not consistent; system may be non linear\n"), 2);
+			x.clear();
+			return false;
+		}
+	}
+
+	return true;
+
+}
+
+/* solves for all the right hand sides against the same factorization; returns the number of failed systems */
+uint32_t solve_linear_system_batch(linear_solver_t * solver, vector< vector<int64_t> > &b, vector< vector<int64_t> > &x){
+
+	uint32_t failed = 0;
+	x.clear();
+	x.resize(b.size());
+
+	for (int i = 0; i < b.size(); i++){
+		if (!solve_linear_system(solver, b[i], x[i])){
+			failed++;
+		}
+	}
+
+	return failed;
+
+}
+
 void printout_matrices(vector<vector<double> >  values){
 	for (int i = 0; i < values.size(); i++){
 		vector<double> row = values[i];
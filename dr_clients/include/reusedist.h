@@ -0,0 +1,20 @@
+#ifndef _REUSEDIST_EXALGO_H
+#define _REUSEDIST_EXALGO_H
+
+#include "dr_api.h"
+
+/*instrumentation routines*/
+void reusedist_init(client_id_t id, const char * name,
+				const char * arguments);
+void reusedist_exit_event(void);
+dr_emit_flags_t reusedist_bb_instrumentation(void *drcontext, void *tag, instrlist_t *bb,
+				instr_t *instr, bool for_trace, bool translating,
+				void *user_data);
+dr_emit_flags_t
+reusedist_bb_analysis(void *drcontext, void *tag, instrlist_t *bb,
+				bool for_trace, bool translating,
+				OUT void **user_data);
+void reusedist_thread_init(void *drcontext);
+void reusedist_thread_exit(void *drcontext);
+
+#endif
@@ -1,62 +1,398 @@
 #include "dr_api.h"
+#include <string.h>
 #include "moduleinfo.h"
 #include "utilities.h"
+#include "drmgr.h"
 #include "drwrap.h"
-#include "halide_funcs.h"
-//#include <stdio.h>
+#include "funcreplace.h"
 
+/*
+	runtime replacement of a lifted function
 
-/* for each client following functions may be implemented
+	buildex writes a binding manifest (<halide folder>\buildex_<exec>_binding.txt, format in buildex
+	include/halide/binding.h) for the function it lifted - the entry pc, where the function gets its buffers and
+	scalar parameters from (stack argument slots or registers at entry) and the layout of every buffer. the AOT
+	compiled pipelines (halide_out_<n>) are linked into the library named in the manifest which is loaded here.
 
-init_func_t init_func;
-exit_func_t process_exit;
-
-drmgr_analysis_cb_t analysis_bb;
-drmgr_insertion_cb_t instrumentation_bb;
-drmgr_xform_cb_t app2app_bb;
-
-thread_func_t thread_init;
-thread_func_t thread_exit;
+	the function is wrapped at its entry. in replace mode the pipelines are called in order with buffer_t's built from
+	the bindings and the original body is skipped; otherwise the original is only timed. either way the per call time
+	is reported at exit so the two runs give the speedup on the real application.
 
+	the pipelines run on the application thread inside the wrap callback - compile them single threaded
+	(no halide thread pool) as the library is an auxiliary library of the client.
 
+	arguments - <manifest file> <replace 1/0>
 */
 
-static void pre_func_cb(void * wrapcxt, OUT void ** user_data);
+/*************************defines******************************/
+
+#define MAX_PIPELINES		8
+#define MAX_PIPELINE_ARGS	8
+#define MAX_DIMENSIONS		4
+
+#define BINDING_NONE		0
+#define BINDING_ARG			1
+#define BINDING_REG			2
+
+/************************typedefs***********************************/
+
+/* layout of the (legacy) halide buffer_t the AOT pipelines take */
+typedef struct _lifted_buffer_t {
+	uint64 dev;
+	byte * host;
+	int extent[MAX_DIMENSIONS];
+	int stride[MAX_DIMENSIONS];
+	int min[MAX_DIMENSIONS];
+	int elem_size;
+	unsigned char host_dirty;
+	unsigned char dev_dirty;
+} lifted_buffer_t;
+
+typedef int (*lifted_func_t)();
+
+typedef struct _arg_binding_t {
+	bool is_buffer;
+	uint location;
+	reg_id_t reg;
+	uint slot;
+	int offset;
+	int elem_size;
+	uint dims;
+	int min[MAX_DIMENSIONS];
+	int extent[MAX_DIMENSIONS];
+	int stride[MAX_DIMENSIONS];
+} arg_binding_t;
+
+typedef struct _pipeline_t {
+	char symbol[MAX_STRING_LENGTH];
+	lifted_func_t func;
+	uint num_args;
+	arg_binding_t args[MAX_PIPELINE_ARGS];
+} pipeline_t;
+
+typedef struct _binding_t {
+	char module[MAX_STRING_LENGTH];
+	uint entry_pc;
+	uint ret_pop;
+	char library[MAX_STRING_LENGTH];
+	dr_auxlib_handle_t lib;
+	uint num_pipelines;
+	pipeline_t pipelines[MAX_PIPELINES];
+	bool replace; /* every argument is bound and every pipeline was found */
+	bool wrapped;
+
+	/* per call statistics (microseconds) */
+	uint64 calls;
+	uint64 total_time;
+	uint64 max_time;
+} binding_t;
 
 typedef struct _client_arg_t{
-	char filter_filename[MAX_STRING_LENGTH];
-	uint filter_mode;
+	char manifest_filename[MAX_STRING_LENGTH];
+	uint replace;
 } client_arg_t;
 
 typedef struct {
-	file_t  logfile;
-	file_t  outfile;
+	uint64 call_start; /* entry time of the timed original */
 } per_thread_t;
 
+/***************************global variables**********************/
+
 static client_arg_t * client_arg;
-static module_t * head;
+static binding_t * binding;
+static void * stats_mutex;
 static int tls_index;
 
 static file_t logfile;
 static char ins_pass_name[MAX_STRING_LENGTH];
-static app_pc code_cache;
 
-static void code_cache_init(void);
-static void code_cache_exit(void);
+/*************************** manifest parsing *********************/
+
+static reg_id_t get_reg_from_name(const char * name){
+
+	if (strcmp(name, "xax") == 0) return DR_REG_XAX;
+	if (strcmp(name, "xbx") == 0) return DR_REG_XBX;
+	if (strcmp(name, "xcx") == 0) return DR_REG_XCX;
+	if (strcmp(name, "xdx") == 0) return DR_REG_XDX;
+	if (strcmp(name, "xsi") == 0) return DR_REG_XSI;
+	if (strcmp(name, "xdi") == 0) return DR_REG_XDI;
+	if (strcmp(name, "xbp") == 0) return DR_REG_XBP;
+	return DR_REG_NULL;
+
+}
+
+/* "arg <slot>", "reg <name>" or "none 0" */
+static bool parse_location(arg_binding_t * arg, const char * kind, const char * where){
+
+	if (strcmp(kind, "arg") == 0){
+		arg->location = BINDING_ARG;
+		return dr_sscanf(where, "%u", &arg->slot) == 1;
+	}
+	else if (strcmp(kind, "reg") == 0){
+		arg->location = BINDING_REG;
+		arg->reg = get_reg_from_name(where);
+		return arg->reg != DR_REG_NULL;
+	}
+	arg->location = BINDING_NONE;
+	return true;
+
+}
+
+static char * next_token(char * line, char * token){
+
+	if (line == NULL) return NULL;
+	while (*line == ' ' || *line == '\t') line++;
+	return dr_get_token(line, token, MAX_STRING_LENGTH);
+
+}
+
+static bool parse_buffer(char * line, arg_binding_t * arg){
+
+	char token[MAX_STRING_LENGTH];
+	char kind[MAX_STRING_LENGTH];
+	char where[MAX_STRING_LENGTH];
+	uint i;
+
+	arg->is_buffer = true;
+	line = next_token(line, token); /* name */
+	line = next_token(line, kind);
+	line = next_token(line, where);
+	if (line == NULL || !parse_location(arg, kind, where)) return false;
+
+	if (dr_sscanf(line, "%d %d %u", &arg->offset, &arg->elem_size, &arg->dims) != 3) return false;
+	if (arg->dims > MAX_DIMENSIONS) return false;
+	for (i = 0; i < 3; i++) line = next_token(line, token);
+
+	for (i = 0; i < arg->dims; i++){
+		if (dr_sscanf(line, "%d %d %d", &arg->min[i], &arg->extent[i], &arg->stride[i]) != 3) return false;
+		line = next_token(line, token);
+		line = next_token(line, token);
+		line = next_token(line, token);
+	}
+	return true;
+
+}
+
+static bool parse_param(char * line, arg_binding_t * arg){
+
+	char kind[MAX_STRING_LENGTH];
+	char where[MAX_STRING_LENGTH];
+
+	arg->is_buffer = false;
+	line = next_token(line, kind);
+	line = next_token(line, where);
+	return line != NULL && parse_location(arg, kind, where);
+
+}
+
+static bool read_manifest(const char * filename, binding_t * bind){
+
+	file_t file;
+	uint64 file_size;
+	size_t size;
+	char * text;
+	char * line;
+	char token[MAX_STRING_LENGTH];
+	pipeline_t * pipeline = NULL;
+	bool ok = true;
+
+	file = dr_open_file(filename, DR_FILE_READ);
+	if (file == INVALID_FILE) return false;
+
+	if (!dr_file_size(file, &file_size)){
+		dr_close_file(file);
+		return false;
+	}
+
+	/* read as a terminated string; dr_get_token and dr_sscanf do not know about line ends so empty lines are skipped */
+	size = (size_t)file_size;
+	text = (char *)dr_global_alloc(size + 1);
+	size = dr_read_file(file, text, size);
+	text[size] = '\0';
+	dr_close_file(file);
+
+	for (line = text; ok && line != NULL && *line != '\0'; line = strchr(line, '\n'), line = (line == NULL) ? NULL : line + 1){
+
+		char * rest;
+		if (*line == '\n' || *line == '\r') continue;
+		rest = next_token(line, token);
+		if (rest == NULL || token[0] == '#') continue;
+
+		if (strcmp(token, "function") == 0){
+			rest = next_token(rest, bind->module);
+			ok = dr_sscanf(rest, "%u %u", &bind->entry_pc, &bind->ret_pop) == 2;
+			rest = next_token(rest, token);
+			rest = next_token(rest, token);
+			rest = next_token(rest, bind->library);
+			ok = ok && rest != NULL;
+		}
+		else if (strcmp(token, "pipeline") == 0){
+			ok = bind->num_pipelines < MAX_PIPELINES;
+			if (ok){
+				pipeline = &bind->pipelines[bind->num_pipelines++];
+				rest = next_token(rest, pipeline->symbol);
+				pipeline->num_args = 0;
+			}
+		}
+		else if (strcmp(token, "param") == 0 || strcmp(token, "buffer") == 0){
+			ok = pipeline != NULL && pipeline->num_args < MAX_PIPELINE_ARGS;
+			if (ok){
+				arg_binding_t * arg = &pipeline->args[pipeline->num_args++];
+				ok = (token[0] == 'p') ? parse_param(rest, arg) : parse_buffer(rest, arg);
+			}
+		}
+		else if (strcmp(token, "end") == 0){
+			break;
+		}
+	}
+
+	dr_global_free(text, (size_t)file_size + 1);
+	return ok && bind->num_pipelines > 0;
+
+}
+
+/* loads the lifted library; the function is only replaced when every pipeline is there and every argument is bound */
+static void load_pipelines(binding_t * bind){
+
+	uint i, j;
+
+	bind->replace = false;
+	bind->lib = dr_load_aux_library(bind->library, NULL, NULL);
+	if (bind->lib == NULL){
+		dr_printf("%s - cannot load %s; the original is only timed\n", ins_pass_name, bind->library);
+		return;
+	}
+
+	for (i = 0; i < bind->num_pipelines; i++){
+		pipeline_t * pipeline = &bind->pipelines[i];
+		pipeline->func = (lifted_func_t)dr_lookup_aux_library_routine(bind->lib, pipeline->symbol);
+		if (pipeline->func == NULL){
+			dr_printf("%s - %s not found in %s\n", ins_pass_name, pipeline->symbol, bind->library);
+			return;
+		}
+		for (j = 0; j < pipeline->num_args; j++){
+			if (pipeline->args[j].location == BINDING_NONE){
+				dr_printf("%s - argument %u of %s is not bound\n", ins_pass_name, j, pipeline->symbol);
+				return;
+			}
+		}
+	}
+
+	bind->replace = true;
+
+}
+
+/*************************** calling the pipelines *****************/
+
+static ptr_uint_t get_bound_value(void * wrapcxt, arg_binding_t * arg){
+
+	if (arg->location == BINDING_ARG){
+		return (ptr_uint_t)drwrap_get_arg(wrapcxt, arg->slot);
+	}
+	else{
+		dr_mcontext_t * mc = drwrap_get_mcontext(wrapcxt);
+		return reg_get_value(arg->reg, mc);
+	}
+
+}
+
+static void setup_buffer(lifted_buffer_t * buf, arg_binding_t * arg, ptr_uint_t pointer){
+
+	uint i;
+
+	memset(buf, 0, sizeof(lifted_buffer_t));
+	buf->host = (byte *)(pointer + arg->offset);
+	buf->elem_size = arg->elem_size;
+	for (i = 0; i < arg->dims; i++){
+		buf->min[i] = arg->min[i];
+		buf->extent[i] = arg->extent[i];
+		buf->stride[i] = arg->stride[i];
+	}
+
+}
+
+static int call_pipeline(pipeline_t * pipeline, ptr_uint_t * a){
+
+	lifted_func_t f = pipeline->func;
+
+	switch (pipeline->num_args){
+	case 1: return f(a[0]);
+	case 2: return f(a[0], a[1]);
+	case 3: return f(a[0], a[1], a[2]);
+	case 4: return f(a[0], a[1], a[2], a[3]);
+	case 5: return f(a[0], a[1], a[2], a[3], a[4]);
+	case 6: return f(a[0], a[1], a[2], a[3], a[4], a[5]);
+	case 7: return f(a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+	case 8: return f(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+	default: return -1;
+	}
+
+}
+
+static void update_stats(binding_t * bind, uint64 elapsed){
+
+	dr_mutex_lock(stats_mutex);
+	bind->calls++;
+	bind->total_time += elapsed;
+	if (elapsed > bind->max_time) bind->max_time = elapsed;
+	dr_mutex_unlock(stats_mutex);
+
+}
+
+static void pre_func_replace(void * wrapcxt, OUT void ** user_data){
+
+	binding_t * bind = (binding_t *)*user_data;
+	lifted_buffer_t buffers[MAX_PIPELINE_ARGS];
+	ptr_uint_t args[MAX_PIPELINE_ARGS];
+	uint64 start;
+	uint i, j;
+
+	if (!bind->replace){
+		per_thread_t * data = drmgr_get_tls_field(drwrap_get_drcontext(wrapcxt), tls_index);
+		data->call_start = dr_get_microseconds();
+		return;
+	}
+
+	start = dr_get_microseconds();
+	for (i = 0; i < bind->num_pipelines; i++){
+		pipeline_t * pipeline = &bind->pipelines[i];
+		for (j = 0; j < pipeline->num_args; j++){
+			ptr_uint_t value = get_bound_value(wrapcxt, &pipeline->args[j]);
+			if (pipeline->args[j].is_buffer){
+				setup_buffer(&buffers[j], &pipeline->args[j], value);
+				args[j] = (ptr_uint_t)&buffers[j];
+			}
+			else{
+				args[j] = value;
+			}
+		}
+		if (call_pipeline(pipeline, args) != 0){
+			dr_printf("%s - %s returned an error\n", ins_pass_name, pipeline->symbol);
+		}
+	}
+	update_stats(bind, dr_get_microseconds() - start);
 
+	drwrap_skip_call(wrapcxt, NULL, bind->ret_pop);
+
+}
 
-int amount_exec = 0;
-int amount_inner = 0;
-int amount_val = 0;
+static void post_func_replace(void * wrapcxt, void * user_data){
 
+	binding_t * bind = (binding_t *)user_data;
+	per_thread_t * data = drmgr_get_tls_field(drwrap_get_drcontext(wrapcxt), tls_index);
 
+	update_stats(bind, dr_get_microseconds() - data->call_start);
+
+}
+
+/*************************** client callbacks **********************/
 
 static bool parse_commandline_args(const char * args) {
 
 	client_arg = (client_arg_t *)dr_global_alloc(sizeof(client_arg_t));
 
-	if (dr_sscanf(args, "%s %d", &client_arg->filter_filename,
-		&client_arg->filter_mode) != 2){
+	if (dr_sscanf(args, "%s %u", &client_arg->manifest_filename,
+		&client_arg->replace) != 2){
 		return false;
 	}
 
@@ -69,39 +405,55 @@ void funcreplace_init(client_id_t id, const char * name, const char * arguments)
 {
 
 	char logfilename[MAX_STRING_LENGTH];
-	file_t in_file;
 
 	drmgr_init();
 	drwrap_init();
 	tls_index = drmgr_register_tls_field();
 	DR_ASSERT(parse_commandline_args(arguments) == true);
-	head = md_initialize();
+	strncpy(ins_pass_name, name, MAX_STRING_LENGTH);
+
+	stats_mutex = dr_mutex_create();
+	binding = (binding_t *)dr_global_alloc(sizeof(binding_t));
+	memset(binding, 0, sizeof(binding_t));
+	DR_ASSERT_MSG(read_manifest(client_arg->manifest_filename, binding), "cannot read the binding manifest");
 
-	if (client_arg->filter_mode != FILTER_NONE){
-		in_file = dr_open_file(client_arg->filter_filename, DR_FILE_READ);
-		md_read_from_file(head, in_file, false);
-		dr_close_file(in_file);
+	if (client_arg->replace){
+		load_pipelines(binding);
 	}
 
 	if (log_mode){
 		populate_conv_filename(logfilename, logdir, name, NULL);
 		logfile = dr_open_file(logfilename, DR_FILE_WRITE_OVERWRITE);
 	}
-	strncpy(ins_pass_name, name, MAX_STRING_LENGTH);
-	code_cache_init();
 
 }
 
 void funcreplace_exit_event(void)
 {
 
-	md_delete_list(head, false);
-	code_cache_exit();
-	dr_global_free(client_arg, sizeof(client_arg_t));
-	drmgr_unregister_tls_field(tls_index);
+	uint64 average = (binding->calls > 0) ? binding->total_time / binding->calls : 0;
+
+	dr_printf("%s - %s %s+%u : %llu calls, total %llu us, average %llu us, max %llu us\n", ins_pass_name,
+		binding->replace ? "lifted" : "original", binding->module, binding->entry_pc,
+		binding->calls, binding->total_time, average, binding->max_time);
+	if (!binding->wrapped){
+		dr_printf("%s - %s was never loaded; nothing was wrapped\n", ins_pass_name, binding->module);
+	}
+
 	if (log_mode){
+		dr_fprintf(logfile, "mode %s\nfunction %s %u\ncalls %llu\ntotal_us %llu\naverage_us %llu\nmax_us %llu\n",
+			binding->replace ? "lifted" : "original", binding->module, binding->entry_pc,
+			binding->calls, binding->total_time, average, binding->max_time);
 		dr_close_file(logfile);
 	}
+
+	if (binding->lib != NULL){
+		dr_unload_aux_library(binding->lib);
+	}
+	dr_global_free(binding, sizeof(binding_t));
+	dr_mutex_destroy(stats_mutex);
+	dr_global_free(client_arg, sizeof(client_arg_t));
+	drmgr_unregister_tls_field(tls_index);
 	drwrap_exit();
 	drmgr_exit();
 
@@ -113,6 +465,7 @@ void funcreplace_thread_init(void *drcontext){
 
 	DEBUG_PRINT("%s - initializing thread %d\n", ins_pass_name, dr_get_thread_id(drcontext));
 	data = dr_thread_alloc(drcontext, sizeof(per_thread_t));
+	data->call_start = 0;
 	drmgr_set_tls_field(drcontext, tls_index, data);
 
 }
@@ -153,220 +506,20 @@ bool for_trace, bool translating)
 	return DR_EMIT_DEFAULT;
 }
 
-void clean_call_halide(){
-
-	int x = 2 + 3;
-	
-	//printf("charith\n");
-	//dr_switch_to_app_state(dr_get_current_drcontext());
-	do_nothing_halide();
-	//dr_switch_to_dr_state(dr_get_current_drcontext());
-	//dr_printf("clean_call_halide\n");
-	/*do_blur_test();
-	dr_printf("clean_call_halide\n");
-	drwrap_replace_native_fini(dr_get_current_drcontext());*/
-
-}
-
-static void pre_func_cb_2(void * wrapcxt, OUT void ** user_data){
-
-	//width and height eax and ecx -> previous function
-	//input  - 0x08
-	//output - 0x0c
-
-
-	uint input;
-	uint output;
-	uint width;
-	uint height;
-	uint other;
-	uint other_2;
-	unsigned char * values;
-	unsigned char * read_back;
-	uint written, read;
-	uint ok;
-	int i = 0;
-	int j = 0;
-
-	char filename[MAX_STRING_LENGTH];
-	char amount_exec_string[MAX_STRING_LENGTH];
-	file_t dump_file;
-
-	amount_exec++;
-	input = drwrap_get_arg(wrapcxt, 0);
-	output = drwrap_get_arg(wrapcxt, 1);
-	height = drwrap_get_arg(wrapcxt, 2); //120 - height
-	width = drwrap_get_arg(wrapcxt, 3);  //144 - width
-	other = drwrap_get_arg(wrapcxt, 4); 
-	other_2 = drwrap_get_arg(wrapcxt, 5);  
-
-	dr_printf("%d - input - %x, output - %x, %d, %d\n", amount_exec, input, output, width, height);
-
-	if (other != other_2){
-		dr_printf("not similar\n");
-	}
-
-	values = dr_global_alloc(sizeof(unsigned char) * other * height);
-	read_back = dr_global_alloc(sizeof(unsigned char) * other * height);
-
-	//do_func_test(width, height, input, output);
-
-	//ok = dr_safe_read(input, other * height, values, &read);
-	//dr_printf("%u %u read\n", ok, read);
-
-	/*dr_snprintf(amount_exec_string, MAX_STRING_LENGTH, "%d", amount_exec++);
-	populate_conv_filename(filename, logdir, ins_pass_name, amount_exec_string);
-	dump_file = dr_open_file(filename, DR_FILE_WRITE_OVERWRITE);
-	dr_write_file(dump_file, values, width * height);
-	dr_close_file(dump_file);*/
-
-	do_blur_test(other, height, input, output);
-	//dr_printf("%d,%d,%d\n", i, j, j*height + i);
-	//for (i = 0; i < 10; i++){
-	
-	
-	/*for (j = 0; j < height; j++){
-		for (i = 0; i < width; i++){
-			values[j * other + i] = 255 - values[j * other + i];
-		}
-	}*/
-	
-	//dr_printf("updating done\n");
-	//dr_safe_write(output, other * height, values, &read);
-	
-	//dr_printf("writing done\n");
-
-	//ok = dr_safe_read(output, other * height, read_back, &read);
-	//dr_printf("%u %u read\n", ok, read);
-	dr_global_free(values, other * height);
-	dr_global_free(read_back, other * height);
-
-	drwrap_skip_call(wrapcxt, 0, 0);
-	
-
-
-}
-
-static void pre_func_cb_3(void * wrapcxt, OUT void ** user_data){
-	//amount_val++;
-	//dr_printf("%d\n", amount_val);
-}
-
-static void pre_func_cb(void * wrapcxt, OUT void ** user_data){
-	
-
-	dr_mcontext_t mc = { sizeof(mc), DR_MC_ALL };
-	uint eax;
-	uint other_reg;
-	int i = 0;
-	int j = 0;
-	uint written, read;
-	uint ok;
-	uint count = 0;
-	uint arg = 0;
-	unsigned char * values;
-
-	//ecx - full size of the image
-	//0x08 - input image
-	//eax - output image
-
-	dr_printf("pre_func_cb pre\n");
-	arg = drwrap_get_arg(wrapcxt, 0);
-	dr_printf("input - %x\n", arg);
-
-	dr_get_mcontext(dr_get_current_drcontext(), &mc);
-	eax = reg_get_value(DR_REG_EAX, &mc);
-	dr_printf("output - %x\n", eax);
-	other_reg = reg_get_value(DR_REG_ECX, &mc);
-	dr_printf("ecx - %u\n", other_reg);
-	dr_printf("%d - inner\n", ++amount_inner);
-
-	values = dr_global_alloc(sizeof(unsigned char) * other_reg);
-
-	dr_safe_read(arg, other_reg, values, &read);
-
-	for (i = 0; i < other_reg; i++){
-		values[i] = 255 - values[i];
-	}
-
-	dr_safe_write(eax, other_reg, values, &read);
-
-	drwrap_skip_call(wrapcxt, 0, 0);
-
-}
-
-
-static void
-code_cache_init(void)
-{
-	void         *drcontext;
-	instrlist_t  *ilist;
-	instr_t      *where;
-	instr_t		 *mov;
-	instr_t		 *ret;
-	byte         *end;
-
-	drcontext = dr_get_current_drcontext();
-	code_cache = dr_nonheap_alloc(PAGE_SIZE,
-		DR_MEMPROT_READ |
-		DR_MEMPROT_WRITE |
-		DR_MEMPROT_EXEC);
-	ilist = instrlist_create(drcontext);
-	
-	where = INSTR_CREATE_push(drcontext,opnd_create_reg(DR_REG_XBP));
-	instrlist_meta_append(ilist, where);
-	mov = INSTR_CREATE_mov_st(drcontext, opnd_create_reg(DR_REG_XSP), opnd_create_reg(DR_REG_XBP));
-	instrlist_meta_append(ilist, mov);
-	ret = INSTR_CREATE_ret(drcontext);
-	instrlist_meta_append(ilist, ret);
-	dr_insert_clean_call(drcontext, ilist, ret, (void *)clean_call_halide, false, 0);
-	
-	/* Encodes the instructions into memory and then cleans up. */
-	end = instrlist_encode(drcontext, ilist, code_cache, false);
-	DR_ASSERT((end - code_cache) < PAGE_SIZE);
-	instrlist_clear_and_destroy(drcontext, ilist);
-	/* set the memory as just +rx now */
-	dr_memory_protect(code_cache, PAGE_SIZE, DR_MEMPROT_READ | DR_MEMPROT_EXEC);
-}
-
-static void
-code_cache_exit(void)
-{
-	dr_nonheap_free(code_cache, PAGE_SIZE);
-}
-
 void funcreplace_module_load(void * drcontext, module_data_t * module, bool loaded){
 
-	module_t * md = md_lookup_module(head, module->full_path);
-	int i = 0;
 	app_pc address;
 
 	DEBUG_PRINT("module load - %s\n", module->full_path);
 
-	if (md != NULL){
-		for (int i = 1; i <= md->bbs[0].start_addr; i++){
-			address = md->bbs[i].start_addr + module->start;
-			if (md->bbs[i].start_addr == 21420880){
-				drwrap_wrap(address, pre_func_cb, NULL);
-			}
-			else if (md->bbs[i].start_addr == 9645248){
-				drwrap_wrap(address, pre_func_cb_3, NULL);
-			}
-			else{
-				drwrap_wrap(address, pre_func_cb_2, NULL);
-			}
-			DEBUG_PRINT("replaced - %x\n", md->bbs[i].start_addr);
-			
-			//DEBUG_PRINT("replacing function %x of %s with %x\n", address, module->full_path, pre_func_cb);
-			//drwrap_replace(address, (app_pc)clean_call_halide, true);
-			//drwrap_replace_native(address, clean_call_halide, true, 0, NULL, false);
-			
-			
-		}
+	if (binding->wrapped || strstr(module->full_path, binding->module) == NULL) return;
+
+	/* the post callback only times the original; a replaced call is skipped before it */
+	address = module->start + binding->entry_pc;
+	if (drwrap_wrap_ex(address, pre_func_replace, binding->replace ? NULL : post_func_replace, binding, 0)){
+		binding->wrapped = true;
+		DEBUG_PRINT("%s - wrapped %s+%x (%s)\n", ins_pass_name, binding->module, binding->entry_pc,
+			binding->replace ? "lifted" : "original");
 	}
 
 }
-
-
-
-
@@ -0,0 +1,549 @@
+#include "hotregion.h"
+#include <string.h>
+#include "dr_api.h"
+#include "drmgr.h"
+#include "drutil.h"
+#include "hashtable.h"
+#include "utilities.h"
+#include "moduleinfo.h"
+#include "defines.h"
+
+/*
+	online hot region detector - localization in a single run
+
+	phases
+	1. profile - every bb of the filtered modules gets an inline execution counter (no clean calls); call targets
+	   are recorded (statically for direct calls, through mbr instrumentation for indirect calls)
+	2. sample - a detector thread watches the counters; once the hottest bb stays the same between two checks
+	   its enclosing function is taken as the greatest call target at or below it and the dominant loop nest as the
+	   bbs of that function executing at least 1/LOOP_NEST_RATIO as often. the code cache is flushed and only the
+	   memory references of the loop nest are instrumented; each sample updates the extent touched by the pc
+	3. done - after MAX_SAMPLES samples the code cache is flushed again and the application runs uninstrumented
+
+	at exit the filter file (the enclosing function) and the app_pc file (the pcs of the loop nest touching the
+	largest regions) are written in the format filter_funcs produces -
+	<output folder>\filter_<exec>.log and <output folder>\filter_<exec>_app_pc.log
+
+	arguments - <filter file> <filter mode> <output folder> <exec> <threshold (% of the largest region)>
+*/
+
+/*************************defines******************************/
+
+#define PHASE_PROFILE		0
+#define PHASE_SAMPLE		1
+#define PHASE_DONE			2
+
+#define MAX_HOT_BBS			262144
+#define MAX_CALL_TARGETS	65536
+#define MAX_HOT_PCS			4096
+#define HASH_BITS			16
+
+#define DETECT_INTERVAL_MS	500
+#define HOT_MIN_COUNT		100000
+#define LOOP_NEST_RATIO		64
+#define MAX_SAMPLES			4000000
+
+/************************typedefs***********************************/
+
+typedef struct _hot_bb_t {
+	app_pc start;
+	app_pc module_start;
+	uint size;
+	uint count;			/* incremented inline */
+	bool in_region;		/* part of the dominant loop nest */
+} hot_bb_t;
+
+typedef struct _hot_pc_t {
+	app_pc pc;
+	uint size;
+	uint direction;
+	app_pc min;
+	app_pc max;
+	uint64 count;
+} hot_pc_t;
+
+typedef struct _client_arg_t {
+	char filter_filename[MAX_STRING_LENGTH];
+	uint filter_mode;
+	char output_folder[MAX_STRING_LENGTH];
+	char exec[MAX_STRING_LENGTH];
+	uint threshold;
+} client_arg_t;
+
+/***************************global variables**********************/
+
+static client_arg_t * client_arg;
+static module_t * head;
+static void * mutex;
+
+static volatile uint phase = PHASE_PROFILE;
+static volatile bool exiting = false;
+
+static hot_bb_t * bbs;
+static uint num_bbs = 0;
+static hashtable_t bb_table;		/* bb start -> hot_bb_t */
+
+static app_pc * call_targets;
+static uint num_call_targets = 0;
+static hashtable_t call_table;		/* call target -> call target */
+
+static hot_pc_t * pcs;
+static uint num_pcs = 0;
+static hashtable_t pc_table;		/* instr pc -> hot_pc_t */
+static volatile uint64 num_samples = 0;
+
+/* the localized region */
+static hot_bb_t * hot_bb = NULL;
+static app_pc region_module_start;
+static app_pc region_func;
+static app_pc region_end;
+static char region_module[MAX_STRING_LENGTH];
+
+static file_t logfile;
+static char ins_pass_name[MAX_STRING_LENGTH];
+
+/**********************function prototypes***********************/
+
+static bool parse_commandline_args(const char * args);
+static void detector(void * arg);
+static bool localize_region(void);
+
+/*********************function implementation*******************/
+
+static bool parse_commandline_args(const char * args) {
+
+	client_arg = (client_arg_t *)dr_global_alloc(sizeof(client_arg_t));
+	if (dr_sscanf(args, "%s %d %s %s %d", &client_arg->filter_filename,
+								&client_arg->filter_mode,
+								&client_arg->output_folder,
+								&client_arg->exec,
+								&client_arg->threshold) != 5){
+		return false;
+	}
+
+	return true;
+}
+
+void hotregion_init(client_id_t id, const char * name, const char * arguments)
+{
+	char logfilename[MAX_STRING_LENGTH];
+	file_t in_file;
+
+	drmgr_init();
+	drutil_init();
+
+	mutex = dr_mutex_create();
+
+	DR_ASSERT(parse_commandline_args(arguments) == true);
+
+	head = md_initialize();
+	if (client_arg->filter_mode != FILTER_NONE){
+		in_file = dr_open_file(client_arg->filter_filename, DR_FILE_READ);
+		DR_ASSERT(in_file != INVALID_FILE);
+		md_read_from_file(head, in_file, false);
+		dr_close_file(in_file);
+	}
+
+	bbs = (hot_bb_t *)dr_global_alloc(sizeof(hot_bb_t) * MAX_HOT_BBS);
+	call_targets = (app_pc *)dr_global_alloc(sizeof(app_pc) * MAX_CALL_TARGETS);
+	pcs = (hot_pc_t *)dr_global_alloc(sizeof(hot_pc_t) * MAX_HOT_PCS);
+	hashtable_init(&bb_table, HASH_BITS, HASH_INTPTR, false);
+	hashtable_init(&call_table, HASH_BITS, HASH_INTPTR, false);
+	hashtable_init(&pc_table, HASH_BITS, HASH_INTPTR, false);
+
+	if (log_mode){
+		populate_conv_filename(logfilename, logdir, name, NULL);
+		logfile = dr_open_file(logfilename, DR_FILE_WRITE_OVERWRITE);
+	}
+	strncpy(ins_pass_name, name, MAX_STRING_LENGTH);
+
+	DR_ASSERT(dr_create_client_thread(detector, NULL));
+
+}
+
+/* output files - same format as filter_funcs (print_funcs_filter_file, print_app_pc_file) */
+static void write_filter_files(void)
+{
+	char filename[MAX_STRING_LENGTH];
+	file_t file;
+	uint i, j;
+	uint selected = 0;
+	app_pc largest = 0;
+
+	if (hot_bb == NULL){
+		dr_printf("%s - no hot region was found\n", ins_pass_name);
+		return;
+	}
+
+	dr_snprintf(filename, MAX_STRING_LENGTH, "%s\\filter_%s.log", client_arg->output_folder, client_arg->exec);
+	file = dr_open_file(filename, DR_FILE_WRITE_OVERWRITE);
+	DR_ASSERT(file != INVALID_FILE);
+	dr_fprintf(file, "1\n\"%s\"\n1\n%u\n", region_module, (uint)(region_func - region_module_start));
+	dr_close_file(file);
+
+	/* candidate instructions - pcs touching at least threshold % of the largest extent */
+	for (i = 0; i < num_pcs; i++){
+		if (pcs[i].count > 0 && (pcs[i].max - pcs[i].min) > (ptr_uint_t)largest){
+			largest = (app_pc)(pcs[i].max - pcs[i].min);
+		}
+	}
+	for (j = 0; j < 2; j++){
+		if (j == 1){
+			dr_snprintf(filename, MAX_STRING_LENGTH, "%s\\filter_%s_app_pc.log", client_arg->output_folder, client_arg->exec);
+			file = dr_open_file(filename, DR_FILE_WRITE_OVERWRITE);
+			DR_ASSERT(file != INVALID_FILE);
+			dr_fprintf(file, "1\n\"%s\"\n%u\n", region_module, selected);
+		}
+		for (i = 0; i < num_pcs; i++){
+			if (pcs[i].count > 0 && (uint64)(pcs[i].max - pcs[i].min) * 100 >= (uint64)(ptr_uint_t)largest * client_arg->threshold){
+				if (j == 0) selected++;
+				else dr_fprintf(file, "%u\n", (uint)(pcs[i].pc - region_module_start));
+			}
+		}
+	}
+	dr_close_file(file);
+
+	dr_printf("%s - function %x of %s, %u of %u sampled pcs selected\n", ins_pass_name,
+		region_func - region_module_start, region_module, selected, num_pcs);
+
+}
+
+void hotregion_exit_event(void)
+{
+	exiting = true;
+
+	/* short runs may end before the detector fired - localize with what was counted */
+	if (phase == PHASE_PROFILE){
+		localize_region();
+	}
+	write_filter_files();
+
+	hashtable_delete(&bb_table);
+	hashtable_delete(&call_table);
+	hashtable_delete(&pc_table);
+	dr_global_free(bbs, sizeof(hot_bb_t) * MAX_HOT_BBS);
+	dr_global_free(call_targets, sizeof(app_pc) * MAX_CALL_TARGETS);
+	dr_global_free(pcs, sizeof(hot_pc_t) * MAX_HOT_PCS);
+
+	md_delete_list(head, false);
+	if (log_mode){
+		dr_close_file(logfile);
+	}
+	dr_mutex_destroy(mutex);
+	dr_global_free(client_arg, sizeof(client_arg_t));
+	drutil_exit();
+	drmgr_exit();
+}
+
+/* region localization - runs on the detector thread (or at exit) */
+
+static bool localize_region(void)
+{
+	uint i;
+	hot_bb_t * hottest = NULL;
+	module_data_t * module_data;
+	app_pc func = NULL;
+	app_pc end = (app_pc)(ptr_uint_t)-1;
+	uint in_region = 0;
+
+	dr_mutex_lock(mutex);
+
+	for (i = 0; i < num_bbs; i++){
+		if (hottest == NULL || bbs[i].count > hottest->count){
+			hottest = &bbs[i];
+		}
+	}
+
+	if (hottest == NULL || hottest->count == 0){
+		dr_mutex_unlock(mutex);
+		return false;
+	}
+
+	/* enclosing function - the closest call target at or below the hottest bb in its module */
+	for (i = 0; i < num_call_targets; i++){
+		if (call_targets[i] <= hottest->start && call_targets[i] >= hottest->module_start
+			&& (func == NULL || call_targets[i] > func)){
+			func = call_targets[i];
+		}
+	}
+	if (func == NULL){
+		func = hottest->start;
+	}
+	for (i = 0; i < num_call_targets; i++){
+		if (call_targets[i] > func && call_targets[i] < end){
+			end = call_targets[i];
+		}
+	}
+
+	/* dominant loop nest */
+	for (i = 0; i < num_bbs; i++){
+		bbs[i].in_region = bbs[i].start >= func && bbs[i].start < end
+			&& (uint64)bbs[i].count * LOOP_NEST_RATIO >= hottest->count;
+		if (bbs[i].in_region) in_region++;
+	}
+
+	module_data = dr_lookup_module(hottest->start);
+	if (module_data != NULL){
+		strncpy(region_module, module_data->full_path, MAX_STRING_LENGTH);
+		dr_free_module_data(module_data);
+	}
+	else{
+		region_module[0] = '\0';
+	}
+
+	region_module_start = hottest->module_start;
+	region_func = func;
+	region_end = end;
+	hot_bb = hottest;
+
+	dr_mutex_unlock(mutex);
+
+	DEBUG_PRINT("%s - hot bb %x (%u) in function %x, %u bbs in the loop nest\n", ins_pass_name,
+		hottest->start - hottest->module_start, hottest->count, func - hottest->module_start, in_region);
+	LOG_PRINT(logfile, "hot bb %x (%u) in function %x of %s, %u bbs in the loop nest\n",
+		hottest->start - hottest->module_start, hottest->count, func - hottest->module_start, region_module, in_region);
+
+	return true;
+}
+
+static void detector(void * arg)
+{
+	app_pc last = NULL;
+	uint i;
+	hot_bb_t * hottest;
+
+	while (!exiting && phase == PHASE_PROFILE){
+
+		dr_sleep(DETECT_INTERVAL_MS);
+
+		hottest = NULL;
+		dr_mutex_lock(mutex);
+		for (i = 0; i < num_bbs; i++){
+			if (hottest == NULL || bbs[i].count > hottest->count){
+				hottest = &bbs[i];
+			}
+		}
+		dr_mutex_unlock(mutex);
+
+		if (hottest == NULL || hottest->count < HOT_MIN_COUNT){
+			continue;
+		}
+
+		/* the hottest bb should be stable between two checks */
+		if (hottest->start == last && localize_region()){
+			phase = PHASE_SAMPLE;
+			dr_delay_flush_region(0, ~((ptr_uint_t)0), 0, NULL);
+			break;
+		}
+		last = hottest->start;
+	}
+}
+
+/* analysis clean calls */
+
+static void
+record_call_target(app_pc target)
+{
+	dr_mutex_lock(mutex);
+	if (hashtable_lookup(&call_table, target) == NULL && num_call_targets < MAX_CALL_TARGETS){
+		call_targets[num_call_targets++] = target;
+		hashtable_add(&call_table, target, target);
+	}
+	dr_mutex_unlock(mutex);
+}
+
+static void
+at_indirect_call(app_pc instr_addr, app_pc target_addr)
+{
+	record_call_target(target_addr);
+}
+
+/* updates are not synchronized - a lost update only shrinks an extent by one access */
+static void
+sample_mem(hot_pc_t * hot_pc, app_pc addr)
+{
+	if (hot_pc->count == 0 || addr < hot_pc->min) hot_pc->min = addr;
+	if (addr + hot_pc->size > hot_pc->max) hot_pc->max = addr + hot_pc->size;
+	hot_pc->count++;
+
+	if (++num_samples == MAX_SAMPLES && phase == PHASE_SAMPLE){
+		phase = PHASE_DONE;
+		dr_delay_flush_region(0, ~((ptr_uint_t)0), 0, NULL);
+	}
+}
+
+/* instrumentation */
+
+static hot_bb_t *
+get_hot_bb(app_pc start, app_pc module_start, uint size)
+{
+	hot_bb_t * bb;
+
+	dr_mutex_lock(mutex);
+	bb = (hot_bb_t *)hashtable_lookup(&bb_table, start);
+	if (bb == NULL && num_bbs < MAX_HOT_BBS){
+		bb = &bbs[num_bbs++];
+		bb->start = start;
+		bb->module_start = module_start;
+		bb->size = size;
+		bb->count = 0;
+		bb->in_region = false;
+		hashtable_add(&bb_table, start, bb);
+	}
+	dr_mutex_unlock(mutex);
+
+	return bb;
+}
+
+static hot_pc_t *
+get_hot_pc(app_pc pc, uint size, bool write)
+{
+	hot_pc_t * hot_pc;
+
+	dr_mutex_lock(mutex);
+	hot_pc = (hot_pc_t *)hashtable_lookup(&pc_table, pc);
+	if (hot_pc == NULL && num_pcs < MAX_HOT_PCS){
+		hot_pc = &pcs[num_pcs++];
+		memset(hot_pc, 0, sizeof(hot_pc_t));
+		hot_pc->pc = pc;
+		hashtable_add(&pc_table, pc, hot_pc);
+	}
+	if (hot_pc != NULL){
+		if (size > hot_pc->size) hot_pc->size = size;
+		hot_pc->direction |= write ? 0x2 : 0x1;
+	}
+	dr_mutex_unlock(mutex);
+
+	return hot_pc;
+}
+
+static void
+instrument_counter(void * drcontext, instrlist_t * bb, instr_t * where, hot_bb_t * hot)
+{
+	dr_save_arith_flags(drcontext, bb, where, SPILL_SLOT_1);
+	instrlist_meta_preinsert(bb, where, INSTR_CREATE_inc(drcontext, OPND_CREATE_ABSMEM((byte *)&hot->count, OPSZ_4)));
+	dr_restore_arith_flags(drcontext, bb, where, SPILL_SLOT_1);
+}
+
+/* stack (ebp / esp based) references are not part of the buffers we are after */
+static bool
+is_buffer_reference(opnd_t opnd)
+{
+	reg_id_t reg;
+
+	reg = opnd_get_base(opnd);
+	if (reg != 0 && reg != DR_REG_XBP && reg != DR_REG_XSP) return true;
+	reg = opnd_get_index(opnd);
+	if (reg != 0 && reg != DR_REG_XBP && reg != DR_REG_XSP) return true;
+	return false;
+}
+
+static void
+instrument_sample(void * drcontext, instrlist_t * bb, instr_t * where, opnd_t ref, bool write)
+{
+	reg_id_t reg1 = DR_REG_XBX;
+	reg_id_t reg2 = DR_REG_XCX;
+	hot_pc_t * hot_pc;
+
+	hot_pc = get_hot_pc(instr_get_app_pc(where), drutil_opnd_mem_size_in_bytes(ref, where), write);
+	if (hot_pc == NULL) return;
+
+	dr_save_reg(drcontext, bb, where, reg1, SPILL_SLOT_2);
+	dr_save_reg(drcontext, bb, where, reg2, SPILL_SLOT_3);
+	drutil_insert_get_mem_addr(drcontext, bb, where, ref, reg1, reg2);
+	dr_insert_clean_call(drcontext, bb, where, (void *)sample_mem, false, 2,
+		OPND_CREATE_INTPTR(hot_pc), opnd_create_reg(reg1));
+	dr_restore_reg(drcontext, bb, where, reg2, SPILL_SLOT_3);
+	dr_restore_reg(drcontext, bb, where, reg1, SPILL_SLOT_2);
+}
+
+dr_emit_flags_t
+hotregion_bb_analysis(void *drcontext, void *tag, instrlist_t *bb,
+				bool for_trace, bool translating,
+				OUT void **user_data)
+{
+	return DR_EMIT_DEFAULT;
+}
+
+dr_emit_flags_t
+hotregion_bb_instrumentation(void *drcontext, void *tag, instrlist_t *bb,
+				instr_t *instr, bool for_trace, bool translating,
+				void *user_data)
+{
+	instr_t * first = NULL;
+	instr_t * last = instrlist_last(bb);
+	instr_t * current;
+	module_data_t * module_data;
+	hot_bb_t * hot;
+	app_pc start;
+	uint i;
+
+	if (phase == PHASE_DONE || !instr_ok_to_mangle(instr)){
+		return DR_EMIT_DEFAULT;
+	}
+
+	for (current = instrlist_first(bb); current != NULL; current = instr_get_next(current)){
+		if (instr_ok_to_mangle(current)){
+			first = current;
+			break;
+		}
+	}
+
+	if (first == NULL || !filter_from_list(head, first, client_arg->filter_mode)){
+		return DR_EMIT_DEFAULT;
+	}
+
+	start = instr_get_app_pc(first);
+
+	if (phase == PHASE_PROFILE){
+
+		if (instr == first){
+			module_data = dr_lookup_module(start);
+			if (module_data == NULL){
+				return DR_EMIT_DEFAULT;
+			}
+			hot = get_hot_bb(start, module_data->start,
+				instr_get_app_pc(last) - start + instr_length(drcontext, last));
+			dr_free_module_data(module_data);
+			if (hot != NULL){
+				instrument_counter(drcontext, bb, instr, hot);
+			}
+		}
+
+		if (instr_is_call_direct(instr)){
+			record_call_target(opnd_get_pc(instr_get_target(instr)));
+		}
+		else if (instr_is_call_indirect(instr)){
+			dr_insert_mbr_instrumentation(drcontext, bb, instr, (app_pc)at_indirect_call, SPILL_SLOT_1);
+		}
+
+	}
+	else if (phase == PHASE_SAMPLE){
+
+		/* only the bbs of the dominant loop nest */
+		dr_mutex_lock(mutex);
+		hot = (hot_bb_t *)hashtable_lookup(&bb_table, start);
+		dr_mutex_unlock(mutex);
+		if (hot == NULL || !hot->in_region){
+			return DR_EMIT_DEFAULT;
+		}
+
+		if (instr_reads_memory(instr)){
+			for (i = 0; i < instr_num_srcs(instr); i++){
+				if (opnd_is_memory_reference(instr_get_src(instr, i)) && is_buffer_reference(instr_get_src(instr, i))){
+					instrument_sample(drcontext, bb, instr, instr_get_src(instr, i), false);
+				}
+			}
+		}
+		if (instr_writes_memory(instr)){
+			for (i = 0; i < instr_num_dsts(instr); i++){
+				if (opnd_is_memory_reference(instr_get_dst(instr, i)) && is_buffer_reference(instr_get_dst(instr, i))){
+					instrument_sample(drcontext, bb, instr, instr_get_dst(instr, i), true);
+				}
+			}
+		}
+
+	}
+
+	return DR_EMIT_DEFAULT;
+}
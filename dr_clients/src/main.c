@@ -18,6 +18,8 @@
 #include "memdump.h"
 #include "funcreplace.h"
 #include "misc.h"
+#include "hotregion.h"
+#include "reusedist.h"
 
 #define ARGUMENT_LENGTH 20
 
@@ -432,7 +434,39 @@ static void setupInsPasses(){
 	ins_pass[9].module_unload = NULL;
 
 
-	pass_length = 10;
+	//ins pass 11 - hotregion - single run localization (profile + memory sampling of the hot region)
+	ins_pass[10].name = "hotregion";
+	ins_pass[10].priority = priority;
+	ins_pass[10].priority.name = ins_pass[10].name;
+	ins_pass[10].priority.priority = 3;
+	ins_pass[10].init_func = hotregion_init;
+	ins_pass[10].app2app_bb = NULL;
+	ins_pass[10].analysis_bb = hotregion_bb_analysis;
+	ins_pass[10].instrumentation_bb = hotregion_bb_instrumentation;
+	ins_pass[10].thread_init = NULL;
+	ins_pass[10].thread_exit = NULL;
+	ins_pass[10].process_exit = hotregion_exit_event;
+	ins_pass[10].module_load = NULL;
+	ins_pass[10].module_unload = NULL;
+
+
+	//ins pass 12 - reusedist - reuse distance and loop working set profile of the filtered code
+	ins_pass[11].name = "reusedist";
+	ins_pass[11].priority = priority;
+	ins_pass[11].priority.name = ins_pass[11].name;
+	ins_pass[11].priority.priority = 3;
+	ins_pass[11].init_func = reusedist_init;
+	ins_pass[11].app2app_bb = NULL;
+	ins_pass[11].analysis_bb = reusedist_bb_analysis;
+	ins_pass[11].instrumentation_bb = reusedist_bb_instrumentation;
+	ins_pass[11].thread_init = reusedist_thread_init;
+	ins_pass[11].thread_exit = reusedist_thread_exit;
+	ins_pass[11].process_exit = reusedist_exit_event;
+	ins_pass[11].module_load = NULL;
+	ins_pass[11].module_unload = NULL;
+
+
+	pass_length = 12;
 
 }
 
@@ -29,6 +29,19 @@
  */
 #define MEM_BUF_SIZE (sizeof(mem_ref_t) * MAX_NUM_MEM_REFS)
 
+/* summary mode - instead of one record per access, a running summary of the regions touched by each pc is kept per
+   thread and only the summaries are written (at thread exit or when the table fills up). the regions follow the same
+   merge rules as update_mem_regions + defragmentation in meminfo.cpp, so filter_funcs reads them in place of the raw
+   accesses. format - s,<module start>,<pc offset>,<direction>,<start>,<end>,<n>,<stride>,<freq>,... */
+#define MAX_SUMMARY_PCS		4096  /* power of 2 */
+#define MAX_SUMMARY_LOAD	(MAX_SUMMARY_PCS / 4 * 3)
+#define MAX_PC_REGIONS		4
+#define MAX_PC_STRIDES		4
+
+/* directions - same as meminfo.h */
+#define SUMMARY_INPUT		0x1
+#define SUMMARY_OUTPUT		0x2
+
 /************************typedefs***********************************/
 
 /* Each mem_ref_t includes the type of reference (read or write),
@@ -41,6 +54,22 @@ typedef struct _mem_ref_t {
 	app_pc pc;
 } mem_ref_t;
 
+typedef struct _region_summary_t {
+	app_pc start;
+	app_pc end;
+	uint direction;
+	uint strides[MAX_PC_STRIDES];
+	uint stride_freqs[MAX_PC_STRIDES];
+} region_summary_t;
+
+/* a slot with pc == NULL is empty; module_start == NULL marks a pc outside any module (never written) */
+typedef struct _pc_summary_t {
+	app_pc pc;
+	app_pc module_start;
+	uint num_regions;
+	region_summary_t regions[MAX_PC_REGIONS];
+} pc_summary_t;
+
 
 /* thread private log file and counter */
 typedef struct {
@@ -56,6 +85,9 @@ typedef struct {
 	uint stack_base;
 	uint stack_limit;
 
+	pc_summary_t * summary;
+	uint summary_used;
+
 } per_thread_t;
 
 typedef struct _client_arg_t{
@@ -63,6 +95,7 @@ typedef struct _client_arg_t{
 	uint filter_mode;
 	char output_folder[MAX_STRING_LENGTH];
 	char extra_info[MAX_STRING_LENGTH];
+	uint summary;	/* optional - 1 writes per pc region summaries instead of the raw trace */
 
 } client_arg_t;
 
@@ -92,17 +125,23 @@ static void instrument_mem(void        *drcontext,
                            int          pos,
                            bool         write);
 static bool parse_commandline_args (const char * args);
+static void summary_flush(per_thread_t * data);
 
 
 /*********************function implementation*******************/
 
 static bool parse_commandline_args (const char * args) {
 
+	int read;
+
 	client_arg = (client_arg_t *)dr_global_alloc(sizeof(client_arg_t));
-	if(dr_sscanf(args,"%s %d %s %s",&client_arg->filter_filename,
+	client_arg->summary = 0;
+	read = dr_sscanf(args,"%s %d %s %s %d",&client_arg->filter_filename,
 								&client_arg->filter_mode,
 								&client_arg->output_folder,
-								&client_arg->extra_info)!=4){
+								&client_arg->extra_info,
+								&client_arg->summary);
+	if(read != 4 && read != 5){
 		return false;
 	}
 	
@@ -190,6 +229,13 @@ void memtrace_thread_init(void *drcontext)
     data->buf_end  = -(ptr_int_t)(data->buf_base + MEM_BUF_SIZE);
     data->num_refs = 0;
 
+	data->summary = NULL;
+	data->summary_used = 0;
+	if (client_arg->summary){
+		data->summary = dr_thread_alloc(drcontext, sizeof(pc_summary_t) * MAX_SUMMARY_PCS);
+		memset(data->summary, 0, sizeof(pc_summary_t) * MAX_SUMMARY_PCS);
+	}
+
     /* We're going to dump our data to a per-thread file.
      * On Windows we need an absolute path so we place it in
      * the same directory as our library. We could also pass
@@ -237,6 +283,10 @@ void memtrace_thread_exit(void *drcontext)
 
     memtrace(drcontext);
     data = drmgr_get_tls_field(drcontext, tls_index);
+	if (data->summary != NULL){
+		summary_flush(data);
+		dr_thread_free(drcontext, data->summary, sizeof(pc_summary_t) * MAX_SUMMARY_PCS);
+	}
     dr_mutex_lock(mutex);
     num_refs += data->num_refs;
     dr_mutex_unlock(mutex);
@@ -339,15 +389,138 @@ memtrace_bb_instrumentation(void *drcontext, void *tag, instrlist_t *bb,
 }
 
 
+/* summary mode */
+
+static void
+summary_write_pc(per_thread_t * data, pc_summary_t * entry)
+{
+	uint i, j;
+	region_summary_t * region;
+
+	if (entry->module_start == NULL) return;
+
+	for (i = 0; i < entry->num_regions; i++){
+		region = &entry->regions[i];
+		dr_fprintf(data->outfile, "s,%x,%x,%d,"PFX","PFX",", entry->module_start, entry->pc - entry->module_start,
+			region->direction, region->start, region->end);
+		for (j = 0; j < MAX_PC_STRIDES && region->stride_freqs[j] != 0; j++);
+		dr_fprintf(data->outfile, "%d", j);
+		for (j = 0; j < MAX_PC_STRIDES && region->stride_freqs[j] != 0; j++){
+			dr_fprintf(data->outfile, ",%d,%d", region->strides[j], region->stride_freqs[j]);
+		}
+		dr_fprintf(data->outfile, "\n");
+	}
+	entry->num_regions = 0;
+}
+
+static void
+summary_flush(per_thread_t * data)
+{
+	uint i;
+
+	for (i = 0; i < MAX_SUMMARY_PCS; i++){
+		if (data->summary[i].pc != NULL){
+			summary_write_pc(data, &data->summary[i]);
+		}
+	}
+	memset(data->summary, 0, sizeof(pc_summary_t) * MAX_SUMMARY_PCS);
+	data->summary_used = 0;
+}
+
+static pc_summary_t *
+summary_lookup(per_thread_t * data, app_pc pc)
+{
+	uint index;
+	module_data_t * mdata;
+	pc_summary_t * entry;
+
+	/* keep the table sparse; a full flush is as good as the thread ending for the offline merge */
+	if (data->summary_used >= MAX_SUMMARY_LOAD){
+		summary_flush(data);
+	}
+
+	index = (uint)(((ptr_uint_t)pc >> 2) ^ ((ptr_uint_t)pc >> 13)) & (MAX_SUMMARY_PCS - 1);
+	while (data->summary[index].pc != NULL && data->summary[index].pc != pc){
+		index = (index + 1) & (MAX_SUMMARY_PCS - 1);
+	}
+
+	entry = &data->summary[index];
+	if (entry->pc == NULL){
+		entry->pc = pc;
+		entry->num_regions = 0;
+		mdata = dr_lookup_module(pc);
+		entry->module_start = (mdata != NULL) ? mdata->start : NULL;
+		dr_free_module_data(mdata);
+		data->summary_used++;
+	}
+
+	return entry;
+}
+
+static void
+summary_update_stride(region_summary_t * region, uint stride)
+{
+	uint i;
+
+	for (i = 0; i < MAX_PC_STRIDES; i++){
+		if (region->stride_freqs[i] == 0){
+			region->strides[i] = stride;
+			region->stride_freqs[i] = 1;
+			return;
+		}
+		if (region->strides[i] == stride){
+			region->stride_freqs[i]++;
+			return;
+		}
+	}
+	/* histogram is full - rare strides are dropped */
+}
+
+static void
+summary_update(per_thread_t * data, mem_ref_t * mem_ref)
+{
+	uint i;
+	app_pc start = (app_pc)mem_ref->addr;
+	app_pc end = start + mem_ref->size;
+	uint direction = mem_ref->write ? SUMMARY_OUTPUT : SUMMARY_INPUT;
+	pc_summary_t * entry;
+	region_summary_t * region;
+
+	entry = summary_lookup(data, mem_ref->pc);
+	if (entry->module_start == NULL) return;
+
+	/* overlapping or adjacent regions grow - the union update_mem_regions and defragmentation arrive at */
+	for (i = 0; i < entry->num_regions; i++){
+		region = &entry->regions[i];
+		if (start <= region->end && end >= region->start){
+			if (start < region->start) region->start = start;
+			if (end > region->end) region->end = end;
+			region->direction |= direction;
+			summary_update_stride(region, mem_ref->size);
+			return;
+		}
+	}
+
+	/* too many disjoint regions for this pc - write the ones we have and start over */
+	if (entry->num_regions == MAX_PC_REGIONS){
+		summary_write_pc(data, entry);
+	}
+
+	region = &entry->regions[entry->num_regions++];
+	memset(region, 0, sizeof(region_summary_t));
+	region->start = start;
+	region->end = end;
+	region->direction = direction;
+	summary_update_stride(region, mem_ref->size);
+}
+
 static void
 memtrace(void *drcontext)
 {
     per_thread_t *data;
     int num_refs;
     mem_ref_t *mem_ref;
-#ifdef READABLE_TRACE
     int i;
-#endif
 
 	module_data_t * mdata;
 
@@ -355,6 +528,13 @@ memtrace(void *drcontext)
     mem_ref   = (mem_ref_t *)data->buf_base;
     num_refs  = (int)((mem_ref_t *)data->buf_ptr - mem_ref);
 
+	if (data->summary != NULL){
+		for (i = 0; i < num_refs; i++) {
+			summary_update(data, mem_ref);
+			++mem_ref;
+		}
+	}
+	else{
 #ifdef READABLE_TRACE
     /*dr_fprintf(data->log,
                "Format: <instr address>,<(r)ead/(w)rite>,<data size>,<data address>\n");*/
@@ -376,6 +556,7 @@ memtrace(void *drcontext)
     dr_write_file(data->log, data->buf_base,
                   (size_t)(data->buf_ptr - data->buf_base));
 #endif
+	}
 
     memset(data->buf_base, 0, MEM_BUF_SIZE);
     data->num_refs += num_refs;
@@ -0,0 +1,688 @@
+#include "reusedist.h"
+#include <string.h>
+#include "dr_api.h"
+#include "drmgr.h"
+#include "drutil.h"
+#include "hashtable.h"
+#include "utilities.h"
+#include "moduleinfo.h"
+#include "defines.h"
+
+/*
+	reuse distance and working set profiler for the filtered code
+
+	every (non stack) memory reference of the filtered bbs calls at_access with the static id of the instruction;
+	the reuse distance of an access is the number of distinct cache lines touched since the previous access to
+	the same line. it is computed online per thread with a hash table line -> time of last access and a fenwick
+	tree over time holding a 1 at the last access of every line, so the distance is a range count. times live in
+	a window of TIME_WINDOW accesses; when it fills up the most recent MAX_LINES lines are renumbered and the rest
+	are forgotten (a later access to them counts as beyond the window).
+
+	loops are found statically - a direct branch to a lower address closes a loop (the latch). every time a latch
+	executes an iteration of its loop ends; the distinct lines touched since the previous execution of the latch
+	are the working set of that iteration (the same range count). loop levels are recovered from the nesting of
+	the [head, latch] ranges; level 1 is the outermost loop of the filtered code.
+
+	output - <output folder>\reusedist_<app>_<extra info>_<thread id>.log
+	t,<line size>,<accesses>,<distinct lines>,<lines beyond the window>
+	p,<module start>,<pc offset>,<direction>,<size>,<accesses>,<cold>,<n>,<bucket 0>,...,<bucket n-1>
+	l,<module start>,<head offset>,<latch offset>,<level>,<iterations>,<mean lines>,<max lines>,<n>,<bucket 0>,...
+	bucket 0 counts distance (working set) 0, bucket i counts [2^(i-1), 2^i) lines and the last bucket everything
+	at or beyond MAX_LINES; cold accesses are first touches (or lines that fell out of the window).
+
+	arguments - <filter file> <filter mode> <output folder> <extra info> [<log2 of the cache line size>]
+*/
+
+/*************************defines******************************/
+
+#define DEFAULT_LINE_BITS	6				/* 64 byte lines */
+#define MAX_LINES			(1 << 17)		/* distances are exact up to this many distinct lines */
+#define TIME_WINDOW			(1 << 18)
+#define LINE_TABLE_SIZE		(1 << 19)		/* at most TIME_WINDOW lines are live - load stays under 1/2 */
+#define NUM_BUCKETS			19				/* 0, [1,2), ... , [2^16, 2^17), >= MAX_LINES */
+
+#define MAX_REUSE_PCS		4096
+#define MAX_LOOPS			1024
+#define HASH_BITS			12
+
+#define SURVIVOR			0x80000000
+
+#define REUSE_INPUT			0x1
+#define REUSE_OUTPUT		0x2
+
+/************************typedefs***********************************/
+
+/* static information - shared by all threads */
+typedef struct _static_pc_t {
+	app_pc pc;
+	app_pc module_start;
+	uint size;
+	uint direction;
+} static_pc_t;
+
+typedef struct _static_loop_t {
+	app_pc head;
+	app_pc latch;
+	app_pc module_start;
+} static_loop_t;
+
+/* dynamic information - per thread */
+typedef struct _line_entry_t {
+	ptr_uint_t line;
+	uint time;			/* 0 - empty slot */
+} line_entry_t;
+
+typedef struct _pc_stat_t {
+	uint64 accesses;
+	uint64 cold;
+	uint64 hist[NUM_BUCKETS];
+} pc_stat_t;
+
+typedef struct _loop_stat_t {
+	bool started;
+	uint last_time;
+	uint64 iterations;
+	uint64 total_lines;
+	uint max_lines;
+	uint64 hist[NUM_BUCKETS];
+} loop_stat_t;
+
+typedef struct {
+
+	/* allocated on the first access of the thread - most threads never run the filtered code */
+	line_entry_t * lines;
+	uint * tree;				/* fenwick tree over [1, TIME_WINDOW] */
+	uint * remap;				/* compaction scratch - old time -> new time */
+	ptr_uint_t * order;			/* compaction scratch - survivors in time order */
+	uint now;
+
+	pc_stat_t * pcs;
+	loop_stat_t * loops;
+
+	uint64 accesses;
+	uint64 distinct;
+	uint64 evicted;
+
+	file_t outfile;
+
+} per_thread_t;
+
+typedef struct _client_arg_t {
+	char filter_filename[MAX_STRING_LENGTH];
+	uint filter_mode;
+	char output_folder[MAX_STRING_LENGTH];
+	char extra_info[MAX_STRING_LENGTH];
+	uint line_bits;
+} client_arg_t;
+
+/***************************global variables**********************/
+
+static client_arg_t * client_arg;
+static module_t * head;
+static void * mutex;
+static int tls_index;
+
+static static_pc_t * static_pcs;
+static uint num_static_pcs = 0;
+static hashtable_t pc_table;		/* instr pc -> index + 1 */
+
+static static_loop_t * static_loops;
+static uint num_static_loops = 0;
+static hashtable_t loop_table;		/* latch pc -> index + 1 */
+
+static file_t logfile;
+static char ins_pass_name[MAX_STRING_LENGTH];
+
+/**********************function prototypes***********************/
+
+static bool parse_commandline_args(const char * args);
+static void write_report(per_thread_t * data);
+
+/*********************function implementation*******************/
+
+static bool parse_commandline_args(const char * args) {
+
+	int read;
+
+	client_arg = (client_arg_t *)dr_global_alloc(sizeof(client_arg_t));
+	client_arg->line_bits = DEFAULT_LINE_BITS;
+	read = dr_sscanf(args, "%s %d %s %s %d", &client_arg->filter_filename,
+								&client_arg->filter_mode,
+								&client_arg->output_folder,
+								&client_arg->extra_info,
+								&client_arg->line_bits);
+	if (read != 4 && read != 5){
+		return false;
+	}
+
+	return true;
+}
+
+void reusedist_init(client_id_t id, const char * name, const char * arguments)
+{
+	char logfilename[MAX_STRING_LENGTH];
+	file_t in_file;
+
+	drmgr_init();
+	drutil_init();
+
+	mutex = dr_mutex_create();
+
+	DR_ASSERT(parse_commandline_args(arguments) == true);
+
+	head = md_initialize();
+	if (client_arg->filter_mode != FILTER_NONE){
+		in_file = dr_open_file(client_arg->filter_filename, DR_FILE_READ);
+		DR_ASSERT(in_file != INVALID_FILE);
+		md_read_from_file(head, in_file, false);
+		dr_close_file(in_file);
+	}
+
+	tls_index = drmgr_register_tls_field();
+	DR_ASSERT(tls_index != -1);
+
+	static_pcs = (static_pc_t *)dr_global_alloc(sizeof(static_pc_t) * MAX_REUSE_PCS);
+	static_loops = (static_loop_t *)dr_global_alloc(sizeof(static_loop_t) * MAX_LOOPS);
+	hashtable_init(&pc_table, HASH_BITS, HASH_INTPTR, false);
+	hashtable_init(&loop_table, HASH_BITS, HASH_INTPTR, false);
+
+	if (log_mode){
+		populate_conv_filename(logfilename, logdir, name, NULL);
+		logfile = dr_open_file(logfilename, DR_FILE_WRITE_OVERWRITE);
+	}
+	strncpy(ins_pass_name, name, MAX_STRING_LENGTH);
+
+}
+
+void reusedist_exit_event(void)
+{
+	hashtable_delete(&pc_table);
+	hashtable_delete(&loop_table);
+	dr_global_free(static_pcs, sizeof(static_pc_t) * MAX_REUSE_PCS);
+	dr_global_free(static_loops, sizeof(static_loop_t) * MAX_LOOPS);
+
+	md_delete_list(head, false);
+	drmgr_unregister_tls_field(tls_index);
+	if (log_mode){
+		dr_close_file(logfile);
+	}
+	dr_mutex_destroy(mutex);
+	dr_global_free(client_arg, sizeof(client_arg_t));
+	drutil_exit();
+	drmgr_exit();
+}
+
+void reusedist_thread_init(void *drcontext)
+{
+	per_thread_t * data;
+
+	data = dr_thread_alloc(drcontext, sizeof(per_thread_t));
+	memset(data, 0, sizeof(per_thread_t));
+	data->outfile = INVALID_FILE;
+	drmgr_set_tls_field(drcontext, tls_index, data);
+}
+
+static void
+free_thread_data(void * drcontext, per_thread_t * data)
+{
+	if (data->lines == NULL) return;
+
+	dr_thread_free(drcontext, data->lines, sizeof(line_entry_t) * LINE_TABLE_SIZE);
+	dr_thread_free(drcontext, data->tree, sizeof(uint) * (TIME_WINDOW + 1));
+	dr_thread_free(drcontext, data->remap, sizeof(uint) * (TIME_WINDOW + 1));
+	dr_thread_free(drcontext, data->order, sizeof(ptr_uint_t) * MAX_LINES);
+	dr_thread_free(drcontext, data->pcs, sizeof(pc_stat_t) * MAX_REUSE_PCS);
+	dr_thread_free(drcontext, data->loops, sizeof(loop_stat_t) * MAX_LOOPS);
+}
+
+void reusedist_thread_exit(void *drcontext)
+{
+	per_thread_t * data;
+	char outfilename[MAX_STRING_LENGTH];
+	char extra_info[MAX_STRING_LENGTH];
+
+	data = drmgr_get_tls_field(drcontext, tls_index);
+
+	if (data->lines != NULL){
+		dr_snprintf(extra_info, MAX_STRING_LENGTH, "%s_%d", client_arg->extra_info, dr_get_thread_id(drcontext));
+		populate_conv_filename(outfilename, client_arg->output_folder, ins_pass_name, extra_info);
+		data->outfile = dr_open_file(outfilename, DR_FILE_WRITE_OVERWRITE);
+		DR_ASSERT(data->outfile != INVALID_FILE);
+		write_report(data);
+		dr_close_file(data->outfile);
+
+		DEBUG_PRINT("%s - thread %d - %llu accesses, %llu distinct lines\n", ins_pass_name,
+			dr_get_thread_id(drcontext), data->accesses, data->distinct);
+	}
+
+	free_thread_data(drcontext, data);
+	dr_thread_free(drcontext, data, sizeof(per_thread_t));
+}
+
+/* fenwick tree over access times */
+
+static void
+tree_add(uint * tree, uint time, int value)
+{
+	for (; time <= TIME_WINDOW; time += time & (~time + 1)){
+		tree[time] += value;
+	}
+}
+
+static uint
+tree_prefix(uint * tree, uint time)
+{
+	uint sum = 0;
+	for (; time > 0; time -= time & (~time + 1)){
+		sum += tree[time];
+	}
+	return sum;
+}
+
+static uint
+get_bucket(uint distance)
+{
+	uint bucket = 0;
+
+	if (distance >= MAX_LINES) return NUM_BUCKETS - 1;
+	while (distance > 0){
+		bucket++;
+		distance >>= 1;
+	}
+	return bucket;
+}
+
+static line_entry_t *
+lookup_line(per_thread_t * data, ptr_uint_t line)
+{
+	uint index = (uint)((line * 2654435761u) >> 7) & (LINE_TABLE_SIZE - 1);
+
+	while (data->lines[index].time != 0 && data->lines[index].line != line){
+		index = (index + 1) & (LINE_TABLE_SIZE - 1);
+	}
+	return &data->lines[index];
+}
+
+/* keeps the MAX_LINES most recently used lines, renumbered 1..n in the same order. loop iteration marks are
+   moved to the number of surviving lines touched at or before them so that range counts stay the same */
+static void
+compact(per_thread_t * data)
+{
+	uint i, t;
+	uint live = 0;
+	uint drop;
+	uint running = 0;
+	uint survivors;
+	line_entry_t * entry;
+
+	memset(data->remap, 0, sizeof(uint) * (TIME_WINDOW + 1));
+	for (i = 0; i < LINE_TABLE_SIZE; i++){
+		if (data->lines[i].time != 0){
+			data->remap[data->lines[i].time] = 1;
+			live++;
+		}
+	}
+
+	drop = (live > MAX_LINES) ? live - MAX_LINES : 0;
+	data->evicted += drop;
+
+	for (t = 1; t <= TIME_WINDOW; t++){
+		if (data->remap[t] && drop > 0){
+			drop--;
+			data->remap[t] = running;
+		}
+		else if (data->remap[t]){
+			data->remap[t] = ++running | SURVIVOR;
+		}
+		else{
+			data->remap[t] = running;
+		}
+	}
+	survivors = running;
+
+	for (i = 0; i < LINE_TABLE_SIZE; i++){
+		if (data->lines[i].time != 0 && (data->remap[data->lines[i].time] & SURVIVOR)){
+			data->order[(data->remap[data->lines[i].time] & ~SURVIVOR) - 1] = data->lines[i].line;
+		}
+	}
+
+	memset(data->lines, 0, sizeof(line_entry_t) * LINE_TABLE_SIZE);
+	for (i = 0; i < survivors; i++){
+		entry = lookup_line(data, data->order[i]);
+		entry->line = data->order[i];
+		entry->time = i + 1;
+	}
+
+	/* linear time build - a 1 at every time in [1, survivors] */
+	memset(data->tree, 0, sizeof(uint) * (TIME_WINDOW + 1));
+	for (t = 1; t <= TIME_WINDOW; t++){
+		if (t <= survivors) data->tree[t]++;
+		i = t + (t & (~t + 1));
+		if (i <= TIME_WINDOW) data->tree[i] += data->tree[t];
+	}
+
+	for (i = 0; i < MAX_LOOPS; i++){
+		if (data->loops[i].started){
+			data->loops[i].last_time = data->remap[data->loops[i].last_time] & ~SURVIVOR;
+		}
+	}
+
+	data->now = survivors;
+
+	LOG_PRINT(logfile, "compaction - %u lines live, %u kept\n", live, survivors);
+}
+
+/* returns the reuse distance in lines or MAX_LINES for a cold access */
+static uint
+access_line(per_thread_t * data, ptr_uint_t line)
+{
+	line_entry_t * entry;
+	uint distance;
+
+	if (data->now == TIME_WINDOW){
+		compact(data);
+	}
+
+	entry = lookup_line(data, line);
+	if (entry->time != 0){
+		distance = tree_prefix(data->tree, data->now) - tree_prefix(data->tree, entry->time);
+		tree_add(data->tree, entry->time, -1);
+	}
+	else{
+		distance = MAX_LINES;
+		entry->line = line;
+		data->distinct++;
+	}
+
+	entry->time = ++data->now;
+	tree_add(data->tree, entry->time, 1);
+
+	return distance;
+}
+
+static per_thread_t *
+get_thread_data(void)
+{
+	void * drcontext = dr_get_current_drcontext();
+	per_thread_t * data = drmgr_get_tls_field(drcontext, tls_index);
+
+	if (data->lines == NULL){
+		data->lines = dr_thread_alloc(drcontext, sizeof(line_entry_t) * LINE_TABLE_SIZE);
+		data->tree = dr_thread_alloc(drcontext, sizeof(uint) * (TIME_WINDOW + 1));
+		data->remap = dr_thread_alloc(drcontext, sizeof(uint) * (TIME_WINDOW + 1));
+		data->order = dr_thread_alloc(drcontext, sizeof(ptr_uint_t) * MAX_LINES);
+		data->pcs = dr_thread_alloc(drcontext, sizeof(pc_stat_t) * MAX_REUSE_PCS);
+		data->loops = dr_thread_alloc(drcontext, sizeof(loop_stat_t) * MAX_LOOPS);
+		memset(data->lines, 0, sizeof(line_entry_t) * LINE_TABLE_SIZE);
+		memset(data->tree, 0, sizeof(uint) * (TIME_WINDOW + 1));
+		memset(data->pcs, 0, sizeof(pc_stat_t) * MAX_REUSE_PCS);
+		memset(data->loops, 0, sizeof(loop_stat_t) * MAX_LOOPS);
+		data->now = 0;
+	}
+
+	return data;
+}
+
+/* analysis clean calls */
+
+static void
+at_access(uint id, app_pc addr)
+{
+	per_thread_t * data = get_thread_data();
+	pc_stat_t * stat = &data->pcs[id];
+	ptr_uint_t first = (ptr_uint_t)addr >> client_arg->line_bits;
+	ptr_uint_t last = ((ptr_uint_t)addr + static_pcs[id].size - 1) >> client_arg->line_bits;
+	ptr_uint_t line;
+	uint distance;
+
+	/* an access straddling lines touches each of them */
+	for (line = first; line <= last; line++){
+		distance = access_line(data, line);
+		if (distance == MAX_LINES) stat->cold++;
+		else stat->hist[get_bucket(distance)]++;
+		stat->accesses++;
+		data->accesses++;
+	}
+}
+
+static void
+at_latch(uint id)
+{
+	per_thread_t * data = get_thread_data();
+	loop_stat_t * loop = &data->loops[id];
+	uint lines;
+
+	if (loop->started){
+		lines = tree_prefix(data->tree, data->now) - tree_prefix(data->tree, loop->last_time);
+		loop->iterations++;
+		loop->total_lines += lines;
+		if (lines > loop->max_lines) loop->max_lines = lines;
+		loop->hist[get_bucket(lines)]++;
+	}
+
+	loop->started = true;
+	loop->last_time = data->now;
+}
+
+/* report */
+
+static uint
+get_loop_level(uint id)
+{
+	uint i;
+	uint level = 1;
+	static_loop_t * loop = &static_loops[id];
+
+	for (i = 0; i < num_static_loops; i++){
+		if (i != id && static_loops[i].head <= loop->head && static_loops[i].latch >= loop->latch
+			&& !(static_loops[i].head == loop->head && static_loops[i].latch == loop->latch)){
+			level++;
+		}
+	}
+	return level;
+}
+
+static void
+write_histogram(file_t file, uint64 * hist)
+{
+	uint i;
+	uint n = NUM_BUCKETS;
+
+	while (n > 0 && hist[n - 1] == 0) n--;
+	dr_fprintf(file, "%d", n);
+	for (i = 0; i < n; i++){
+		dr_fprintf(file, ",%llu", hist[i]);
+	}
+	dr_fprintf(file, "\n");
+}
+
+static void
+write_report(per_thread_t * data)
+{
+	uint i;
+	static_pc_t * pc;
+	static_loop_t * loop;
+	loop_stat_t * stat;
+
+	dr_fprintf(data->outfile, "t,%d,%llu,%llu,%llu\n", 1 << client_arg->line_bits, data->accesses, data->distinct, data->evicted);
+
+	dr_mutex_lock(mutex);
+
+	for (i = 0; i < num_static_pcs; i++){
+		if (data->pcs[i].accesses == 0) continue;
+		pc = &static_pcs[i];
+		dr_fprintf(data->outfile, "p,%x,%x,%d,%d,%llu,%llu,", pc->module_start, pc->pc - pc->module_start,
+			pc->direction, pc->size, data->pcs[i].accesses, data->pcs[i].cold);
+		write_histogram(data->outfile, data->pcs[i].hist);
+	}
+
+	for (i = 0; i < num_static_loops; i++){
+		stat = &data->loops[i];
+		if (stat->iterations == 0) continue;
+		loop = &static_loops[i];
+		dr_fprintf(data->outfile, "l,%x,%x,%x,%d,%llu,%llu,%d,", loop->module_start, loop->head - loop->module_start,
+			loop->latch - loop->module_start, get_loop_level(i), stat->iterations,
+			stat->total_lines / stat->iterations, stat->max_lines);
+		write_histogram(data->outfile, stat->hist);
+	}
+
+	dr_mutex_unlock(mutex);
+}
+
+/* instrumentation */
+
+static int
+get_static_pc(app_pc pc, app_pc module_start, uint size, bool write)
+{
+	int id = -1;
+	void * value;
+
+	dr_mutex_lock(mutex);
+	value = hashtable_lookup(&pc_table, pc);
+	if (value != NULL){
+		id = (int)((ptr_uint_t)value - 1);
+	}
+	else if (num_static_pcs < MAX_REUSE_PCS){
+		id = num_static_pcs++;
+		static_pcs[id].pc = pc;
+		static_pcs[id].module_start = module_start;
+		static_pcs[id].size = 0;
+		static_pcs[id].direction = 0;
+		hashtable_add(&pc_table, pc, (void *)(ptr_uint_t)(id + 1));
+	}
+	if (id != -1){
+		if (size > static_pcs[id].size) static_pcs[id].size = size;
+		static_pcs[id].direction |= write ? REUSE_OUTPUT : REUSE_INPUT;
+	}
+	dr_mutex_unlock(mutex);
+
+	return id;
+}
+
+static int
+get_static_loop(app_pc latch, app_pc loop_head, app_pc module_start)
+{
+	int id = -1;
+	void * value;
+
+	dr_mutex_lock(mutex);
+	value = hashtable_lookup(&loop_table, latch);
+	if (value != NULL){
+		id = (int)((ptr_uint_t)value - 1);
+	}
+	else if (num_static_loops < MAX_LOOPS){
+		id = num_static_loops++;
+		static_loops[id].head = loop_head;
+		static_loops[id].latch = latch;
+		static_loops[id].module_start = module_start;
+		hashtable_add(&loop_table, latch, (void *)(ptr_uint_t)(id + 1));
+	}
+	dr_mutex_unlock(mutex);
+
+	return id;
+}
+
+/* stack (ebp / esp based) references are spills and locals, not the buffers the kernel walks */
+static bool
+is_buffer_reference(opnd_t opnd)
+{
+	reg_id_t reg;
+
+	reg = opnd_get_base(opnd);
+	if (reg != 0 && reg != DR_REG_XBP && reg != DR_REG_XSP) return true;
+	reg = opnd_get_index(opnd);
+	if (reg != 0 && reg != DR_REG_XBP && reg != DR_REG_XSP) return true;
+	return false;
+}
+
+static void
+instrument_access(void * drcontext, instrlist_t * bb, instr_t * where, opnd_t ref, bool write, app_pc module_start)
+{
+	reg_id_t reg1 = DR_REG_XBX;
+	reg_id_t reg2 = DR_REG_XCX;
+	int id;
+
+	id = get_static_pc(instr_get_app_pc(where), module_start, drutil_opnd_mem_size_in_bytes(ref, where), write);
+	if (id == -1) return;
+
+	dr_save_reg(drcontext, bb, where, reg1, SPILL_SLOT_2);
+	dr_save_reg(drcontext, bb, where, reg2, SPILL_SLOT_3);
+	drutil_insert_get_mem_addr(drcontext, bb, where, ref, reg1, reg2);
+	dr_insert_clean_call(drcontext, bb, where, (void *)at_access, false, 2,
+		OPND_CREATE_INT32(id), opnd_create_reg(reg1));
+	dr_restore_reg(drcontext, bb, where, reg2, SPILL_SLOT_3);
+	dr_restore_reg(drcontext, bb, where, reg1, SPILL_SLOT_2);
+}
+
+dr_emit_flags_t
+reusedist_bb_analysis(void *drcontext, void *tag, instrlist_t *bb,
+				bool for_trace, bool translating,
+				OUT void **user_data)
+{
+	return DR_EMIT_DEFAULT;
+}
+
+dr_emit_flags_t
+reusedist_bb_instrumentation(void *drcontext, void *tag, instrlist_t *bb,
+				instr_t *instr, bool for_trace, bool translating,
+				void *user_data)
+{
+	instr_t * first = NULL;
+	instr_t * current;
+	module_data_t * module_data;
+	app_pc module_start;
+	app_pc target;
+	int id;
+	uint i;
+
+	if (!instr_ok_to_mangle(instr)){
+		return DR_EMIT_DEFAULT;
+	}
+
+	for (current = instrlist_first(bb); current != NULL; current = instr_get_next(current)){
+		if (instr_ok_to_mangle(current)){
+			first = current;
+			break;
+		}
+	}
+
+	if (first == NULL || !filter_from_list(head, first, client_arg->filter_mode)){
+		return DR_EMIT_DEFAULT;
+	}
+
+	module_data = dr_lookup_module(instr_get_app_pc(instr));
+	if (module_data == NULL){
+		return DR_EMIT_DEFAULT;
+	}
+	module_start = module_data->start;
+	dr_free_module_data(module_data);
+
+	if (instr_reads_memory(instr)){
+		for (i = 0; i < instr_num_srcs(instr); i++){
+			if (opnd_is_memory_reference(instr_get_src(instr, i)) && is_buffer_reference(instr_get_src(instr, i))){
+				instrument_access(drcontext, bb, instr, instr_get_src(instr, i), false, module_start);
+			}
+		}
+	}
+	if (instr_writes_memory(instr)){
+		for (i = 0; i < instr_num_dsts(instr); i++){
+			if (opnd_is_memory_reference(instr_get_dst(instr, i)) && is_buffer_reference(instr_get_dst(instr, i))){
+				instrument_access(drcontext, bb, instr, instr_get_dst(instr, i), true, module_start);
+			}
+		}
+	}
+
+	/* a backward direct branch ends an iteration of the loop headed by its target; the call is placed before the
+	   branch so the exiting (not taken) execution closes the last iteration as well */
+	if ((instr_is_cbr(instr) || instr_is_ubr(instr)) && opnd_is_pc(instr_get_target(instr))){
+		target = opnd_get_pc(instr_get_target(instr));
+		if (target <= instr_get_app_pc(instr) && target >= module_start){
+			id = get_static_loop(instr_get_app_pc(instr), target, module_start);
+			if (id != -1){
+				dr_insert_clean_call(drcontext, bb, instr, (void *)at_latch, false, 1, OPND_CREATE_INT32(id));
+			}
+		}
+	}
+
+	return DR_EMIT_DEFAULT;
+}
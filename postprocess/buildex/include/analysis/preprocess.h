@@ -1,7 +1,7 @@
 #ifndef _PREPROCESS_H
 #define _PREPROCESS_H
 
-#include  "..\..\..\dr_clients\include\output.h"
+#include  "../../../dr_clients/include/output.h"
 #include <string>
 #include <iostream>
 #include <stdint.h>
@@ -19,6 +19,7 @@ std::vector<uint32_t> get_instrace_startpoints(vec_cinstr &instrs, std::vector<u
 
 vec_cinstr filter_instr_trace(uint32_t start_pc, uint32_t end_pc, vec_cinstr &unfiltered_instrs);
 vec_cinstr filter_instr_trace(std::vector<uint32_t> start_pcs, std::vector<uint32_t> end_pcs, vec_cinstr &unfiltered_instrs);
+std::vector< std::vector<uint32_t> > split_instr_trace(std::vector<uint32_t> start_pcs, std::vector<uint32_t> end_pcs, vec_cinstr &instrs);
 
 std::pair<uint32_t, uint32_t> get_start_end_pcs(std::vector<Static_Info *> &infos, Static_Info * first);
 
@@ -8,7 +8,7 @@ all the static information found about dynamically executed instructions */
 #include <stdint.h>
 #include <vector>
 
-#include  "..\..\..\dr_clients\include\output.h"
+#include  "../../../dr_clients/include/output.h"
 
 
 //#include "analysis/x86_analysis.h"
@@ -4,6 +4,8 @@
 #include <fstream>
 #include <iostream>
 #include <vector>
+#include <map>
+#include <unordered_map>
 #include <stdint.h>
 
 #include "trees/trees.h"
@@ -38,13 +40,35 @@ void build_conc_tree(uint64_t destination,
 				std::vector<mem_regions_t *> &regions,
 				std::vector<Func_Info_t *> &func_info);
 	
+/* canonical store of the conditional predicates built for the trees of one trace. a dynamic conditional (the lines
+   of its compare and jump) is built from the trace once; a predicate equal to one built before for the same jump pc
+   is interned to it. the first conditional tree of a predicate links the canonical nodes, later ones get copies */
+struct cond_pred_t {
+	uint32_t jump_pc;
+	uint64_t hash;
+	Node * pred;		/* compare node and its sources */
+	bool linked;
+};
+
+struct cond_store_t {
+	std::map< std::pair<uint32_t, uint32_t>, cond_pred_t * > instances;	/* (line_cond, line_jump) */
+	std::unordered_map<uint64_t, std::vector<cond_pred_t *> > predicates;	/* hash combined with the jump pc */
+	uint32_t built;
+	uint32_t reused;
+	uint32_t interned;
+
+	cond_store_t();
+	~cond_store_t();
+};
+
 void build_conc_trees_for_conditionals(
 				std::vector<uint32_t> start_points, 
 				Conc_Tree * tree, 
 				vec_cinstr &instrs,
 				uint64_t farthest,
 				std::vector<mem_regions_t *> &regions,
-				std::vector<Func_Info_t *> &func_info);
+				std::vector<Func_Info_t *> &func_info,
+				cond_store_t * store);
 
 /* tree clustering and other categorizing */				
 				
@@ -72,6 +96,22 @@ std::vector< std::vector <Conc_Tree *> > cluster_trees
 				std::string output_folder,
 				std::vector<Func_Info_t *> &func_info);
 
+std::vector< std::vector <Conc_Tree *> > cluster_trees_adaptive
+				(std::vector<mem_regions_t *> mem_regions,
+				std::vector<mem_regions_t *> &total_regions,
+				std::vector<uint32_t> start_points,
+				vec_cinstr &instrs,
+				uint64_t farthest,
+				std::string output_folder,
+				std::vector<Func_Info_t *> &func_info,
+				uint32_t window,
+				uint32_t max_cluster_trees,
+				uint32_t seed);
+
+void number_sampled_trees(
+				std::vector< std::vector<Conc_Tree *> > &clustered_trees,
+				std::vector< std::pair<int32_t, int32_t> > samples);
+
 /* abs tree building */	
 
 struct Abs_Tree_Charac{
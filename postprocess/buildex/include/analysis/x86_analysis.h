@@ -4,8 +4,9 @@
  //this will be coded as a c file which can be both used inside 
  //therefore, will not use any C++ features 
 
-#include  "..\..\..\dr_clients\include\output.h"
-#include "analysis\staticinfo.h"
+#include  "../../../dr_clients/include/output.h"
+#include "analysis/staticinfo.h"
+#include "analysis/x86_semantics.h"
 #include <string>
 #include <iostream>
 #include <stdint.h>
@@ -39,6 +40,7 @@ enum {
 	op_split_l,
 	op_concat,
 	op_signex,
+	op_convert,		/* integer <-> floating point and float <-> double (cvt*) */
 
 	/* to cater to different widths */
 	op_partial_overlap,
@@ -80,16 +82,18 @@ enum {
  } rinstr_t;
 
  
-/* reducing cinstrs to rinstrs */
+/* reducing cinstrs to rinstrs; rinstr is caller provided storage for MAX_RINSTRS (analysis/x86_semantics.h) */
  rinstr_t * cinstr_to_rinstrs_eflags
 			(cinstr_t * cinstr, 
+			rinstr_t * rinstr,
 			int &amount, 
-			std::string disasm, 
+			const std::string &disasm, 
 			uint32_t line);
  rinstr_t * cinstr_to_rinstrs (
 			cinstr_t * cinstr, 
+			rinstr_t * rinstr,
 			int &amount, 
-			std::string disasm, 
+			const std::string &disasm, 
 			uint32_t line);
  void cinstr_convert_reg(cinstr_t * instr);
  cinstr_t * create_new_cinstr(const cinstr_t  &instr);
@@ -99,9 +103,8 @@ enum {
 
  void	update_floating_point_regs(
 	 vec_cinstr  &instrs,
-	 uint32_t direction,
-	 std::vector<Static_Info * > static_info,
-	 std::vector<uint32_t> pc);
+	 const std::vector<uint32_t> &start_pcs,
+	 const std::vector<uint32_t> &end_pcs);
  void	update_regs_to_mem_range(vec_cinstr  &instrs);
 
  /* x86 instruction analysis functions */
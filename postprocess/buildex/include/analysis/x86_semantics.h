@@ -0,0 +1,144 @@
+#ifndef _X86_SEMANTICS_H
+#define _X86_SEMANTICS_H
+
+#include <stdint.h>
+
+/*
+declarative semantics of the x86 instructions reduced by cinstr_to_rinstrs. an opcode maps to a shape - the
+flavors (forms) of the instruction, each a list of reduced instruction templates over the operands of the complex
+instruction - plus the operation filled into the shape, the condition it tests and the eflags it writes. opcodes
+of the same shape (e.g. all two operand arithmetic) share it. cinstr_to_rinstrs picks the first form whose operand
+counts and guard match and expands its templates into caller provided storage.
+
+adding an instruction is a table entry in x86_semantics.cpp; a new shape is only needed for a new way of breaking
+up an instruction.
+*/
+
+#define MAX_RINSTRS		4	/* reduced instructions of a single complex instruction */
+#define RSEM_MAX_FORMS	4
+
+/* EFLAGS bit positions */
+enum eflag_bits {
+
+	Reserved_31,
+	Reserved_30,
+	Reserved_29,
+	Reserved_28,
+	Reserved_27,
+	Reserved_26,
+	Reserved_25,
+	Reserved_24,
+	Reserved_23,
+	Reserved_22,
+	ID_Flag,
+	Virtual_Interrupt_Pending,
+	Virtual_Interrupt_Flag,
+	Alignment_Check,
+	Virtual_Mode,
+	Resume_Flag,
+	Reserved_15,
+	Nested_Task,
+	IO_Privilege_Level,
+	Overflow_Flag,
+	Direction_Flag,
+	Interrupt_Enable_Flag,
+	Trap_Flag,
+	Sign_Flag,
+	Zero_Flag,
+	Reserved_5,
+	Auxiliary_Carry_Flag,
+	Reserved_3,
+	Parity_Flag,
+	Reserved_1,
+	Carry_Flag
+
+};
+
+/* operand kinds of a template */
+enum {
+	RO_NONE,
+	RO_DST,			/* dsts[index] */
+	RO_SRC,			/* srcs[index] */
+	RO_VIRTUAL,		/* DR_REG_VIRTUAL_1, value * srcs[index].width wide */
+	RO_IMM,			/* immediate value; width bytes wide or as wide as srcs[index] */
+	RO_FLAG			/* immediate 1 if the condition of the opcode holds else 0, as wide as dsts[index] */
+};
+
+typedef struct _rsem_opnd_t {
+	uint8_t kind;
+	uint8_t index;
+	uint8_t width;		/* RO_DST / RO_SRC - non zero selects a part of the operand ... */
+	uint8_t offset;		/* ... starting offset bytes below its end (the low bytes of a register come last) */
+	int32_t value;
+} rsem_opnd_t;
+
+#define RSEM_OP		-1	/* template operation filled from the opcode's entry */
+
+typedef struct _rsem_instr_t {
+	int operation;
+	rsem_opnd_t dst;
+	uint32_t num_srcs;
+	rsem_opnd_t srcs[2];
+	bool sign;
+} rsem_instr_t;
+
+/* guards of a form; all set bits have to hold */
+#define RG_SAME_SRCS	0x01	/* srcs[0] and srcs[1] are the same location (xor eax, eax) */
+#define RG_NO_SCALE		0x02	/* lea without an index */
+#define RG_CARRY		0x04	/* carry flag set */
+#define RG_COND			0x08	/* condition of the opcode holds */
+#define RG_SRC_MEM		0x10	/* srcs[0] is memory */
+#define RG_EXCHANGE		0x20	/* dsts[0], dsts[1] are srcs[0], srcs[1] */
+#define RG_DST_REG		0x40	/* dsts[0] is a register */
+
+typedef struct _rsem_form_t {
+	uint32_t num_dsts;
+	uint32_t num_srcs;
+	uint32_t guard;
+	uint32_t amount;
+	rsem_instr_t rinstrs[MAX_RINSTRS];
+} rsem_form_t;
+
+/* shape flags */
+#define RSEM_SKIP		0x1	/* no destination of interest (branches, nops, control words); no matching form is not an error */
+#define RSEM_ADDRESS	0x2	/* srcs are base, index, scale, disp; an absent base (register 0) reads as immediate 0 */
+#define RSEM_EFLAGS		0x4	/* only writes the eflags; reduced by cinstr_to_rinstrs_eflags, skipped otherwise */
+
+typedef struct _rsem_shape_t {
+	uint32_t flags;
+	uint32_t num_forms;
+	rsem_form_t forms[RSEM_MAX_FORMS];
+} rsem_shape_t;
+
+/* conditions of cmovcc / setcc */
+enum {
+	RC_NONE,
+	RC_L,
+	RC_LE,
+	RC_NLE,
+	RC_NL,
+	RC_Z,
+	RC_NZ,
+	RC_S,
+	RC_NS,
+	RC_B
+};
+
+/* entry flags */
+#define RSEM_FLOATING	0x1	/* the reduced instructions work on floating point values */
+#define RSEM_FP_PUSH	0x2	/* pushes the x87 stack before writing its destination */
+#define RSEM_FP_POP		0x4	/* pops the x87 stack after reading and writing its operands */
+
+typedef struct _rsem_t {
+	uint32_t opcode;
+	const rsem_shape_t * shape;
+	int operation;			/* replaces RSEM_OP */
+	uint32_t cond;			/* RC_* */
+	uint32_t eflags;		/* mask of the eflag_bits written */
+	uint32_t flags;
+} rsem_t;
+
+/* indexed by opcode; NULL for an opcode without semantics */
+const rsem_t * get_opcode_semantics(uint32_t opcode);
+
+#endif
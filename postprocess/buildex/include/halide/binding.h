@@ -0,0 +1,44 @@
+#ifndef _HALIDE_BINDING_H
+#define _HALIDE_BINDING_H
+
+#include <stdint.h>
+#include <vector>
+#include <ostream>
+#include <string>
+
+#include "halide/halide.h"
+#include "analysis/x86_analysis.h"
+#include "memory/memregions.h"
+
+/*
+binding manifest - tells the funcreplace client how to call the AOT compiled lifted pipelines (halide_out_<n>) in place
+of the original function. for each buffer we find where the original function gets its base pointer from: a stack
+argument slot (read relative to the stack pointer at entry) or a register live at entry; the same is done for the
+scalar Params.
+
+manifest format (one record per line, # starts a comment)
+	function <module> <entry_pc> <ret_pop_bytes> <library>
+	pipeline <symbol> <no_of_args>
+	param <arg|reg|none> <slot or register> <width>
+	buffer <name> <arg|reg|none> <slot or register> <offset> <elem_size> <dims> (<min> <extent> <stride>) * dims
+	end
+the pipelines of a function are called in order; the offset is added to the bound pointer to get the element at min
+and is 0 unless edited as the trace does not carry the pointer values. a function with a "none" binding is only timed.
+*/
+
+#define BINDING_NONE	0
+#define BINDING_ARG		1
+#define BINDING_REG		2
+
+struct buffer_binding_t {
+	mem_regions_t * region;
+	uint32_t location;
+	uint32_t index; /* stack argument slot or DR register (full width) */
+};
+
+std::vector<buffer_binding_t> find_buffer_bindings(vec_cinstr &unfiltered_instrs, vec_cinstr &instrs,
+	std::vector<mem_regions_t *> regions, uint32_t * ret_pop);
+void print_binding_manifest(std::ostream &out, Halide_Program * halide, vec_cinstr &unfiltered_instrs,
+	vec_cinstr &instrs, std::string library);
+
+#endif
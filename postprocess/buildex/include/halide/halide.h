@@ -7,10 +7,17 @@
 #include <map>
 
 #include "halide/halide.h"
+#include "halide/halide_ir.h"
 #include "trees/trees.h"
 #include "memory/memregions.h"
 
 
+/* schedules that can be emitted for the lifted program */
+#define SCHEDULE_NONE		0	/* Halide default - everything inlined and serial */
+#define SCHEDULE_PARALLEL	1	/* vectorized inner dimension, parallel outer dimension, intermediates computed at root */
+#define SCHEDULE_TILED		2	/* parallel vectorized tiles, intermediates computed per tile of their consumer */
+#define SCHEDULE_TUNABLE	3	/* schedule knobs read from the environment; the program can time itself (see utility/autotune.py) */
+
 struct mem_dump_regions_t{
 
 	string name;
@@ -47,9 +54,8 @@ public:
 		std::string name;
 		RDom_type type;
 		Abs_Node * red_node;
-		std::vector< std::pair<int32_t, int32_t> > extents;
-
-		std::vector< std::vector<int32_t> > abstract_indexes;
+		std::vector< std::pair<int32_t, int32_t> > extents; /* first and last index per dimension */
+		uint32_t update; /* RED_* of halide/reduction.h */
 	};
 
 
@@ -60,13 +66,6 @@ public:
 		uint32_t variations;
 	};
 
-	/* select expressions for input dependent conditionals */
-	struct Select_Expr {
-		std::string name;
-		std::string condition;
-		std::string truth_value;
-	};
-
 	
 	std::vector<Abs_Node *> inputs;
 	std::vector<Abs_Node *> params;
@@ -78,6 +77,11 @@ public:
 	std::vector<Func *> funcs;
 	std::vector<Abs_Node *> output; /* this is used to populate the arguments string */
 
+	uint32_t schedule;
+
+	/* expressions of all definitions - structurally equal subexpressions are shared */
+	Halide_IR ir;
+
 	
 public:
 
@@ -102,7 +106,7 @@ public:
 	/* Main halide program printing function */
 	void print_halide_program(std::ostream &file, std::vector<std::string> red_variables);
 
-	std::vector<mem_dump_regions_t *> get_memory_regions(std::vector<std::string> memdump_files);
+	std::vector<mem_dump_regions_t *> get_memory_regions(std::vector<std::string> memdump_files, std::string folder); /* dump.h and the raw files go to folder */
 	void resolve_conditionals();
 
 
@@ -115,16 +119,28 @@ private:
 	std::string print_function(Func * func, std::vector<std::string> red_variables);
 	std::string print_pure_trees(Func * func);
 	std::string print_red_trees(Func * func, std::vector<std::string> red_variables);
-	std::string print_predicated_tree(std::vector<Abs_Tree *> trees, std::string expr_tag, std::vector<std::string> vars);
+	std::string print_predicated_tree(std::vector<Abs_Tree *> trees, std::string expr_tag, std::vector<std::string> vars, bool saturate);
 
-	/* print out sub parts of the Halide function */
-	std::string print_abs_tree(Node * node, Node * head, std::vector<string> vars);
-	std::string print_conditional_trees(std::vector< std::pair<Abs_Tree *, bool > > conditions,
+	/* translate the trees into the expression IR (halide/halide_ir.h) */
+	hir_expr_t * build_abs_tree(Node * node, Node * head, std::vector<string> vars);
+	std::vector< std::pair<hir_expr_t *, bool> > build_conditional_literals(std::vector< std::pair<Abs_Tree *, bool > > conditions,
 		std::vector<string> vars);
 
-	/* printing full and partial overlap nodes */
-	std::string print_full_overlap_node(Abs_Node * node, Node * head, std::vector<string> vars);
-	std::string print_partial_overlap_node(Abs_Node * node, Node * head, std::vector<string> vars);
+	/* full and partial overlap nodes */
+	hir_expr_t * build_full_overlap_node(Abs_Node * node, Node * head, std::vector<string> vars);
+	hir_expr_t * build_partial_overlap_node(Abs_Node * node, Node * head, std::vector<string> vars);
+
+	/* schedule generation */
+	std::string print_schedule();
+	std::string print_func_schedule(Func * func, Func * consumer);
+	std::string print_func_schedule_tunable(Func * func, Func * consumer);
+	std::string print_reduction_schedule(Func * func, std::string guard);
+	std::string print_tuning_driver();
+	std::string print_param_bindings(std::string env, std::string list, bool required);
+	std::string print_validation_driver();
+	std::vector<Func *> get_final_funcs();
+	std::vector<Func *> get_producers(Func * func);
+	Func * get_consumer(Func * func);
 
 	/* auxiliary functions */
 	Func *check_function(mem_regions_t * mem);
@@ -132,9 +148,6 @@ private:
 	void populate_input_params(Abs_Node * node);
 	std::string print_rdom(RDom * rdom, std::vector<std::string> variables);
 	int32_t get_rdom_location(Func *func, RDom *rdom);
-
-	/* very crude change*/
-	std::string get_indirect_string(Abs_Node * node, Abs_Node * head, std::vector<std::string> vars);
 	
 
 };
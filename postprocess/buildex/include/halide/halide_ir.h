@@ -0,0 +1,80 @@
+#ifndef _HALIDE_IR_H
+#define _HALIDE_IR_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+
+/*
+structured form of the expressions of the lifted program. the Abs_Trees of a definition are translated once into
+hash consed expression nodes - structurally equal subexpressions are the same node - and the backends work on the
+nodes instead of re-walking the trees. the C++ text backend (print_hir_definition) binds a subexpression used more
+than once in a definition to an Expr printed before it.
+*/
+
+enum hir_kind_t {
+	HIR_LEAF,		/* text printed as is - Vars, buffer accesses, constants, Params */
+	HIR_NEG,		/* - a */
+	HIR_UNARY,		/* <op> a */
+	HIR_NARY,		/* a <op> b <op> ... */
+	HIR_CAST,		/* cast<text>(a) */
+	HIR_MASK,		/* a & value */
+	HIR_SHIFT,		/* a >> value */
+	HIR_CALL,		/* text(a, b, ...) */
+	HIR_ACCESS,		/* text(a) - indirect access into a buffer */
+	HIR_NOT,		/* !a */
+	HIR_AND,		/* a && b && ... */
+	HIR_SELECT,		/* select(a, b, c) */
+	HIR_CLAMP		/* clamp(a, b, c) */
+};
+
+struct hir_expr_t {
+	hir_kind_t kind;
+	std::string text;		/* leaf text, operator, cast type, called function or accessed buffer */
+	int64_t value;			/* mask or shift amount */
+	std::vector<hir_expr_t *> args;
+	uint64_t hash;
+	uint32_t id;			/* creation order; a node's args always have smaller ids */
+};
+
+class Halide_IR {
+
+public:
+
+	Halide_IR();
+	~Halide_IR();
+
+	/* returns the existing node if a structurally equal one was made before */
+	hir_expr_t * make(hir_kind_t kind, std::string text, std::vector<hir_expr_t *> args, int64_t value = 0);
+	hir_expr_t * leaf(std::string text);
+
+	uint32_t size();
+	uint32_t shared(); /* make() calls answered with an existing node */
+
+private:
+
+	std::unordered_map<uint64_t, std::vector<hir_expr_t *> > table;
+	std::vector<hir_expr_t *> exprs;
+	uint32_t hits;
+
+};
+
+/* a predicated value; literals are (predicate, taken) pairs that all have to hold */
+struct hir_branch_t {
+	std::vector< std::pair<hir_expr_t *, bool> > literals;
+	hir_expr_t * value;
+};
+
+#define HIR_MAX_DECISION_PREDICATES	8
+
+/* the first branch whose literals hold, otherwise 'otherwise' - as a decision structure of selects over single
+   predicates; falls back to a select chain over conjunctions with more than HIR_MAX_DECISION_PREDICATES predicates */
+hir_expr_t * build_hir_decision(Halide_IR &ir, std::vector<hir_branch_t> branches, hir_expr_t * otherwise);
+
+/* C++ text backend */
+std::string print_hir_expr(hir_expr_t * expr, std::map<hir_expr_t *, std::string> &bound);
+std::string print_hir_definition(std::string lhs, hir_expr_t * expr, std::string prefix);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef _HALIDE_REDUCTION_H
+#define _HALIDE_REDUCTION_H
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+#include "trees/trees.h"
+#include "trees/nodes.h"
+
+/*
+reduction analysis over the abstract trees of an update definition. an update is self dependent when a node other
+than the head reads the buffer the head writes; the operation combining that read with the new value decides whether
+the update is associative (and can be split with rfactor) or has to run in the order of the reduction domain.
+min / max updates are recognized from two branches - one keeping the old value, one storing a value it was compared
+against.
+*/
+
+#define RED_NONE		0	/* order dependent or not understood */
+#define RED_SUM			1	/* out = out + e, out = out - e */
+#define RED_COUNT		2	/* out = out + 1 */
+#define RED_PRODUCT		3	/* out = out * e */
+#define RED_BITWISE		4	/* out = out & e, out | e, out ^ e */
+#define RED_MIN			5
+#define RED_MAX			6
+
+Abs_Node * find_self_read(Abs_Tree * tree);
+uint32_t classify_reduction(std::vector<Abs_Tree *> trees);
+std::string reduction_name(uint32_t update);
+
+#endif
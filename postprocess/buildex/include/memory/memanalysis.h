@@ -21,4 +21,7 @@ std::vector<mem_regions_t *> get_input_output_regions(std::vector<mem_regions_t
 std::vector<mem_regions_t *> get_input_regions(std::vector<mem_regions_t *> total_regions, std::vector<pc_mem_region_t *> &pc_mems,
 	std::vector<uint32_t> start_points, vec_cinstr &instrs);
 
+/* output region of a single function's trace - the output or intermediate buffer it writes most, else output */
+mem_regions_t * get_function_output_region(std::vector<mem_regions_t *> &total_regions, vec_cinstr &instrs, mem_regions_t * output);
+
 #endif
\ No newline at end of file
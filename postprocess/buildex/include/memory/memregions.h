@@ -5,8 +5,8 @@
 #include <string>
 #include <vector>
 #include "meminfo.h"
-#include "analysis\staticinfo.h"
-#include "analysis\x86_analysis.h"
+#include "analysis/staticinfo.h"
+#include "analysis/x86_analysis.h"
 
 #define DIMENSIONS 3
 
@@ -79,6 +79,7 @@ void remove_possible_stack_frames(std::vector<pc_mem_region_t *> &pc_mem, std::v
 /* extracting random locations, memregions */
 std::vector<uint64_t> get_nbd_of_random_points(std::vector<mem_regions_t *> image_regions, uint32_t seed, uint32_t * stride);
 std::vector<uint64_t> get_nbd_of_random_points_2(std::vector<mem_regions_t *> image_regions, uint32_t seed, uint32_t * stride);
+std::vector< std::vector<int32_t> > get_stratified_index_list(mem_regions_t * mem, uint32_t * level, std::vector<bool> &visited, uint32_t border);
 mem_regions_t* get_random_output_region(std::vector<mem_regions_t *> regions);
 uint64_t get_random_mem_location(mem_regions_t * region, uint32_t seed);
 uint32_t get_region_size(mem_regions_t * region);
@@ -1,7 +1,7 @@
  #ifndef _NODES_H
  #define _NODES_H
  
-#include  "..\..\..\dr_clients\include\output.h"
+#include  "../../../dr_clients/include/output.h"
 #include <vector>
 #include <stdint.h>
 
@@ -2,11 +2,15 @@
  #define _TREES_H
  
  #include <stdint.h>
- #include "trees\nodes.h"
- #include "analysis\x86_analysis.h"
+ #include "trees/nodes.h"
+ #include "analysis/x86_analysis.h"
  
  /* trees and their routines */
 
+/* optional rules of Tree::normalize_tree */
+#define NORMALIZE_OR_MINUS_1	0x1		/* remove_or_minus_1 */
+#define NORMALIZE_IDENTITIES	0x2		/* remove_identities */
+
 typedef void *  (*node_mutator) (Node * node, void * value);
 typedef void *  (*return_mutator) (void * node_value, std::vector<void *> traverse_value, void * value);
 typedef Node *  (*node_to_node)(void * head, void * node, void * peripheral_data);
@@ -37,7 +41,7 @@ void * empty_ret_mutator(void * value, vector<void *> values, void * ori_value);
 
 	 uint32_t num_nodes;
 	 int32_t tree_num; /* this is for numbering the tree (most porabably based on output location - used in tree clustering) */
-	 static uint32_t num_paras;
+	 static thread_local uint32_t num_paras; /* per lifting job */
 	 bool recursive;
 	 bool dummy_tree;
 
@@ -84,6 +88,7 @@ void * empty_ret_mutator(void * value, vector<void *> values, void * ori_value);
 	 void remove_or_minus_1();
 	 void mark_recursive();
 	 void remove_identities();
+	 void normalize_tree(uint32_t rules); /* the passes above fused into one bottom-up pass */
  };
 
 
@@ -103,6 +108,7 @@ void * empty_ret_mutator(void * value, vector<void *> values, void * ori_value);
 
 	 frontier_t * frontier;  /*this is actually a hash table keeping pointers to the Nodes already allocated */
 	 std::vector<uint32_t> mem_in_frontier; /* memoization structures for partial mem and reg writes and reads */
+	 uint32_t frontier_size; /* live entries over all buckets - its peak goes to the metrics report */
 	 
 	 bool func_inside;
 	 uint32_t func_index;
@@ -117,6 +123,7 @@ void * empty_ret_mutator(void * value, vector<void *> values, void * ori_value);
 	 void get_partial_overlap_nodes(std::vector< std::pair<Node *, std::vector<Node *> > > &nodes, operand_t * opnd);
 
 	 void number_parameters(Node * node, vector<mem_regions_t *> regions);
+	 uint64_t get_structural_hash(Node * node);
 
 
  public:
@@ -154,6 +161,7 @@ void * empty_ret_mutator(void * value, vector<void *> values, void * ori_value);
 	 void remove_dest_forward(operand_t * opnd);
 
 	 void number_parameters(std::vector<mem_regions_t *> regions);
+	 uint64_t get_structural_hash();
 	 std::string serialize_tree();
 	 void construct_tree(std::string stree);
 	 void print_conditionals();
@@ -215,7 +223,7 @@ void * empty_ret_mutator(void * value, vector<void *> values, void * ori_value);
 	 
 	 void build_compound_tree_exact(std::vector<Abs_Tree *> abs_trees);
 	 void build_compound_tree_unrolled(std::vector<Abs_Tree *> abs_trees);
-	 void abstract_buffer_indexes();
+	 bool abstract_buffer_indexes();
 	 Abs_Tree * compound_to_abs_tree();
 
 	 std::string serialize_tree();
@@ -4,7 +4,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "common_defines.h"
-#include "..\..\dr_clients\include\output.h"
+#include "../../dr_clients/include/output.h"
 
 
 enum {
@@ -0,0 +1,80 @@
+#ifndef _METRICS_BUILDEX_H
+#define _METRICS_BUILDEX_H
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+
+/*
+structured metrics for the buildex pipeline - scoped timers around the stages and key functions and a fixed set of
+counters. everything is off unless init_metrics() is called (-metrics <file>); a disabled counter or timer costs a
+single branch on metrics_enabled. the report is written as json when the process exits
+*/
+
+enum metric_counter_id_t {
+	METRIC_BYTES_READ, /* bytes of trace / disassembly text consumed */
+	METRIC_INSTRS_PARSED, /* cinstrs created from the trace */
+	METRIC_DISASM_PARSED, /* static disassembly entries */
+	METRIC_RINSTRS_DECODED, /* rinstrs produced by cinstr_to_rinstrs */
+	METRIC_TREES_BUILT,
+	METRIC_CLUSTERS,
+	METRIC_NODES_ALLOCATED,
+	METRIC_FRONTIER_PEAK, /* largest number of live frontier entries in a single tree build */
+	METRIC_CONDITIONALS_BUILT, /* conditional predicates built from the trace */
+	METRIC_CONDITIONALS_SHARED, /* conditionals answered by an already built or an equal predicate */
+	METRIC_NUM_COUNTERS
+};
+
+/* series are per item values (e.g. trees in each cluster) reported as arrays */
+enum metric_series_id_t {
+	METRIC_SERIES_TREES_PER_CLUSTER,
+	METRIC_NUM_SERIES
+};
+
+struct metric_timer_t {
+	const char * name;
+	std::atomic<uint64_t> calls;
+	std::atomic<uint64_t> total_ns;
+	std::atomic<uint64_t> max_ns;
+};
+
+extern bool metrics_enabled;
+extern std::atomic<uint64_t> metric_counters[METRIC_NUM_COUNTERS];
+
+void init_metrics(const char * report_file);
+void write_metrics_report();
+
+metric_timer_t * get_metric_timer(const char * name);
+void metric_max(metric_counter_id_t counter, uint64_t value);
+void metric_series_add(metric_series_id_t series, uint64_t value);
+
+#define METRIC_ADD(counter, value)	do { if (metrics_enabled) { metric_counters[counter] += (value); } } while (0)
+#define METRIC_MAX(counter, value)	do { if (metrics_enabled) { metric_max(counter, value); } } while (0)
+#define METRIC_SERIES(series, value)	do { if (metrics_enabled) { metric_series_add(series, value); } } while (0)
+
+/* times the enclosing scope; end() stops it early. the timer is looked up once per call site (call sites may run on
+   several threads when -parallel lifts the functions through run_workers) */
+class Metric_Scope {
+
+public:
+	Metric_Scope(std::atomic<metric_timer_t *> * timer, const char * name);
+	~Metric_Scope();
+	void end();
+
+private:
+	metric_timer_t * timer;
+	std::chrono::steady_clock::time_point start;
+
+};
+
+#define METRIC_CONCAT_(a, b)	a##b
+#define METRIC_CONCAT(a, b)		METRIC_CONCAT_(a, b)
+#define METRIC_SCOPE(name) \
+	static std::atomic<metric_timer_t *> METRIC_CONCAT(metric_timer_, __LINE__)(NULL); \
+	Metric_Scope METRIC_CONCAT(metric_scope_, __LINE__)(&METRIC_CONCAT(metric_timer_, __LINE__), name)
+/* a named stage timer which can be ended before the scope closes */
+#define METRIC_STAGE(var, name) \
+	static std::atomic<metric_timer_t *> METRIC_CONCAT(metric_timer_, var)(NULL); \
+	Metric_Scope var(&METRIC_CONCAT(metric_timer_, var), name)
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef _WORKERS_BUILDEX_H
+#define _WORKERS_BUILDEX_H
+
+#include <stdint.h>
+#include <functional>
+
+/*
+a minimal worker pool - runs work(0) ... work(jobs - 1) on up to threads new threads (never on the caller's) and
+returns once all of them are done. jobs are handed out in order; work must only touch state that is its own or
+read-only, thread_local state (e.g. log_file) starts out fresh in every worker
+*/
+
+void run_workers(uint32_t threads, uint32_t jobs, std::function<void(uint32_t)> work);
+
+#endif
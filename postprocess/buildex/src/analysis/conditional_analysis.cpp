@@ -30,10 +30,10 @@ std::vector<uint32_t> find_dependant_statements(vec_cinstr &instrs, mem_regions_
 	for (int i = 0; i < instrs.size(); i++){
 
 		cinstr_t * instr = instrs[i].first;
-		rinstr_t * rinstr;
-		string para = instrs[i].second->disassembly;
+		rinstr_t rinstr[MAX_RINSTRS];
+		const string &para = instrs[i].second->disassembly;
 
-		rinstr = cinstr_to_rinstrs_eflags(instr, amount, para, i + 1);
+		cinstr_to_rinstrs_eflags(instr, rinstr, amount, para, i + 1);
 
 		bool dependant = false;
 		for (int i = 0; i < amount; i++){
@@ -1,4 +1,5 @@
 #include <vector>
+#include <algorithm>
 
 #include "analysis/indirection_analysis.h"
 #include "analysis/staticinfo.h"
@@ -65,10 +66,10 @@ vector< vector<uint32_t> > find_dependant_statements_with_indirection(vec_cinstr
 		for (int i = start; i < end; i++){
 
 			cinstr_t * instr = instrs[i].first;
-			rinstr_t * rinstr;
-			string para = instrs[i].second->disassembly;
+			rinstr_t rinstr[MAX_RINSTRS];
+			const string &para = instrs[i].second->disassembly;
 
-			rinstr = cinstr_to_rinstrs_eflags(instr, amount, para, i + 1);
+			cinstr_to_rinstrs_eflags(instr, rinstr, amount, para, i + 1);
 
 			bool direct_dependant = false;
 			bool indirect_dependant = false;
@@ -141,6 +141,35 @@ vec_cinstr filter_instr_trace(vector<uint32_t> start_pc, vector<uint32_t> end_pc
 }
 
 
+/* lines of instrs that belong to each start, end pc pair - every invocation of the function in trace order. same
+   matching as filter_instr_trace, but the static information is left as it is */
+vector< vector<uint32_t> > split_instr_trace(vector<uint32_t> start_pc, vector<uint32_t> end_pc, vec_cinstr &instrs){
+
+	vector< vector<uint32_t> > lines(start_pc.size());
+	bool start = false;
+	int32_t index = -1;
+
+	for (int i = 0; i < instrs.size(); i++){
+
+		if (!start){
+			index = check_pc(start_pc, instrs[i].first->pc);
+			if (index != -1) start = true;
+		}
+
+		if (start){
+			lines[index].push_back(i);
+		}
+
+		if (start && instrs[i].first->pc == end_pc[index]){
+			start = false;
+		}
+	}
+
+	return lines;
+
+}
+
+
 /* for a single function get start and end points */
 pair<uint32_t, uint32_t> get_start_end_pcs(vector<Static_Info *> &infos, Static_Info * first){
 
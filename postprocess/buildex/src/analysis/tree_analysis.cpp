@@ -3,6 +3,11 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <set>
+#include <cstring>
 
 #include "analysis/tree_analysis.h"
 #include "common_defines.h"
@@ -11,6 +16,7 @@
 #include "utility/defines.h"
 
 #include "utility/print_helper.h"
+#include "utility/metrics.h"
 
 #include "utilities.h"
 
@@ -79,6 +85,7 @@ void build_conc_tree_helper(
 
 	int32_t no_rinstrs;
 	cinstr_t * instr;
+	rinstr_t storage[MAX_RINSTRS];
 	rinstr_t * rinstr;
 	int32_t curpos = start_trace;
 
@@ -91,7 +98,7 @@ void build_conc_tree_helper(
 		rinstr = NULL;
 		DEBUG_PRINT(("->line - %d\n", curpos), 4);
 		DEBUG_PRINT(("%s\n", instrs[curpos].second->disassembly.c_str()), 4);
-		rinstr = cinstr_to_rinstrs(instr, no_rinstrs, instrs[curpos].second->disassembly, curpos);
+		rinstr = cinstr_to_rinstrs(instr, storage, no_rinstrs, instrs[curpos].second->disassembly, curpos);
 		if (debug_level >= 4){ print_rinstrs(log_file,rinstr, no_rinstrs); }
 
 		bool updated = false;
@@ -107,7 +114,6 @@ void build_conc_tree_helper(
 		if (affected){  /* that is this instr affects the frontier */
 			update_jump_conditionals(tree, instrs, curpos);
 		}
-		delete[] rinstr;
 	}
 
 }
@@ -124,6 +130,7 @@ void build_tree_intial_update(uint64_t destination,
 
 	DEBUG_PRINT(("initial update tree building\n"), 2);
 
+	rinstr_t storage[MAX_RINSTRS];
 	rinstr_t * rinstr = NULL;
 	cinstr_t * instr = NULL;
 	int amount;
@@ -137,7 +144,7 @@ void build_tree_intial_update(uint64_t destination,
 		for (int j = 0; j < instr->num_dsts; j++){
 			operand_t opnd = instr->dsts[j];
 			if (is_overlapped(destination, destination + stride - 1 , opnd.value, opnd.value + opnd.width - 1)){
-				rinstr = cinstr_to_rinstrs_eflags(instr, amount, instrs[i].second->disassembly, i);
+				rinstr = cinstr_to_rinstrs_eflags(instr, storage, amount, instrs[i].second->disassembly, i);
 				for (int k = amount - 1; k >= 0; k--){
 					if (rinstr[k].dst.value == opnd.value && rinstr[k].dst.width == opnd.width){
 						found = true;
@@ -167,7 +174,6 @@ void build_tree_intial_update(uint64_t destination,
 	for (int i = index; i >= 0; i--){
 		tree->update_depandancy_backward(&rinstr[i], instr, instrs[curpos].second, curpos, regions, func_info);
 	}
-	delete[] rinstr;
 
 
 	uint32_t start_trace = curpos + 1;
@@ -226,6 +232,7 @@ Conc_Tree * build_conc_tree(uint64_t destination,
 	int32_t initial_endtrace = end_trace;
 	
 	DEBUG_PRINT(("build_tree_multi_func(concrete)....\n"), 3);
+	METRIC_SCOPE("build_conc_tree");
 
 	/* get the initial starting and ending positions */
 	uint curpos;
@@ -251,6 +258,7 @@ Conc_Tree * build_conc_tree(uint64_t destination,
 	curpos = start_trace;
 
 	cinstr_t * instr;
+	rinstr_t storage[MAX_RINSTRS];
 	rinstr_t * rinstr;
 	int no_rinstrs;
 
@@ -261,7 +269,7 @@ Conc_Tree * build_conc_tree(uint64_t destination,
 	//major assumption here is that reg and mem 'value' fields do not overlap. This is assumed in all other places as well. can have an assert for this
 	instr = instrs[curpos].first;
 	DEBUG_PRINT(("starting from instr - %s\n", instrs[curpos].second->disassembly.c_str()), 3);
-	rinstr = cinstr_to_rinstrs(instr, no_rinstrs, instrs[curpos].second->disassembly, curpos);
+	rinstr = cinstr_to_rinstrs(instr, storage, no_rinstrs, instrs[curpos].second->disassembly, curpos);
 
 	for (int i = no_rinstrs - 1; i >= 0; i--){
 		if (rinstr[i].dst.value == destination){
@@ -277,12 +285,13 @@ Conc_Tree * build_conc_tree(uint64_t destination,
 
 	ASSERT_MSG((dest_present == true) && (index >= 0), ("ERROR: couldn't find the dest to start trace\n")); //we should have found the destination
 
+	METRIC_ADD(METRIC_TREES_BUILT, 1);
+
 	/* build the initial part of the tree */
 	for (int i = index; i >= 0; i--){
 		
 		tree->update_depandancy_backward(&rinstr[i], instrs[curpos].first, instrs[curpos].second, curpos, regions, func_info);
 	}
-	delete[] rinstr;
 
 	start_trace++;
 	uint32_t start_to_initial = start_trace;
@@ -320,13 +329,8 @@ Conc_Tree * build_conc_tree(uint64_t destination,
 	Conc_Tree * initial_tree = NULL;
 
 	if (conctree_opt){
-		tree->remove_assign_nodes();
-		tree->remove_multiplication();
-		tree->remove_po_nodes();
-		tree->canonicalize_tree();
-		tree->simplify_immediates();
-		tree->remove_or_minus_1();
-		tree->remove_identities();
+		tree->simplify_tree();
+		tree->normalize_tree(NORMALIZE_OR_MINUS_1 | NORMALIZE_IDENTITIES);
 		tree->number_parameters(regions);
 		tree->recursive = false;
 		tree->mark_recursive();
@@ -359,11 +363,8 @@ Conc_Tree * build_conc_tree(uint64_t destination,
 		}
 
 		if (conctree_opt){
-			initial_tree->remove_assign_nodes();
-			initial_tree->remove_multiplication();
-			initial_tree->remove_po_nodes();
-			initial_tree->canonicalize_tree();
-			initial_tree->simplify_immediates();
+			initial_tree->simplify_tree();
+			initial_tree->normalize_tree(0);
 			initial_tree->number_parameters(regions);
 		}
 	}
@@ -383,7 +384,7 @@ Conc_Tree * build_conc_tree(uint64_t destination,
 
 		DEBUG_PRINT(("--------debug tree printing-----------\n"), 2);
 
-		ofstream file(get_standard_folder("output") + "\\tree_" + to_string(destination) + ".dot");
+		ofstream file(join_path(get_standard_folder("output"), "tree_" + to_string(destination) + ".dot"));
 		tree->number_tree_nodes();
 		tree->print_dot(file, "tree", 0);
 		tree->num_nodes = 0;
@@ -401,14 +402,14 @@ Conc_Tree * build_conc_tree(uint64_t destination,
 			abs_tree->canonicalize_tree();
 		}
 
-		ofstream abs_file(get_standard_folder("output") + "\\abs_tree_" + to_string(destination) + ".dot");
+		ofstream abs_file(join_path(get_standard_folder("output"), "abs_tree_" + to_string(destination) + ".dot"));
 		abs_tree->number_tree_nodes();
 		abs_tree->print_dot(abs_file, "abs_tree", 0);
 		abs_tree->num_nodes = 0;
 
 		if (initial_tree != NULL){
 			DEBUG_PRINT(("initial_tree built\n"), 2);
-			ofstream initial_file(get_standard_folder("output") + "\\tree_" + to_string(destination) + "_initial.dot");
+			ofstream initial_file(join_path(get_standard_folder("output"), "tree_" + to_string(destination) + "_initial.dot"));
 			initial_tree->number_tree_nodes();
 			initial_tree->print_dot(initial_file, "initial_tree", 0);
 			DEBUG_PRINT(("number of conditionals : %d\n", initial_tree->conditionals.size()), 2);
@@ -466,6 +467,7 @@ void build_conc_tree_single_func(uint64_t destination,
 
 
 	cinstr_t * instr;
+	rinstr_t storage[MAX_RINSTRS];
 	rinstr_t * rinstr;
 	int no_rinstrs;
 
@@ -487,10 +489,10 @@ void build_conc_tree_single_func(uint64_t destination,
 
 
 	if (instrs[curpos].second != NULL){
-		rinstr = cinstr_to_rinstrs(instr, no_rinstrs, instrs[curpos].second->disassembly, curpos);
+		rinstr = cinstr_to_rinstrs(instr, storage, no_rinstrs, instrs[curpos].second->disassembly, curpos);
 	}
 	else{
-		rinstr = cinstr_to_rinstrs(instr, no_rinstrs, "not captured\n", curpos);
+		rinstr = cinstr_to_rinstrs(instr, storage, no_rinstrs, "not captured\n", curpos);
 	}
 
 
@@ -536,10 +538,10 @@ void build_conc_tree_single_func(uint64_t destination,
 			}
 
 			if (instrs[curpos].second != NULL){
-				rinstr = cinstr_to_rinstrs(instr, no_rinstrs, instrs[curpos].second->disassembly, curpos);
+				rinstr = cinstr_to_rinstrs(instr, storage, no_rinstrs, instrs[curpos].second->disassembly, curpos);
 			}
 			else{
-				rinstr = cinstr_to_rinstrs(instr, no_rinstrs, "not captured\n", curpos);
+				rinstr = cinstr_to_rinstrs(instr, storage, no_rinstrs, "not captured\n", curpos);
 			}
 
 			if (debug_level >= 4){ print_rinstrs(log_file,rinstr, no_rinstrs); }
@@ -566,7 +568,6 @@ void build_conc_tree_single_func(uint64_t destination,
 			}
 		}
 
-		delete[] rinstr;
 	}
 
 	DEBUG_PRINT(("build_tree(concrete) - done\n"), 2);
@@ -671,133 +672,304 @@ void create_dependancy(Node * src, Node * dest){
 
 }
 
-void build_conc_trees_for_conditionals(
+/************************************************************************/
+/*  Conditional predicates					                            */
+/************************************************************************/
+
+cond_store_t::cond_store_t() : built(0), reused(0), interned(0){
+}
+
+/* the predicate nodes belong to the conditional trees that link them */
+cond_store_t::~cond_store_t(){
+	for (auto it = predicates.begin(); it != predicates.end(); it++){
+		for (int i = 0; i < it->second.size(); i++){
+			delete it->second[i];
+		}
+	}
+}
+
+/* hash of the predicate over the operations and the symbols of its leaves; intermediate locations are not part of it */
+static uint64_t get_predicate_hash(Node * node, map<Node *, uint64_t> &memo){
+
+	auto it = memo.find(node);
+	if (it != memo.end()) return it->second;
+
+	uint64_t hash = 14695981039346656037ULL; /* FNV-1a */
+	hash = (hash ^ (uint64_t)(node->operation + 1)) * 1099511628211ULL;
+	hash = (hash ^ ((node->sign << 1) | node->minus)) * 1099511628211ULL;
+	hash = (hash ^ node->srcs.size()) * 1099511628211ULL;
+
+	if (node->srcs.size() == 0){
+		hash = (hash ^ node->symbol->type) * 1099511628211ULL;
+		hash = (hash ^ node->symbol->width) * 1099511628211ULL;
+		uint64_t value = node->symbol->value;
+		if (node->symbol->type == IMM_FLOAT_TYPE){
+			uint32_t bits;
+			memcpy(&bits, &node->symbol->float_value, sizeof(bits));
+			value = bits;
+		}
+		hash = (hash ^ value) * 1099511628211ULL;
+	}
+
+	for (int i = 0; i < node->srcs.size(); i++){
+		hash = (hash ^ get_predicate_hash(node->srcs[i], memo)) * 1099511628211ULL;
+	}
+
+	memo[node] = hash;
+	return hash;
+
+}
+
+static bool are_predicates_equal(Node * first, Node * second, set< pair<Node *, Node *> > &equal){
+
+	if (first == second || equal.find(make_pair(first, second)) != equal.end()) return true;
+
+	if (first->operation != second->operation || first->sign != second->sign || first->minus != second->minus ||
+		first->func_name != second->func_name || first->srcs.size() != second->srcs.size()){
+		return false;
+	}
+
+	if (first->srcs.size() == 0){
+		operand_t * a = first->symbol;
+		operand_t * b = second->symbol;
+		if (a->type != b->type || a->width != b->width) return false;
+		if (a->type == IMM_FLOAT_TYPE ? (a->float_value != b->float_value) : (a->value != b->value)) return false;
+	}
+
+	for (int i = 0; i < first->srcs.size(); i++){
+		if (!are_predicates_equal(first->srcs[i], second->srcs[i], equal)) return false;
+	}
+
+	equal.insert(make_pair(first, second));
+	return true;
+
+}
+
+/* copy keeping the nodes shared within the predicate shared */
+static Node * copy_predicate(Node * node, map<Node *, Node *> &copies){
+
+	auto it = copies.find(node);
+	if (it != copies.end()) return it->second;
+
+	Conc_Node * copy = new Conc_Node(node->symbol);
+	copy->operation = node->operation;
+	copy->sign = node->sign;
+	copy->minus = node->minus;
+	copy->func_name = node->func_name;
+	copy->pc = node->pc;
+	copy->line = node->line;
+	copy->is_para = node->is_para;
+	copy->para_num = node->para_num;
+	copy->is_double = node->is_double;
+	copy->region = static_cast<Conc_Node *>(node)->region;
+	copies[node] = copy;
+
+	for (int i = 0; i < node->srcs.size(); i++){
+		create_dependancy(copy, copy_predicate(node->srcs[i], copies));
+	}
+
+	return copy;
+
+}
+
+/* builds the trees of the compare sources from the trace and joins them by the jump condition */
+static Node * build_conditional_predicate(
 	std::vector<uint32_t> start_points,
-	Conc_Tree * tree,
 	vec_cinstr &instrs,
+	uint32_t line_cond,
+	uint32_t line_jump,
 	uint64_t farthest,
 	vector<mem_regions_t *> &regions,
 	vector<Func_Info_t *> &func_info){
 
+	cinstr_t * instr = instrs[line_cond].first;
 
-	DEBUG_PRINT(("build conc tree for conditionals.....\n"), 3);
-
-	for (int i = 0; i < tree->conditionals.size(); i++){
-
-		Jump_Info * info = tree->conditionals[i]->jump_info;
-		uint32_t line_cond = tree->conditionals[i]->line_cond;
-		uint32_t line_jump = tree->conditionals[i]->line_jump;
-
-		cinstr_t * instr = instrs[line_cond].first;
+	vector<Conc_Tree *> cond_trees;
 
-		vector<Conc_Tree *> cond_trees;
+	/* cmp x1, x2 - 2 srcs and no dest */
 
-		/* cmp x1, x2 - 2 srcs and no dest */
+	for (int j = 0; j < instr->num_srcs; j++){
+		//now build the trees
+		if (instr->srcs[j].type != IMM_INT_TYPE && instr->srcs[j].type != IMM_FLOAT_TYPE){
 
-		for (int j = 0; j < instr->num_srcs; j++){
-			//now build the trees
-			if (instr->srcs[j].type != IMM_INT_TYPE && instr->srcs[j].type != IMM_FLOAT_TYPE){
-
-				/* find the dst when these srcs are written */
-				uint32_t dst_line = 0;
-				for (int k = line_cond; k < instrs.size(); k++){
-					cinstr_t * temp = instrs[k].first;
-					bool found = false;
-					for (int m = 0; m < temp->num_dsts; m++){
-						if (temp->dsts[m].type == instr->srcs[j].type && temp->dsts[m].value == instr->srcs[j].value){
-							dst_line = k;
-							found = true;
-							break;
-						}
+			/* find the dst when these srcs are written */
+			uint32_t dst_line = 0;
+			for (int k = line_cond; k < instrs.size(); k++){
+				cinstr_t * temp = instrs[k].first;
+				bool found = false;
+				for (int m = 0; m < temp->num_dsts; m++){
+					if (temp->dsts[m].type == instr->srcs[j].type && temp->dsts[m].value == instr->srcs[j].value){
+						dst_line = k;
+						found = true;
+						break;
 					}
-					if (found) break;
 				}
-				ASSERT_MSG((dst_line != 0), ("ERROR: couldn't find the conditional destination\n"));
+				if (found) break;
+			}
+			ASSERT_MSG((dst_line != 0), ("ERROR: couldn't find the conditional destination\n"));
+
+			Conc_Tree * cond_tree = new Conc_Tree();
+			build_conc_tree(instr->srcs[j].value, instr->srcs[j].width, start_points, dst_line + 1, FILE_ENDING, cond_tree, instrs, farthest, regions, func_info);
+			cond_trees.push_back(cond_tree);
 
-				Conc_Tree * cond_tree = new Conc_Tree();
-				build_conc_tree(instr->srcs[j].value, instr->srcs[j].width, start_points, dst_line + 1, FILE_ENDING, cond_tree, instrs, farthest, regions, func_info);
-				cond_trees.push_back(cond_tree);
+		}
+		else{
 
+			Conc_Tree * cond_tree = new Conc_Tree();
+			Node * head;
+			if (instr->srcs[j].type == IMM_INT_TYPE){
+				head = new Conc_Node(instr->srcs[j].type, instr->srcs[j].value, instr->srcs[j].width, 0.0);
 			}
 			else{
-
-				Conc_Tree * cond_tree = new Conc_Tree();
-				Node * head;
-				if (instr->srcs[j].type == IMM_INT_TYPE){
-					head = new Conc_Node(instr->srcs[j].type, instr->srcs[j].value, instr->srcs[j].width, 0.0);
-				}
-				else{
-					head = new Conc_Node(instr->srcs[j].type, 0, instr->srcs[j].width, instr->srcs[j].float_value);
-				}
-				cond_tree->set_head(head);
-				cond_trees.push_back(cond_tree);
+				head = new Conc_Node(instr->srcs[j].type, 0, instr->srcs[j].width, instr->srcs[j].float_value);
 			}
+			cond_tree->set_head(head);
+			cond_trees.push_back(cond_tree);
 		}
+	}
+
+	/* remove assign nodes head */
+	for (int j = 0; j < cond_trees.size(); j++){
+		cond_trees[j]->change_head_node();
+	}
 
-		/* common things */
+	Node * left = cond_trees[0]->get_head();
+	Node * right = cond_trees[1]->get_head();
 
-		/* remove assign nodes head */
-		for (int j = 0; j < cond_trees.size(); j++){
-			cond_trees[j]->change_head_node();
-		}
+	if (instr->opcode == OP_cmp){
 
-		/* get the computational node */
-		Node * comp_node = tree->get_head();
-		Node * new_head_node = new Conc_Node(comp_node->symbol->type, comp_node->symbol->value, comp_node->symbol->width, 0.0);
+		Conc_Node * node = new Conc_Node(REG_TYPE, 150, 4, 0.0);
+		node->operation = dr_logical_to_operation(instrs[line_jump].first->opcode);
+
+		create_dependancy(node, left);
+		create_dependancy(node, right);
+		return node;
+
+	}
+	else if (instr->opcode == OP_test){
 
-		if (instr->opcode == OP_cmp){
+		Conc_Node * head_node = new Conc_Node(REG_TYPE, 150, 4, 0.0);
+		head_node->operation = dr_logical_to_operation(instrs[line_jump].first->opcode);
 
-			/* now create the tree */
-			Conc_Node * node = new Conc_Node(REG_TYPE, 150, 4, 0.0);
-			node->operation = dr_logical_to_operation(instrs[line_jump].first->opcode);
+		/* create an and node */
+		Conc_Node * and_node = new Conc_Node(REG_TYPE, 150, 4, 0.0);
+		and_node->operation = op_and;
 
-			/* merge the trees together */
-			Node * left = cond_trees[0]->get_head();
-			Node * right = cond_trees[1]->get_head();
+		create_dependancy(and_node, left);
+		create_dependancy(and_node, right);
+
+		create_dependancy(head_node, and_node);
+		create_dependancy(head_node, new Conc_Node(IMM_INT_TYPE, 0, 4, 0.0)); /* immediate zero node */
+		return head_node;
+
+	}
+
+	ASSERT_MSG((false), ("ERROR: conditionals for other instructions are not done - %s\n", dr_operation_to_string(instr->opcode).c_str()));
+	return NULL;
+
+}
+
+/* canonical predicate of a dynamic conditional - built from the trace only the first time it is seen */
+static cond_pred_t * get_conditional_predicate(
+	cond_store_t * store,
+	std::vector<uint32_t> start_points,
+	vec_cinstr &instrs,
+	uint32_t line_cond,
+	uint32_t line_jump,
+	uint64_t farthest,
+	vector<mem_regions_t *> &regions,
+	vector<Func_Info_t *> &func_info){
+
+	pair<uint32_t, uint32_t> instance = make_pair(line_cond, line_jump);
+	auto it = store->instances.find(instance);
+	if (it != store->instances.end()){
+		store->reused++;
+		METRIC_ADD(METRIC_CONDITIONALS_SHARED, 1);
+		return it->second;
+	}
 
-			create_dependancy(node, left);
-			create_dependancy(node, right);
+	Node * pred = build_conditional_predicate(start_points, instrs, line_cond, line_jump, farthest, regions, func_info);
+	store->built++;
+	METRIC_ADD(METRIC_CONDITIONALS_BUILT, 1);
 
-			create_dependancy(new_head_node, node);
-			Conc_Tree * new_cond_tree = new Conc_Tree();
-			new_cond_tree->set_head(new_head_node);
-			tree->conditionals[i]->tree = new_cond_tree;
+	uint32_t jump_pc = instrs[line_jump].first->pc;
+	map<Node *, uint64_t> memo;
+	uint64_t hash = get_predicate_hash(pred, memo);
 
+	vector<cond_pred_t *> &bucket = store->predicates[(hash ^ jump_pc) * 1099511628211ULL];
+	cond_pred_t * canonical = NULL;
+	for (int i = 0; i < bucket.size(); i++){
+		set< pair<Node *, Node *> > equal;
+		if (bucket[i]->jump_pc == jump_pc && bucket[i]->hash == hash && are_predicates_equal(bucket[i]->pred, pred, equal)){
+			canonical = bucket[i];
+			break;
 		}
+	}
 
+	if (canonical != NULL){
+		/* the same predicate as an earlier conditional of this jump; drop the new nodes */
+		Conc_Tree * duplicate = new Conc_Tree();
+		duplicate->set_head(pred);
+		delete duplicate;
+		store->interned++;
+		METRIC_ADD(METRIC_CONDITIONALS_SHARED, 1);
+	}
+	else{
+		canonical = new cond_pred_t;
+		canonical->jump_pc = jump_pc;
+		canonical->hash = hash;
+		canonical->pred = pred;
+		canonical->linked = false;
+		bucket.push_back(canonical);
+	}
 
-		else if (instr->opcode == OP_test){
+	store->instances[instance] = canonical;
+	return canonical;
 
-			Conc_Node * head_node = new Conc_Node(REG_TYPE, 150, 4, 0.0);
-			head_node->operation = dr_logical_to_operation(instrs[line_jump].first->opcode);
+}
 
-			/* create an and node */
-			Conc_Node * and_node = new Conc_Node(REG_TYPE, 150, 4, 0.0);
-			and_node->operation = op_and;
+void build_conc_trees_for_conditionals(
+	std::vector<uint32_t> start_points,
+	Conc_Tree * tree,
+	vec_cinstr &instrs,
+	uint64_t farthest,
+	vector<mem_regions_t *> &regions,
+	vector<Func_Info_t *> &func_info,
+	cond_store_t * store){
 
-			Node * left = cond_trees[0]->get_head();
-			Node * right = cond_trees[1]->get_head();
 
-			create_dependancy(and_node, left);
-			create_dependancy(and_node, right);
+	DEBUG_PRINT(("build conc tree for conditionals.....\n"), 3);
 
-			create_dependancy(head_node, and_node);
-			create_dependancy(head_node, new Conc_Node(IMM_INT_TYPE, 0, 4, 0.0)); /* immediate zero node */
+	for (int i = 0; i < tree->conditionals.size(); i++){
 
-			create_dependancy(new_head_node, head_node);
-			Conc_Tree * new_cond_tree = new Conc_Tree();
-			new_cond_tree->set_head(new_head_node);
-			tree->conditionals[i]->tree = new_cond_tree;
+		uint32_t line_cond = tree->conditionals[i]->line_cond;
+		uint32_t line_jump = tree->conditionals[i]->line_jump;
 
+		cond_pred_t * canonical = get_conditional_predicate(store, start_points, instrs, line_cond, line_jump, farthest, regions, func_info);
 
+		Node * pred;
+		if (!canonical->linked){
+			pred = canonical->pred;
+			canonical->linked = true;
 		}
-
 		else{
-			ASSERT_MSG((false), ("ERROR: conditionals for other instructions are not done - %s\n", dr_operation_to_string(instr->opcode).c_str()));
+			map<Node *, Node *> copies;
+			pred = copy_predicate(canonical->pred, copies);
 		}
 
+		/* the conditional tree is headed by the computational node */
+		Node * comp_node = tree->get_head();
+		Node * new_head_node = new Conc_Node(comp_node->symbol->type, comp_node->symbol->value, comp_node->symbol->width, 0.0);
+
+		create_dependancy(new_head_node, pred);
+		Conc_Tree * new_cond_tree = new Conc_Tree();
+		new_cond_tree->set_head(new_head_node);
+		tree->conditionals[i]->tree = new_cond_tree;
+
 	}
 
+	DEBUG_PRINT(("conditionals - built %d, reused %d, interned %d\n", store->built, store->reused, store->interned), 3);
+
 }
 
 
@@ -970,6 +1142,16 @@ vector< vector<int32_t> > get_index_list(mem_regions_t * mem){
 
 }
 
+static void record_cluster_metrics(std::vector< std::vector<Conc_Tree *> > &clustered_trees){
+
+	if (!metrics_enabled) return;
+	METRIC_ADD(METRIC_CLUSTERS, clustered_trees.size());
+	for (int i = 0; i < clustered_trees.size(); i++){
+		metric_series_add(METRIC_SERIES_TREES_PER_CLUSTER, clustered_trees[i].size());
+	}
+
+}
+
 std::vector< std::vector <Conc_Tree *> > cluster_trees
 		(std::vector<mem_regions_t *> mem_regions,
 		std::vector<mem_regions_t *> &total_regions,
@@ -989,6 +1171,7 @@ std::vector< std::vector <Conc_Tree *> > cluster_trees
 	vector< vector<int32_t> > indexes = get_index_list(mem);
 	vector<int32_t> offset = indexes[0];
 	bool success = true;
+	cond_store_t store; /* conditionals shared by the trees of the output */
 
 	//for (int i = indexes.size() - 1; i >= 0; i--){
 	//for (int i = 0; i < indexes.size()/8; i++){
@@ -1018,10 +1201,10 @@ std::vector< std::vector <Conc_Tree *> > cluster_trees
 		Conc_Tree * tree = new Conc_Tree();
 		tree->tree_num = i;
 		Conc_Tree * initial_tree = build_conc_tree(location, mem->bytes_per_pixel, start_points, FILE_BEGINNING, FILE_ENDING, tree, instrs, farthest, total_regions, func_info);
-		build_conc_trees_for_conditionals(start_points, tree, instrs, farthest, total_regions, func_info);
+		build_conc_trees_for_conditionals(start_points, tree, instrs, farthest, total_regions, func_info, &store);
 		trees.push_back(tree);
 		if (initial_tree != NULL){
-			build_conc_trees_for_conditionals(start_points, initial_tree, instrs, farthest, total_regions, func_info);
+			build_conc_trees_for_conditionals(start_points, initial_tree, instrs, farthest, total_regions, func_info, &store);
 			trees.push_back(initial_tree);
 		}
 
@@ -1080,11 +1263,285 @@ std::vector< std::vector <Conc_Tree *> > cluster_trees
 
 	/* get the divergence points */
 
+	record_cluster_metrics(clustered_trees);
 	return clustered_trees;
 
 
 }
 
+/* raster position of an index in the region (dimension 0 fastest varying) and back */
+static int32_t get_raster_position(mem_regions_t * mem, vector<int32_t> &index){
+	int32_t position = 0;
+	int32_t scale = 1;
+	for (int i = 0; i < mem->dimensions; i++){
+		position += index[i] * scale;
+		scale *= mem->extents[i];
+	}
+	return position;
+}
+
+static vector<int32_t> get_raster_index(mem_regions_t * mem, int32_t position){
+	vector<int32_t> index;
+	for (int i = 0; i < mem->dimensions; i++){
+		index.push_back(position % mem->extents[i]);
+		position /= mem->extents[i];
+	}
+	return index;
+}
+
+/* cluster of a tree among the clusters built so far; -1 if the tree starts a new cluster */
+static int32_t find_tree_cluster(vector< vector<Conc_Tree *> > &clustered_trees, vector<uint64_t> &cluster_hashes, Conc_Tree * tree){
+	uint64_t hash = tree->get_structural_hash();
+	for (int i = 0; i < clustered_trees.size(); i++){
+		if (cluster_hashes[i] == hash && clustered_trees[i][0]->are_trees_similar(tree)){
+			return i;
+		}
+	}
+	return -1;
+}
+
+/* a full cluster still takes a tree beyond its first or last numbered tree so that its ends stay known - the tree
+   replaces one between the ends. returns the index to replace, the cluster size to append or -1 if the tree is not needed */
+static int32_t get_span_slot(vector<Conc_Tree *> &trees, int32_t tree_num){
+
+	if (tree_num < 0) return -1;
+
+	int32_t first = -1, last = -1;
+	for (int i = 0; i < trees.size(); i++){
+		if (trees[i]->tree_num < 0) continue;
+		if (first == -1 || trees[i]->tree_num < trees[first]->tree_num) first = i;
+		if (last == -1 || trees[i]->tree_num > trees[last]->tree_num) last = i;
+	}
+	if (first == -1) return trees.size();
+	if (tree_num > trees[first]->tree_num && tree_num < trees[last]->tree_num) return -1;
+
+	for (int i = 0; i < trees.size(); i++){
+		if (trees[i]->tree_num > trees[first]->tree_num && trees[i]->tree_num < trees[last]->tree_num) return i;
+	}
+	return trees.size();
+
+}
+
+/* the tree of an output location without its initial definition tree */
+static Conc_Tree * build_location_tree(mem_regions_t * mem, int32_t position, std::vector<uint32_t> start_points, vec_cinstr &instrs,
+		uint64_t farthest, std::vector<mem_regions_t *> &total_regions, std::vector<Func_Info_t *> &func_info){
+
+	bool success = true;
+	uint64_t location = get_mem_location(get_raster_index(mem, position), vector<int32_t>(mem->dimensions, 0), mem, &success);
+	ASSERT_MSG(success, ("ERROR: getting mem location error\n"));
+
+	Conc_Tree * tree = new Conc_Tree();
+	tree->tree_num = position;
+	Conc_Tree * initial_tree = build_conc_tree(location, mem->bytes_per_pixel, start_points, FILE_BEGINNING, FILE_ENDING, tree, instrs, farthest, total_regions, func_info);
+	if (initial_tree != NULL) delete initial_tree;
+	return tree;
+
+}
+
+/* tree_num of the trees numbered by raster position is made consecutive within a run of samples (raster position,
+   cluster) of their cluster, with a hole between runs - the consecutive tree numbers build_abs_trees checks for then
+   mean no location of another cluster was seen between the trees. trees of the initial definitions keep -1 and
+   numbering starts at 1 so that they count as a gap as in cluster_trees */
+void number_sampled_trees(std::vector< std::vector<Conc_Tree *> > &clustered_trees, std::vector< std::pair<int32_t, int32_t> > samples){
+
+	sort(samples.begin(), samples.end());
+
+	map<int32_t, Conc_Tree *> numbered;
+	for (int i = 0; i < clustered_trees.size(); i++){
+		for (int j = 0; j < clustered_trees[i].size(); j++){
+			if (clustered_trees[i][j]->tree_num >= 0) numbered[clustered_trees[i][j]->tree_num] = clustered_trees[i][j];
+		}
+	}
+
+	vector<int32_t> next(clustered_trees.size(), 1);
+	for (int i = 0; i < samples.size(); i++){
+		int32_t cluster = samples[i].second;
+		if (i > 0 && samples[i - 1].second != cluster && next[cluster] > 1) next[cluster]++;
+		map<int32_t, Conc_Tree *>::iterator it = numbered.find(samples[i].first);
+		if (it != numbered.end()) it->second->tree_num = next[cluster]++;
+	}
+
+}
+
+/* adaptive version of cluster_trees - output locations are sampled stratified over the region (borders first, then a
+   coarse-to-fine grid) and the trees are clustered as they are built. Sampling stops once no new cluster was found for
+   'window' consecutive locations. A cluster only keeps 'max_cluster_trees' trees which is what build_abs_trees consumes,
+   and its first and last sampled trees. tree_num is renumbered so that build_abs_trees sees a gap only where a location
+   of another cluster lies between two trees of a cluster, not where sampling skipped locations */
+std::vector< std::vector <Conc_Tree *> > cluster_trees_adaptive
+		(std::vector<mem_regions_t *> mem_regions,
+		std::vector<mem_regions_t *> &total_regions,
+		std::vector<uint32_t> start_points,
+		vec_cinstr &instrs,
+		uint64_t farthest,
+		std::string output_folder,
+		std::vector<Func_Info_t *> &func_info,
+		uint32_t window,
+		uint32_t max_cluster_trees,
+		uint32_t seed){
+
+	DEBUG_PRINT(("Building trees for sampled locations in the output and clustering adaptively\n"), 2);
+
+	mem_regions_t * mem = get_random_output_region(mem_regions);
+
+	vector< vector<Conc_Tree *> > clustered_trees;
+	vector<uint64_t> cluster_hashes;
+	vector< pair<int32_t, int32_t> > samples; /* (raster position, cluster) of every location a tree was built for */
+	cond_store_t store; /* conditionals shared by the trees of the output */
+
+	vector<bool> visited(get_region_size(mem), false);
+	vector<int32_t> offset(mem->dimensions, 0);
+	uint32_t level = 0;
+	uint32_t since_new = 0;
+	uint32_t count = 0;
+	bool success = true;
+	bool done = false;
+
+	srand(seed);
+
+	while (!done){
+
+		vector< vector<int32_t> > indexes = get_stratified_index_list(mem, &level, visited, 2);
+		if (indexes.empty()) break;
+
+		for (int i = 0; i < indexes.size(); i++){
+
+			uint64_t location = get_mem_location(indexes[i], offset, mem, &success);
+			ASSERT_MSG(success, ("ERROR: getting mem location error\n"));
+
+			DEBUG_PRINT(("building tree for location %llx\n", location), 3);
+			DEBUG_PRINT(("."), 2);
+
+			/* number the tree by its raster position as in cluster_trees */
+			Conc_Tree * tree = new Conc_Tree();
+			tree->tree_num = get_raster_position(mem, indexes[i]);
+			Conc_Tree * initial_tree = build_conc_tree(location, mem->bytes_per_pixel, start_points, FILE_BEGINNING, FILE_ENDING, tree, instrs, farthest, total_regions, func_info);
+
+			vector<Conc_Tree *> built;
+			built.push_back(tree);
+			if (initial_tree != NULL) built.push_back(initial_tree);
+
+			bool new_cluster = false;
+			for (int j = 0; j < built.size(); j++){
+
+				Conc_Tree * now = built[j];
+				if (now->get_head() == NULL) continue;
+
+				int32_t cluster = find_tree_cluster(clustered_trees, cluster_hashes, now);
+				if (now == tree) samples.push_back(make_pair(now->tree_num, (cluster == -1) ? (int32_t)clustered_trees.size() : cluster));
+
+				if (cluster == -1){
+					build_conc_trees_for_conditionals(start_points, now, instrs, farthest, total_regions, func_info, &store);
+					clustered_trees.push_back(vector<Conc_Tree *>(1, now));
+					cluster_hashes.push_back(now->get_structural_hash());
+					new_cluster = true;
+				}
+				else if (clustered_trees[cluster].size() < max_cluster_trees){
+					build_conc_trees_for_conditionals(start_points, now, instrs, farthest, total_regions, func_info, &store);
+					clustered_trees[cluster].push_back(now);
+				}
+				else{
+					int32_t slot = get_span_slot(clustered_trees[cluster], now->tree_num);
+					if (slot == -1){
+						delete now; /* the cluster already has the trees needed for abstraction */
+					}
+					else{
+						build_conc_trees_for_conditionals(start_points, now, instrs, farthest, total_regions, func_info, &store);
+						if (slot == clustered_trees[cluster].size()){
+							clustered_trees[cluster].push_back(now);
+						}
+						else{
+							delete clustered_trees[cluster][slot];
+							clustered_trees[cluster][slot] = now;
+						}
+					}
+				}
+			}
+
+			count++;
+			if (new_cluster) since_new = 0;
+			else since_new++;
+
+			if (since_new >= window){
+				done = true;
+				break;
+			}
+		}
+	}
+	DEBUG_PRINT(("\n"), 2);
+
+	/* the samples only bound the ends of a cluster. where no sample of another cluster lies between its samples the
+	   cluster is taken to be contiguous and its first and last locations are searched for between its end samples
+	   and the neighbouring samples (or the region bounds) */
+	uint32_t searched = 0;
+	for (int i = 0; i < clustered_trees.size(); i++){
+
+		sort(samples.begin(), samples.end());
+		int32_t first = -1, last = -1;
+		bool contiguous = true;
+		for (int j = 0; j < samples.size(); j++){
+			if (samples[j].second != i) continue;
+			if (first == -1) first = j;
+			else if (last != j - 1) contiguous = false;
+			last = j;
+		}
+		if (first == -1 || !contiguous) continue;
+
+		pair<int32_t, int32_t> ends[2];
+		ends[0] = make_pair(samples[first].first, (first > 0) ? samples[first - 1].first : -1);
+		ends[1] = make_pair(samples[last].first, (last + 1 < samples.size()) ? samples[last + 1].first : (int32_t)get_region_size(mem));
+
+		for (int j = 0; j < 2; j++){
+
+			/* inside - a location of the cluster, outside - the nearest location known not to be */
+			int32_t inside = ends[j].first;
+			int32_t outside = ends[j].second;
+			Conc_Tree * end = NULL;
+
+			while (outside - inside > 1 || inside - outside > 1){
+
+				int32_t middle = inside + (outside - inside) / 2;
+				Conc_Tree * tree = build_location_tree(mem, middle, start_points, instrs, farthest, total_regions, func_info);
+				searched++;
+
+				int32_t cluster = (tree->get_head() == NULL) ? -1 : find_tree_cluster(clustered_trees, cluster_hashes, tree);
+				if (cluster != -1) samples.push_back(make_pair(middle, cluster));
+
+				if (cluster == i){
+					if (end != NULL) delete end;
+					end = tree;
+					inside = middle;
+				}
+				else{
+					delete tree;
+					outside = middle;
+				}
+			}
+
+			if (end != NULL){
+				build_conc_trees_for_conditionals(start_points, end, instrs, farthest, total_regions, func_info, &store);
+				clustered_trees[i].push_back(end);
+			}
+		}
+	}
+
+	number_sampled_trees(clustered_trees, samples);
+
+	/* build_abs_trees expects the trees of a cluster in raster order (first and last trees, gaps in tree numbers) */
+	for (int i = 0; i < clustered_trees.size(); i++){
+		sort(clustered_trees[i].begin(), clustered_trees[i].end(), [](Conc_Tree * first, Conc_Tree * second)->bool{
+			return first->tree_num < second->tree_num;
+		});
+	}
+
+	cout << "locations sampled : " << count << " of " << visited.size() << ", " << searched << " more for the cluster ends" << endl;
+	cout << "number of tree clusters : " << clustered_trees.size() << endl;
+
+	record_cluster_metrics(clustered_trees);
+	return clustered_trees;
+
+}
+
 /* categorize the trees based on */
 vector< vector<Conc_Tree *> >  categorize_trees(vector<Conc_Tree * > trees){
 
@@ -1246,11 +1703,14 @@ Abs_Tree* abstract_the_trees(vector<Conc_Tree *> cluster, uint32_t no_trees, uin
 		Comp_Abs_Tree * comp_tree = new Comp_Abs_Tree();
 		comp_tree->build_compound_tree_unrolled(abs_trees);
 
-		ofstream comp_file(get_standard_folder("output") + "\\comp_tree.dot");
+		ofstream comp_file(join_path(get_standard_folder("output"), "comp_tree.dot"));
 		comp_tree->number_tree_nodes();
 		comp_tree->print_dot(comp_file, "comp", 1);
 
-		comp_tree->abstract_buffer_indexes();
+		if (!comp_tree->abstract_buffer_indexes()){
+			DEBUG_PRINT(("WARNING: buffer indexes could not be abstracted\n"), 1);
+			return NULL;
+		}
 		Abs_Tree * final_tree = comp_tree->compound_to_abs_tree();
 		return final_tree;
 	}
@@ -1258,7 +1718,7 @@ Abs_Tree* abstract_the_trees(vector<Conc_Tree *> cluster, uint32_t no_trees, uin
 		DEBUG_PRINT(("the trees are not similar; please check\n"), 1);
 
 		for (int i = 0; i < trees.size(); i++){
-			ofstream file(get_standard_folder("output") + "\\abs_tree_not_sim" + to_string(i) + ".dot");
+			ofstream file(join_path(get_standard_folder("output"), "abs_tree_not_sim" + to_string(i) + ".dot"));
 			trees[i]->number_tree_nodes();
 			trees[i]->print_dot(file, "abs", i);
 		}
@@ -1296,6 +1756,11 @@ vector< pair<Abs_Tree *, bool > > get_conditional_trees(vector<Conc_Tree *> clus
 		}
 
 		Abs_Tree * cond_abs_tree = abstract_the_trees(trees, no_trees, 1, total_regions, pc_mem);
+		if (cond_abs_tree == NULL){
+			DEBUG_PRINT(("WARNING: conditional %d could not be abstracted\n", i), 2);
+			cond_abs_trees.clear();
+			return cond_abs_trees;
+		}
 		
 		cond_abs_trees.push_back(make_pair(cond_abs_tree,clusters[0]->conditionals[i]->taken));
 	}
@@ -1327,14 +1792,14 @@ vector<Abs_Tree_Charac *> build_abs_trees(
 
 
 		Conc_Tree * tree = clusters[i][0];
-		ofstream conc_file(folder + "\\conc_comp_" + to_string(i) + ".dot", ofstream::out);
+		ofstream conc_file(join_path(folder, "conc_comp_" + to_string(i) + ".dot"), ofstream::out);
 		tree->print_dot(conc_file,"cluster_conc",i);
 		
 		for (int j = 0; j < tree->conditionals.size(); j++){
 
 			Conc_Tree * cond_tree = tree->conditionals[j]->tree;
 			cond_tree->number_tree_nodes();
-			ofstream conc_file(folder + "\\conc_cond_" + to_string(i) + "_" + to_string(j) + ".dot", ofstream::out);
+			ofstream conc_file(join_path(folder, "conc_cond_" + to_string(i) + "_" + to_string(j) + ".dot"), ofstream::out);
 			cond_tree->print_dot(conc_file,"cluster_conc_cond",j);
 			
 		}
@@ -1362,10 +1827,18 @@ vector<Abs_Tree_Charac *> build_abs_trees(
 
 
 		Abs_Tree * abs_tree = abstract_the_trees(clusters[i], no_trees, skip_trees, total_regions, pc_mem);
+		if (abs_tree == NULL){
+			DEBUG_PRINT(("WARNING: cluster %d could not be abstracted\n", i), 2);
+			continue;
+		}
 		/* get the conditional trees*/
 		abs_tree->conditional_trees = get_conditional_trees(clusters[i], no_trees, total_regions, skip_trees, pc_mem);
+		if (abs_tree->conditional_trees.size() != clusters[i][0]->conditionals.size()){
+			DEBUG_PRINT(("WARNING: conditionals of cluster %d could not be abstracted\n", i), 2);
+			continue;
+		}
 
-		ofstream abs_file(folder + "\\symbolic_tree_" + to_string(i) + ".dot", ofstream::out);
+		ofstream abs_file(join_path(folder, "symbolic_tree_" + to_string(i) + ".dot"), ofstream::out);
 		uint32_t max_dimensions = abs_tree->get_maximum_dimensions();
 		abs_tree->number_tree_nodes();
 		abs_tree->print_dot_algebraic(abs_file, "alg", 0, get_vars("x", max_dimensions));
@@ -3,54 +3,18 @@
 #include <iostream>
 #include <string>
 
-#include "analysis\x86_analysis.h"
-#include "utility\fileparser.h" /* disasm strings*/
-#include "utility\defines.h"
-#include "utility\print_helper.h" /* printing opnd etc.*/
-#include "analysis\staticinfo.h"
+#include "analysis/x86_analysis.h"
+#include "analysis/x86_semantics.h"
+#include "utility/fileparser.h" /* disasm strings*/
+#include "utility/defines.h"
+#include "utility/print_helper.h" /* printing opnd etc.*/
+#include "utility/metrics.h"
+#include "analysis/staticinfo.h"
 
 
 using namespace std;
 
 
-/* EFLAGS bit positions */
-
-enum eflag_bits {
-
-	Reserved_31,
-	Reserved_30,
-	Reserved_29,
-	Reserved_28,
-	Reserved_27,
-	Reserved_26,
-	Reserved_25,
-	Reserved_24,
-	Reserved_23,
-	Reserved_22,
-	ID_Flag,
-	Virtual_Interrupt_Pending,
-	Virtual_Interrupt_Flag,
-	Alignment_Check,
-	Virtual_Mode,
-	Resume_Flag,
-	Reserved_15,
-	Nested_Task,
-	IO_Privilege_Level,
-	Overflow_Flag,
-	Direction_Flag,
-	Interrupt_Enable_Flag,
-	Trap_Flag,
-	Sign_Flag,
-	Zero_Flag,
-	Reserved_5,
-	Auxiliary_Carry_Flag,
-	Reserved_3,
-	Parity_Flag,
-	Reserved_1,
-	Carry_Flag
-
-};
-
 enum lahf_bits {
 
 	/*Sign_lahf,
@@ -76,8 +40,6 @@ enum lahf_bits {
 };
 
 
-#define SET_FLAG(flag,member) flag |= (1 << member)
-
 #define assign_value(start,opnd)  \
 	opnd->value = (start) * MAX_SIZE_OF_REG - opnd->width; \
 	 break
@@ -96,41 +58,38 @@ enum lahf_bits {
 	 break
 
 #define sbsd_reg(v,start,opnd) \
-	case DR_REG_R##v##:		   \
-	case DR_REG_E##v##:		   \
-	case DR_REG_##v##:         \
+	case DR_REG_R##v:		   \
+	case DR_REG_E##v:		   \
+	case DR_REG_##v:         \
 	case DR_REG_##v##L:        \
 	assign_value(start,opnd)   
 
 #define x64_reg(v,start,opnd) \
-	case DR_REG_R##v##:       \
+	case DR_REG_R##v:       \
 	case DR_REG_R##v##D:      \
 	case DR_REG_R##v##W:      \
 	case DR_REG_R##v##L:      \
 	assign_value(start,opnd)  
 
 #define mmx_reg(v,start,end)  \
-	case DR_REG_MM##v##:      \
-	case DR_REG_XMM##v##:	  \
-	case DR_REG_YMM##v##:     \
+	case DR_REG_MM##v:      \
+	case DR_REG_XMM##v:	  \
+	case DR_REG_YMM##v:     \
 	assign_value(start,opnd)
 
 #define new_mmx_reg(v, start, end) \
-	case DR_REG_XMM##v##:	  \
-	case DR_REG_YMM##v##:     \
+	case DR_REG_XMM##v:	  \
+	case DR_REG_YMM##v:     \
 	assign_value(start,opnd)
 
 #define fp_reg(v,start,end)  \
-	case DR_REG_##v##:        \
+	case DR_REG_##v:        \
 	assign_value(start,opnd)
 
 #define seg_reg(v,start,end)  \
-	case DR_SEG_##v##:        \
+	case DR_SEG_##v:        \
 	assign_value(start,opnd)
 
-#define if_bounds(d,s)  if( (cinstr->num_dsts == d ) && (cinstr->num_srcs == s ) )
-#define elseif_bounds(d,s) else if( (cinstr->num_dsts == d ) && (cinstr->num_srcs == s ) )
-#define else_bounds else{ unhandled = true; } break
 
 /* function prototypes */
 static void populate_rinstr(rinstr_t * rinstr, operand_t dst, int num_srcs, operand_t src1, operand_t src2, int operation, bool sign);
@@ -161,797 +120,186 @@ cinstr_t * create_new_cinstr(const cinstr_t  &instr){
 	return new_instr;
 }
 
-/* this gets true dependancies + instructions affecting eflags 
-Function - cinstr_to_rinstrs_eflags
-
-Parameters - refer to cinstr_to_rinstrs function
-Return - refer to cinstr_to_rinstrs function
-
-This function is similar to cinstr_to_rinstrs in all ways except in addition, it canonicalizes instructions which affect eflags 
-but does not write to any destination permanently.
+/* condition of a cmovcc / setcc from the flags recovered at runtime via lahf */
+static bool check_semantic_condition(uint32_t cond, uint32_t flags){
 
-*/
-rinstr_t * cinstr_to_rinstrs_eflags(cinstr_t * cinstr, int &amount, std::string disasm, uint32_t line){
-
-	//get already handled instructions which pose true dependencies - this will decide whether an instruction is not handled at all
-	rinstr_t * rinstr = cinstr_to_rinstrs(cinstr, amount, disasm, line);
-
-	bool unhandled = false;
-	//check for non-true dependancies; but ins which affect eflags
-
-	if (rinstr == NULL){
-		switch (cinstr->opcode){
-		case OP_cmp:
-			if_bounds(0, 2){
-				rinstr = new rinstr_t[1];
-				amount = 1;
-				operand_t virtual_reg = { REG_TYPE, cinstr->srcs[0].width, DR_REG_VIRTUAL_1 };
-				reg_to_mem_range(&virtual_reg);
-				rinstr[0] = { op_sub, virtual_reg, 2, { cinstr->srcs[0], cinstr->srcs[1] }, true };
-			}
-			else_bounds;
-		case OP_test:
-			if_bounds(0, 2){
-				rinstr = new rinstr_t[1];
-				amount = 1;
-				operand_t virtual_reg = { REG_TYPE, cinstr->srcs[0].width, DR_REG_VIRTUAL_1 };
-				reg_to_mem_range(&virtual_reg);
-				rinstr[0] = { op_and, virtual_reg, 2, { cinstr->srcs[0], cinstr->srcs[1] }, true };
-			}
-			else_bounds;
-		}
+	bool zf = check_lahf_bit(Zero_lahf, flags);
+	bool sf = check_lahf_bit(Sign_lahf, flags);
+	bool of = check_lahf_bit(Overflow_lahf, flags);
+	bool cf = check_lahf_bit(Carry_lahf, flags);
 
-		ASSERT_MSG((!unhandled), ("ERROR: opcode %s(%d) with %d dests and %d srcs (app_pc - %d) not handled in canonicalization\n", dr_operation_to_string(cinstr->opcode).c_str(), cinstr->opcode,
-			cinstr->num_dsts, cinstr->num_srcs, cinstr->pc));
+	switch (cond){
+	case RC_L: return sf != of;
+	case RC_LE: return zf || (sf != of);
+	case RC_NLE: return !zf && (sf == of);
+	case RC_NL: return sf == of;
+	case RC_Z: return zf;
+	case RC_NZ: return !zf;
+	case RC_S: return sf;
+	case RC_NS: return !sf;
+	case RC_B: return cf;
 	}
 
-	return rinstr;
+	ASSERT_MSG(false, ("ERROR: unknown condition %d\n", cond));
+	return false;
 
 }
 
-/* this is a pure function without side effects for cinstr - check to make sure */
-
-/*
-Function - cinstr_to_rinstrs
-
-Parameters
- cinstr - pointer to a pre-populated complex x86 instruction
- amount - pass by reference variable, which will contain how many reduced set instructions were need to canonicalize the given x86 instruction
- disasm - string of the disassembly of 'cinstr'. Can be used for debuggin purposes 
- line	- the line in which this instruction can be found in the instruction trace (after filtering)
-
-Return
- rinstr_t * - an array of reduced instructions
-
- Please fill out new instructions using the guidelines given in the README file.
-
-*/
-rinstr_t * cinstr_to_rinstrs(cinstr_t * cinstr, int &amount, std::string disasm, uint32_t line){
-
-	int operation;
-
-	DEBUG_PRINT(("entering canonicalization - app_pc %u\n", cinstr->pc), 4);
-
-	rinstr_t * rinstr;
-	rinstr = NULL;
-	amount = 0;
-
-	bool unhandled = false;
-
+static bool check_semantic_guard(uint32_t guard, const rsem_t * sem, cinstr_t * cinstr, const operand_t * srcs){
 
-	switch (cinstr->opcode){
-
-		/************************* vector instructions ****************************/
-	case OP_movss:
-		//Kevin - to test
-		if_bounds(1,1){
-			// move low 32 bits from src to dst. Upper bits unchanged if dst is register
-			// bits 127-32 zeroed if source is memory
-			operand_t dst = cinstr -> dsts[0];
-			operand_t src = cinstr -> srcs[0];
-			// get low 32 bits of dst (or 4 bytes)
-			operand_t dst_low = {dst.type, 4, dst.value + dst.width - 4, NULL };
-			operand_t src_low = {src.type, 4, src.value + src.width - 4, NULL };
-			if ( dst.type == MEM_STACK_TYPE || dst.type == MEM_HEAP_TYPE ){
-				rinstr = new rinstr_t[2];
-				rinstr[0] = { op_assign, dst_low, 1, { src_low }, true };
-				//get upper bits
-				operand_t dst_high = {dst.type, 12, dst.value + dst.width - 16, NULL};
-				// move zeros into upper bits
-				operand_t immediate = { IMM_INT_TYPE, 12, 0 , NULL};
-				rinstr[1] = { op_assign, dst_high, 1, { immediate }, true };
-			}
-			else {
-				rinstr = new rinstr_t[1];
-				rinstr[0] = { op_assign, dst_low, 1, { src_low }, true };
-			}
-		}
-		else_bounds;
-
-	case OP_pmuldq:
-		// Kevin - to test
-		if_bounds(2,1){
-			// If destination larger than 128 bit, should keep upper bits unchanged
-			// dsts[0][63:0] <- srcs[0][31:0] * srcs[1][31:0]
-			// dsts[0][127:64] <- srcs[0][95:64] * srcs[1][95:64]
-
-			amount = 2;
-			rinstr = new rinstr_t[amount];
-			// create virtual reg/mem accessing 32 bit input ranges tmp 64 bit reg and 2 tmp 32 bit reg
-			operand_t input1 = cinstr -> srcs[0];
-			operand_t input2 = cinstr -> srcs[1];
-			operand_t output = cinstr -> dsts[0];
-			// offset starting point by correct number of BYTES (divide by 8 to change from bits to bytes)
-			operand_t input32_1 = { input1.type, 4, input1.value + input1.width - 4, NULL };
-			operand_t input32_2 = { input2.type, 4, input2.value + input2.width - 4, NULL };
-			operand_t input96_1 = { input1.type, 4, input1.value + input1.width - 12, NULL };
-			operand_t input96_2 = { input2.type, 4, input2.value + input2.width - 12, NULL };
-			// create virtual reg/mem accessing 8 byte output ranges
-			operand_t output_low = { output.type, 8, output.value + output.width - 8, NULL };
-			operand_t output_high = { output.type, 8, output.value + output.width - 16, NULL };
-
-			// out_low <- input32_1 * input32_2
-			rinstr[0] = { op_mul, output_low, 2, { input32_1, input32_2 }, true };
-			// out_high <- input96_1 * input96_2
-			rinstr[1] = { op_mul, output_high, 2, { input96_1, input96_2 }, true };
-		}
-		else_bounds;
-
-		/******************************************integer instructions****************************************************************/
-
-	case OP_push_imm:
-	case OP_push:
-		// [esp - 4] (dst[1]) <- src[0]
-		if_bounds(2, 2){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			rinstr[0] = { op_assign, cinstr->dsts[1], 1, { cinstr->srcs[0] }, false };
-		}
-		else_bounds;
-
-	case OP_pop:
-		// dst[0] <- [esp] (src[1])
-		if_bounds(2, 2){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			rinstr[0] = { op_assign, cinstr->dsts[0], 1, { cinstr->srcs[1] }, false };
-		}
-		else_bounds;
-
-	case OP_mov_st:
-	case OP_mov_ld:
-	case OP_mov_imm:
-	case OP_movzx:
-	case OP_movsx:
-	case OP_movq:
-	case OP_movd:
-	case OP_movapd:
-	case OP_movdqa:
-	case OP_mov_seg:
-	case OP_movaps: // Kevin - to test
-
-	case OP_vmovss: // check!!
-	case OP_vmovsd: //check !
-
-	case OP_vcvtsi2ss: // check!!
-	case OP_vcvtsi2sd: // check !!
-	case OP_vcvttss2si: // check !! 
-	case OP_vcvttsd2si: // cehck !!
-
-	case OP_cvttsd2si: // check !!
-	
-		// dst[0] <- src[0]
-		if_bounds(1, 1){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			rinstr[0] = { op_assign, cinstr->dsts[0], 1, { cinstr->srcs[0] }, false };
-		}
-		elseif_bounds(1, 2){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			rinstr[0] = { op_assign, cinstr->dsts[0], 1, { cinstr->srcs[1] }, false };
-		}
-		else_bounds;
-
-	case OP_vmulss: // check !!
-	case OP_vmulsd:
-		if_bounds(1, 2){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			rinstr[0] = { op_mul, cinstr->dsts[0], 2, { cinstr->srcs[0], cinstr->srcs[1] }, false };
-		}
-		else_bounds;
-
-	case OP_vaddsd:
-		if_bounds(1, 2){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			rinstr[0] = { op_add, cinstr->dsts[0], 2, { cinstr->srcs[0], cinstr->srcs[1] }, false };
-		}
-		else_bounds;
-
-
-	case OP_imul:
-		// 1st flavour -> 1 dst * 2 src
-		//dst[0] <- src[0] * src[1]
-		if_bounds(1, 2){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			rinstr[0] = { op_mul, cinstr->dsts[0], 2, { cinstr->srcs[0], cinstr->srcs[1] }, true };
-		}
-		elseif_bounds(2, 2){
-			// edx [dst0] : eax [dst1] <- eax [src1] * [src0] 
-			rinstr = new rinstr_t[3];
-			amount = 3;
-			// create an operand for the virtual register
-			operand_t virtual_reg = { REG_TYPE, 2 * cinstr->srcs[1].width, DR_REG_VIRTUAL_1 , NULL};
-			reg_to_mem_range(&virtual_reg);
-
-			//virtual <= eax * src0
-			rinstr[0] = { op_mul, virtual_reg, 2, { cinstr->srcs[1], cinstr->srcs[0] }, true };
-
-			//edx <= split_h(virtual)
-			rinstr[1] = { op_split_h, cinstr->dsts[0], 1, { virtual_reg }, true };
-
-			//eax <= split_l(virtual)
-			rinstr[2] = { op_split_l, cinstr->dsts[1], 1, { virtual_reg }, true };
-		}
-		else_bounds;
-
-
-	case OP_mul:
-
-		if_bounds(2, 2){
-			// edx [dst0] : eax [dst1] <- eax [src1] * [src0] 
-			rinstr = new rinstr_t[3];
-			amount = 3;
-			// create an operand for the virtual register
-			operand_t virtual_reg = { REG_TYPE, 2 * cinstr->srcs[1].width, DR_REG_VIRTUAL_1 , NULL};
-			reg_to_mem_range(&virtual_reg);
-
-			//virtual <= eax * src0
-			rinstr[0] = { op_mul, virtual_reg, 2, { cinstr->srcs[1], cinstr->srcs[0] }, false };
-
-			//edx <= split_h(virtual)
-			rinstr[1] = { op_split_h, cinstr->dsts[0], 1, { virtual_reg }, false };
-
-			//eax <= split_l(virtual)
-			rinstr[2] = { op_split_l, cinstr->dsts[1], 1, { virtual_reg }, false };
-
-		}
-		else_bounds;
-
-	case OP_idiv:
-		//dst - edx / dx , eax / ax , src - src[0], edx / dx , eax / ax
-		if_bounds(2, 3){
-			rinstr = new rinstr_t[3];
-			amount = 3;
-			/* create an operand for the virtual register */
-			operand_t virtual_reg = { REG_TYPE, 2 * cinstr->srcs[1].width, DR_REG_VIRTUAL_1 , NULL};
-			reg_to_mem_range(&virtual_reg);
-
-			//virtual <- edx:eax
-			rinstr[0] = { op_concat, virtual_reg, 2, { cinstr->srcs[1], cinstr->srcs[2] }, false };
-
-			//edx <- virtual % src[0]
-			rinstr[1] = { op_mod, cinstr->dsts[0], 2, { virtual_reg, cinstr->srcs[0] }, true };
-
-			//eax <- virtual / src[0]
-			rinstr[2] = { op_div, cinstr->dsts[1], 2, { virtual_reg, cinstr->srcs[0] }, true };
-		}
-		else_bounds;
-
-	case OP_cdq:
-		// need to change
-		// edx <- eax
-		if_bounds(1, 1){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			rinstr[0] = { op_signex, cinstr->dsts[0], 1, { cinstr->srcs[0] }, true };
-
-		}
-		else_bounds;
-
-	case OP_cwde:
-		// eax <- ax
-		if_bounds(1, 1){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			rinstr[0] = { op_signex, cinstr->dsts[0], 1, { cinstr->srcs[0] }, true };
-
-		}
-		else_bounds;
-
-	case OP_xchg:
-		//exchange the two registers
-		if_bounds(2, 2){
-			rinstr = new rinstr_t[3];
-			amount = 3;
-			operand_t virtual_reg = { REG_TYPE, cinstr->srcs[0].width, DR_REG_VIRTUAL_1 , NULL};
-			reg_to_mem_range(&virtual_reg);
-
-			ASSERT_MSG(((cinstr->dsts[0].value == cinstr->srcs[0].value) && (cinstr->dsts[1].value == cinstr->srcs[1].value)), ("op_fxch the dsts and srcs should match\n"));
-
-			//virtual <- src[0]
-			rinstr[0] = { op_assign, virtual_reg, 1, { cinstr->srcs[0] }, false };
-			//dst[0] <- src[1]
-			rinstr[1] = { op_assign, cinstr->dsts[0], 1, { cinstr->srcs[1] }, false };
-			//dst[1] <- virtual 
-			rinstr[2] = { op_assign, cinstr->dsts[1], 1, { virtual_reg }, false };
-		}
-		else_bounds;
-
-	case OP_xorps:// KEVIN - test
-	case OP_xor:
-	case OP_sub:
-	case OP_pxor:
-	case OP_psubd:
-
-
-		if_bounds(1, 2){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-
-			uint32_t operation;
-			switch (cinstr->opcode){
-			case OP_xorps: // KEVIN -test
-			case OP_xor:
-			case OP_pxor:
-				operation = op_xor; break;
-			case OP_sub:
-			case OP_psubd:
-				operation = op_sub; break;
-
-			}
+	if ((guard & RG_SAME_SRCS) && !(srcs[0].type == srcs[1].type && srcs[0].value == srcs[1].value)) return false;
+	if ((guard & RG_NO_SCALE) && srcs[2].value != 0) return false;
+	if ((guard & RG_CARRY) && !check_lahf_bit(Carry_lahf, cinstr->eflags)) return false;
+	if ((guard & RG_COND) && !check_semantic_condition(sem->cond, cinstr->eflags)) return false;
+	if ((guard & RG_SRC_MEM) && srcs[0].type != MEM_STACK_TYPE && srcs[0].type != MEM_HEAP_TYPE) return false;
+	if ((guard & RG_DST_REG) && cinstr->dsts[0].type != REG_TYPE) return false;
+	if ((guard & RG_EXCHANGE) && !(cinstr->dsts[0].value == srcs[0].value && cinstr->dsts[1].value == srcs[1].value)) return false;
+	return true;
 
-			operand_t first = cinstr->srcs[0];
-			operand_t second = cinstr->srcs[1];
-			if (first.type == second.type && first.value == second.value){
-				operand_t zero = { IMM_INT_TYPE, cinstr->srcs[0].width, 0 , NULL};
-				rinstr[0] = { op_assign, cinstr->dsts[0], 1, { zero }, false };
-			}
-			else{
-				rinstr[0] = { operation, cinstr->dsts[0], 2, { cinstr->srcs[1], cinstr->srcs[0] }, false };
-			}
-
-		}
-		else_bounds;
-
-	case OP_add:
-	case OP_and:
-	case OP_or:
-	case OP_andpd:
-
-		// dst[0] <- src[1] (op) src[0]
-		if_bounds(1, 2){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			uint32_t operation;
-			switch (cinstr->opcode){
-
-			case OP_add:
-				operation = op_add; break;
-			case OP_and:
-			case OP_andpd:
-				operation = op_and; break;
-			case OP_or: operation = op_or; break;
-			}
-			rinstr[0] = { operation, cinstr->dsts[0], 2, { cinstr->srcs[1], cinstr->srcs[0] }, false };  /* changed for SUB (src1, src0) from the reverse: please verify */
-		}
-		else_bounds;
-
-	case OP_neg:
-		if_bounds(1, 1){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			rinstr[0] = { op_sub, cinstr->dsts[0], 1, { cinstr->srcs[0] }, false };
-		}
-		else_bounds;
-
-	case OP_dec:
-		if_bounds(1, 1){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			operand_t immediate = { IMM_INT_TYPE, cinstr->srcs[0].width, 1 , NULL};
-			rinstr[0] = { op_sub, cinstr->dsts[0], 2, { cinstr->srcs[0], immediate }, true };
-		}
-		else_bounds;
-
-	case OP_inc:
-		if_bounds(1, 1){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			operand_t immediate = { IMM_INT_TYPE, cinstr->srcs[0].width, 1 , NULL};
-			rinstr[0] = { op_add, cinstr->dsts[0], 2, { cinstr->srcs[0], immediate }, true };
-		}
-		else_bounds;
-
-	case OP_sar:
-
-		if_bounds(1, 2){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			rinstr[0] = { op_rsh, cinstr->dsts[0], 2, { cinstr->srcs[1], cinstr->srcs[0] }, true };
-		}
-		else_bounds;
-
-	case OP_shr:
-	case OP_psrlq:
-
-		if_bounds(1, 2){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			rinstr[0] = { op_rsh, cinstr->dsts[0], 2, { cinstr->srcs[1], cinstr->srcs[0] }, false };
-		}
-		else_bounds;
-
-	case OP_shl:
-	case OP_psllq:
-
-		if_bounds(1, 2){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			rinstr[0] = { op_lsh, cinstr->dsts[0], 2, { cinstr->srcs[1], cinstr->srcs[0] }, false };
-		}
-		else_bounds;
-
-	case OP_not:
-
-		if_bounds(1, 1){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			rinstr[0] = { op_not, cinstr->dsts[0], 1, { cinstr->srcs[0] }, false };
-		}
-		else_bounds;
-
-	case OP_lea:
-
-		//[base, index, scale, disp]
-		if_bounds(1, 4){
-			if (cinstr->srcs[0].value == 0 && cinstr->srcs[0].type == REG_TYPE){
-				cinstr->srcs[0].type = IMM_INT_TYPE;
-				cinstr->srcs[0].width = 4;
-				cinstr->srcs[0].value = 0;
-			}
-
-			if (cinstr->srcs[2].value == 0){
-				rinstr = new rinstr_t[1];
-				amount = 1;
-				//dst <= base(src0) + disp(src3)
-				rinstr[0] = { op_add, cinstr->dsts[0], 2, { cinstr->srcs[0], cinstr->srcs[3] }, true };
-
-			}
-			else{
-				rinstr = new rinstr_t[3];
-				amount = 3;
-				operand_t virtual_reg = { REG_TYPE, cinstr->srcs[0].width, DR_REG_VIRTUAL_1 , NULL};
-				reg_to_mem_range(&virtual_reg);
-
-				//virtual <= scale(src2) * index(src1)
-				rinstr[0] = { op_mul, virtual_reg, 2, { cinstr->srcs[2], cinstr->srcs[1] }, true };
-				//virtual <= virtual + base(src0)
-				rinstr[1] = { op_add, virtual_reg, 2, { virtual_reg, cinstr->srcs[0] }, true };
-				//dst <= virtual + disp
-				rinstr[2] = { op_add, cinstr->dsts[0], 2, { virtual_reg, cinstr->srcs[3] }, true };
-
-			}
-
-		}
-		else_bounds;
-
-	case OP_sbb:
-
-		if_bounds(1, 2){
-			bool cf = check_lahf_bit(Carry_lahf, cinstr->eflags);
-			if (cf){
-				rinstr = new rinstr_t[2];
-				amount = 2;
-			}
-			else{
-				rinstr = new rinstr_t[1];
-				amount = 1;
-			}
-			//dsts[0] <- srcs[1] - srcs[0]
-			if ((cinstr->srcs[0].type == cinstr->srcs[1].type) && (cinstr->srcs[0].value == cinstr->srcs[1].value)){
-				operand_t immediate_0 = { IMM_INT_TYPE, cinstr->srcs[1].width, 0 , NULL};
-				rinstr[0] = { op_assign, cinstr->dsts[0], 1, { immediate_0 }, true };
-			}
-			else{
-				rinstr[0] = { op_sub, cinstr->dsts[0], 2, { cinstr->srcs[1], cinstr->srcs[0] }, true };  /* changed for SUB (src1, src0) from the reverse: please verify */
-			}
-			if (cf){ //substract an immediate 1
-				//dsts[0] <- dsts[0] - 1
-				operand_t immediate_1 = { IMM_INT_TYPE, cinstr->srcs[1].width, 1 , NULL};
-				rinstr[1] = { op_sub, cinstr->dsts[0], 2, { cinstr->dsts[0], immediate_1 }, true };
-			}
-		}
-		else_bounds;
-
-	case OP_adc:
-
-		if_bounds(1, 2){
-
-			bool cf = check_lahf_bit(Carry_lahf, cinstr->eflags);
-			if (cf){
-				rinstr = new rinstr_t[2];
-				amount = 2;
-			}
-			else{
-				rinstr = new rinstr_t[1];
-				amount = 1;
-			}
-
-			//dsts[0] <- srcs[1] + srcs[0]
-			rinstr[0] = { op_add, cinstr->dsts[0], 2, { cinstr->srcs[1], cinstr->srcs[0] }, true };
-			//dsts[0] <- dsts[0] + 1
-			if (cf){
-				operand_t immediate_1 = { IMM_INT_TYPE, cinstr->srcs[1].width, 1, NULL };
-				rinstr[1] = { op_add, cinstr->dsts[0], 2, { cinstr->dsts[0], immediate_1}, true };
-			}
-		}
-		else_bounds;
-
-	case OP_cmovle:
-	case OP_cmovnle:
-	case OP_cmovl:
-	case OP_cmovnl:
-	case OP_cmovz:
-	case OP_cmovns:
-	case OP_cmovnz:
-		if_bounds(1, 2){
-
-			bool zf = check_lahf_bit(Zero_lahf, cinstr->eflags);
-			bool sf = check_lahf_bit(Sign_lahf, cinstr->eflags);
-			bool of = check_lahf_bit(Overflow_lahf, cinstr->eflags);
-
-
-			bool check = false;
-			if (cinstr->opcode == OP_cmovl) check = sf != of;
-			else if (cinstr->opcode == OP_cmovle) check = zf || (sf != of) ;
-			else if (cinstr->opcode == OP_cmovnle) check = !zf || (sf == of);
-			else if (cinstr->opcode == OP_cmovnl) check = sf == of;
-			else if (cinstr->opcode == OP_cmovz) check = zf;
-			else if (cinstr->opcode == OP_cmovnz) check = !zf;
-			else if (cinstr->opcode == OP_cmovns) check = !sf;
-
-			if (check){
-				rinstr = new rinstr_t[1];
-				amount = 1;
-				rinstr[0] = { op_assign, cinstr->dsts[0], 1, { cinstr->srcs[0] }, true };
-			}
-			else{
-				amount = 0;
-			}
-
-		}
-		else_bounds;
-
-	case OP_setz:
-	case OP_sets:
-	case OP_setns:
-	case OP_setnz:
-	case OP_setb:
-
-		if_bounds(1, 0){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			bool flag;
-			switch (cinstr->opcode){
-			case OP_setz: flag = check_lahf_bit(Zero_lahf, cinstr->eflags); break;
-			case OP_setnz: flag = check_lahf_bit(Zero_lahf, cinstr->eflags); break;
-			case OP_sets: flag = check_lahf_bit(Sign_lahf, cinstr->eflags); break;
-			case OP_setns: flag = !check_lahf_bit(Sign_lahf, cinstr->eflags); break;
-			case OP_setb: flag = check_lahf_bit(Carry_lahf, cinstr->eflags); break;
-			}
-			if (flag){
-				operand_t immediate = { IMM_INT_TYPE, cinstr->dsts[0].width, 1, NULL};
-				rinstr[0] = { op_assign, cinstr->dsts[0], 1, { immediate }, true };
-			}
-			else{
-				operand_t immediate = { IMM_INT_TYPE, cinstr->dsts[0].width, 0, NULL};
-				rinstr[0] = { op_assign, cinstr->dsts[0], 1, { immediate }, true };
-			}
-		}
-		else_bounds;
-
-	case OP_xadd:
-
-		if_bounds(2, 2){
-			rinstr = new rinstr_t[3];
-			operand_t virtual_reg = { REG_TYPE, cinstr->srcs[0].width, DR_REG_VIRTUAL_1, NULL};
-			reg_to_mem_range(&virtual_reg);
-			rinstr[0] = { op_add, virtual_reg, 2, { cinstr->srcs[0], cinstr->srcs[1] }, true };
-			rinstr[1] = { op_assign, cinstr->srcs[1], 1, { cinstr->srcs[0] }, true };
-			rinstr[2] = { op_assign, cinstr->srcs[0], 1, { virtual_reg }, true };
-			amount = 3;
-
-		}
-		else_bounds;
+}
 
-		/***************************************************floating point instructions*********************************************************/
+static operand_t get_semantic_opnd(const rsem_opnd_t &spec, const rsem_t * sem, cinstr_t * cinstr, const operand_t * srcs){
+
+	operand_t opnd = { REG_TYPE, 0, 0, NULL };
+
+	switch (spec.kind){
+	case RO_DST: opnd = cinstr->dsts[spec.index]; break;
+	case RO_SRC: opnd = srcs[spec.index]; break;
+	case RO_VIRTUAL:
+		opnd.width = spec.value * srcs[spec.index].width;
+		opnd.value = DR_REG_VIRTUAL_1;
+		reg_to_mem_range(&opnd);
+		return opnd;
+	case RO_IMM:
+		opnd.type = IMM_INT_TYPE;
+		opnd.width = (spec.width != 0) ? spec.width : srcs[spec.index].width;
+		opnd.value = spec.value;
+		return opnd;
+	case RO_FLAG:
+		opnd.type = IMM_INT_TYPE;
+		opnd.width = cinstr->dsts[spec.index].width;
+		opnd.value = check_semantic_condition(sem->cond, cinstr->eflags) ? 1 : 0;
+		return opnd;
+	}
 
-		/* floating point instructions */
+	/* part of a register or memory range */
+	if (spec.width != 0){
+		opnd.value = opnd.value + opnd.width - spec.offset;
+		opnd.width = spec.width;
+		opnd.addr = NULL;
+	}
+	return opnd;
 
-	case OP_fld: //Push m32fp onto the FPU register stack.
-	case OP_fld1: //Push +1.0 onto the FPU register stack
-	case OP_fild: //Push m32int onto the FPU register stack.
-	case OP_fldz: //Push +0.0 onto the FPU register stack.
-		// dst[0] <- src[0]
-		if_bounds(1, 1){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			rinstr[0] = { op_assign, cinstr->dsts[0], 1, { cinstr->srcs[0] }, false };
+}
 
-		}
-		else_bounds;
+/* expands the first matching form into rinstr; false if no form matches */
+static bool expand_semantics(const rsem_t * sem, cinstr_t * cinstr, rinstr_t * rinstr, int &amount){
 
+	const rsem_shape_t * shape = sem->shape;
 
-	case OP_fst:
-	case OP_fstp:  //Copy ST(0) to m32fp and pop register stack.
-	case OP_fistp:  //Store ST(0) in m32int and pop register stack.
-		if_bounds(1, 1){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			rinstr[0] = { op_assign, cinstr->dsts[0], 1, { cinstr->srcs[0] }, false };
+	/* sources are read from a copy so that cinstr is left as it is */
+	operand_t srcs[MAX_SRCS];
+	for (int i = 0; i < cinstr->num_srcs; i++){
+		srcs[i] = cinstr->srcs[i];
+	}
+	if ((shape->flags & RSEM_ADDRESS) && srcs[0].type == REG_TYPE && srcs[0].value == 0){
+		operand_t zero = { IMM_INT_TYPE, 4, 0, NULL };
+		srcs[0] = zero;
+	}
 
-		}
-		else_bounds;
+	for (int i = 0; i < shape->num_forms; i++){
 
-	case OP_fmul: //Multiply ST(0) by m32fp and store result in ST(0).
-	case OP_fmulp:  //Multiply ST(i) by ST(0), store result in ST(i), and pop the register stack.
-		if_bounds(1, 2){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			rinstr[0] = { op_mul, cinstr->dsts[0], 2, { cinstr->srcs[0], cinstr->srcs[1] }, true };
+		const rsem_form_t * form = &shape->forms[i];
+		if (form->num_dsts != cinstr->num_dsts || form->num_srcs != cinstr->num_srcs) continue;
+		if (!check_semantic_guard(form->guard, sem, cinstr, srcs)) continue;
 
-		}
-		else_bounds;
-
-		//Exchange the contents of ST(0) and ST(i).
-	case OP_fxch:
-		//exchange the two registers
-		if_bounds(2, 2){
-			rinstr = new rinstr_t[3];
-			amount = 3;
-			operand_t virtual_reg = { REG_TYPE, cinstr->srcs[0].width, DR_REG_VIRTUAL_1, NULL};
-			reg_to_mem_range(&virtual_reg);
-			ASSERT_MSG(((cinstr->dsts[0].value == cinstr->srcs[0].value) && (cinstr->dsts[1].value == cinstr->srcs[1].value)), ("op_fxch the dsts and srcs should match\n"));
-			//virtual <- src[0]
-			rinstr[0] = { op_assign, virtual_reg, 1, { cinstr->srcs[0] }, false };
-			//dst[0] <- src[1]
-			rinstr[1] = { op_assign, cinstr->dsts[0], 1, { cinstr->srcs[1] }, false };
-			//dst[1] <- virtual 
-			rinstr[2] = { op_assign, cinstr->dsts[1], 1, { virtual_reg }, false };
-		}
-		else_bounds;
-
-	case OP_faddp:  //Add ST(0) to ST(i), store result in ST(i), and pop the register stack
-	case OP_fadd:   //Add m32fp to ST(0) and store result in ST(0).
-	case OP_fsubp:  //Subtract ST(0) from ST(1), store result in ST(1), and pop register stack.
-	case OP_fsub:   //Subtract m32fp from ST(0) and store result in ST(0).
-	case OP_fdivp:  //Divide ST(1) by ST(0), store result in ST(1), and pop the register stack.
-	case OP_fdiv:   //Divide ST(0) by m32fp and store result in ST(0).
-		// dst[0] <- src[1] (op) src[0]
-		if_bounds(1, 2){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			uint32_t operation;
-			switch (cinstr->opcode){
-			case OP_faddp:
-			case OP_fadd:
-				operation = op_add; break;
-			case OP_fsubp:
-			case OP_fsub:
-				operation = op_sub; break;
-			case OP_fdiv:
-			case OP_fdivp:
-				operation = op_div; break;
+		for (int j = 0; j < form->amount; j++){
+			const rsem_instr_t * templ = &form->rinstrs[j];
+			rinstr[j].operation = (templ->operation == RSEM_OP) ? sem->operation : templ->operation;
+			rinstr[j].dst = get_semantic_opnd(templ->dst, sem, cinstr, srcs);
+			rinstr[j].num_srcs = templ->num_srcs;
+			for (int k = 0; k < templ->num_srcs; k++){
+				rinstr[j].srcs[k] = get_semantic_opnd(templ->srcs[k], sem, cinstr, srcs);
 			}
-			rinstr[0] = { operation, cinstr->dsts[0], 2, { cinstr->srcs[1], cinstr->srcs[0] }, false };  /* changed for SUB (src1, src0) from the reverse: please verify */
-
-
+			rinstr[j].sign = templ->sign;
+			rinstr[j].is_floating = (sem->flags & RSEM_FLOATING) != 0;
 		}
-		else_bounds;
+		amount = form->amount;
+		return true;
 
-	case OP_fsubr:
-		if_bounds(1, 2){
-			rinstr = new rinstr_t[1];
-			amount = 1;
-			rinstr[0] = { op_sub, cinstr->dsts[0], 2, { cinstr->srcs[0], cinstr->srcs[1] }, false };
-		}
-		else_bounds;
+	}
 
-		/******************************************************control flow instructions**************************************************************************************************/
+	return false;
 
-	case OP_btr:
+}
 
-	case OP_cmpxchg:
-	case OP_rep_stos:
-	case OP_cld:
-	case OP_jbe:
+static rinstr_t * reduce_cinstr(cinstr_t * cinstr, rinstr_t * rinstr, int &amount, bool eflags){
 
-	case OP_fcom:
-	case OP_fcomp:
+	DEBUG_PRINT(("entering canonicalization - app_pc %u\n", cinstr->pc), 4);
 
-		/* above change */
+	amount = 0;
 
-	case OP_jmp:
-	case OP_jmp_short:
-	case OP_jnl:
-	case OP_jnl_short:
-	case OP_jl:
-	case OP_jnle:
-	case OP_jnle_short:
-	case OP_jnz:
-	case OP_jnz_short:
-	case OP_jz:
-	case OP_jnb_short:
-	case OP_jb_short:
-	case OP_jz_short:
-	case OP_jl_short:
-	case OP_jns_short:
-	case OP_js_short:
-	case OP_jnbe_short:
-	case OP_jle_short:
-	case OP_jle:
-	case OP_jbe_short:
-	case OP_jns:
-	case OP_jb:
-	case OP_jnb:
-	case OP_js:
-	case OP_jmp_ind:
-	case OP_jnbe:
+	const rsem_t * sem = get_opcode_semantics(cinstr->opcode);
+	bool handled = false;
+	if (sem != NULL){
+		if ((sem->shape->flags & RSEM_EFLAGS) && !eflags) handled = true;
+		else handled = expand_semantics(sem, cinstr, rinstr, amount) || (sem->shape->flags & RSEM_SKIP);
+	}
 
-	case OP_cmp:
-	case OP_test:
+	ASSERT_MSG((handled), ("ERROR: opcode %s(%d) with %d dests and %d srcs (app_pc - %d) not handled in canonicalization\n", dr_operation_to_string(cinstr->opcode).c_str(), cinstr->opcode,
+		cinstr->num_dsts, cinstr->num_srcs, cinstr->pc));
 
-	case OP_call:
-	case OP_ret:
-	case OP_call_ind:
+	if (amount == 0){
+		DEBUG_PRINT(("opcode skipped\n"), 4);
+		return NULL;
+	}
 
-		/* need to check these as they change esp and ebp ; for now just disregard */
-	case OP_enter:
-	case OP_leave:
+	DEBUG_PRINT(("opcode reduced\n"), 4);
+	METRIC_ADD(METRIC_RINSTRS_DECODED, amount);
+	return rinstr;
 
-		/* floating point control word stores and loads */
-	case OP_fldcw:
-	case OP_fnstcw:
-	case OP_fnstsw:
-	case OP_stmxcsr:
-	case OP_fwait:
+}
 
-	case OP_nop_modrm:
+/* this gets true dependancies + instructions affecting eflags
+Function - cinstr_to_rinstrs_eflags
 
+Parameters - refer to cinstr_to_rinstrs function
+Return - refer to cinstr_to_rinstrs function
 
+This function is similar to cinstr_to_rinstrs in all ways except in addition, it canonicalizes instructions which affect eflags
+but does not write to any destination permanently (the RSEM_EFLAGS shapes of the semantics table).
 
-	case OP_nop:
+*/
+rinstr_t * cinstr_to_rinstrs_eflags(cinstr_t * cinstr, rinstr_t * rinstr, int &amount, const std::string &disasm, uint32_t line){
 
+	return reduce_cinstr(cinstr, rinstr, amount, true);
 
-		break;
+}
 
-	default:
-		unhandled = true;
+/*
+Function - cinstr_to_rinstrs
 
+Parameters
+ cinstr - pointer to a pre-populated complex x86 instruction
+ rinstr - caller provided storage for at least MAX_RINSTRS reduced instructions
+ amount - pass by reference variable, which will contain how many reduced set instructions were need to canonicalize the given x86 instruction
+ disasm - string of the disassembly of 'cinstr'. Can be used for debuggin purposes
+ line	- the line in which this instruction can be found in the instruction trace (after filtering)
 
-	}
+Return
+ rinstr_t * - rinstr filled with amount reduced instructions, NULL if the instruction has nothing to reduce
 
-	ASSERT_MSG((!unhandled), ("ERROR: opcode %s(%d) with %d dests and %d srcs (app_pc - %d) not handled in canonicalization\n", dr_operation_to_string(cinstr->opcode).c_str(), cinstr->opcode,
-		cinstr->num_dsts, cinstr->num_srcs, cinstr->pc));
+ The reduction is driven by the semantics table in x86_semantics.cpp; please fill out new instructions using the
+ guidelines given in the README file.
 
-	if (rinstr == NULL){
-		DEBUG_PRINT(("opcode skipped\n"), 4);
-	}
-	else{
-		DEBUG_PRINT(("opcode reduced\n"), 4);
-	}
+*/
+rinstr_t * cinstr_to_rinstrs(cinstr_t * cinstr, rinstr_t * rinstr, int &amount, const std::string &disasm, uint32_t line){
 
-	for (int i = 0; i < amount; i++){
-		rinstr[i].is_floating = is_floating_point_ins(cinstr->opcode);
-	}
+	return reduce_cinstr(cinstr, rinstr, amount, false);
 
-	return rinstr;
 }
 
+
 void cinstr_convert_reg(cinstr_t * instr){
 
 	for (int i = 0; i < instr->num_srcs; i++){
@@ -1168,73 +516,62 @@ int mem_range_to_reg(operand_t * opnd){
 
 }
 
-void update_regs_to_mem_range(vec_cinstr &instrs){
-
-	DEBUG_PRINT(("converting reg to mem\n"), 2);
+static void update_instr_regs_to_mem_range(cinstr_t * instr){
 
-	for (int i = 0; i < instrs.size(); i++){
-		cinstr_t * instr = instrs[i].first;
-		//print_cinstr(instrs[i].first);
-		for (int i = 0; i < instr->num_srcs; i++){
-			if ((instr->srcs[i].type == REG_TYPE) && (instr->srcs[i].value > DR_REG_ST7)) instr->srcs[i].value += 8;
-			reg_to_mem_range(&instr->srcs[i]);
-			if (instr->srcs[i].addr != NULL){
-				for (int j = 0; j < 4; j++){
-					if (instr->srcs[i].addr[j].type == REG_TYPE && instr->srcs[i].addr[j].value == 0){
-						continue;
-					}
-					reg_to_mem_range(&instr->srcs[i].addr[j]);
+	for (int i = 0; i < instr->num_srcs; i++){
+		if ((instr->srcs[i].type == REG_TYPE) && (instr->srcs[i].value > DR_REG_ST7)) instr->srcs[i].value += 8;
+		reg_to_mem_range(&instr->srcs[i]);
+		if (instr->srcs[i].addr != NULL){
+			for (int j = 0; j < 4; j++){
+				if (instr->srcs[i].addr[j].type == REG_TYPE && instr->srcs[i].addr[j].value == 0){
+					continue;
 				}
+				reg_to_mem_range(&instr->srcs[i].addr[j]);
 			}
 		}
+	}
 
-		for (int i = 0; i < instr->num_dsts; i++){
-			if (instr->dsts[i].type == REG_TYPE && (instr->dsts[i].value > DR_REG_ST7)) instr->dsts[i].value += 8;
-			reg_to_mem_range(&instr->dsts[i]);
-			if (instr->dsts[i].addr != NULL){
-				for (int j = 0; j < 4; j++){
-					if (instr->dsts[i].addr[j].type == REG_TYPE && instr->dsts[i].addr[j].value == 0){
-						continue;
-					}
-					reg_to_mem_range(&instr->dsts[i].addr[j]);
+	for (int i = 0; i < instr->num_dsts; i++){
+		if (instr->dsts[i].type == REG_TYPE && (instr->dsts[i].value > DR_REG_ST7)) instr->dsts[i].value += 8;
+		reg_to_mem_range(&instr->dsts[i]);
+		if (instr->dsts[i].addr != NULL){
+			for (int j = 0; j < 4; j++){
+				if (instr->dsts[i].addr[j].type == REG_TYPE && instr->dsts[i].addr[j].value == 0){
+					continue;
 				}
+				reg_to_mem_range(&instr->dsts[i].addr[j]);
 			}
 		}
 	}
 
 }
 
+void update_regs_to_mem_range(vec_cinstr &instrs){
+
+	DEBUG_PRINT(("converting reg to mem\n"), 2);
+
+	for (int i = 0; i < instrs.size(); i++){
+		update_instr_regs_to_mem_range(instrs[i].first);
+	}
+
+}
+
 /************************************* handling floating point instructions ******************************************/
 
-#define FP_PUSH	1
-#define FP_POP	2
+/*
+the x87 registers are a stack; st(i) names a different value after every push and pop. update_floating_point_regs
+renames them in a single forward walk to stable stack slots - the slot of st(i) is tos - i, where tos starts at
+DR_REG_ST8 at each function start so that the slots DR_REG_ST0 .. DR_REG_ST15 cover eight values on either side.
+pushes and pops come from the semantics table (RSEM_FP_PUSH / RSEM_FP_POP).
+*/
 
-int32_t tos = DR_REG_ST8;
+#define FP_STACK_BASE	DR_REG_ST8
 
+/* instruction that pushes or pops the x87 stack */
 bool is_floating_point_ins(uint32_t opcode){
-	switch (opcode){
 
-	case OP_fld: //Push m32fp onto the FPU register stack.
-	case OP_fld1: //Push +1.0 onto the FPU register stack
-	case OP_fild: //Push m32int onto the FPU register stack.
-	case OP_fldz: //Push +0.0 onto the FPU register stack.
-	case OP_fst: //Copy ST(0) to m32fp.
-	case OP_fstp:  //Copy ST(0) to m32fp and pop register stack.
-	case OP_fistp:  //Store ST(0) in m32int and pop register stack.
-	case OP_fmul: //Multiply ST(0) by m32fp and store result in ST(0).
-	case OP_fmulp:  //Multiply ST(i) by ST(0), store result in ST(i), and pop the register stack.
-	case OP_fxch:
-	case OP_faddp:  //Add ST(0) to ST(i), store result in ST(i), and pop the register stack
-	case OP_fadd:   //Add m32fp to ST(0) and store result in ST(0).
-	case OP_fsubp:  //Subtract ST(0) from ST(1), store result in ST(1), and pop register stack.
-	case OP_fsub:   //Subtract m32fp from ST(0) and store result in ST(0).
-	case OP_fdivp:  //Divide ST(1) by ST(0), store result in ST(1), and pop the register stack.
-	case OP_fdiv:   //Divide ST(0) by m32fp and store result in ST(0).
-	case OP_fcomp:
-		return true;
-	default:
-		return false;
-	}
+	const rsem_t * sem = get_opcode_semantics(opcode);
+	return (sem != NULL) && ((sem->flags & (RSEM_FP_PUSH | RSEM_FP_POP)) != 0);
 
 }
 
@@ -1248,177 +585,90 @@ bool is_floating_point_reg(operand_t * opnd){
 		);
 }
 
-void get_floating_point_reg(operand_t  * opnd, string disasm, uint32_t line){
+static void update_fp_opnd(operand_t * opnd, int32_t tos, cinstr_t * cinstr, Static_Info * info){
 
-	int32_t reg = mem_range_to_reg(opnd);
-	int32_t offset = reg - DR_REG_ST0;
-	int32_t ret = tos - offset;
-	//cout << line << " floating point reg : " << regname_to_string(ret)  << " " << disasm << endl;
-	//cout << "tos_f: " << tos << endl;
-	ASSERT_MSG((ret <= (int32_t)DR_REG_ST15) && (ret >= (int32_t)DR_REG_ST0), ("ERROR: floating point stack under/overflow"));
-	opnd->value = (uint32_t)ret;
-	reg_to_mem_range(opnd);
-}
+	if (!is_floating_point_reg(opnd)) return;
 
-void update_tos(uint32_t type, string disasm, uint32_t line, uint32_t direction){
-	
-	if (direction == BACKWARD_ANALYSIS){
-		if (type == FP_PUSH){
-			ASSERT_MSG(tos >= DR_REG_ST0, ("ERROR: floating point stack overflow\n"));
-			tos--;
-		}
-		else if (type == FP_POP){
-			ASSERT_MSG(tos < DR_REG_ST15, ("ERROR: floating point stack underflow\n"));
-			tos++;
-		}
-	}
-	else if (direction == FORWARD_ANALYSIS){
-		if (type == FP_POP){
-			ASSERT_MSG(tos >= DR_REG_ST0, ("ERROR: floating point stack overflow\n"));
-			tos--;
-		}
-		else if (type == FP_PUSH){
-			ASSERT_MSG(tos < DR_REG_ST15, ("ERROR: floating point stack underflow\n"));
-			tos++;
-		}
-	}
-
-	//cout << line << " " << disasm <<  " - tos : " << tos - DR_REG_ST8 << endl;
-	
+	int32_t slot = tos - (mem_range_to_reg(opnd) - DR_REG_ST0);
+	ASSERT_MSG((slot <= (int32_t)DR_REG_ST15) && (slot >= (int32_t)DR_REG_ST0), ("ERROR: floating point stack under/overflow at app_pc %d (%s)\n",
+		cinstr->pc, info->disassembly.c_str()));
+	opnd->value = (uint32_t)slot;
+	reg_to_mem_range(opnd);
 
 }
 
-void update_fp_reg(cinstr_t * cinstr, string disasm, uint32_t line){
+static void update_fp_instr(cinstr_t * cinstr, int32_t &tos, Static_Info * info){
+
+	const rsem_t * sem = get_opcode_semantics(cinstr->opcode);
+	uint32_t flags = (sem != NULL) ? sem->flags : 0;
 
+	/* sources read the stack as it was, destinations after a push; pops come last */
+	for (int i = 0; i < cinstr->num_srcs; i++){
+		update_fp_opnd(&cinstr->srcs[i], tos, cinstr, info);
+	}
+	if (flags & RSEM_FP_PUSH){
+		tos++;
+	}
 	for (int i = 0; i < cinstr->num_dsts; i++){
-		if (is_floating_point_reg(&cinstr->dsts[i])){
-			get_floating_point_reg(&cinstr->dsts[i], disasm, line);
-		}
+		update_fp_opnd(&cinstr->dsts[i], tos, cinstr, info);
 	}
-	for (int i = 0; i < cinstr->num_srcs; i++){
-		if (is_floating_point_reg(&cinstr->srcs[i])){
-			get_floating_point_reg(&cinstr->srcs[i], disasm, line);
-		}
+	if (flags & RSEM_FP_POP){
+		tos--;
 	}
 
 }
 
-void update_fp_dest(cinstr_t * cinstr, string disasm, uint32_t line){
-	for (int i = 0; i < cinstr->num_dsts; i++){
-		if (is_floating_point_reg(&cinstr->dsts[i])){
-			get_floating_point_reg(&cinstr->dsts[i], disasm, line);
-		}
-	}
-}
+static void check_fp_stack(int32_t tos, uint32_t pc, const char * where){
 
-void update_fp_src(cinstr_t * cinstr, string disasm, uint32_t line){
-	for (int i = 0; i < cinstr->num_srcs; i++){
-		if (is_floating_point_reg(&cinstr->srcs[i])){
-			get_floating_point_reg(&cinstr->srcs[i], disasm, line);
-		}
+	if (tos != FP_STACK_BASE){
+		DEBUG_PRINT(("WARNING: x87 stack imbalance of %d at function %s (app_pc %d)\n", tos - FP_STACK_BASE, where, pc), 1);
 	}
+
 }
 
-void update_floating_point_regs(vec_cinstr &instrs, uint32_t direction, vector<Static_Info *> static_info, vector<uint32_t> pc){
+/*
+Function - update_floating_point_regs
+
+Parameters
+ instrs	- the filtered forward instruction trace
+ start_pcs, end_pcs - function boundaries the trace was filtered by
 
-	DEBUG_PRINT(("updating floating point regs\n"), 2);
+Converts the registers to memory ranges (see update_regs_to_mem_range) and renames the x87 stack registers to stable
+slots in the same walk. The backward trace should be copied from the result rather than renamed on its own. A
+function whose stack is not back to where it started at its end (or at the next start) is reported; an x87 float
+return value leaves one slot behind and is expected.
+*/
+void update_floating_point_regs(vec_cinstr &instrs, const std::vector<uint32_t> &start_pcs, const std::vector<uint32_t> &end_pcs){
 
-	tos = DR_REG_ST8;
+	DEBUG_PRINT(("converting reg to mem and updating floating point regs\n"), 2);
 
+	int32_t tos = FP_STACK_BASE;
 
 	for (int i = 0; i < instrs.size(); i++){
 
 		cinstr_t * cinstr = instrs[i].first;
-		bool unhandled = false;
-		string disasm = get_disasm_string(static_info, cinstr->pc);
-		//cout << vector[0] << endl;
-	
-		uint32_t line = i + 1;
+		update_instr_regs_to_mem_range(cinstr);
 
 		/* reset for start of the function */
-		for (int j = 0; j < pc.size(); j++){
-			if (cinstr->pc == pc[j]){
-				tos = DR_REG_ST8;
+		for (int j = 0; j < start_pcs.size(); j++){
+			if (cinstr->pc == start_pcs[j]){
+				if (i != 0) check_fp_stack(tos, cinstr->pc, "start");
+				tos = FP_STACK_BASE;
 				break;
 			}
 		}
 
-		int amount;
-		//cinstr_to_rinstrs(cinstr, amount, "", 5);
+		update_fp_instr(cinstr, tos, instrs[i].second);
 
-		if (!is_floating_point_ins(cinstr->opcode)){
-			update_fp_reg(cinstr, disasm, i + 1);
-		}
-		else{
-			switch (cinstr->opcode){
-			case OP_fld: //Push m32fp onto the FPU register stack.
-			case OP_fld1: //Push +1.0 onto the FPU register stack
-			case OP_fild: //Push m32int onto the FPU register stack.
-			case OP_fldz: //Push +0.0 onto the FPU register stack.
-				if (direction == FORWARD_ANALYSIS){
-					update_fp_src(cinstr, disasm, line);
-					update_tos(FP_PUSH, disasm, line, direction);
-					update_fp_dest(cinstr, disasm, line);
-				}
-				else if (direction == BACKWARD_ANALYSIS){
-					update_fp_dest(cinstr, disasm, line);
-					update_tos(FP_PUSH, disasm, line, direction);
-					update_fp_src(cinstr, disasm, line);
-				}
-				break;
-			case OP_fst:
-				update_fp_reg(cinstr, disasm, line);
-				break;
-			case OP_fstp:  //Copy ST(0) to m32fp and pop register stack.
-			case OP_fistp:  //Store ST(0) in m32int and pop register stack. 
-				if (direction == FORWARD_ANALYSIS){
-					update_fp_reg(cinstr, disasm, line);
-					update_tos(FP_POP, disasm, line, direction);
-				}
-				else if (direction == BACKWARD_ANALYSIS){
-					update_tos(FP_POP, disasm, line, direction);
-					update_fp_reg(cinstr, disasm, line);
-				}
+		for (int j = 0; j < end_pcs.size(); j++){
+			if (cinstr->pc == end_pcs[j]){
+				check_fp_stack(tos, cinstr->pc, "end");
 				break;
-			case OP_fmul: //Multiply ST(0) by m32fp and store result in ST(0).
-			case OP_fmulp:  //Multiply ST(i) by ST(0), store result in ST(i), and pop the register stack.
-				if (cinstr->opcode == OP_fmulp && direction == BACKWARD_ANALYSIS){
-					update_tos(FP_POP, disasm, line, direction);
-				}
-				update_fp_reg(cinstr, disasm, line);
-				if (cinstr->opcode == OP_fmulp && direction == FORWARD_ANALYSIS){
-					update_tos(FP_POP, disasm, line, direction);
-				}
-				break;
-			case OP_fxch:
-				update_fp_reg(cinstr, disasm, line);
-			case OP_faddp:  //Add ST(0) to ST(i), store result in ST(i), and pop the register stack
-			case OP_fadd:   //Add m32fp to ST(0) and store result in ST(0).
-			case OP_fsubp:  //Subtract ST(0) from ST(1), store result in ST(1), and pop register stack.
-			case OP_fsub:   //Subtract m32fp from ST(0) and store result in ST(0).
-			case OP_fdivp:  //Divide ST(1) by ST(0), store result in ST(1), and pop the register stack.
-			case OP_fdiv:   //Divide ST(0) by m32fp and store result in ST(0).
-				if (((cinstr->opcode == OP_faddp) || (cinstr->opcode == OP_fsubp) || (cinstr->opcode == OP_fdivp)) && (direction == BACKWARD_ANALYSIS)){
-					update_tos(FP_POP, disasm, line, direction);
-				}
-				update_fp_reg(cinstr, disasm, line);
-				if (((cinstr->opcode == OP_faddp) || (cinstr->opcode == OP_fsubp) || (cinstr->opcode == OP_fdivp)) && (direction == FORWARD_ANALYSIS)){
-					update_tos(FP_POP, disasm, line, direction);
-				}
-				break;
-			case OP_fcomp:
-				update_tos(FP_POP, disasm, line, direction);
-				break;
-			default:
-				unhandled = true;
 			}
-			ASSERT_MSG((!unhandled), ("ERROR: opcode %s(%d) with %d dests and %d srcs (app_pc - %d) not handled in canonicalization\n", dr_operation_to_string(cinstr->opcode).c_str(), cinstr->opcode,
-				cinstr->num_dsts, cinstr->num_srcs, cinstr->pc));
 		}
 
 	}
 
-
 }
 
 /*******************************  generic x86 analysis functions *****************************************************/
@@ -1456,102 +706,7 @@ Return
 */
 bool is_instr_handled(uint32_t opcode){
 
-	switch (opcode){
-	case OP_movaps:
-	case OP_xorps:
-	case OP_movss:
-	case OP_pmuldq:
-	case OP_push_imm:
-	case OP_push:
-	case OP_pop:
-	case OP_mov_st:
-	case OP_mov_ld:
-	case OP_mov_imm:
-	case OP_movzx:
-	case OP_movsx:
-	case OP_movq:
-	case OP_movd:
-	case OP_movapd:
-	case OP_movdqa:
-	case OP_cvttsd2si:
-	case OP_imul:
-	case OP_mul:
-	case OP_idiv:
-	case OP_cdq:
-	case OP_xchg:
-	case OP_xor:
-	case OP_sub:
-	case OP_pxor:
-	case OP_psubd:
-	case OP_add:
-	case OP_and:
-	case OP_or:
-	case OP_andpd:
-	case OP_neg:
-	case OP_dec:
-	case OP_inc:
-	case OP_sar:
-	case OP_shr:
-	case OP_shl:
-	case OP_psllq:
-	case OP_psrlq:
-	case OP_not:
-	case OP_lea:
-	case OP_sbb:
-	case OP_setz:
-	case OP_sets:
-	case OP_setns:
-	case OP_setb:
-	case OP_cmp:
-	case OP_test:
-	case OP_jmp:
-	case OP_jmp_short:
-	case OP_jnl:
-	case OP_jnl_short:
-	case OP_jl:
-	case OP_jnle:
-	case OP_jnle_short:
-	case OP_jnz:
-	case OP_jnz_short:
-	case OP_jz:
-	case OP_jnb_short:
-	case OP_jb_short:
-	case OP_jz_short:
-	case OP_jl_short:
-	case OP_jns_short:
-	case OP_js_short:
-	case OP_jnbe_short:
-	case OP_jle_short:
-	case OP_jle:
-	case OP_jbe_short:
-	case OP_jns:
-	case OP_jb:
-	case OP_jnb:
-	case OP_js:
-	case OP_jmp_ind:
-	case OP_call:
-	case OP_ret:
-	case OP_call_ind:
-	case OP_enter:
-	case OP_leave:
-	case OP_fldcw:
-	case OP_fnstcw:
-	case OP_stmxcsr:
-	case OP_nop:
-	case OP_adc:
-	case OP_cwde:
-
-	case OP_cmovle:
-	case OP_cmovnle:
-	case OP_cmovl:
-	case OP_cmovnl:
-	case OP_cmovz:
-	case OP_cmovnz:
-
-		return true;
-	default:
-		return false;
-	}
+	return get_opcode_semantics(opcode) != NULL;
 
 }
 
@@ -1567,62 +722,8 @@ Return
 */
 uint32_t is_eflags_affected(uint32_t opcode){
 
-	uint32_t flags = 0;
-	
-	switch (opcode){
-	case OP_imul:
-	case OP_mul:
-		//CF and OF
-		SET_FLAG(flags, Carry_Flag);
-		SET_FLAG(flags, Overflow_Flag); break;
-
-
-    // all 6 flags
-	case OP_sub:
-	case OP_add:
-	case OP_neg:
-	case OP_sbb:
-	case OP_cmp:
-		//Op_cmp - CF, OF, SF, ZF, AF, and PF
-		//Op_neg - CF 0 if opnd 0, OF, SF, ZF, AF, and PF
-		//OF, SF, ZF, AF, CF, and PF
-		SET_FLAG(flags, Overflow_Flag);
-		SET_FLAG(flags, Sign_Flag);
-		SET_FLAG(flags, Zero_Flag);
-		SET_FLAG(flags, Carry_Flag);
-		SET_FLAG(flags, Parity_Flag);
-		SET_FLAG(flags, Auxiliary_Carry_Flag); break;
-	
-	// without AF
-	case OP_test:
-		//OF and CF flags are set to 0. The SF, ZF, and PF 
-	case OP_sar:
-	case OP_shr:
-	case OP_shl:
-		//OF, CF, SF, ZF, and PF (AF is generally undefined) - there are conditions for OF, CF as well but we will disregard them for now
-	case OP_xor:
-	case OP_and:
-	case OP_or:
-		//OF,CF cleared, SF, ZF, PF
-		SET_FLAG(flags, Overflow_Flag);
-		SET_FLAG(flags, Sign_Flag);
-		SET_FLAG(flags, Zero_Flag);
-		SET_FLAG(flags, Carry_Flag);
-		SET_FLAG(flags, Parity_Flag); break;
-	
-	// without CF
-	case OP_dec:
-	case OP_inc:
-		//OF, SF, ZF, AF, and PF
-		SET_FLAG(flags, Overflow_Flag);
-		SET_FLAG(flags, Sign_Flag);
-		SET_FLAG(flags, Zero_Flag);
-		SET_FLAG(flags, Parity_Flag);
-		SET_FLAG(flags, Auxiliary_Carry_Flag); break;
-	
-	}
-
-	return flags;
+	const rsem_t * sem = get_opcode_semantics(opcode);
+	return (sem != NULL) ? sem->eflags : 0;
 
 }
 
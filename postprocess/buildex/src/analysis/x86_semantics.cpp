@@ -0,0 +1,398 @@
+#include "analysis/x86_semantics.h"
+#include "analysis/x86_analysis.h"
+#include "utility/defines.h"
+
+/* template operands */
+#define NO				{ RO_NONE, 0, 0, 0, 0 }
+#define D(i)			{ RO_DST, i, 0, 0, 0 }
+#define S(i)			{ RO_SRC, i, 0, 0, 0 }
+#define D_PART(i,w,o)	{ RO_DST, i, w, o, 0 }
+#define S_PART(i,w,o)	{ RO_SRC, i, w, o, 0 }
+#define V(i,scale)		{ RO_VIRTUAL, i, 0, 0, scale }
+#define IMM(i,v)		{ RO_IMM, i, 0, 0, v }
+#define IMM_W(w,v)		{ RO_IMM, 0, w, 0, v }
+#define FLAG(i)			{ RO_FLAG, i, 0, 0, 0 }
+
+/* templates */
+#define R1(op,dst,src,sign)			{ op, dst, 1, { src, NO }, sign }
+#define R2(op,dst,src1,src2,sign)	{ op, dst, 2, { src1, src2 }, sign }
+
+/* eflags masks */
+#define EF(flag)		(1u << flag)
+#define EF_ARITH		(EF(Overflow_Flag) | EF(Sign_Flag) | EF(Zero_Flag) | EF(Carry_Flag) | EF(Parity_Flag) | EF(Auxiliary_Carry_Flag))
+#define EF_LOGIC		(EF(Overflow_Flag) | EF(Sign_Flag) | EF(Zero_Flag) | EF(Carry_Flag) | EF(Parity_Flag))
+#define EF_INCDEC		(EF(Overflow_Flag) | EF(Sign_Flag) | EF(Zero_Flag) | EF(Parity_Flag) | EF(Auxiliary_Carry_Flag))
+#define EF_MUL			(EF(Carry_Flag) | EF(Overflow_Flag))
+
+/************************************ shapes ************************************************************************/
+
+/* nothing to reduce */
+static const rsem_shape_t shape_skip = { RSEM_SKIP, 0 };
+
+/* cmp / test - only written to a virtual register when the eflags are of interest */
+static const rsem_shape_t shape_compare = { RSEM_EFLAGS, 1, {
+	{ 0, 2, 0, 1, { R2(RSEM_OP, V(0, 1), S(0), S(1), true) } } } };
+
+/* dst[0] <- src[0]; the two source flavor reads src[1] (mov with a segment) */
+static const rsem_shape_t shape_move = { 0, 2, {
+	{ 1, 1, 0, 1, { R1(op_assign, D(0), S(0), false) } },
+	{ 1, 2, 0, 1, { R1(op_assign, D(0), S(1), false) } } } };
+
+/* dst[0] <- src[0] */
+static const rsem_shape_t shape_copy = { 0, 1, {
+	{ 1, 1, 0, 1, { R1(op_assign, D(0), S(0), false) } } } };
+
+/* low 32 bits of dst <- low 32 bits of src; a load from memory into a register also zeroes its upper 96 bits */
+static const rsem_shape_t shape_movss = { 0, 2, {
+	{ 1, 1, RG_SRC_MEM | RG_DST_REG, 2, { R1(op_assign, D_PART(0, 4, 4), S_PART(0, 4, 4), true),
+							 R1(op_assign, D_PART(0, 12, 16), IMM_W(12, 0), true) } },
+	{ 1, 1, 0, 1, { R1(op_assign, D_PART(0, 4, 4), S_PART(0, 4, 4), true) } } } };
+
+/* low 64 bits of dst <- low 64 bits of src; a load from memory into a register also zeroes its upper 64 bits */
+static const rsem_shape_t shape_movsd = { 0, 2, {
+	{ 1, 1, RG_SRC_MEM | RG_DST_REG, 2, { R1(op_assign, D_PART(0, 8, 8), S_PART(0, 8, 8), true),
+							 R1(op_assign, D_PART(0, 8, 16), IMM_W(8, 0), true) } },
+	{ 1, 1, 0, 1, { R1(op_assign, D_PART(0, 8, 8), S_PART(0, 8, 8), true) } } } };
+
+/* conversions write the low lane of an xmm destination and keep the rest; the vex forms take the rest from src[0]
+   and convert src[1] */
+static const rsem_shape_t shape_cvt_int_ss = { 0, 2, {
+	{ 1, 1, 0, 1, { R1(op_convert, D_PART(0, 4, 4), S(0), true) } },
+	{ 1, 2, 0, 2, { R1(op_assign, D_PART(0, 12, 16), S_PART(0, 12, 16), true),
+					R1(op_convert, D_PART(0, 4, 4), S(1), true) } } } };
+
+static const rsem_shape_t shape_cvt_int_sd = { 0, 2, {
+	{ 1, 1, 0, 1, { R1(op_convert, D_PART(0, 8, 8), S(0), true) } },
+	{ 1, 2, 0, 2, { R1(op_assign, D_PART(0, 8, 16), S_PART(0, 8, 16), true),
+					R1(op_convert, D_PART(0, 8, 8), S(1), true) } } } };
+
+static const rsem_shape_t shape_cvt_ss_int = { 0, 2, {
+	{ 1, 1, 0, 1, { R1(op_convert, D(0), S_PART(0, 4, 4), true) } },
+	{ 1, 2, 0, 1, { R1(op_convert, D(0), S_PART(1, 4, 4), true) } } } };
+
+static const rsem_shape_t shape_cvt_sd_int = { 0, 2, {
+	{ 1, 1, 0, 1, { R1(op_convert, D(0), S_PART(0, 8, 8), true) } },
+	{ 1, 2, 0, 1, { R1(op_convert, D(0), S_PART(1, 8, 8), true) } } } };
+
+static const rsem_shape_t shape_cvt_ss_sd = { 0, 1, {
+	{ 1, 1, 0, 1, { R1(op_convert, D_PART(0, 8, 8), S_PART(0, 4, 4), true) } } } };
+
+static const rsem_shape_t shape_cvt_sd_ss = { 0, 1, {
+	{ 1, 1, 0, 1, { R1(op_convert, D_PART(0, 4, 4), S_PART(0, 8, 8), true) } } } };
+
+/* dst[63:0] <- src0[31:0] * src1[31:0], dst[127:64] <- src0[95:64] * src1[95:64] */
+static const rsem_shape_t shape_pmuldq = { 0, 1, {
+	{ 1, 2, 0, 2, { R2(op_mul, D_PART(0, 8, 8), S_PART(0, 4, 4), S_PART(1, 4, 4), true),
+					R2(op_mul, D_PART(0, 8, 16), S_PART(0, 4, 12), S_PART(1, 4, 12), true) } } } };
+
+/* [esp - 4] (dst[1]) <- src[0] */
+static const rsem_shape_t shape_push = { 0, 1, {
+	{ 2, 2, 0, 1, { R1(op_assign, D(1), S(0), false) } } } };
+
+/* dst[0] <- [esp] (src[1]) */
+static const rsem_shape_t shape_pop = { 0, 1, {
+	{ 2, 2, 0, 1, { R1(op_assign, D(0), S(1), false) } } } };
+
+/* dst[0] <- src[1] (op) src[0] - two operand form, the destination is also src[1] */
+static const rsem_shape_t shape_binary = { 0, 1, {
+	{ 1, 2, 0, 1, { R2(RSEM_OP, D(0), S(1), S(0), false) } } } };
+
+static const rsem_shape_t shape_binary_signed = { 0, 1, {
+	{ 1, 2, 0, 1, { R2(RSEM_OP, D(0), S(1), S(0), true) } } } };
+
+/* as shape_binary; the same location on both sides (xor eax, eax) is a zero */
+static const rsem_shape_t shape_binary_zeroing = { 0, 2, {
+	{ 1, 2, RG_SAME_SRCS, 1, { R1(op_assign, D(0), IMM(0, 0), false) } },
+	{ 1, 2, 0, 1, { R2(RSEM_OP, D(0), S(1), S(0), false) } } } };
+
+/* dst[0] <- src[0] (op) src[1] - three operand (vex) forms and the x87 forms with the memory operand first */
+static const rsem_shape_t shape_ternary = { 0, 1, {
+	{ 1, 2, 0, 1, { R2(RSEM_OP, D(0), S(0), S(1), false) } } } };
+
+static const rsem_shape_t shape_ternary_signed = { 0, 1, {
+	{ 1, 2, 0, 1, { R2(RSEM_OP, D(0), S(0), S(1), true) } } } };
+
+/* dst[0] <- (op) src[0] */
+static const rsem_shape_t shape_unary = { 0, 1, {
+	{ 1, 1, 0, 1, { R1(RSEM_OP, D(0), S(0), false) } } } };
+
+static const rsem_shape_t shape_unary_signed = { 0, 1, {
+	{ 1, 1, 0, 1, { R1(RSEM_OP, D(0), S(0), true) } } } };
+
+/* dst[0] <- src[0] (op) 1 */
+static const rsem_shape_t shape_step = { 0, 1, {
+	{ 1, 1, 0, 1, { R2(RSEM_OP, D(0), S(0), IMM(0, 1), true) } } } };
+
+/* dst[0] <- src[0] * src[1]; edx [dst0] : eax [dst1] <- eax [src1] * [src0] through a double width virtual */
+static const rsem_shape_t shape_imul = { 0, 2, {
+	{ 1, 2, 0, 1, { R2(op_mul, D(0), S(0), S(1), true) } },
+	{ 2, 2, 0, 3, { R2(op_mul, V(1, 2), S(1), S(0), true),
+					R1(op_split_h, D(0), V(1, 2), true),
+					R1(op_split_l, D(1), V(1, 2), true) } } } };
+
+static const rsem_shape_t shape_mul = { 0, 1, {
+	{ 2, 2, 0, 3, { R2(op_mul, V(1, 2), S(1), S(0), false),
+					R1(op_split_h, D(0), V(1, 2), false),
+					R1(op_split_l, D(1), V(1, 2), false) } } } };
+
+/* virtual <- edx:eax; edx <- virtual % src[0]; eax <- virtual / src[0] */
+static const rsem_shape_t shape_idiv = { 0, 1, {
+	{ 2, 3, 0, 3, { R2(op_concat, V(1, 2), S(1), S(2), false),
+					R2(op_mod, D(0), V(1, 2), S(0), true),
+					R2(op_div, D(1), V(1, 2), S(0), true) } } } };
+
+static const rsem_shape_t shape_div = { 0, 1, {
+	{ 2, 3, 0, 3, { R2(op_concat, V(1, 2), S(1), S(2), false),
+					R2(op_mod, D(0), V(1, 2), S(0), false),
+					R2(op_div, D(1), V(1, 2), S(0), false) } } } };
+
+/* virtual <- src[0]; dst[0] <- src[1]; dst[1] <- virtual */
+static const rsem_shape_t shape_exchange = { 0, 1, {
+	{ 2, 2, RG_EXCHANGE, 3, { R1(op_assign, V(0, 1), S(0), false),
+							  R1(op_assign, D(0), S(1), false),
+							  R1(op_assign, D(1), V(0, 1), false) } } } };
+
+/* virtual <- src[0] + src[1]; src[1] <- src[0]; src[0] <- virtual */
+static const rsem_shape_t shape_xadd = { 0, 1, {
+	{ 2, 2, 0, 3, { R2(op_add, V(0, 1), S(0), S(1), true),
+					R1(op_assign, S(1), S(0), true),
+					R1(op_assign, S(0), V(0, 1), true) } } } };
+
+/* [base, index, scale, disp]: dst <- base + disp, or virtual <- scale * index; virtual <- virtual + base; dst <- virtual + disp */
+static const rsem_shape_t shape_lea = { RSEM_ADDRESS, 2, {
+	{ 1, 4, RG_NO_SCALE, 1, { R2(op_add, D(0), S(0), S(3), true) } },
+	{ 1, 4, 0, 3, { R2(op_mul, V(0, 1), S(2), S(1), true),
+					R2(op_add, V(0, 1), V(0, 1), S(0), true),
+					R2(op_add, D(0), V(0, 1), S(3), true) } } } };
+
+/* dst[0] <- src[1] - src[0], less 1 with the carry */
+static const rsem_shape_t shape_sbb = { 0, 4, {
+	{ 1, 2, RG_SAME_SRCS | RG_CARRY, 2, { R1(op_assign, D(0), IMM(1, 0), true),
+										  R2(op_sub, D(0), D(0), IMM(1, 1), true) } },
+	{ 1, 2, RG_SAME_SRCS, 1, { R1(op_assign, D(0), IMM(1, 0), true) } },
+	{ 1, 2, RG_CARRY, 2, { R2(op_sub, D(0), S(1), S(0), true),
+						   R2(op_sub, D(0), D(0), IMM(1, 1), true) } },
+	{ 1, 2, 0, 1, { R2(op_sub, D(0), S(1), S(0), true) } } } };
+
+/* dst[0] <- src[1] + src[0], plus 1 with the carry */
+static const rsem_shape_t shape_adc = { 0, 2, {
+	{ 1, 2, RG_CARRY, 2, { R2(op_add, D(0), S(1), S(0), true),
+						   R2(op_add, D(0), D(0), IMM(1, 1), true) } },
+	{ 1, 2, 0, 1, { R2(op_add, D(0), S(1), S(0), true) } } } };
+
+/* dst[0] <- src[0] if the condition holds, else nothing is written */
+static const rsem_shape_t shape_cmov = { 0, 2, {
+	{ 1, 2, RG_COND, 1, { R1(op_assign, D(0), S(0), true) } },
+	{ 1, 2, 0, 0 } } };
+
+/* dst[0] <- condition ? 1 : 0 */
+static const rsem_shape_t shape_set = { 0, 1, {
+	{ 1, 0, 0, 1, { R1(op_assign, D(0), FLAG(0), true) } } } };
+
+/************************************ opcodes ***********************************************************************/
+
+#define SKIP(opcode)	{ opcode, &shape_skip, op_unknown, RC_NONE, 0, 0 }
+
+static const rsem_t semantics[] = {
+
+	/* vector and scalar sse / avx */
+	{ OP_movss, &shape_movss, op_assign, RC_NONE, 0, 0 },
+	{ OP_pmuldq, &shape_pmuldq, op_mul, RC_NONE, 0, 0 },
+	{ OP_movq, &shape_move, op_assign, RC_NONE, 0, 0 },
+	{ OP_movd, &shape_move, op_assign, RC_NONE, 0, 0 },
+	{ OP_movapd, &shape_move, op_assign, RC_NONE, 0, 0 },
+	{ OP_movaps, &shape_move, op_assign, RC_NONE, 0, 0 },
+	{ OP_movdqa, &shape_move, op_assign, RC_NONE, 0, 0 },
+	{ OP_movdqu, &shape_move, op_assign, RC_NONE, 0, 0 },
+	{ OP_movups, &shape_move, op_assign, RC_NONE, 0, 0 },
+	{ OP_movupd, &shape_move, op_assign, RC_NONE, 0, 0 },
+	{ OP_movsd, &shape_movsd, op_assign, RC_NONE, 0, 0 },
+	{ OP_vmovss, &shape_move, op_assign, RC_NONE, 0, 0 },
+	{ OP_vmovsd, &shape_move, op_assign, RC_NONE, 0, 0 },
+	{ OP_cvtsi2ss, &shape_cvt_int_ss, op_convert, RC_NONE, 0, 0 },
+	{ OP_cvtsi2sd, &shape_cvt_int_sd, op_convert, RC_NONE, 0, 0 },
+	{ OP_cvttss2si, &shape_cvt_ss_int, op_convert, RC_NONE, 0, 0 },
+	{ OP_cvttsd2si, &shape_cvt_sd_int, op_convert, RC_NONE, 0, RSEM_FLOATING },
+	{ OP_cvtss2sd, &shape_cvt_ss_sd, op_convert, RC_NONE, 0, 0 },
+	{ OP_cvtsd2ss, &shape_cvt_sd_ss, op_convert, RC_NONE, 0, RSEM_FLOATING },
+	{ OP_vcvtsi2ss, &shape_cvt_int_ss, op_convert, RC_NONE, 0, 0 },
+	{ OP_vcvtsi2sd, &shape_cvt_int_sd, op_convert, RC_NONE, 0, 0 },
+	{ OP_vcvttss2si, &shape_cvt_ss_int, op_convert, RC_NONE, 0, 0 },
+	{ OP_vcvttsd2si, &shape_cvt_sd_int, op_convert, RC_NONE, 0, RSEM_FLOATING },
+	{ OP_xorps, &shape_binary_zeroing, op_xor, RC_NONE, 0, 0 },
+	{ OP_pxor, &shape_binary_zeroing, op_xor, RC_NONE, 0, 0 },
+	{ OP_psubd, &shape_binary_zeroing, op_sub, RC_NONE, 0, 0 },
+	{ OP_psubq, &shape_binary_zeroing, op_sub, RC_NONE, 0, 0 },
+	{ OP_paddd, &shape_binary, op_add, RC_NONE, 0, 0 },
+	{ OP_paddq, &shape_binary, op_add, RC_NONE, 0, 0 },
+	{ OP_pand, &shape_binary, op_and, RC_NONE, 0, 0 },
+	{ OP_por, &shape_binary, op_or, RC_NONE, 0, 0 },
+	{ OP_andps, &shape_binary, op_and, RC_NONE, 0, 0 },
+	{ OP_andpd, &shape_binary, op_and, RC_NONE, 0, 0 },
+	{ OP_orps, &shape_binary, op_or, RC_NONE, 0, 0 },
+	{ OP_psrlq, &shape_binary, op_rsh, RC_NONE, 0, 0 },
+	{ OP_psllq, &shape_binary, op_lsh, RC_NONE, 0, 0 },
+	{ OP_addss, &shape_binary, op_add, RC_NONE, 0, 0 },
+	{ OP_subss, &shape_binary, op_sub, RC_NONE, 0, 0 },
+	{ OP_mulss, &shape_binary, op_mul, RC_NONE, 0, 0 },
+	{ OP_divss, &shape_binary, op_div, RC_NONE, 0, 0 },
+	{ OP_addsd, &shape_binary, op_add, RC_NONE, 0, RSEM_FLOATING },
+	{ OP_subsd, &shape_binary, op_sub, RC_NONE, 0, RSEM_FLOATING },
+	{ OP_mulsd, &shape_binary, op_mul, RC_NONE, 0, RSEM_FLOATING },
+	{ OP_divsd, &shape_binary, op_div, RC_NONE, 0, RSEM_FLOATING },
+	{ OP_vaddss, &shape_ternary, op_add, RC_NONE, 0, 0 },
+	{ OP_vsubss, &shape_ternary, op_sub, RC_NONE, 0, 0 },
+	{ OP_vmulss, &shape_ternary, op_mul, RC_NONE, 0, 0 },
+	{ OP_vdivss, &shape_ternary, op_div, RC_NONE, 0, 0 },
+	{ OP_vaddsd, &shape_ternary, op_add, RC_NONE, 0, RSEM_FLOATING },
+	{ OP_vsubsd, &shape_ternary, op_sub, RC_NONE, 0, RSEM_FLOATING },
+	{ OP_vmulsd, &shape_ternary, op_mul, RC_NONE, 0, RSEM_FLOATING },
+	{ OP_vdivsd, &shape_ternary, op_div, RC_NONE, 0, RSEM_FLOATING },
+
+	/* integer */
+	{ OP_push_imm, &shape_push, op_assign, RC_NONE, 0, 0 },
+	{ OP_push, &shape_push, op_assign, RC_NONE, 0, 0 },
+	{ OP_pop, &shape_pop, op_assign, RC_NONE, 0, 0 },
+	{ OP_mov_st, &shape_move, op_assign, RC_NONE, 0, 0 },
+	{ OP_mov_ld, &shape_move, op_assign, RC_NONE, 0, 0 },
+	{ OP_mov_imm, &shape_move, op_assign, RC_NONE, 0, 0 },
+	{ OP_mov_seg, &shape_move, op_assign, RC_NONE, 0, 0 },
+	{ OP_movzx, &shape_move, op_assign, RC_NONE, 0, 0 },
+	{ OP_movsx, &shape_move, op_assign, RC_NONE, 0, 0 },
+	{ OP_imul, &shape_imul, op_mul, RC_NONE, EF_MUL, 0 },
+	{ OP_mul, &shape_mul, op_mul, RC_NONE, EF_MUL, 0 },
+	{ OP_idiv, &shape_idiv, op_div, RC_NONE, 0, 0 },
+	{ OP_div, &shape_div, op_div, RC_NONE, 0, 0 },
+	{ OP_cdq, &shape_unary_signed, op_signex, RC_NONE, 0, 0 },
+	{ OP_cwde, &shape_unary_signed, op_signex, RC_NONE, 0, 0 },
+	{ OP_xchg, &shape_exchange, op_assign, RC_NONE, 0, 0 },
+	{ OP_xadd, &shape_xadd, op_add, RC_NONE, 0, 0 },
+	{ OP_xor, &shape_binary_zeroing, op_xor, RC_NONE, EF_LOGIC, 0 },
+	{ OP_sub, &shape_binary_zeroing, op_sub, RC_NONE, EF_ARITH, 0 },
+	{ OP_add, &shape_binary, op_add, RC_NONE, EF_ARITH, 0 },
+	{ OP_and, &shape_binary, op_and, RC_NONE, EF_LOGIC, 0 },
+	{ OP_or, &shape_binary, op_or, RC_NONE, EF_LOGIC, 0 },
+	{ OP_sar, &shape_binary_signed, op_rsh, RC_NONE, EF_LOGIC, 0 },
+	{ OP_shr, &shape_binary, op_rsh, RC_NONE, EF_LOGIC, 0 },
+	{ OP_shl, &shape_binary, op_lsh, RC_NONE, EF_LOGIC, 0 },
+	{ OP_neg, &shape_unary, op_sub, RC_NONE, EF_ARITH, 0 },
+	{ OP_not, &shape_unary, op_not, RC_NONE, 0, 0 },
+	{ OP_dec, &shape_step, op_sub, RC_NONE, EF_INCDEC, 0 },
+	{ OP_inc, &shape_step, op_add, RC_NONE, EF_INCDEC, 0 },
+	{ OP_lea, &shape_lea, op_add, RC_NONE, 0, 0 },
+	{ OP_sbb, &shape_sbb, op_sub, RC_NONE, EF_ARITH, 0 },
+	{ OP_adc, &shape_adc, op_add, RC_NONE, 0, 0 },
+	{ OP_cmovl, &shape_cmov, op_assign, RC_L, 0, 0 },
+	{ OP_cmovle, &shape_cmov, op_assign, RC_LE, 0, 0 },
+	{ OP_cmovnle, &shape_cmov, op_assign, RC_NLE, 0, 0 },
+	{ OP_cmovnl, &shape_cmov, op_assign, RC_NL, 0, 0 },
+	{ OP_cmovz, &shape_cmov, op_assign, RC_Z, 0, 0 },
+	{ OP_cmovnz, &shape_cmov, op_assign, RC_NZ, 0, 0 },
+	{ OP_cmovns, &shape_cmov, op_assign, RC_NS, 0, 0 },
+	{ OP_setz, &shape_set, op_assign, RC_Z, 0, 0 },
+	{ OP_setnz, &shape_set, op_assign, RC_NZ, 0, 0 },
+	{ OP_sets, &shape_set, op_assign, RC_S, 0, 0 },
+	{ OP_setns, &shape_set, op_assign, RC_NS, 0, 0 },
+	{ OP_setb, &shape_set, op_assign, RC_B, 0, 0 },
+
+	/* x87 - the stack registers are renamed to stack slots before reduction (update_floating_point_regs) */
+	{ OP_fld, &shape_copy, op_assign, RC_NONE, 0, RSEM_FLOATING | RSEM_FP_PUSH },
+	{ OP_fld1, &shape_copy, op_assign, RC_NONE, 0, RSEM_FLOATING | RSEM_FP_PUSH },
+	{ OP_fild, &shape_copy, op_assign, RC_NONE, 0, RSEM_FLOATING | RSEM_FP_PUSH },
+	{ OP_fldz, &shape_copy, op_assign, RC_NONE, 0, RSEM_FLOATING | RSEM_FP_PUSH },
+	{ OP_fst, &shape_copy, op_assign, RC_NONE, 0, RSEM_FLOATING },
+	{ OP_fstp, &shape_copy, op_assign, RC_NONE, 0, RSEM_FLOATING | RSEM_FP_POP },
+	{ OP_fistp, &shape_copy, op_assign, RC_NONE, 0, RSEM_FLOATING | RSEM_FP_POP },
+	{ OP_fmul, &shape_ternary_signed, op_mul, RC_NONE, 0, RSEM_FLOATING },
+	{ OP_fmulp, &shape_ternary_signed, op_mul, RC_NONE, 0, RSEM_FLOATING | RSEM_FP_POP },
+	{ OP_fimul, &shape_ternary_signed, op_mul, RC_NONE, 0, RSEM_FLOATING },
+	{ OP_fxch, &shape_exchange, op_assign, RC_NONE, 0, RSEM_FLOATING },
+	{ OP_fadd, &shape_binary, op_add, RC_NONE, 0, RSEM_FLOATING },
+	{ OP_faddp, &shape_binary, op_add, RC_NONE, 0, RSEM_FLOATING | RSEM_FP_POP },
+	{ OP_fiadd, &shape_binary, op_add, RC_NONE, 0, RSEM_FLOATING },
+	{ OP_fsub, &shape_binary, op_sub, RC_NONE, 0, RSEM_FLOATING },
+	{ OP_fsubp, &shape_binary, op_sub, RC_NONE, 0, RSEM_FLOATING | RSEM_FP_POP },
+	{ OP_fisub, &shape_binary, op_sub, RC_NONE, 0, RSEM_FLOATING },
+	{ OP_fdiv, &shape_binary, op_div, RC_NONE, 0, RSEM_FLOATING },
+	{ OP_fdivp, &shape_binary, op_div, RC_NONE, 0, RSEM_FLOATING | RSEM_FP_POP },
+	{ OP_fidiv, &shape_binary, op_div, RC_NONE, 0, RSEM_FLOATING },
+	{ OP_fsubr, &shape_ternary, op_sub, RC_NONE, 0, RSEM_FLOATING },
+	{ OP_fdivr, &shape_ternary, op_div, RC_NONE, 0, RSEM_FLOATING },
+	{ OP_fchs, &shape_unary, op_sub, RC_NONE, 0, RSEM_FLOATING },
+
+	/* compares - only reduced for the eflags */
+	{ OP_cmp, &shape_compare, op_sub, RC_NONE, EF_ARITH, 0 },
+	{ OP_test, &shape_compare, op_and, RC_NONE, EF_LOGIC, 0 },
+
+	/* control flow, stack frames, control words and the instructions not modelled yet */
+	SKIP(OP_btr),
+	SKIP(OP_cmpxchg),
+	SKIP(OP_rep_stos),
+	SKIP(OP_cld),
+	SKIP(OP_fcom),
+	{ OP_fcomp, &shape_skip, op_unknown, RC_NONE, 0, RSEM_FP_POP },
+	SKIP(OP_jmp),
+	SKIP(OP_jmp_short),
+	SKIP(OP_jmp_ind),
+	SKIP(OP_jnl),
+	SKIP(OP_jnl_short),
+	SKIP(OP_jl),
+	SKIP(OP_jl_short),
+	SKIP(OP_jnle),
+	SKIP(OP_jnle_short),
+	SKIP(OP_jle),
+	SKIP(OP_jle_short),
+	SKIP(OP_jnz),
+	SKIP(OP_jnz_short),
+	SKIP(OP_jz),
+	SKIP(OP_jz_short),
+	SKIP(OP_jb),
+	SKIP(OP_jb_short),
+	SKIP(OP_jnb),
+	SKIP(OP_jnb_short),
+	SKIP(OP_jbe),
+	SKIP(OP_jbe_short),
+	SKIP(OP_jnbe),
+	SKIP(OP_jnbe_short),
+	SKIP(OP_js),
+	SKIP(OP_js_short),
+	SKIP(OP_jns),
+	SKIP(OP_jns_short),
+	SKIP(OP_call),
+	SKIP(OP_call_ind),
+	SKIP(OP_ret),
+	SKIP(OP_enter),		/* these change esp and ebp; disregarded for now */
+	SKIP(OP_leave),
+	SKIP(OP_fldcw),
+	SKIP(OP_fnstcw),
+	SKIP(OP_fnstsw),
+	SKIP(OP_stmxcsr),
+	SKIP(OP_fwait),
+	SKIP(OP_nop_modrm),
+	SKIP(OP_nop)
+
+};
+
+typedef struct _rsem_index_t {
+	const rsem_t * entries[OP_AFTER_LAST];
+} rsem_index_t;
+
+static rsem_index_t * build_semantics_index(){
+
+	rsem_index_t * index = new rsem_index_t();
+	for (int i = 0; i < sizeof(semantics) / sizeof(semantics[0]); i++){
+		uint32_t opcode = semantics[i].opcode;
+		ASSERT_MSG((opcode < OP_AFTER_LAST && index->entries[opcode] == NULL), ("ERROR: opcode %d has more than one semantics entry\n", opcode));
+		index->entries[opcode] = &semantics[i];
+	}
+	return index;
+
+}
+
+const rsem_t * get_opcode_semantics(uint32_t opcode){
+
+	static const rsem_index_t * index = build_semantics_index();
+	if (opcode >= OP_AFTER_LAST) return NULL;
+	return index->entries[opcode];
+
+}
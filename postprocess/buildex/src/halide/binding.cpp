@@ -0,0 +1,297 @@
+#include <map>
+#include <algorithm>
+#include <string>
+
+#include "halide/binding.h"
+#include "trees/nodes.h"
+#include "utility/defines.h"
+#include "common_defines.h"
+
+using namespace std;
+
+/* register names the client understands (pointer sized DR registers) */
+static const char * get_binding_reg_name(int reg){
+
+	switch (reg){
+	case DR_REG_RAX: return "xax";
+	case DR_REG_RBX: return "xbx";
+	case DR_REG_RCX: return "xcx";
+	case DR_REG_RDX: return "xdx";
+	case DR_REG_RSI: return "xsi";
+	case DR_REG_RDI: return "xdi";
+	case DR_REG_RBP: return "xbp";
+	default: return NULL;
+	}
+
+}
+
+/* the trace is in mem range form by now (update_regs_to_mem_range); 0 is no register */
+static int get_binding_reg(operand_t * opnd){
+
+	if (opnd->type != REG_TYPE || opnd->value == 0) return 0;
+	return mem_range_to_reg(opnd);
+
+}
+
+static bool is_mem_operand(operand_t * opnd){
+	return opnd->type == MEM_STACK_TYPE || opnd->type == MEM_HEAP_TYPE;
+}
+
+/* binds the region accessed by the memory operand to where its base register came from */
+static void bind_access(operand_t * opnd, vector<buffer_binding_t> &bindings, map<int, uint32_t> &arg_regs, vector<int> &written_regs){
+
+	if (!is_mem_operand(opnd) || opnd->addr == NULL) return;
+
+	int base = get_binding_reg(&opnd->addr[0]);
+	if (base == 0 || base == DR_REG_RSP) return;
+
+	for (int i = 0; i < bindings.size(); i++){
+		mem_regions_t * region = bindings[i].region;
+		if (bindings[i].location != BINDING_NONE) continue;
+		if (opnd->value < region->start || opnd->value > region->end) continue;
+
+		if (arg_regs.find(base) != arg_regs.end()){
+			bindings[i].location = BINDING_ARG;
+			bindings[i].index = arg_regs[base];
+		}
+		else if (find(written_regs.begin(), written_regs.end(), base) == written_regs.end() && get_binding_reg_name(base) != NULL){
+			bindings[i].location = BINDING_REG;
+			bindings[i].index = base;
+		}
+	}
+
+}
+
+/* argument slot (0 based) if the operand reads an argument of the function entered with the given stack pointer */
+static int32_t get_arg_slot(operand_t * opnd, uint64_t entry_sp, uint32_t slot_width){
+
+	if (opnd->type != MEM_STACK_TYPE || entry_sp == 0) return -1;
+	if (opnd->value <= entry_sp || opnd->width != slot_width) return -1;
+	if ((opnd->value - entry_sp) % slot_width != 0) return -1;
+	return (opnd->value - entry_sp) / slot_width - 1;
+
+}
+
+/* slot whose pointer the destination register holds after the instruction, -1 if it is not an argument pointer */
+static int32_t get_dst_slot(cinstr_t * instr, int dst_reg, map<int, uint32_t> &arg_regs, uint64_t entry_sp, uint32_t slot_width){
+
+	if ((instr->opcode == OP_mov_ld || instr->opcode == OP_mov_st) && instr->num_srcs >= 1){
+		operand_t * src = &instr->srcs[0];
+		int32_t slot = get_arg_slot(src, entry_sp, slot_width);
+		if (slot >= 0) return slot;
+		int src_reg = get_binding_reg(src);
+		if (src_reg != 0 && arg_regs.find(src_reg) != arg_regs.end()) return arg_regs[src_reg];
+	}
+	else if (instr->opcode == OP_lea && instr->num_srcs >= 1){
+		/* lea srcs are base, index, scale, disp; the result still points into the same buffer */
+		int base = get_binding_reg(&instr->srcs[0]);
+		if (base != 0 && arg_regs.find(base) != arg_regs.end()) return arg_regs[base];
+	}
+	else if (instr->opcode == OP_add || instr->opcode == OP_sub){
+		/* pointer bumps by a constant */
+		bool self = false;
+		bool imm = false;
+		for (int i = 0; i < instr->num_srcs; i++){
+			if (get_binding_reg(&instr->srcs[i]) == dst_reg) self = true;
+			else if (instr->srcs[i].type == IMM_INT_TYPE) imm = true;
+		}
+		if (self && imm && arg_regs.find(dst_reg) != arg_regs.end()) return arg_regs[dst_reg];
+	}
+
+	return -1;
+
+}
+
+/* the stack pointer at entry is the address the call stored the return address to (0 if the call was not traced) */
+static void get_entry_stack_pointer(vec_cinstr &unfiltered_instrs, vec_cinstr &instrs, uint64_t * entry_sp, uint32_t * slot_width){
+
+	*entry_sp = 0;
+	*slot_width = 4;
+	for (int i = 1; i < unfiltered_instrs.size(); i++){
+		if (unfiltered_instrs[i].first != instrs[0].first) continue;
+		cinstr_t * call = unfiltered_instrs[i - 1].first;
+		if (call->opcode == OP_call || call->opcode == OP_call_ind){
+			for (int j = 0; j < call->num_dsts; j++){
+				if (call->dsts[j].type == MEM_STACK_TYPE){
+					*entry_sp = call->dsts[j].value;
+					*slot_width = call->dsts[j].width;
+				}
+			}
+		}
+		break;
+	}
+
+}
+
+/*
+walks the first invocation of the function in the (filtered) trace. argument k is read from entry_sp + (k + 1) * slot
+width. a register keeps the argument it was loaded from through moves, lea and constant add/sub; the first access into
+a buffer decides its binding. ret_pop is the immediate of the function's own ret (callee cleaned arguments)
+*/
+vector<buffer_binding_t> find_buffer_bindings(vec_cinstr &unfiltered_instrs, vec_cinstr &instrs,
+	vector<mem_regions_t *> regions, uint32_t * ret_pop){
+
+	vector<buffer_binding_t> bindings;
+	for (int i = 0; i < regions.size(); i++){
+		buffer_binding_t binding;
+		binding.region = regions[i];
+		binding.location = BINDING_NONE;
+		binding.index = 0;
+		bindings.push_back(binding);
+	}
+
+	*ret_pop = 0;
+	if (instrs.size() == 0) return bindings;
+
+	uint64_t entry_sp;
+	uint32_t slot_width;
+	get_entry_stack_pointer(unfiltered_instrs, instrs, &entry_sp, &slot_width);
+
+	if (entry_sp == 0){
+		DEBUG_PRINT(("binding: the call into the function is not in the trace; only register bindings are found\n"), 2);
+	}
+
+	map<int, uint32_t> arg_regs;
+	vector<int> written_regs;
+	int32_t depth = 0;
+
+	for (int i = 0; i < instrs.size(); i++){
+
+		cinstr_t * instr = instrs[i].first;
+
+		for (int j = 0; j < instr->num_srcs; j++){
+			bind_access(&instr->srcs[j], bindings, arg_regs, written_regs);
+		}
+		for (int j = 0; j < instr->num_dsts; j++){
+			bind_access(&instr->dsts[j], bindings, arg_regs, written_regs);
+		}
+
+		/* only the function's own body tracks registers; callees are assumed to preserve them */
+		if (depth == 0){
+			for (int j = 0; j < instr->num_dsts; j++){
+				int reg = get_binding_reg(&instr->dsts[j]);
+				if (reg == 0 || reg == DR_REG_RSP) continue;
+
+				int32_t slot = get_dst_slot(instr, reg, arg_regs, entry_sp, slot_width);
+				arg_regs.erase(reg);
+				if (slot >= 0) arg_regs[reg] = slot;
+				if (find(written_regs.begin(), written_regs.end(), reg) == written_regs.end()){
+					written_regs.push_back(reg);
+				}
+			}
+		}
+
+		if (instr->opcode == OP_call || instr->opcode == OP_call_ind){
+			depth++;
+		}
+		else if (instr->opcode == OP_ret){
+			if (depth == 0){
+				for (int j = 0; j < instr->num_srcs; j++){
+					if (instr->srcs[j].type == IMM_INT_TYPE) *ret_pop = instr->srcs[j].value;
+				}
+				break;
+			}
+			depth--;
+		}
+	}
+
+	for (int i = 0; i < bindings.size(); i++){
+		if (bindings[i].location == BINDING_NONE){
+			DEBUG_PRINT(("binding: could not find where %s comes from\n", bindings[i].region->name.c_str()), 1);
+		}
+	}
+
+	return bindings;
+
+}
+
+static void print_buffer_binding(ostream &out, buffer_binding_t * binding){
+
+	mem_regions_t * region = binding->region;
+	uint32_t elem_size = (region->bytes_per_pixel > 0) ? region->bytes_per_pixel : 1;
+
+	out << "buffer " << region->name << " ";
+	switch (binding->location){
+	case BINDING_ARG: out << "arg " << binding->index; break;
+	case BINDING_REG: out << "reg " << get_binding_reg_name(binding->index); break;
+	default: out << "none 0"; break;
+	}
+	out << " 0 " << elem_size << " " << region->dimensions;
+	for (int i = 0; i < region->dimensions; i++){
+		out << " " << region->min[i] << " " << region->extents[i] << " " << region->strides[i] / elem_size;
+	}
+	out << endl;
+
+}
+
+/* scalar Params are the non buffer locations the trees read - an argument slot or a register at entry */
+static void print_param_binding(ostream &out, Abs_Node * param, uint64_t entry_sp, uint32_t slot_width){
+
+	int32_t slot = get_arg_slot(param->symbol, entry_sp, slot_width);
+	const char * reg = get_binding_reg_name(get_binding_reg(param->symbol));
+
+	out << "param ";
+	if (param->is_double) out << "none 0"; /* passed in x87/sse registers; not supported by the client */
+	else if (slot >= 0) out << "arg " << slot;
+	else if (reg != NULL) out << "reg " << reg;
+	else out << "none 0";
+	out << " " << param->symbol->width << endl;
+
+}
+
+static buffer_binding_t * get_binding(vector<buffer_binding_t> &bindings, mem_regions_t * region){
+	for (int i = 0; i < bindings.size(); i++){
+		if (bindings[i].region == region) return &bindings[i];
+	}
+	return NULL;
+}
+
+/* pipelines take the Params, then the ImageParams and then the output buffer - the order print_halide_program uses */
+void print_binding_manifest(ostream &out, Halide_Program * halide, vec_cinstr &unfiltered_instrs,
+	vec_cinstr &instrs, string library){
+
+	DEBUG_PRINT(("printing the binding manifest....\n"), 1);
+
+	if (instrs.size() == 0) return;
+
+	vector<mem_regions_t *> regions;
+	for (int i = 0; i < halide->inputs.size(); i++){
+		mem_regions_t * region = halide->inputs[i]->mem_info.associated_mem;
+		if (find(regions.begin(), regions.end(), region) == regions.end()) regions.push_back(region);
+	}
+	for (int i = 0; i < halide->output.size(); i++){
+		mem_regions_t * region = halide->output[i]->mem_info.associated_mem;
+		if (find(regions.begin(), regions.end(), region) == regions.end()) regions.push_back(region);
+	}
+
+	uint32_t ret_pop;
+	vector<buffer_binding_t> bindings = find_buffer_bindings(unfiltered_instrs, instrs, regions, &ret_pop);
+
+	uint64_t entry_sp;
+	uint32_t slot_width;
+	get_entry_stack_pointer(unfiltered_instrs, instrs, &entry_sp, &slot_width);
+
+	string module = instrs[0].second->module_name;
+	size_t separator = module.find_last_of("\\/");
+	if (separator != string::npos) module = module.substr(separator + 1);
+
+	out << "# binding manifest for the lifted pipelines - see buildex include/halide/binding.h" << endl;
+	out << "function " << module << " " << instrs[0].first->pc << " " << ret_pop << " " << library << endl;
+
+	for (int i = 0; i < halide->output.size(); i++){
+
+		out << "pipeline halide_out_" << i << " " << halide->params.size() + halide->inputs.size() + 1 << endl;
+
+		for (int j = 0; j < halide->params.size(); j++){
+			print_param_binding(out, halide->params[j], entry_sp, slot_width);
+		}
+		for (int j = 0; j < halide->inputs.size(); j++){
+			print_buffer_binding(out, get_binding(bindings, halide->inputs[j]->mem_info.associated_mem));
+		}
+		print_buffer_binding(out, get_binding(bindings, halide->output[i]->mem_info.associated_mem));
+
+	}
+
+	out << "end" << endl;
+
+}
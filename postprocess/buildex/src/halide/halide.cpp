@@ -1,10 +1,12 @@
-#include <sys\stat.h>
+#include <sys/stat.h>
 #include <string>
 #include <stack>
 #include <algorithm>
 #include <list>
 
 #include "halide/halide.h"
+#include "halide/halide_ir.h"
+#include "halide/reduction.h"
 #include "trees/nodes.h"
 #include "common_defines.h"
 
@@ -14,7 +16,7 @@
 
 Halide_Program::Halide_Program()
 {
-
+	schedule = SCHEDULE_NONE;
 }
 
 
@@ -28,6 +30,47 @@ string print_Halide_header(){
 	return "#include <Halide.h>\n  #include <vector>\n  using namespace std;\n  using namespace Halide;\n  int main(){ \n";
 }
 
+/* knobs of a tunable schedule are read from the environment so that one build can be timed with many schedules;
+   recovered input images are read as 8 bit ppm files, interleaved (c,x,y) or planar (x,y,c) like the buffer */
+string print_Halide_tuning_header(){
+	return "#include <Halide.h>\n  #include <stdio.h>\n  #include <stdlib.h>\n  #include <string>\n  #include <sstream>\n  #include <chrono>\n  #include <iostream>\n"
+		"  static int knob(const char * name, int value){ const char * env = getenv(name); return (env != NULL) ? atoi(env) : value; }\n"
+		"  template<typename T> Halide::Image<T> tune_load(std::string file, int dims, bool channels_first){\n"
+		"  FILE * f = fopen(file.c_str(), \"rb\"); char magic[3] = { 0 }; int w = 0, h = 0, maxval = 0;\n"
+		"  if (f == NULL || fscanf(f, \"%2s %d %d %d\", magic, &w, &h, &maxval) != 4 || std::string(magic) != \"P6\" || maxval > 255){ fprintf(stderr, \"%s is not an 8 bit ppm\\n\", file.c_str()); exit(1); }\n"
+		"  fgetc(f);\n"
+		"  Halide::Image<T> im = (dims == 2) ? Halide::Image<T>(w, h) : (channels_first ? Halide::Image<T>(3, w, h) : Halide::Image<T>(w, h, 3));\n"
+		"  for (int y = 0; y < h; y++) for (int x = 0; x < w; x++) for (int c = 0; c < 3; c++){ T v = (T)fgetc(f);\n"
+		"  if (dims == 2){ if (c == 0) im(x, y) = v; } else if (channels_first) im(c, x, y) = v; else im(x, y, c) = v; }\n"
+		"  fclose(f); return im; }\n";
+}
+
+/* every program can check itself against the memory dumps of the original run (see print_validation_driver); raw
+   dumps are read with byte strides into dense images and compared element by element */
+string print_Halide_validation_header(){
+	return "#include <Halide.h>\n  #include <stdio.h>\n  #include <stdlib.h>\n  #include <string.h>\n  #include <math.h>\n  #include <string>\n  #include <vector>\n  #include <sstream>\n  #include <chrono>\n  #include <iostream>\n"
+		"  static std::vector<unsigned char> validate_read(std::string file){ std::vector<unsigned char> bytes; FILE * f = fopen(file.c_str(), \"rb\");\n"
+		"  if (f == NULL){ fprintf(stderr, \"cannot open %s\\n\", file.c_str()); return bytes; }\n"
+		"  int c; while ((c = fgetc(f)) != EOF) bytes.push_back((unsigned char)c); fclose(f); return bytes; }\n"
+		"  template<typename T> bool validate_load(std::string file, Halide::Image<T> &im, const int * extents, const int * strides){\n"
+		"  std::vector<unsigned char> bytes = validate_read(file); size_t index = 0;\n"
+		"  for (int z = 0; z < extents[2]; z++) for (int y = 0; y < extents[1]; y++) for (int x = 0; x < extents[0]; x++){\n"
+		"  size_t offset = (size_t)x * strides[0] + (size_t)y * strides[1] + (size_t)z * strides[2];\n"
+		"  if (offset + sizeof(T) > bytes.size()){ fprintf(stderr, \"%s is smaller than the buffer\\n\", file.c_str()); return false; }\n"
+		"  memcpy(&im.data()[index++], &bytes[offset], sizeof(T)); }\n"
+		"  return true; }\n"
+		"  template<typename T> long validate_compare(std::string name, Halide::Image<T> &out, std::string file, const int * extents, const int * strides,\n"
+		"  double tolerance, int report, double * max_error){\n"
+		"  Halide::Image<T> expected(extents[0], extents[1], extents[2]); if (!validate_load(file, expected, extents, strides)) return -1;\n"
+		"  long mismatches = 0; size_t index = 0;\n"
+		"  for (int z = 0; z < extents[2]; z++) for (int y = 0; y < extents[1]; y++) for (int x = 0; x < extents[0]; x++, index++){\n"
+		"  double lifted = (double)out.data()[index]; double original = (double)expected.data()[index]; double error = fabs(lifted - original);\n"
+		"  if (error > *max_error) *max_error = error;\n"
+		"  if (error > tolerance){ if (mismatches < report) printf(\"validate_mismatch %s %d %d %d lifted %g original %g\\n\", name.c_str(), x, y, z, lifted, original);\n"
+		"  mismatches++; } }\n"
+		"  return mismatches; }\n";
+}
+
 string print_Halide_footer(){
 	return "return 0;\n}";
 }
@@ -100,6 +143,14 @@ string print_Halide_parameter_declaration(Abs_Node * node){
 
 }
 
+/* C type of a buffer element - used when binding and realizing buffers in the tuning driver */
+string print_C_type(uint width, bool sign, bool is_float){
+
+	if (is_float) return (width == 8) ? "double" : "float";
+	return string(sign ? "" : "u") + "int" + to_string(width * 8) + "_t";
+
+}
+
 /* Func name;*/
 string print_Halide_function_declaration(Abs_Node * node){
 	return "Func " + node->mem_info.associated_mem->name + ";";
@@ -251,14 +302,13 @@ int32_t Halide_Program::get_rdom_location(Func *func, RDom *rdom){
 
 				bool similar = true;
 				for (int j = 0; j < first.size(); j++){
-					if (first[i].first != second[i].first || first[i].second != second[i].second){
+					if (first[j].first != second[j].first || first[j].second != second[j].second){
 						similar = false;
 						break;
 					}
 				}
 
 				if (similar){
-					delete rdom;
 					return i;
 				}
 			}
@@ -276,17 +326,33 @@ void Halide_Program::populate_red_funcs(Abs_Tree * tree,
 	std::vector< std::pair<int32_t, int32_t > > boundaries, Abs_Node * node){
 
 	RDom * rdom = new RDom();
+	rdom->update = RED_NONE;
 	if (node != NULL){
 		rdom->red_node = node;
 		rdom->type = INDIRECT_REF;
+		/* the domain walks the whole buffer holding the indirect locations - its bounds are the region's */
+		mem_regions_t * mem = node->mem_info.associated_mem;
+		for (int i = 0; i < mem->dimensions; i++){
+			if (mem->extents[i] == 0){
+				rdom->extents.clear();
+				break;
+			}
+			rdom->extents.push_back(make_pair(0, (int32_t)mem->extents[i] - 1));
+		}
 		cout << "indirect ref populated" << endl;
 	}
 	else{
+		rdom->red_node = NULL;
 		rdom->extents = boundaries;
 		rdom->type = EXTENTS;
 		cout << "extents populated" << endl;
 	}
 
+	if (find_self_read(tree) == NULL){
+		DEBUG_PRINT(("WARNING: reduction tree of %s does not read the buffer it updates\n",
+			static_cast<Abs_Node *>(tree->get_head())->mem_info.associated_mem->name.c_str()), 2);
+	}
+
 	Abs_Node * head = static_cast<Abs_Node *>(tree->get_head());
 	Func * func = check_function(head->mem_info.associated_mem);
 	if (func == NULL){
@@ -421,84 +487,39 @@ void Halide_Program::populate_halide_program(){
 /* casting and overlap node printing								    */
 /************************************************************************/
 
-string get_cast_string(Abs_Node * node, uint32_t sign){
-
-	string ret = "";
-	ret += "cast<";
+string get_cast_type(Abs_Node * node, uint32_t sign){
 
 	if (node->is_double){
-		ret += "double>";
-	}
-	else{
-		if (!sign) ret += "u";
-		ret += "int" + to_string(node->symbol->width * 8) + "_t>";
+		return "double";
 	}
-
-	return ret;
-
+	return string(sign ? "" : "u") + "int" + to_string(node->symbol->width * 8) + "_t";
 	
 }
 
 /* FO -> going from small to big (like ah -> eax) */
-string Halide_Program::print_full_overlap_node(Abs_Node * node, Node * head, vector<string> vars){
+hir_expr_t * Halide_Program::build_full_overlap_node(Abs_Node * node, Node * head, vector<string> vars){
 	/* here, we will some times we need to use shifting and anding */
 	Abs_Node * overlap = static_cast<Abs_Node *>(node->srcs[0]);
 
-	uint32_t overlap_end = overlap->symbol->value + overlap->symbol->width;
-	uint32_t node_end = node->symbol->value + node->symbol->width;
-
 	/* BUG - overlap_end == node_end ? this is not always true if mem and reg values are*/
 
-	
-	string ret = "";
-
 	if (node->symbol->width == overlap->symbol->width){ /* where the nodes are of reg and memory etc.*/
-		ret += print_abs_tree(overlap, head, vars);
-		return ret;
+		return build_abs_tree(overlap, head, vars);
 	}
 
 	uint32_t mask = uint32_t(~0) >> (32 - node->symbol->width * 8);
 	mask = mask > 65535 ? 65535 : mask;
 
-	
-	/*if(node->symbol->type == REG_TYPE && overlap->symbol->type == REG_TYPE && overlap_end != node_end){
-		ret += " ( ( ";
-		ret += print_abs_tree(overlap,head, vars);
-		ret += " >> " + to_string((overlap_end - node_end) * 8) + " ) ";
-		ret += " ) & " + to_string(mask);
-	}
-	else{*/
-		ret += " ( ";
-		ret += print_abs_tree(overlap, head, vars);
-		ret += " ) & " + to_string(mask);
-	//}
-
-	return ret;
+	return ir.make(HIR_MASK, "", { build_abs_tree(overlap, head, vars) }, mask);
 
 }
 
-string Halide_Program::print_partial_overlap_node(Abs_Node * node, Node * head, vector<string> vars){
-
-	string ret = "";
-
-	/*for (int i = 0; i < node->srcs.size(); i++)
-	{
-		Abs_Node * overlap = static_cast<Abs_Node *>(node->srcs[i]);
+/* partial overlaps (a value assembled from narrower ones) are not lifted yet */
+hir_expr_t * Halide_Program::build_partial_overlap_node(Abs_Node * node, Node * head, vector<string> vars){
 
-		uint32_t overlap_end = overlap->symbol->value + overlap->symbol->width;
-		uint32_t node_end = node->symbol->value + node->symbol->width;
+	DEBUG_PRINT(("WARNING: partial overlap node is not supported in the Halide backend\n"), 1);
+	return ir.leaf("");
 
-		
-		ret += "(";
-		ret += print_abs_tree(overlap, head,vars);
-		ret += " << " + to_string((node_end - overlap_end) * 8);
-		ret += ")";
-
-		if (i != node->srcs.size() - 1){
-			ret+= " | ";
-		}
-	}*/
-	return ret;
 }
 
 /************************************************************************/
@@ -516,6 +537,10 @@ void Halide_Program::print_halide_program(std::ostream &out, vector<string> red_
 	}
 
 	/*print the Halide header*/
+	if (schedule == SCHEDULE_TUNABLE){
+		out << print_Halide_tuning_header();
+	}
+	out << print_Halide_validation_header();
 	out << print_Halide_header() << endl;
 
 	/****************** print declarations **********************/
@@ -547,6 +572,16 @@ void Halide_Program::print_halide_program(std::ostream &out, vector<string> red_
 	for (int i = 0; i < funcs.size(); i++){
 		out << print_function(funcs[i], red_variables) << endl;
 	}
+	DEBUG_PRINT(("halide ir - %u expression nodes, %u shared\n", ir.size(), ir.shared()), 2);
+
+	/***************** print the schedule ************************/
+
+	out << print_schedule() << endl;
+
+	if (schedule == SCHEDULE_TUNABLE){
+		out << print_tuning_driver() << endl;
+	}
+	out << print_validation_driver() << endl;
 
 	/***************finalizing - instructions for code generation ******/
 
@@ -570,33 +605,523 @@ void Halide_Program::print_halide_program(std::ostream &out, vector<string> red_
 
 }
 
-vector<string> get_reduction_index_variables(string rvar){
+/************************************************************************/
+/* schedule generation                                                  */
+/************************************************************************/
 
-	vector<string> rvars;
-	rvars.push_back(rvar + ".x");
-	rvars.push_back(rvar + ".y");
-	rvars.push_back(rvar + ".z");
-	rvars.push_back(rvar + ".w");
-	return rvars;
+/* tuning constants for the emitted schedules */
+#define VECTOR_BYTES		16			/* SSE width; all the x86 targets we lift from have it */
+#define TILE_BYTES			(32 * 1024)	/* keep a tile of the output and its producers within L1/L2 */
+#define MIN_PARALLEL_ROWS	16			/* below this parallel task overhead outweighs the work */
+
+static mem_regions_t * get_func_mem(Halide_Program::Func * func){
+	return static_cast<Abs_Node *>(func->pure_trees[0]->get_head())->mem_info.associated_mem;
+}
+
+/* buffers read by the trees of a function (head is the written buffer and is not counted) */
+static void get_read_regions(Node * dst, Node * head, vector<mem_regions_t *> &regions){
+
+	Abs_Node * node = static_cast<Abs_Node *>(dst);
+
+	if (node != head && (node->type == Abs_Node::INPUT_NODE || node->type == Abs_Node::INTERMEDIATE_NODE || node->type == Abs_Node::OUTPUT_NODE)){
+		mem_regions_t * mem = node->mem_info.associated_mem;
+		if (find(regions.begin(), regions.end(), mem) == regions.end()){
+			regions.push_back(mem);
+		}
+	}
+
+	for (int i = 0; i < node->srcs.size(); i++){
+		get_read_regions(node->srcs[i], head, regions);
+	}
+
+}
+
+/* funcs (not ImageParams) which the given func reads from */
+vector<Halide_Program::Func *> Halide_Program::get_producers(Func * func){
+
+	vector<mem_regions_t *> regions;
+	for (int i = 0; i < func->pure_trees.size(); i++){
+		get_read_regions(func->pure_trees[i]->get_head(), func->pure_trees[i]->get_head(), regions);
+	}
+	for (int i = 0; i < func->reduction_trees.size(); i++){
+		for (int j = 0; j < func->reduction_trees[i].second.size(); j++){
+			get_read_regions(func->reduction_trees[i].second[j]->get_head(), func->reduction_trees[i].second[j]->get_head(), regions);
+		}
+	}
+
+	vector<Func *> producers;
+	for (int i = 0; i < regions.size(); i++){
+		if ((regions[i]->trees_direction & MEM_INPUT) == MEM_INPUT) continue; /* read through the ImageParam */
+		Func * producer = check_function(regions[i]);
+		if (producer != NULL && producer != func){
+			producers.push_back(producer);
+		}
+	}
+
+	return producers;
+
+}
+
+/* a func can be computed inside its consumer only if it has exactly one */
+Halide_Program::Func * Halide_Program::get_consumer(Func * func){
+
+	Func * consumer = NULL;
+	for (int i = 0; i < funcs.size(); i++){
+		if (funcs[i] == func) continue;
+		vector<Func *> producers = get_producers(funcs[i]);
+		if (find(producers.begin(), producers.end(), func) != producers.end()){
+			if (consumer != NULL) return NULL;
+			consumer = funcs[i];
+		}
+	}
+
+	return consumer;
+
+}
+
+/* vectorized (x) and outer (y) dimensions of a func; an innermost colour dimension narrower than a vector
+   is unrolled instead and the next dimension is vectorized */
+static void get_schedule_dimensions(mem_regions_t * mem, uint32_t dimensions, uint32_t vector_width, int32_t * x, int32_t * y, bool * channels){
+
+	*x = 0;
+	*y = (dimensions > 1) ? 1 : -1;
+	*channels = false;
+
+	if (dimensions > 1 && mem->extents[0] <= 4 && mem->extents[0] < vector_width){
+		*channels = true;
+		*x = 1;
+		*y = (dimensions > 2) ? 2 : -1;
+	}
 
 }
 
-string print_expression_name(string expr_name, uint32_t conditional){
+static uint32_t get_vector_width(Abs_Node * head){
+	mem_regions_t * mem = head->mem_info.associated_mem;
+	uint32_t element_bytes = (mem->bytes_per_pixel > 0) ? mem->bytes_per_pixel : head->symbol->width;
+	return max((uint32_t)1, (uint32_t)VECTOR_BYTES / element_bytes);
+}
+
+/* unroll needs a constant extent - the colour dimension is bounded to the channels of the buffer first */
+static string print_channel_unroll(mem_regions_t * mem, string var){
+	return ".bound(" + var + ",0," + to_string(mem->extents[0]) + ").unroll(" + var + ")";
+}
 
-	return expr_name + "_" + to_string(conditional);
+/* pure funcs with at least two non colour dimensions are tiled */
+static bool is_func_tiled(Halide_Program::Func * func){
+
+	Abs_Node * head = static_cast<Abs_Node *>(func->pure_trees[0]->get_head());
+	int32_t x, y;
+	bool channels;
+	get_schedule_dimensions(head->mem_info.associated_mem, head->mem_info.dimensions, get_vector_width(head), &x, &y, &channels);
+	return (y != -1) && (func->reduction_trees.size() == 0);
 
 }
 
-string print_select_statement(Halide_Program::Select_Expr * current_expr,Halide_Program::Select_Expr * next_expr){
+string Halide_Program::print_func_schedule(Func * func, Func * consumer){
+
+	Abs_Node * head = static_cast<Abs_Node *>(func->pure_trees[0]->get_head());
+	mem_regions_t * mem = head->mem_info.associated_mem;
+	uint32_t dimensions = head->mem_info.dimensions;
+	string name = mem->name;
+
+	uint32_t element_bytes = (mem->bytes_per_pixel > 0) ? mem->bytes_per_pixel : head->symbol->width;
+	uint32_t vector_width = get_vector_width(head);
+
+	int32_t x, y;
+	bool channels;
+	get_schedule_dimensions(mem, dimensions, vector_width, &x, &y, &channels);
+
+	bool vectorize = (vector_width > 1) && (mem->extents[x] >= vector_width);
+	bool parallel = (y != -1) && (mem->extents[y] >= MIN_PARALLEL_ROWS);
+
+	string ret = name;
+
+	/* producers with a single pure consumer are computed per tile of the consumer */
+	if (schedule == SCHEDULE_TILED && consumer != NULL && func->reduction_trees.size() == 0 && is_func_tiled(consumer)){
+
+		ret += ".compute_at(" + get_func_mem(consumer)->name + ",s_xo)";
+		if (channels) ret += ".reorder(" + vars[x] + "," + vars[0] + ")" + print_channel_unroll(mem, vars[0]);
+		if (vectorize) ret += ".vectorize(" + vars[x] + "," + to_string(vector_width) + ")";
+		return ret + ";\n";
+
+	}
+
+	if (consumer != NULL){
+		ret += ".compute_root()";
+	}
+
+	if (channels){
+		ret += ".reorder(" + vars[x] + "," + vars[0];
+		for (int i = 2; i < dimensions; i++) ret += "," + vars[i];
+		ret += ")" + print_channel_unroll(mem, vars[0]);
+	}
+
+	if (schedule == SCHEDULE_TILED && is_func_tiled(func)){
+
+		/* tile width is a multiple of the vector width, tile height fills the rest of the tile budget */
+		uint32_t tile_x = min(mem->extents[x], (uint32_t)64 / vector_width * vector_width);
+		if (tile_x == 0) tile_x = mem->extents[x];
+		uint32_t tile_y = min(mem->extents[y], max((uint32_t)1, (uint32_t)TILE_BYTES / (tile_x * element_bytes)));
+
+		ret += ".tile(" + vars[x] + "," + vars[y] + ",s_xo,s_yo,s_xi,s_yi," + to_string(tile_x) + "," + to_string(tile_y) + ")";
+		if (vectorize) ret += ".vectorize(s_xi," + to_string(vector_width) + ")";
+		if (parallel) ret += ".parallel(s_yo)";
 
-	if (next_expr != NULL){ /* we have a false value*/
-		return "Expr " + current_expr->name + " = select(" + current_expr->condition + "," + current_expr->truth_value + "," + next_expr->name + ");\n";
 	}
 	else{
-		return "Expr " + current_expr->name + " = " + current_expr->truth_value + ";\n";
+
+		if (vectorize) ret += ".vectorize(" + vars[x] + "," + to_string(vector_width) + ")";
+		if (parallel) ret += ".parallel(" + vars[y] + ")";
+
 	}
 
-	
+	/* update definitions are left serial unless they are associative (see print_reduction_schedule) */
+	return ret + ";\n" + print_reduction_schedule(func, "");
+
+}
+
+/* an associative update over a domain of two or more dimensions is split along its outer dimension with rfactor;
+   the partial results are computed in parallel and merged by the original update. other updates stay serial -
+   their domain may carry dependencies */
+string Halide_Program::print_reduction_schedule(Func * func, string guard){
+
+	const char * rvar_names[] = { "x", "y", "z", "w" };
+	string name = get_func_mem(func)->name;
+	string ret = "";
+
+	for (int i = 0; i < func->reduction_trees.size(); i++){
+
+		RDom * rdom = func->reduction_trees[i].first;
+		uint32_t dims = rdom->extents.size();
+		if (rdom->update == RED_NONE || dims < 2 || dims > 4) continue;
+
+		pair<int32_t, int32_t> outer = rdom->extents[dims - 1];
+		if (outer.second - outer.first + 1 < MIN_PARALLEL_ROWS) continue;
+
+		string rvar = rdom->name + "." + rvar_names[dims - 1];
+		string u = rdom->name + "_u";
+		string partial = rdom->name + "_f";
+		ret += guard + "{ Var " + u + "; Func " + partial + " = " + name + ".update(" + to_string(i) + ").rfactor(" + rvar + "," + u + "); ";
+		ret += partial + ".compute_root().update(0).parallel(" + u + "); }\n";
+
+	}
+
+	return ret;
+
+}
+
+/* same decisions as print_func_schedule, but every choice is guarded by a knob:
+   EXALGO_SCHED_VECTOR (1 - off), EXALGO_SCHED_TILE_X / _Y (0 - no tiling), EXALGO_SCHED_PARALLEL,
+   EXALGO_SCHED_PRODUCERS (0 - compute_root, 1 - compute_at consumer tile, 2 - inline) */
+string Halide_Program::print_func_schedule_tunable(Func * func, Func * consumer){
+
+	Abs_Node * head = static_cast<Abs_Node *>(func->pure_trees[0]->get_head());
+	mem_regions_t * mem = head->mem_info.associated_mem;
+	uint32_t dimensions = head->mem_info.dimensions;
+	string name = mem->name;
+
+	int32_t x, y;
+	bool channels;
+	get_schedule_dimensions(mem, dimensions, get_vector_width(head), &x, &y, &channels);
+
+	string ret = "";
+
+	if (consumer != NULL && func->reduction_trees.size() == 0){
+
+		string at = is_func_tiled(consumer) ? "s_tile_x > 0 && " : "false && ";
+		ret += "if (" + at + "s_producers == 1) " + name + ".compute_at(" + get_func_mem(consumer)->name + ",s_xo);\n";
+		ret += "else if (s_producers != 2) " + name + ".compute_root();\n";
+		ret += "if (s_producers != 2 && s_vector > 1) " + name + ".vectorize(" + vars[x] + ",s_vector);\n";
+		if (y != -1){
+			ret += "if (s_producers == 0 && s_parallel) " + name + ".parallel(" + vars[y] + ");\n";
+		}
+		return ret;
+
+	}
+
+	if (consumer != NULL){
+		ret += name + ".compute_root();\n";
+	}
+
+	if (channels){
+		ret += name + ".reorder(" + vars[x] + "," + vars[0];
+		for (int i = 2; i < dimensions; i++) ret += "," + vars[i];
+		ret += ")" + print_channel_unroll(mem, vars[0]) + ";\n";
+	}
+
+	string untiled = "if (s_vector > 1) " + name + ".vectorize(" + vars[x] + ",s_vector);";
+	if (y != -1){
+		untiled += " if (s_parallel) " + name + ".parallel(" + vars[y] + ");";
+	}
+
+	if (is_func_tiled(func)){
+		ret += "if (s_tile_x > 0){ " + name + ".tile(" + vars[x] + "," + vars[y] + ",s_xo,s_yo,s_xi,s_yi,s_tile_x,s_tile_y);";
+		ret += " if (s_vector > 1) " + name + ".vectorize(s_xi,s_vector); if (s_parallel) " + name + ".parallel(s_yo); }\n";
+		ret += "else { " + untiled + " }\n";
+	}
+	else{
+		ret += untiled + "\n";
+	}
+
+	ret += print_reduction_schedule(func, "if (s_parallel) ");
+
+	return ret;
+
+}
+
+string Halide_Program::print_schedule(){
+
+	if (schedule == SCHEDULE_NONE) return "";
+
+	/* markers let the autotuner find the schedule section */
+	string ret = "/* schedule begin */\n";
+
+	if (schedule == SCHEDULE_TILED || schedule == SCHEDULE_TUNABLE){
+		ret += print_Halide_variable_declaration("s_xo") + " " + print_Halide_variable_declaration("s_yo") + " ";
+		ret += print_Halide_variable_declaration("s_xi") + " " + print_Halide_variable_declaration("s_yi") + "\n";
+	}
+
+	if (schedule == SCHEDULE_TUNABLE){
+
+		/* defaults are the SCHEDULE_TILED choices for the first output */
+		uint32_t vector_width = 1;
+		for (int i = 0; i < funcs.size(); i++){
+			if (get_consumer(funcs[i]) == NULL){
+				vector_width = get_vector_width(static_cast<Abs_Node *>(funcs[i]->pure_trees[0]->get_head()));
+				break;
+			}
+		}
+
+		ret += "int s_vector = knob(\"EXALGO_SCHED_VECTOR\"," + to_string(vector_width) + ");\n";
+		ret += "int s_tile_x = knob(\"EXALGO_SCHED_TILE_X\",64);\n";
+		ret += "int s_tile_y = knob(\"EXALGO_SCHED_TILE_Y\",32);\n";
+		ret += "int s_parallel = knob(\"EXALGO_SCHED_PARALLEL\",1);\n";
+		ret += "int s_producers = knob(\"EXALGO_SCHED_PRODUCERS\",1);\n";
+
+		for (int i = 0; i < funcs.size(); i++){
+			ret += print_func_schedule_tunable(funcs[i], get_consumer(funcs[i]));
+		}
+
+	}
+	else{
+
+		for (int i = 0; i < funcs.size(); i++){
+			ret += print_func_schedule(funcs[i], get_consumer(funcs[i]));
+		}
+
+	}
+
+	ret += "/* schedule end */\n";
+
+	return ret;
+
+}
+
+/* sets the scalar Params in order from the comma separated values in the env variable; a missing value fails the
+   driver when required, else the Param is set to 0 with a warning */
+string Halide_Program::print_param_bindings(string env, string list, bool required){
+
+	string ret = "vector<string> " + list + "; string " + list + "_item;\n";
+	ret += "if (getenv(\"" + env + "\") != NULL){ stringstream " + list + "_stream(getenv(\"" + env + "\"));\n";
+	ret += "while (getline(" + list + "_stream, " + list + "_item, ',')) " + list + ".push_back(" + list + "_item); }\n";
+
+	for (int i = 0; i < params.size(); i++){
+		string type = params[i]->is_double ? "double" : print_C_type(params[i]->symbol->width, params[i]->sign, false);
+		string name = "p_" + to_string(params[i]->para_num);
+		ret += "if (" + list + ".size() > " + to_string(i) + ") " + name + ".set((" + type + ")atof(" + list + "[" + to_string(i) + "].c_str()));\n";
+		if (required){
+			ret += "else { cerr << \"" + name + " is not given in " + env + "\" << endl; return 1; }\n";
+		}
+		else{
+			ret += "else cerr << \"" + name + " is not given; using 0\" << endl;\n";
+		}
+	}
+
+	return ret;
+
+}
+
+/* when EXALGO_TUNE_INPUTS lists one ppm image per ImageParam (and EXALGO_TUNE_PARAMS the values of the scalar Params),
+   the program JIT compiles the final funcs, times EXALGO_TUNE_ITERATIONS realizations on the recovered extents and
+   exits without compiling to file */
+string Halide_Program::print_tuning_driver(){
+
+	string ret = "if (getenv(\"EXALGO_TUNE_INPUTS\") != NULL){\n";
+	ret += "vector<string> tune_inputs; string tune_item; stringstream tune_list(getenv(\"EXALGO_TUNE_INPUTS\"));\n";
+	ret += "while (getline(tune_list, tune_item, ',')) tune_inputs.push_back(tune_item);\n";
+
+	uint32_t count = 0;
+	for (int i = 0; i < inputs.size(); i++){
+		mem_regions_t * mem = inputs[i]->mem_info.associated_mem;
+		if ((mem->trees_direction & MEM_INPUT) != MEM_INPUT) continue;
+		string name = mem->name + (((mem->trees_direction & MEM_OUTPUT) == MEM_OUTPUT) ? "_buf_in" : "");
+		string type = print_C_type(inputs[i]->symbol->width, inputs[i]->sign, inputs[i]->is_double);
+		ret += "if (tune_inputs.size() <= " + to_string(count) + "){ cerr << \"missing input for " + name + "\" << endl; return 1; }\n";
+		string channels_first = (inputs[i]->mem_info.dimensions > 2 && mem->extents[0] <= 4) ? "true" : "false";
+		ret += "Image<" + type + "> tune_in_" + to_string(count) + " = tune_load<" + type + ">(tune_inputs[" + to_string(count) + "],"
+			+ to_string(inputs[i]->mem_info.dimensions) + "," + channels_first + ");\n";
+		ret += name + ".set(tune_in_" + to_string(count) + ");\n";
+		count++;
+	}
+
+	/* the params steer control flow and the extents touched; candidates are not timed without them */
+	ret += print_param_bindings("EXALGO_TUNE_PARAMS", "tune_params", true);
+
+	ret += "int tune_iterations = knob(\"EXALGO_TUNE_ITERATIONS\",5);\n";
+	ret += "double tune_best = 0;\n";
+
+	vector<Func *> final_funcs = get_final_funcs();
+	for (int i = 0; i < final_funcs.size(); i++){
+
+		Abs_Node * head = static_cast<Abs_Node *>(final_funcs[i]->pure_trees[0]->get_head());
+		mem_regions_t * mem = head->mem_info.associated_mem;
+
+		string extents = "";
+		for (int j = 0; j < head->mem_info.dimensions; j++){
+			extents += to_string(mem->extents[j]);
+			if (j != head->mem_info.dimensions - 1) extents += ",";
+		}
+
+		string type = print_C_type(head->symbol->width, head->sign, head->is_double);
+		ret += "{ " + mem->name + ".compile_jit(); double best = -1;\n";
+		ret += "for (int it = 0; it < tune_iterations; it++){ auto start = chrono::high_resolution_clock::now();\n";
+		ret += "Image<" + type + "> tune_out = " + mem->name + ".realize(" + extents + ");\n";
+		ret += "double elapsed = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();\n";
+		ret += "if (best < 0 || elapsed < best) best = elapsed; }\n";
+		ret += "tune_best += best; }\n";
+
+	}
+
+	ret += "cout << \"tune_time_ms \" << tune_best << endl;\n";
+	ret += "return 0;\n}\n";
+
+	return ret;
+
+}
+
+/* funcs no other func consumes - the ones realized by the tuning and validation drivers */
+vector<Halide_Program::Func *> Halide_Program::get_final_funcs(){
+
+	vector<Func *> final_funcs;
+	for (int i = 0; i < funcs.size(); i++){
+
+		bool final_func = true;
+		for (int j = 0; j < funcs.size(); j++){
+			vector<Func *> producers = get_producers(funcs[j]);
+			if (funcs[j] != funcs[i] && find(producers.begin(), producers.end(), funcs[i]) != producers.end()){
+				final_func = false;
+				break;
+			}
+		}
+		if (final_func) final_funcs.push_back(funcs[i]);
+
+	}
+	return final_funcs;
+
+}
+
+/* extents and byte strides of a region as initializers of int[3] - dimensions past the region's have extent 1 */
+static string print_validation_layout(mem_regions_t * mem, uint32_t dims, string name){
+
+	string extents = "";
+	string strides = "";
+	for (int i = 0; i < 3; i++){
+		extents += (i < dims) ? to_string(mem->extents[i]) : "1";
+		strides += (i < dims) ? to_string(mem->strides[i]) : "0";
+		if (i != 2){
+			extents += ",";
+			strides += ",";
+		}
+	}
+	return "static const int " + name + "_extents[3] = {" + extents + "}; static const int " + name + "_strides[3] = {" + strides + "};\n";
+
+}
+
+/* when EXALGO_VALIDATE_DIR points at the raw buffers written by get_memory_regions (<region>_in.raw for the inputs and
+   <region>_out.raw for what the original wrote), the program JIT compiles the final funcs on the original inputs and
+   reports mismatches, the max absolute error, its throughput and a PASS/FAIL verdict. scalar Params are taken in order
+   from EXALGO_VALIDATE_PARAMS. the exit code is 0 on PASS and 2 on FAIL */
+string Halide_Program::print_validation_driver(){
+
+	string ret = "if (getenv(\"EXALGO_VALIDATE_DIR\") != NULL){\n";
+	ret += "string validate_dir = string(getenv(\"EXALGO_VALIDATE_DIR\")) + \"/\";\n";
+	ret += "double validate_tolerance = (getenv(\"EXALGO_VALIDATE_TOLERANCE\") != NULL) ? atof(getenv(\"EXALGO_VALIDATE_TOLERANCE\")) : 0;\n";
+	ret += "int validate_report = (getenv(\"EXALGO_VALIDATE_REPORT\") != NULL) ? atoi(getenv(\"EXALGO_VALIDATE_REPORT\")) : 10;\n";
+	ret += "int validate_iterations = (getenv(\"EXALGO_VALIDATE_ITERATIONS\") != NULL) ? atoi(getenv(\"EXALGO_VALIDATE_ITERATIONS\")) : 5;\n";
+	ret += print_param_bindings("EXALGO_VALIDATE_PARAMS", "validate_params", false);
+
+	uint32_t count = 0;
+	for (int i = 0; i < inputs.size(); i++){
+		mem_regions_t * mem = inputs[i]->mem_info.associated_mem;
+		if ((mem->trees_direction & MEM_INPUT) != MEM_INPUT) continue;
+		string name = mem->name + (((mem->trees_direction & MEM_OUTPUT) == MEM_OUTPUT) ? "_buf_in" : "");
+		string type = print_C_type(inputs[i]->symbol->width, inputs[i]->sign, inputs[i]->is_double);
+		string image = "validate_in_" + to_string(count);
+		uint32_t dims = inputs[i]->mem_info.dimensions;
+
+		ret += print_validation_layout(mem, dims, image);
+		string extents = "";
+		for (int j = 0; j < dims; j++){
+			extents += image + "_extents[" + to_string(j) + "]";
+			if (j != dims - 1) extents += ",";
+		}
+		ret += "Image<" + type + "> " + image + "(" + extents + ");\n";
+		ret += "if (!validate_load<" + type + ">(validate_dir + \"" + mem->name + "_in.raw\", " + image + ", " + image + "_extents, " + image + "_strides)) return 1;\n";
+		ret += name + ".set(" + image + ");\n";
+		count++;
+	}
+
+	ret += "bool validate_pass = true; double validate_ms = 0; double validate_elements = 0;\n";
+
+	vector<Func *> final_funcs = get_final_funcs();
+	for (int i = 0; i < final_funcs.size(); i++){
+
+		Abs_Node * head = static_cast<Abs_Node *>(final_funcs[i]->pure_trees[0]->get_head());
+		mem_regions_t * mem = head->mem_info.associated_mem;
+		uint32_t dims = head->mem_info.dimensions;
+		string image = "validate_out_" + to_string(i);
+
+		string extents = "";
+		for (int j = 0; j < dims; j++){
+			extents += to_string(mem->extents[j]);
+			if (j != dims - 1) extents += ",";
+		}
+
+		string type = print_C_type(head->symbol->width, head->sign, head->is_double);
+		ret += "{ " + print_validation_layout(mem, dims, image);
+		ret += mem->name + ".compile_jit(); double best = -1;\n";
+		ret += "Image<" + type + "> " + image + " = " + mem->name + ".realize(" + extents + ");\n";
+		ret += "for (int it = 0; it < validate_iterations; it++){ auto start = chrono::high_resolution_clock::now();\n";
+		ret += image + " = " + mem->name + ".realize(" + extents + ");\n";
+		ret += "double elapsed = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();\n";
+		ret += "if (best < 0 || elapsed < best) best = elapsed; }\n";
+		ret += "double max_error = 0; double elements = (double)" + image + "_extents[0] * " + image + "_extents[1] * " + image + "_extents[2];\n";
+		ret += "long mismatches = validate_compare<" + type + ">(\"" + mem->name + "\", " + image + ", validate_dir + \"" + mem->name + "_out.raw\", "
+			+ image + "_extents, " + image + "_strides, validate_tolerance, validate_report, &max_error);\n";
+		ret += "cout << \"validate_output " + mem->name + " mismatches \" << mismatches << \" of \" << elements << \" max_abs_error \" << max_error << endl;\n";
+		ret += "if (mismatches != 0) validate_pass = false;\n";
+		ret += "validate_ms += (best < 0) ? 0 : best; validate_elements += elements; }\n";
+
+	}
+
+	ret += "cout << \"validate_time_ms \" << validate_ms << endl;\n";
+	ret += "cout << \"validate_mpixels_per_s \" << ((validate_ms > 0) ? validate_elements / (validate_ms * 1000) : 0) << endl;\n";
+	ret += "cout << \"validate_verdict \" << (validate_pass ? \"PASS\" : \"FAIL\") << endl;\n";
+	ret += "return validate_pass ? 0 : 2;\n}\n";
+
+	return ret;
+
+}
+
+vector<string> get_reduction_index_variables(string rvar){
+
+	vector<string> rvars;
+	rvars.push_back(rvar + ".x");
+	rvars.push_back(rvar + ".y");
+	rvars.push_back(rvar + ".z");
+	rvars.push_back(rvar + ".w");
+	return rvars;
+
 }
 
 Abs_Node * get_indirect_node(Abs_Node * node){
@@ -647,41 +1172,24 @@ string print_output_func_def(Abs_Node * head, vector<string> vars){
 	return ret;
 }
 
-string Halide_Program::print_predicated_tree(vector<Abs_Tree *> trees, string expr_tag, vector<string> vars){
-
-	vector<Select_Expr *> exprs;
-
-	/* populate the expressions */
-	for (int i = 0; i < trees.size(); i++){
-		Abs_Node * head = static_cast<Abs_Node *>(trees[i]->get_head());
-		Select_Expr * expr = new Select_Expr();
-		expr->name = print_expression_name(head->mem_info.associated_mem->name + expr_tag, i);
-		expr->condition = print_conditional_trees(trees[i]->conditional_trees, vars);
-		expr->truth_value = print_abs_tree(trees[i]->get_head(),
-			trees[i]->get_head(), vars);
-		exprs.push_back(expr);
-	}
-
-	/* final print statements */
-	vector<string> statements;
-
-	for (int i = 0; i < exprs.size() - 1; i++){
-		statements.push_back(print_select_statement(exprs[i], exprs[i + 1]));
+/* the branches of a definition are merged into one decision structure over their predicates (build_hir_decision) -
+   the value of the first branch whose conditions hold, else the last branch; subexpressions shared between the
+   branches and conditions are printed once as Exprs <name><tag><n>. the value is saturated to the range of the
+   output unless the definition is an associative update - rfactor cannot prove clamp(old + e) associative, so those
+   wrap around in the output type as the traced x86 arithmetic does */
+string Halide_Program::print_predicated_tree(vector<Abs_Tree *> trees, string expr_tag, vector<string> vars, bool saturate){
+
+	vector<hir_branch_t> branches;
+	for (int i = 0; i < trees.size() - 1; i++){
+		hir_branch_t branch;
+		branch.literals = build_conditional_literals(trees[i]->conditional_trees, vars);
+		branch.value = build_abs_tree(trees[i]->get_head(), trees[i]->get_head(), vars);
+		branches.push_back(branch);
 	}
 
-	statements.push_back(print_select_statement(exprs[exprs.size() - 1], NULL));
-	
-
-	string output = "";
-
-	for (int i = statements.size() - 1; i >= 0; i--){
-		output += statements[i];
-	}
-
-	/* finally update the final output location */
-	output += print_output_func_def(
-		static_cast<Abs_Node *>(trees[0]->get_head()),
-		vars);
+	/* the last branch is taken when no other condition holds */
+	Abs_Tree * last = trees[trees.size() - 1];
+	hir_expr_t * value = build_hir_decision(ir, branches, build_abs_tree(last->get_head(), last->get_head(), vars));
 
 	Abs_Node * head_node = static_cast<Abs_Node *>(trees[0]->get_head());
 
@@ -689,40 +1197,42 @@ string Halide_Program::print_predicated_tree(vector<Abs_Tree *> trees, string ex
 	uint32_t clamp_min = 0;
 
 	/* BUG - what to do with the sign?? */
-	output += " = " + get_cast_string(head_node,false) + "( clamp(" + exprs[0]->name + "," + to_string(clamp_min) + "," + to_string(clamp_max) + ") );\n";
+	if (saturate){
+		value = ir.make(HIR_CLAMP, "", { value, ir.leaf(to_string(clamp_min)), ir.leaf(to_string(clamp_max)) });
+	}
+	hir_expr_t * output = ir.make(HIR_CAST, get_cast_type(head_node, false), { value });
 
-	return output;
+	/* finally update the final output location */
+	return print_hir_definition(print_output_func_def(head_node, vars), output, head_node->mem_info.associated_mem->name + expr_tag);
 
 }
 
 string Halide_Program::print_pure_trees(Func * func){
 
-	return print_predicated_tree(func->pure_trees, "_p_", vars);
+	return print_predicated_tree(func->pure_trees, "_p_", vars, true);
 
 }
 
+/* RDom name(min_0, extent_0, min_1, extent_1, ...) - r.x walks the first dimension of the buffer fastest as the
+   traced loops do; an indirect domain without known extents takes the bounds of the buffer at run time */
 string Halide_Program::print_rdom(RDom * rdom, vector<string> variables){
 
 	string name = rvars[rvars.size() - 1];
 	string ret = "RDom " + name + "(";
 	cout << "rdom type " << rdom->type << endl;
-	if (rdom->type == INDIRECT_REF){
-		ret += rdom->red_node->mem_info.associated_mem->name;
+	if (rdom->type == INDIRECT_REF && rdom->extents.size() == 0){
+		mem_regions_t * mem = rdom->red_node->mem_info.associated_mem;
+		ret += mem->name + (((mem->trees_direction & MEM_OUTPUT) == MEM_OUTPUT) ? "_buf_in" : "");
 	}
 	else{
-		for (int i = 0; i < rdom->abstract_indexes.size(); i++){
-			for (int j = 0; j < rdom->abstract_indexes[i].size(); j++){
-				ret += to_string(rdom->abstract_indexes[i][j]) + " * " + variables[j];
-				if (j != rdom->abstract_indexes[i].size() - 1){
-					ret += " + ";
-				}
-			}
-			if (i != rdom->abstract_indexes.size()){
-				ret += " , ";
+		for (int i = 0; i < rdom->extents.size(); i++){
+			ret += to_string(rdom->extents[i].first) + "," + to_string(rdom->extents[i].second - rdom->extents[i].first + 1);
+			if (i != rdom->extents.size() - 1){
+				ret += ",";
 			}
 		}
 	}
-	ret += " );";
+	ret += ");";
 	return ret;
 
 }
@@ -740,8 +1250,12 @@ std::string Halide_Program::print_red_trees(Func * func, vector<string> red_vari
 	for (int i = 0; i < func->reduction_trees.size(); i++){
 		string name = "r_" + to_string(rvars.size());
 		rvars.push_back(name);
-		ret += print_rdom(func->reduction_trees[i].first, red_variables) + "\n";
-		ret += print_predicated_tree(func->reduction_trees[i].second, "_r" + to_string(i) + "_", get_reduction_index_variables(name));
+		RDom * rdom = func->reduction_trees[i].first;
+		rdom->name = name;
+		rdom->update = classify_reduction(func->reduction_trees[i].second);
+		ret += "/* " + reduction_name(rdom->update) + " update" + ((rdom->update != RED_NONE) ? " (associative)" : "") + " */\n";
+		ret += print_rdom(rdom, red_variables) + "\n";
+		ret += print_predicated_tree(func->reduction_trees[i].second, "_r" + to_string(i) + "_", get_reduction_index_variables(name), rdom->update == RED_NONE);
 	
 	}
 
@@ -765,105 +1279,57 @@ std::string Halide_Program::print_function(Func * func, vector<string> red_varia
 	
 }
 
-
 /* Need to revamp these routines based on how the trees are transformed */
-/* very crude printing */
-std::string Halide_Program::get_indirect_string(Abs_Node * node, Abs_Node * head, vector<string> vars){
-
-
-	return print_abs_tree(node->srcs[0], head, vars);
-
-
-	/*if (node->srcs[0]->operation == op_add){
-		Abs_Node * base = (Abs_Node *)node->srcs[0]->srcs[0]; 
-		Abs_Node * index = (Abs_Node *)node->srcs[0]->srcs[1];
-
-		if (base->type == Abs_Node::OPERATION_ONLY){
-			return print_abs_tree(index, head, vars);
-		}
-		else{
-			return print_abs_tree(base, head, vars);
-		}
-	}
-
-	return ""; */
-
-}
-
-
-std::string Halide_Program::print_abs_tree(Node * nnode, Node * head ,vector<string> vars){
+/* very crude translation */
+hir_expr_t * Halide_Program::build_abs_tree(Node * nnode, Node * head ,vector<string> vars){
 
 	Abs_Node * node = static_cast<Abs_Node *>(nnode);
 
-	string ret = "";
-	
-	if (node->minus){
-		ret += "- (";
-	}
+	hir_expr_t * ret = NULL;
 	
 	if (node->type == Abs_Node::OPERATION_ONLY){
 		if (node->operation == op_full_overlap){
-			ret += " ( ";
-			ret += print_full_overlap_node(node, head, vars);
-			ret += " ) ";
+			ret = build_full_overlap_node(node, head, vars);
 		}
 		else if (node->operation == op_partial_overlap){
-			ret += " ( ";
-			ret += print_partial_overlap_node(node, head,  vars);
-			ret += " ) ";
+			ret = build_partial_overlap_node(node, head,  vars);
 		}
 		else if (node->operation == op_split_h){
-			ret += " ( ";
-			ret += print_abs_tree(node->srcs[0],head, vars);
-			ret += " ) >> ( " + to_string(node->srcs[0]->symbol->width * 8 / 2) + ")";
+			ret = ir.make(HIR_SHIFT, "", { build_abs_tree(node->srcs[0], head, vars) }, node->srcs[0]->symbol->width * 8 / 2);
 		}
 		else if (node->operation == op_split_l){
-			ret += " ( ";
-			ret += print_abs_tree(node->srcs[0],head, vars);
-			ret += " ) & " + to_string((node->srcs[0]->symbol->width / 2) * 8);
+			ret = ir.make(HIR_MASK, "", { build_abs_tree(node->srcs[0], head, vars) }, (node->srcs[0]->symbol->width / 2) * 8);
+		}
+		else if (node->operation == op_convert){
+			ret = ir.make(HIR_CAST, get_cast_type(node, node->sign), { build_abs_tree(node->srcs[0], head, vars) });
 		}
 		else if (node->operation == op_indirect){
-			ret += "(";
-			ret += get_indirect_string(node, (Abs_Node *)head, vars);
-			ret += ")";
+			ret = build_abs_tree(node->srcs[0], head, vars);
 		}
 		else if (node->operation == op_call){
-			ret += "(";
-			ret += node->func_name + "(";
+			vector<hir_expr_t *> args;
 			for (int k = 0; k < node->srcs.size(); k++){
-				Abs_Node * abs_nodes = (Abs_Node *)node->srcs[k];
-				ret += print_abs_tree(abs_nodes, head, vars);
-				if (k != node->srcs.size() - 1){
-					ret += ",";
-				}
+				args.push_back(build_abs_tree(node->srcs[k], head, vars));
 			}
-			ret += ")";
+			ret = ir.make(HIR_CALL, node->func_name, args);
 		}
 		else if (node->srcs.size() == 1){
-			ret += " " + node->get_symbolic_string(vars) + " ";
-			ret += print_abs_tree(node->srcs[0],head, vars);
+			ret = ir.make(HIR_UNARY, node->get_symbolic_string(vars), { build_abs_tree(node->srcs[0], head, vars) });
 		}
 		else{
-
-			ret += "(";
+			vector<hir_expr_t *> args;
 			for (int i = 0; i < node->srcs.size(); i++){
-
-				if (node->srcs[i]->symbol->width != node->symbol->width){
-						ret += get_cast_string(node, node->srcs[i]->minus) + "(";
-				}
-				ret += print_abs_tree(node->srcs[i],head, vars);
+				hir_expr_t * arg = build_abs_tree(node->srcs[i], head, vars);
 				if (node->srcs[i]->symbol->width != node->symbol->width){
-					ret += ")";
-				}
-				if (i != node->srcs.size() - 1){
-					ret += " " + node->get_symbolic_string(vars) + " ";
+					arg = ir.make(HIR_CAST, get_cast_type(node, node->srcs[i]->minus), { arg });
 				}
+				args.push_back(arg);
 			}
-			ret += ")";
+			ret = ir.make(HIR_NARY, node->get_symbolic_string(vars), args);
 		}
 	}
 	else if (node->type == Abs_Node::SUBTREE_BOUNDARY){
-	
+		ret = ir.leaf("");
 	}
 	else {
 
@@ -873,16 +1339,16 @@ std::string Halide_Program::print_abs_tree(Node * nnode, Node * head ,vector<str
 
 		if (node != head){
 			if (indirect){
-				ret += node->mem_info.associated_mem->name ;
-				ret += print_abs_tree(node->srcs[pos], head, vars); /* assumes that these nodes are at the leaves */
+				/* assumes that these nodes are at the leaves */
+				ret = ir.make(HIR_ACCESS, node->mem_info.associated_mem->name, { build_abs_tree(node->srcs[pos], head, vars) });
 			}
 			else{
 
 				if (node->type == Abs_Node::PARAMETER){
-					ret += "p_" + to_string(param_match[node->para_num]) + " ";
+					ret = ir.leaf("p_" + to_string(param_match[node->para_num]));
 				}
 				else{
-					ret += node->get_symbolic_string(vars) + " ";
+					ret = ir.leaf(node->get_symbolic_string(vars));
 				}
 			}
 		}
@@ -897,11 +1363,11 @@ std::string Halide_Program::print_abs_tree(Node * nnode, Node * head ,vector<str
 			if (node->operation != op_assign){  /* the node contains some other operation */
 				uint32_t ori_type = node->type;
 				node->type = Abs_Node::OPERATION_ONLY;
-				ret += print_abs_tree(node, head, vars);
+				ret = build_abs_tree(node, head, vars);
 				node->type = ori_type;
 			}
 			else{
-				ret += print_abs_tree(node->srcs[0], head, vars);
+				ret = build_abs_tree(node->srcs[0], head, vars);
 			}
 
 			if (indirect){
@@ -914,43 +1380,26 @@ std::string Halide_Program::print_abs_tree(Node * nnode, Node * head ,vector<str
 	}
 
 	if (node->minus){
-		ret += ")";
+		ret = ir.make(HIR_NEG, "", { ret });
 	}
 
 	return ret;
 }
 
-std::string Halide_Program::print_conditional_trees(std::vector< std::pair<Abs_Tree *, bool > > conditions, vector<string> vars){
+vector< pair<hir_expr_t *, bool> > Halide_Program::build_conditional_literals(std::vector< std::pair<Abs_Tree *, bool > > conditions, vector<string> vars){
 
-	string ret = "";
+	vector< pair<hir_expr_t *, bool> > literals;
 
 	for (int i = 0; i < conditions.size(); i++){
 
 		Abs_Node * node = static_cast<Abs_Node *>(conditions[i].first->get_head());
 		/* because the head node is just the output node - verify this fact */
 		ASSERT_MSG((node->srcs.size() == 1), ("ERROR: expected single source\n"));
-		bool taken = conditions[i].second;
 
-		if (!taken){
-			ret += "! (";
-		}
-
-		ret += print_abs_tree(node->srcs[0], node, vars);
-		if (i != conditions.size() - 1){
-			ret += " && ";
-		}
-
-		if (!taken){
-			ret += ")";
-		}
-	}
-
-	if (ret == ""){
-		ret += "true";
+		literals.push_back(make_pair(build_abs_tree(node->srcs[0], node, vars), conditions[i].second));
 	}
 
-	return ret;
-
+	return literals;
 
 }
 
@@ -979,7 +1428,19 @@ void print_dump_to_file(ofstream &file, mem_dump_regions_t * region){
 
 }
 
-vector<mem_dump_regions_t *> Halide_Program::get_memory_regions(vector<string> memdump_files){
+/* raw bytes of the region as the original laid them out - read back by the validation driver with the region's strides */
+void print_dump_to_raw_file(string filename, mem_dump_regions_t * region){
+
+	ofstream file(filename, ios::out | ios::binary);
+	if (!file.is_open()){
+		DEBUG_PRINT(("WARNING: cannot write %s\n", filename.c_str()), 1);
+		return;
+	}
+	file.write(region->values, region->size);
+
+}
+
+vector<mem_dump_regions_t *> Halide_Program::get_memory_regions(vector<string> memdump_files, string folder){
 
 	struct mem_dump_t{
 		char * buffer;
@@ -1041,6 +1502,8 @@ vector<mem_dump_regions_t *> Halide_Program::get_memory_regions(vector<string> m
 		}
 	}
 
+	uint32_t output_dumps = dumps.size();
+
 	// for all inputs
 	for (int i = 0; i < inputs.size(); i++){
 
@@ -1062,6 +1525,8 @@ vector<mem_dump_regions_t *> Halide_Program::get_memory_regions(vector<string> m
 	}
 
 
+	uint32_t input_dumps = dumps.size();
+
 	//for all dummy inputs
 	for (int i = 0; i < funcs.size(); i++){
 		if (funcs[i]->reduction_trees.size() > 0){
@@ -1090,11 +1555,19 @@ vector<mem_dump_regions_t *> Halide_Program::get_memory_regions(vector<string> m
 		}
 	}
 
-	ofstream file(get_standard_folder("output") + "\\dump.h");
+	ofstream file(join_path(folder, "dump.h"));
 	for (int i = 0; i < dumps.size(); i++){
 		print_dump_to_file(file, dumps[i]); 
 	}
 
+	/* funcs are what the original wrote, inputs what it read; the dummy inputs are already named <region>_in */
+	for (int i = 0; i < dumps.size(); i++){
+		string name = dumps[i]->name;
+		if (i < output_dumps) name += "_out";
+		else if (i < input_dumps) name += "_in";
+		print_dump_to_raw_file(join_path(folder, name + ".raw"), dumps[i]);
+	}
+
 	return dumps;
 
 }
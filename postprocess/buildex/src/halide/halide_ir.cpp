@@ -0,0 +1,231 @@
+#include <functional>
+#include <algorithm>
+
+#include "halide/halide_ir.h"
+#include "utility/defines.h"
+
+using namespace std;
+
+Halide_IR::Halide_IR(){
+	hits = 0;
+}
+
+Halide_IR::~Halide_IR(){
+	for (int i = 0; i < exprs.size(); i++){
+		delete exprs[i];
+	}
+}
+
+static uint64_t combine_hash(uint64_t seed, uint64_t value){
+	return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+hir_expr_t * Halide_IR::make(hir_kind_t kind, string text, vector<hir_expr_t *> args, int64_t value){
+
+	/* args are hash consed already, so comparing them by pointer compares the whole subexpression */
+	uint64_t hash = combine_hash(kind, std::hash<string>()(text));
+	hash = combine_hash(hash, (uint64_t)value);
+	for (int i = 0; i < args.size(); i++){
+		ASSERT_MSG((args[i] != NULL), ("ERROR: null argument to a Halide IR node\n"));
+		hash = combine_hash(hash, args[i]->id);
+	}
+
+	vector<hir_expr_t *> &bucket = table[hash];
+	for (int i = 0; i < bucket.size(); i++){
+		hir_expr_t * expr = bucket[i];
+		if (expr->kind == kind && expr->value == value && expr->text == text && expr->args == args){
+			hits++;
+			return expr;
+		}
+	}
+
+	hir_expr_t * expr = new hir_expr_t;
+	expr->kind = kind;
+	expr->text = text;
+	expr->value = value;
+	expr->args = args;
+	expr->hash = hash;
+	expr->id = exprs.size();
+	exprs.push_back(expr);
+	bucket.push_back(expr);
+	return expr;
+
+}
+
+hir_expr_t * Halide_IR::leaf(string text){
+	return make(HIR_LEAF, text, vector<hir_expr_t *>());
+}
+
+uint32_t Halide_IR::size(){
+	return exprs.size();
+}
+
+uint32_t Halide_IR::shared(){
+	return hits;
+}
+
+/* the branches as seen once predicate pred is known to be taken (or not); branches contradicting it are dropped */
+static vector<hir_branch_t> restrict_branches(vector<hir_branch_t> &branches, hir_expr_t * pred, bool taken){
+
+	vector<hir_branch_t> ret;
+	for (int i = 0; i < branches.size(); i++){
+		hir_branch_t branch;
+		branch.value = branches[i].value;
+		bool contradicts = false;
+		for (int j = 0; j < branches[i].literals.size(); j++){
+			if (branches[i].literals[j].first != pred){
+				branch.literals.push_back(branches[i].literals[j]);
+			}
+			else if (branches[i].literals[j].second != taken){
+				contradicts = true;
+				break;
+			}
+		}
+		if (!contradicts) ret.push_back(branch);
+	}
+	return ret;
+
+}
+
+/* shannon expansion over the predicates of the first undecided branch */
+static hir_expr_t * build_hir_decision_node(Halide_IR &ir, vector<hir_branch_t> &branches, hir_expr_t * otherwise){
+
+	if (branches.empty()) return otherwise;
+	if (branches[0].literals.empty()) return branches[0].value;
+
+	hir_expr_t * pred = branches[0].literals[0].first;
+	vector<hir_branch_t> taken = restrict_branches(branches, pred, true);
+	vector<hir_branch_t> not_taken = restrict_branches(branches, pred, false);
+
+	hir_expr_t * if_taken = build_hir_decision_node(ir, taken, otherwise);
+	hir_expr_t * if_not_taken = build_hir_decision_node(ir, not_taken, otherwise);
+
+	if (if_taken == if_not_taken) return if_taken;
+	return ir.make(HIR_SELECT, "", { pred, if_taken, if_not_taken });
+
+}
+
+hir_expr_t * build_hir_decision(Halide_IR &ir, vector<hir_branch_t> branches, hir_expr_t * otherwise){
+
+	/* a predicate repeated within a condition is dropped; a condition needing a predicate both ways never holds */
+	vector<hir_branch_t> normalized;
+	vector<hir_expr_t *> preds;
+	for (int i = 0; i < branches.size(); i++){
+		hir_branch_t branch;
+		branch.value = branches[i].value;
+		bool never = false;
+		for (int j = 0; j < branches[i].literals.size() && !never; j++){
+			pair<hir_expr_t *, bool> literal = branches[i].literals[j];
+			bool seen = false;
+			for (int k = 0; k < branch.literals.size(); k++){
+				if (branch.literals[k].first != literal.first) continue;
+				seen = true;
+				never = (branch.literals[k].second != literal.second);
+				break;
+			}
+			if (!seen) branch.literals.push_back(literal);
+			if (find(preds.begin(), preds.end(), literal.first) == preds.end()) preds.push_back(literal.first);
+		}
+		if (!never) normalized.push_back(branch);
+	}
+
+	if (preds.size() <= HIR_MAX_DECISION_PREDICATES){
+		return build_hir_decision_node(ir, normalized, otherwise);
+	}
+
+	hir_expr_t * value = otherwise;
+	for (int i = normalized.size() - 1; i >= 0; i--){
+		vector<hir_expr_t *> terms;
+		for (int j = 0; j < normalized[i].literals.size(); j++){
+			hir_expr_t * pred = normalized[i].literals[j].first;
+			terms.push_back(normalized[i].literals[j].second ? pred : ir.make(HIR_NOT, "", { pred }));
+		}
+		if (terms.empty()){
+			value = normalized[i].value;
+		}
+		else if (normalized[i].value != value){
+			hir_expr_t * cond = (terms.size() == 1) ? terms[0] : ir.make(HIR_AND, "", terms);
+			value = ir.make(HIR_SELECT, "", { cond, normalized[i].value, value });
+		}
+	}
+	return value;
+
+}
+
+static string print_hir_args(hir_expr_t * expr, string separator, map<hir_expr_t *, string> &bound){
+
+	string ret = "";
+	for (int i = 0; i < expr->args.size(); i++){
+		ret += print_hir_expr(expr->args[i], bound);
+		if (i != expr->args.size() - 1){
+			ret += separator;
+		}
+	}
+	return ret;
+
+}
+
+/* every compound node is parenthesized; bound nodes print as the name of their Expr */
+string print_hir_expr(hir_expr_t * expr, map<hir_expr_t *, string> &bound){
+
+	map<hir_expr_t *, string>::iterator it = bound.find(expr);
+	if (it != bound.end()) return it->second;
+
+	switch (expr->kind){
+	case HIR_LEAF: return expr->text;
+	case HIR_NEG: return "(-" + print_hir_expr(expr->args[0], bound) + ")";
+	case HIR_UNARY: return "(" + expr->text + " " + print_hir_expr(expr->args[0], bound) + ")";
+	case HIR_NARY: return "(" + print_hir_args(expr, " " + expr->text + " ", bound) + ")";
+	case HIR_CAST: return "cast<" + expr->text + ">(" + print_hir_expr(expr->args[0], bound) + ")";
+	case HIR_MASK: return "(" + print_hir_expr(expr->args[0], bound) + " & " + to_string(expr->value) + ")";
+	case HIR_SHIFT: return "(" + print_hir_expr(expr->args[0], bound) + " >> " + to_string(expr->value) + ")";
+	case HIR_CALL: return expr->text + "(" + print_hir_args(expr, ",", bound) + ")";
+	case HIR_ACCESS: return expr->text + "(" + print_hir_args(expr, ",", bound) + ")";
+	case HIR_NOT: return "!(" + print_hir_expr(expr->args[0], bound) + ")";
+	case HIR_AND: return "(" + print_hir_args(expr, " && ", bound) + ")";
+	case HIR_SELECT: return "select(" + print_hir_args(expr, ",", bound) + ")";
+	case HIR_CLAMP: return "clamp(" + print_hir_args(expr, ",", bound) + ")";
+	}
+
+	ASSERT_MSG(false, ("ERROR: unknown Halide IR node\n"));
+	return "";
+
+}
+
+/* number of distinct parents of each node reachable from expr; nodes are listed args first */
+static void count_hir_uses(hir_expr_t * expr, map<hir_expr_t *, uint32_t> &uses, vector<hir_expr_t *> &order){
+
+	for (int i = 0; i < expr->args.size(); i++){
+		hir_expr_t * arg = expr->args[i];
+		if (find(expr->args.begin(), expr->args.begin() + i, arg) != expr->args.begin() + i) continue;
+		if (uses[arg]++ == 0){
+			count_hir_uses(arg, uses, order);
+		}
+	}
+	order.push_back(expr);
+
+}
+
+/* lhs = expr; with the compound subexpressions used more than once bound to Exprs named <prefix><n> */
+string print_hir_definition(string lhs, hir_expr_t * expr, string prefix){
+
+	map<hir_expr_t *, uint32_t> uses;
+	vector<hir_expr_t *> order;
+	count_hir_uses(expr, uses, order);
+
+	string ret = "";
+	map<hir_expr_t *, string> bound;
+	uint32_t count = 0;
+
+	for (int i = 0; i < order.size(); i++){
+		hir_expr_t * sub = order[i];
+		if (sub == expr || sub->kind == HIR_LEAF || uses[sub] < 2) continue;
+		string name = prefix + to_string(count++);
+		ret += "Expr " + name + " = " + print_hir_expr(sub, bound) + ";\n";
+		bound[sub] = name;
+	}
+
+	ret += lhs + " = " + print_hir_expr(expr, bound) + ";\n";
+	return ret;
+
+}
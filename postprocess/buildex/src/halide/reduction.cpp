@@ -0,0 +1,218 @@
+#include "halide/reduction.h"
+#include "analysis/x86_analysis.h"
+#include "utility/defines.h"
+
+using namespace std;
+
+/* internal update shapes; only the RED_* values leave this file */
+#define UPDATE_IDENTITY		100		/* out = out */
+#define UPDATE_OVERWRITE	101		/* out = e, e does not read out */
+
+static bool is_buffer_node(Abs_Node * node){
+	return node->type == Abs_Node::INPUT_NODE || node->type == Abs_Node::OUTPUT_NODE || node->type == Abs_Node::INTERMEDIATE_NODE;
+}
+
+static bool is_self_read(Node * nnode, Abs_Node * head){
+
+	Abs_Node * node = static_cast<Abs_Node *>(nnode);
+	if (node == head || !is_buffer_node(node)) return false;
+	return node->mem_info.associated_mem == head->mem_info.associated_mem;
+
+}
+
+/* same buffer element - the dimensions and the abstracted index coefficients agree */
+static bool same_location(Abs_Node * a, Abs_Node * b){
+
+	if (a->mem_info.associated_mem != b->mem_info.associated_mem) return false;
+	if (a->mem_info.dimensions != b->mem_info.dimensions || a->mem_info.head_dimensions != b->mem_info.head_dimensions) return false;
+	if (a->mem_info.indexes == NULL || b->mem_info.indexes == NULL) return a->mem_info.indexes == b->mem_info.indexes;
+	for (int i = 0; i < a->mem_info.dimensions; i++){
+		for (int j = 0; j < a->mem_info.head_dimensions + 1; j++){
+			if (a->mem_info.indexes[i][j] != b->mem_info.indexes[i][j]) return false;
+		}
+	}
+	return true;
+
+}
+
+/* a read of the element the head writes; a read of another element of the buffer (a scan) is order dependent */
+static bool is_old_value(Node * node, Abs_Node * head){
+	return is_self_read(node, head) && same_location(static_cast<Abs_Node *>(node), head);
+}
+
+static Abs_Node * search_self_read(Node * node, Abs_Node * head){
+
+	if (is_self_read(node, head)) return static_cast<Abs_Node *>(node);
+	for (int i = 0; i < node->srcs.size(); i++){
+		Abs_Node * found = search_self_read(node->srcs[i], head);
+		if (found != NULL) return found;
+	}
+	return NULL;
+
+}
+
+/* a node other than the head reading the buffer the head writes; NULL if the tree is not self dependent */
+Abs_Node * find_self_read(Abs_Tree * tree){
+
+	Abs_Node * head = static_cast<Abs_Node *>(tree->get_head());
+	for (int i = 0; i < head->srcs.size(); i++){
+		if (head->srcs[i]->operation == op_indirect) continue; /* the location written, not a read */
+		Abs_Node * found = search_self_read(head->srcs[i], head);
+		if (found != NULL) return found;
+	}
+	return NULL;
+
+}
+
+/* structural equality - the compared value of a min / max has to be the stored one */
+static bool same_abs_tree(Node * first, Node * second){
+
+	Abs_Node * a = static_cast<Abs_Node *>(first);
+	Abs_Node * b = static_cast<Abs_Node *>(second);
+
+	if (a->type != b->type || a->operation != b->operation || a->minus != b->minus) return false;
+	if (a->srcs.size() != b->srcs.size()) return false;
+	if (is_buffer_node(a) && !same_location(a, b)) return false;
+	if (a->type == Abs_Node::IMMEDIATE_INT && a->symbol->value != b->symbol->value) return false;
+	if (a->type == Abs_Node::IMMEDIATE_FLOAT && a->symbol->float_value != b->symbol->float_value) return false;
+	if (a->type == Abs_Node::PARAMETER && a->para_num != b->para_num) return false;
+
+	for (int i = 0; i < a->srcs.size(); i++){
+		if (!same_abs_tree(a->srcs[i], b->srcs[i])) return false;
+	}
+	return true;
+
+}
+
+/* operation combining the operands into the stored value (the indirect location of the head is not an operand) */
+static uint32_t get_update_operands(Abs_Node * head, vector<Node *> &operands){
+
+	operands.clear();
+	vector<Node *> srcs;
+	for (int i = 0; i < head->srcs.size(); i++){
+		if (head->srcs[i]->operation != op_indirect) srcs.push_back(head->srcs[i]);
+	}
+
+	if (head->operation != op_assign){
+		operands = srcs;
+		return head->operation;
+	}
+	if (srcs.size() != 1) return op_unknown;
+
+	Abs_Node * value = static_cast<Abs_Node *>(srcs[0]);
+	if (value->type == Abs_Node::OPERATION_ONLY && !value->minus){
+		operands = value->srcs;
+		return value->operation;
+	}
+	operands.push_back(value);
+	return op_assign;
+
+}
+
+static uint32_t classify_update(Abs_Tree * tree, Node ** stored){
+
+	Abs_Node * head = static_cast<Abs_Node *>(tree->get_head());
+	vector<Node *> operands;
+	uint32_t operation = get_update_operands(head, operands);
+
+	/* exactly one operand is the old value and nothing else reads the buffer */
+	int32_t self = -1;
+	for (int i = 0; i < operands.size(); i++){
+		if (is_old_value(operands[i], head) && !operands[i]->minus){
+			if (self != -1) return RED_NONE;
+			self = i;
+		}
+		else if (search_self_read(operands[i], head) != NULL){
+			return RED_NONE;
+		}
+	}
+
+	if (operation == op_assign){
+		*stored = operands[0];
+		return (self == 0) ? UPDATE_IDENTITY : UPDATE_OVERWRITE;
+	}
+	if (self == -1) return RED_NONE;
+
+	switch (operation){
+	case op_add:
+		if (operands.size() == 2){
+			Abs_Node * other = static_cast<Abs_Node *>(operands[1 - self]);
+			if (other->type == Abs_Node::IMMEDIATE_INT && other->symbol->value == 1 && !other->minus) return RED_COUNT;
+		}
+		return RED_SUM;
+	case op_sub: return (self == 0) ? RED_SUM : RED_NONE;
+	case op_mul: return RED_PRODUCT;
+	case op_and:
+	case op_or:
+	case op_xor: return RED_BITWISE;
+	default: return RED_NONE;
+	}
+
+}
+
+/* out = e under (out < e) is a max; the comparison may be either way round and the branch the negation */
+static uint32_t classify_min_max(Abs_Tree * tree, Node * stored){
+
+	if (tree->conditional_trees.size() != 1) return RED_NONE;
+
+	Abs_Node * head = static_cast<Abs_Node *>(tree->get_head());
+	Abs_Node * cond_head = static_cast<Abs_Node *>(tree->conditional_trees[0].first->get_head());
+	if (cond_head->srcs.size() != 1) return RED_NONE;
+	Node * cond = cond_head->srcs[0];
+	if (cond->srcs.size() != 2) return RED_NONE;
+
+	bool less;
+	if (cond->operation == op_lt || cond->operation == op_le) less = true;
+	else if (cond->operation == op_gt || cond->operation == op_ge) less = false;
+	else return RED_NONE;
+
+	if (!tree->conditional_trees[0].second) less = !less;
+
+	/* normalize to (value <cmp> out) */
+	if (is_old_value(cond->srcs[0], head) && same_abs_tree(cond->srcs[1], stored)) less = !less;
+	else if (!(is_old_value(cond->srcs[1], head) && same_abs_tree(cond->srcs[0], stored))) return RED_NONE;
+
+	return less ? RED_MIN : RED_MAX;
+
+}
+
+/* the branches of one update definition (same reduction domain) */
+uint32_t classify_reduction(vector<Abs_Tree *> trees){
+
+	if (trees.size() == 1){
+		Node * stored = NULL;
+		uint32_t update = classify_update(trees[0], &stored);
+		if (trees[0]->conditional_trees.size() > 0) return RED_NONE;
+		return (update == UPDATE_IDENTITY || update == UPDATE_OVERWRITE) ? RED_NONE : update;
+	}
+
+	if (trees.size() == 2){
+		Node * stored[2] = { NULL, NULL };
+		uint32_t updates[2];
+		for (int i = 0; i < 2; i++){
+			updates[i] = classify_update(trees[i], &stored[i]);
+		}
+		for (int i = 0; i < 2; i++){
+			if (updates[i] == UPDATE_OVERWRITE && updates[1 - i] == UPDATE_IDENTITY){
+				return classify_min_max(trees[i], stored[i]);
+			}
+		}
+	}
+
+	return RED_NONE;
+
+}
+
+string reduction_name(uint32_t update){
+
+	switch (update){
+	case RED_SUM: return "sum";
+	case RED_COUNT: return "count";
+	case RED_PRODUCT: return "product";
+	case RED_BITWISE: return "bitwise";
+	case RED_MIN: return "min";
+	case RED_MAX: return "max";
+	default: return "ordered";
+	}
+
+}
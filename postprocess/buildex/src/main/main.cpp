@@ -1,7 +1,6 @@
  //main application - read a instrace in a file and then build an expression tree
  //you need to choose where to start and end the trace and other criteria in this file's implementation.
 
-#include <Windows.h>
 #include <stdio.h>
 #include <iostream>
 #include <vector>
@@ -14,15 +13,17 @@
 #include <assert.h>
 #include <algorithm>
 
-#include  "..\..\..\dr_clients\include\output.h"
-#include "utility\fileparser.h"
-#include "utility\defines.h"
+#include  "../../../dr_clients/include/output.h"
+#include "utility/fileparser.h"
+#include "utility/defines.h"
+#include "utility/metrics.h"
+#include "utility/workers.h"
 
-#include "analysis\tree_analysis.h"
-#include "analysis\staticinfo.h"
-#include "analysis\preprocess.h"
-#include "analysis\conditional_analysis.h"
-#include "analysis\indirection_analysis.h"
+#include "analysis/tree_analysis.h"
+#include "analysis/staticinfo.h"
+#include "analysis/preprocess.h"
+#include "analysis/conditional_analysis.h"
+#include "analysis/indirection_analysis.h"
 
 #include "memory/memregions.h"
 #include "memory/memdump.h"
@@ -30,6 +31,7 @@
 #include "memory/memanalysis.h"
 
 #include "halide/halide.h"
+#include "halide/binding.h"
 
 #include "utilities.h"
 #include "meminfo.h"
@@ -40,9 +42,9 @@
 
  bool debug = true;
  uint32_t debug_level = 2;
- ofstream log_file;
+ thread_local ofstream log_file;
 
- uint32_t Tree::num_paras = 0;
+ thread_local uint32_t Tree::num_paras = 0;
 
 
  bool conctree_opt = true;
@@ -70,7 +72,7 @@
 	 printf("\t debug_level - the level of debugging (higher means more debug info) \n");
 	 
 	 printf("\t seed - the seed to select the random memory point\n");
-	 printf("\t tree_build - the tree building method \"random - 1\",\"random set - 2\",\"similar - 3\",\"clustered - 4\"\n");
+	 printf("\t tree_build - the tree building method \"random - 1\",\"random set - 2\",\"similar - 3\",\"clustered - 4\",\"adaptive clustered - 5\"\n");
 	 printf("\t mode - the mode in which this tool is running mem_info_stage, tree_build_stage, abstraction_stage, halide_output_stage\n");
  
 	 printf("\t dump - whether the application memory dump should be used\n");
@@ -87,6 +89,14 @@
 	 printf("\t abstree_opt - turn on abstract tree optimizations\n");
 	 printf("\t conctree_opt - turn on conc tree optimizations\n");
 	 printf("\t debug_tree - whether printing all the trees are enabled\n");
+	 printf("\t confidence - adaptive tree building stops after this many locations without a new cluster\n");
+	 printf("\t schedule - schedule of the emitted Halide program \"none - 0\",\"parallel - 1\",\"tiled - 2\",\"tunable - 3\"\n");
+	 printf("\t link - linking of the memory regions into dimensions \"greedy - 1\",\"dynamic programming - 2\"\n");
+	 printf("\t parallel - lift each captured function on its own, on this many threads (0 - all functions together)\n");
+	 printf("\t metrics - file to which stage timings and counters are written as json at exit\n");
+
+	 printf("buildex does not build the emitted Halide programs, so it gives no PASS/FAIL verdict itself - run the lift with\n");
+	 printf("utility/automation_all.py --halide <Halide folder> or check each program with utility/validate.py\n");
 
  }
 
@@ -95,6 +105,7 @@
 #define BUILD_RANDOM_SET	2
 #define	BUILD_SIMILAR		3
 #define BUILD_CLUSTERS		4
+#define BUILD_ADAPTIVE		5
 
 
  /* stage to stop */
@@ -112,6 +123,338 @@
 
 
 
+
+ /* a lifting of the tree building, abstraction and halide stages - of all the captured functions together or, with
+    -parallel, of a single one. the regions are the job's own copies as these stages write to them (dummy regions,
+    trees_direction); static info and the memory layout are shared and only read */
+ struct lift_job_t {
+	 vector<uint32_t> start_pcs;
+	 vec_cinstr instrs_forward;
+	 vec_cinstr instrs_backward;
+	 vector<mem_regions_t *> image_regions;
+	 vector<mem_regions_t *> total_mem_regions;
+	 string dot_folder;		/* folder of the tree dot files */
+	 string dot_prefix;		/* dot_folder + file prefix */
+	 string halide_prefix;	/* halide program, binding manifest and lifted library */
+	 string dump_folder;		/* dump.h and the raw validation buffers */
+	 string log_filename;	/* empty - the log of the calling thread */
+ };
+
+ /* the options of main used by the lifting; common to all the jobs */
+ struct lift_config_t {
+	 uint32_t tree_build;
+	 uint32_t mode;
+	 int32_t start_trace;
+	 int32_t end_trace;
+	 uint64_t dest;
+	 uint32_t stride;
+	 uint32_t seed;
+	 uint32_t skip;
+	 uint32_t no_trees;
+	 uint32_t confidence;
+	 uint32_t schedule;
+	 vector<pc_mem_region_t *> * pc_mem_info;
+	 vector<Func_Info_t *> * func_replacements;
+	 vec_cinstr * instrs_unfiltered;
+	 vector<string> memdump_files;
+ };
+
+ /* the stages of lifting one function; the tree build and abstraction modes stop after their stage */
+ void lift_function_stages(lift_job_t * job, lift_config_t * config){
+
+	 vector<uint32_t> &start_pcs = job->start_pcs;
+	 vec_cinstr &instrs_forward = job->instrs_forward;
+	 vec_cinstr &instrs_backward = job->instrs_backward;
+	 vector<mem_regions_t *> &image_regions = job->image_regions;
+	 vector<mem_regions_t *> &total_mem_regions = job->total_mem_regions;
+	 vector<pc_mem_region_t *> &pc_mem_info = *config->pc_mem_info;
+	 vector<Func_Info_t *> &func_replacements = *config->func_replacements;
+
+	 uint32_t tree_build = config->tree_build;
+	 int32_t start_trace = config->start_trace;
+	 int32_t end_trace = config->end_trace;
+	 uint64_t dest = config->dest;
+	 uint32_t stride = config->stride;
+	 uint32_t seed = config->seed;
+	 uint32_t skip = config->skip;
+	 uint32_t no_trees = config->no_trees;
+	 uint32_t confidence = config->confidence;
+
+	 /********************************* tree construction *******************************************************************/
+
+	 DEBUG_PRINT(("******************tree building********************************\n"), 2);
+	 METRIC_STAGE(tree_stage, "tree_building_stage");
+
+	 vector<Conc_Tree *> conc_trees;
+	 vector< vector< Conc_Tree *> > clustered_trees;
+	 cond_store_t cond_store; /* conditionals shared by the trees built here */
+
+	 /* capture the function start points if the end trace is not given specifically */
+	 vector<uint32_t> start_points;
+	 vector<uint32_t> start_points_forward;
+	 if (end_trace == FILE_ENDING){
+		 start_points = get_instrace_startpoints(instrs_backward, start_pcs);
+		 start_points_forward = get_instrace_startpoints(instrs_forward, start_pcs);
+		 DEBUG_PRINT(("no of funcs captured - %d\n start points : \n", start_points.size()), 1);
+		 for (int i = 0; i < start_points.size(); i++){
+			 DEBUG_PRINT(("%d-", start_points[i]), 1);
+		 }
+		 DEBUG_PRINT(("\n"), 1);
+	 }
+
+
+	 if (tree_build == BUILD_RANDOM){
+
+		 uint64_t farthest = get_farthest_mem_access_point(total_mem_regions);
+
+		 if (start_trace == FILE_BEGINNING){
+			 mem_regions_t * random_mem_region = get_random_output_region(image_regions);
+			 uint64 mem_location = get_random_mem_location(random_mem_region, seed);
+			 DEBUG_PRINT(("random mem location we got - %llx\n", mem_location), 1);
+			 dest = mem_location;
+			 stride = random_mem_region->bytes_per_pixel;
+		 }
+		 else{
+			 /* else I assume that the stride and the dest are set properly */
+			 ASSERT_MSG((stride != 0 && dest != 0), ("ERROR: if the starting point is given please specify the dest and stride\n"));
+		 }
+		 DEBUG_PRINT(("func pc entry - %x\n", start_pcs[0]), 1);
+
+		 //Node * node = create_tree_for_dest(dest, stride, instrace_file, start_points, start_trace, end_trace, disasm)->get_head();
+		 Conc_Tree * tree = new Conc_Tree();
+		 Conc_Tree * initial = build_conc_tree(dest, stride, start_points, start_trace, end_trace, tree, instrs_backward, farthest, total_mem_regions, func_replacements);
+		 tree->print_conditionals();
+		 DEBUG_PRINT(("creating conditional trees\n"), 2);
+		 build_conc_trees_for_conditionals(start_points, tree, instrs_backward, farthest, total_mem_regions, func_replacements, &cond_store);
+		 for (int i = 0; i < tree->conditionals.size(); i++){
+			 conc_trees.push_back(tree->conditionals[i]->tree);
+		 }
+		 conc_trees.push_back(tree);
+		 if (initial != NULL){
+			 build_conc_trees_for_conditionals(start_points, initial, instrs_backward, farthest, total_mem_regions, func_replacements, &cond_store);
+			 conc_trees.push_back(initial);
+		 }
+
+	 }
+	 else if (tree_build == BUILD_RANDOM_SET){
+
+		 uint64_t farthest = get_farthest_mem_access_point(total_mem_regions);
+		 /*ok we need find a set of random locations */
+		 vector<uint64_t> nbd_locations = get_nbd_of_random_points(image_regions, seed, &stride);
+
+		 /* ok now build trees for the set of locations */
+		 for (int i = 0; i < nbd_locations.size(); i++){
+
+			 Conc_Tree * tree = new Conc_Tree();
+			 Conc_Tree * initial = build_conc_tree(nbd_locations[i], stride, start_points, FILE_BEGINNING, end_trace, tree, instrs_backward, farthest, total_mem_regions, func_replacements);
+			 build_conc_trees_for_conditionals(start_points, tree, instrs_backward, farthest, total_mem_regions, func_replacements, &cond_store);
+
+			 conc_trees.push_back(tree);
+			 if (initial != NULL){
+				 build_conc_trees_for_conditionals(start_points, initial, instrs_backward, farthest, total_mem_regions, func_replacements, &cond_store);
+				 conc_trees.push_back(initial);
+			 }
+		 }
+
+		 /* checking similarity of the trees and if not repeat?? */
+		 vector<vector<Conc_Tree *> > clustered_conc_trees = categorize_trees(conc_trees);
+		 ASSERT_MSG((clustered_conc_trees.size() == 1), ("ERROR: The trees should be similar\n"));
+
+	 }
+	 else if (tree_build == BUILD_SIMILAR){
+		 uint64_t farthest = get_farthest_mem_access_point(total_mem_regions);
+		 conc_trees = get_similar_trees(image_regions, total_mem_regions, seed, &stride, start_points, start_trace, end_trace, farthest, instrs_backward, func_replacements);
+	 }
+	 else if (tree_build == BUILD_CLUSTERS){
+		 uint64_t farthest = get_farthest_mem_access_point(total_mem_regions);
+		 clustered_trees = cluster_trees(image_regions, total_mem_regions, start_points, instrs_backward, farthest, job->dot_prefix, func_replacements);
+	 }
+	 else if (tree_build == BUILD_ADAPTIVE){
+		 uint64_t farthest = get_farthest_mem_access_point(total_mem_regions);
+		 /* abstract_the_trees strides through a cluster by at most skip + 10 trees */
+		 uint32_t max_cluster_trees = no_trees * (skip + 10) + 1;
+		 clustered_trees = cluster_trees_adaptive(image_regions, total_mem_regions, start_points, instrs_backward, farthest, job->dot_prefix, func_replacements, confidence, max_cluster_trees, seed);
+	 }
+
+
+	 /* number the trees - for all the conc trees built */
+	 if (tree_build == BUILD_CLUSTERS || tree_build == BUILD_ADAPTIVE){
+		 for (int i = 0; i < clustered_trees.size(); i++){
+			 for (int j = 0; j < clustered_trees[i].size(); j++){
+				 clustered_trees[i][j]->number_tree_nodes();
+			 }
+		 }
+		 DEBUG_PRINT(("numbering done\n"),2);
+
+	 }
+	 else{
+		 for (int i = 0; i < conc_trees.size(); i++){
+			 conc_trees[i]->number_tree_nodes();
+			 DEBUG_PRINT(("number of nodes : %d\n",conc_trees[i]->num_nodes),2);
+		 }
+	 }
+
+
+
+	 /* debug printing - need to change the branches */
+	 if (clustered_trees.size() > 0){
+		 for (int i = 0; i < clustered_trees.size(); i++){
+			 DEBUG_PRINT(("cluster - %d, size - %d\n",i, clustered_trees[i].size()), 2);
+			 DEBUG_PRINT(("printing to dot file...\n"), 2);
+			 ofstream conc_file(job->dot_prefix + "_conctree_" + to_string(i) + ".dot", ofstream::out);
+			 clustered_trees[i][0]->print_dot(conc_file, "conc", i);
+			 DEBUG_PRINT(("conditionals: %d\n", clustered_trees[i][0]->conditionals.size()),2);
+		 }
+	 }
+	 else{
+		 for (int i = 0; i < conc_trees.size(); i++){
+
+			 /* Expression printing */
+			 DEBUG_PRINT(("printing out the expression\n"), 2);
+			 ofstream expression_file(job->dot_prefix + "_expression_" + to_string(i) + ".txt", ofstream::out);
+
+			 DEBUG_PRINT(("printing to dot file...\n"), 2);
+			 ofstream conc_file(job->dot_prefix + "_conctree_" + to_string(i) + ".dot", ofstream::out);
+			 conc_trees[i]->print_dot(conc_file, "conc", i);
+
+		 }
+	 }
+
+	 tree_stage.end();
+
+	 if (config->mode == TREE_BUILD_STAGE){
+		 return;
+	 }
+
+
+	 /***************************************ABSTRACTION*********************************************************/
+
+	 METRIC_STAGE(abs_stage, "abstraction_stage");
+	 vector<Abs_Tree_Charac *> abs_trees;
+	 Abs_Tree * final_abs_tree;
+
+
+	 if (clustered_trees.size() > 0){
+		 abs_trees = build_abs_trees(clustered_trees, job->dot_folder, no_trees, total_mem_regions, skip, pc_mem_info);
+		 DEBUG_PRINT(("building abstract trees done"), 2);
+	 }
+	 else if (conc_trees.size() > 0){
+		vector<Abs_Tree *> abs_trees;
+		for (int i = 0; i < conc_trees.size(); i++){
+			Abs_Tree * abs_tree = new Abs_Tree();
+			abs_tree->build_abs_tree_unrolled(conc_trees[i], total_mem_regions);
+			abs_tree->number_tree_nodes();
+			abs_trees.push_back(abs_tree);
+		}
+
+
+		/* debug printing */
+		if (debug_tree){
+			for (int i = 0; i < abs_trees.size(); i++){
+				ofstream abs_file(job->dot_prefix + "_abstree_" + to_string(i) + ".dot", ofstream::out);
+				abs_trees[i]->print_dot(abs_file, "abs", i);
+			}
+		}
+
+		Comp_Abs_Tree * comp_tree = new Comp_Abs_Tree();
+		comp_tree->build_compound_tree_unrolled(abs_trees);
+		comp_tree->number_tree_nodes();
+		ofstream comp_file(job->dot_prefix + "_comp_tree.dot", ofstream::out);
+		comp_tree->print_dot(comp_file, "comp", 0);
+		comp_tree->abstract_buffer_indexes();
+		final_abs_tree = comp_tree->compound_to_abs_tree();
+
+		ofstream alg_file(job->dot_prefix + "_algebraic.dot", ofstream::out);
+		uint32_t max_dimensions = final_abs_tree->get_maximum_dimensions();
+		final_abs_tree->print_dot_algebraic(alg_file, "alg", 0, get_vars("x", max_dimensions));
+
+	}
+	 
+
+	 DEBUG_PRINT(("******************tree building done********************************\n"), 2);
+
+	 abs_stage.end();
+
+	 if (config->mode == ABSTRACTION_STAGE){
+		 return;
+	 }
+
+
+	 /**************************************HALIDE OUTPUT + ALGEBRIC FILTERS********************************************************/
+
+	 DEBUG_PRINT(("******************Halide population********************************\n"), 2);
+	 METRIC_STAGE(halide_stage, "halide_stage");
+
+	 Halide_Program * halide = new Halide_Program(); 
+
+	 if (abs_trees.size() == 0){
+		 halide->populate_pure_funcs(final_abs_tree);
+	 }
+	 else{
+		 DEBUG_PRINT(("halide population...\n"), 2);
+		 for (int i = 0; i < abs_trees.size(); i++){
+			 if (abs_trees[i]->is_recursive){
+				 DEBUG_PRINT(("red func populated\n"), 2);
+				 halide->populate_red_funcs(abs_trees[i]->tree, abs_trees[i]->extents, abs_trees[i]->red_node);
+			 }
+			 else{
+				 DEBUG_PRINT(("pure func populated\n"), 2);
+				 halide->populate_pure_funcs(abs_trees[i]->tree); 
+			 }
+		 }
+	 }
+
+	 halide->resolve_conditionals();
+	 halide->populate_vars(4);
+	 halide->populate_input_params();
+	 halide->populate_params();
+	 halide->schedule = config->schedule;
+
+	 vector<string> red_variables;
+	 ofstream halide_file(job->halide_prefix + "_halide.cpp", ofstream::out);
+	 halide->print_halide_program(halide_file, red_variables);
+
+	 /* manifest for the funcreplace client to run the AOT compiled pipelines (linked into <name>_lifted) in place of the function */
+	 ofstream binding_file(job->halide_prefix + "_binding.txt", ofstream::out);
+#ifdef _WIN32
+	 string lifted_library = job->halide_prefix + "_lifted.dll";
+#else
+	 string lifted_library = job->halide_prefix + "_lifted.so";
+#endif
+	 print_binding_manifest(binding_file, halide, *config->instrs_unfiltered, instrs_forward, lifted_library);
+
+	 halide_stage.end();
+	 DEBUG_PRINT(("******************Halide population done********************************\n"), 2);
+
+	 /* dumping memory values to files for debugging lifted halide filters - should be done separately */
+	 halide->get_memory_regions(config->memdump_files, job->dump_folder);
+
+	 /* where utility/validate.py finds the raw buffers of this program; buildex does not compile Halide itself, the
+	    lift driver (automation_all.py --halide) validates every program with them */
+	 ofstream dumps_file(job->halide_prefix + "_dumps.txt", ofstream::out);
+	 dumps_file << job->dump_folder << endl;
+	 DEBUG_PRINT(("raw buffers for validation are in %s - check the lift with utility/validate.py\n", job->dump_folder.c_str()), 1);
+
+ }
+
+ void lift_function(lift_job_t * job, lift_config_t * config){
+
+	 /* a worker runs several jobs - the parameter numbering and the log of the thread start afresh for each */
+	 Tree::num_paras = 0;
+
+	 bool job_log = debug && !job->log_filename.empty();
+	 if (job_log){
+		 log_file.open(job->log_filename, ofstream::out);
+	 }
+
+	 lift_function_stages(job, config);
+
+	 if (job_log){
+		 log_file.close();
+	 }
+
+ }
+
  int main(int argc, char ** argv){
 
 	 /* setting up the files and other inputs and outputs for the program */
@@ -129,8 +472,6 @@
 	 uint32_t stride = 0;
 	 
 	 int32_t thread_id = -1;
-	 uint32_t start_pc = 0; /* start pc of the function */
-	 uint32_t end_pc = 0; /* end pc of the function */
 	 uint32_t seed = 50;
 
 	 uint32_t tree_build = BUILD_CLUSTERS;
@@ -146,6 +487,10 @@
 	 uint32_t no_trees = 4;
 
 	 uint32_t anaopt = ALL_ANALYSIS;
+	 uint32_t confidence = 64;
+	 uint32_t schedule = SCHEDULE_NONE;
+	 uint32_t threads = 0;
+	 uint32_t link = GREEDY;
 
 
 	 /***************************** command line args processing ************************/
@@ -240,6 +585,21 @@
 		 else if (args[i]->name.compare("-debug_tree") == 0){
 			 debug_tree = atoi(args[i]->value.c_str());
 		 }
+		 else if (args[i]->name.compare("-confidence") == 0){
+			 confidence = atoi(args[i]->value.c_str());
+		 }
+		 else if (args[i]->name.compare("-schedule") == 0){
+			 schedule = atoi(args[i]->value.c_str());
+		 }
+		 else if (args[i]->name.compare("-link") == 0){
+			 link = atoi(args[i]->value.c_str());
+		 }
+		 else if (args[i]->name.compare("-parallel") == 0){
+			 threads = atoi(args[i]->value.c_str());
+		 }
+		 else if (args[i]->name.compare("-metrics") == 0){
+			 init_metrics(args[i]->value.c_str());
+		 }
 		 
 		 else{
 			 ASSERT_MSG(false, ("ERROR: unknown option\n"));
@@ -249,6 +609,7 @@
 
 	 ASSERT_MSG((start_pcs.size() == end_pcs.size()), ("ERROR: start and end pcs sizes should match\n"));
 	 ASSERT_MSG(!exec.empty(), ("exec must be specified\n"));
+	 ASSERT_MSG((schedule <= SCHEDULE_TUNABLE), ("ERROR: unknown schedule %u - expected 0 to 3\n", schedule));
 	 ASSERT_MSG((!in_image.empty()) && (!out_image.empty()), ("image must be specified\n"));
 
 	 /********************************open the files************************************/
@@ -275,20 +636,19 @@
 
 
 	 if (thread_id != -1){ /* here we can get a specific instrace file*/
-		 instrace_filename = get_standard_folder("output") + "\\instrace_" + exec + "_" + to_string(thread_id) + ".log";
+		 instrace_filename = join_path(get_standard_folder("output"), "instrace_" + exec + "_" + to_string(thread_id) + ".log");
 		 instrace_file.open(instrace_filename, ifstream::in);
 	 }
 	 else{ /* get the instrace file with the largest size */
-		 struct _stat buf;
 		 int64_t max_size = -1;
 		 /* get the instrace files for this exec */
 		 for (int i = 0; i < files.size(); i++){
 			 if (is_prefix(files[i], "instrace_" + exec + "_" + in_image + "_instr")){
 				 /*open the file*/
-				 string file = output_folder + "\\" + files[i];
-				 _stat(file.c_str(), &buf);
-				 if (max_size < buf.st_size){
-					 max_size = buf.st_size;
+				 string file = join_path(output_folder, files[i]);
+				 int64_t size = get_file_size(file);
+				 if (max_size < size){
+					 max_size = size;
 					 instrace_filename = file;
 				 }
 
@@ -300,16 +660,15 @@
 	 ASSERT_MSG(instrace_file.good(), ("instrace file cannot be opened\n"));
 
 	 /* get the disasm file */
-	struct _stat buf;
 	int64_t max_size = -1;
 	/* get the instrace files for this exec */
 	for (int i = 0; i < files.size(); i++){
 		if (is_prefix(files[i], "instrace_" + exec + "_" + in_image + "_asm_instr")){
 			/*open the file*/
-			string file = output_folder + "\\" + files[i];
-			_stat(file.c_str(), &buf);
-			if (max_size < buf.st_size){
-				max_size = buf.st_size;
+			string file = join_path(output_folder, files[i]);
+			int64_t size = get_file_size(file);
+			if (max_size < size){
+				max_size = size;
 				disasm_filename = file;
 			}
 
@@ -323,40 +682,35 @@
 	/* populate the memory dump filenames */
 	 for (int i = 0; i < files.size(); i++){
 		 if (is_prefix(files[i], "memdump_" + exec)){
-			 memdump_files.push_back(output_folder + "\\" + files[i]);
+			 memdump_files.push_back(join_path(output_folder, files[i]));
 		 }
 	 }
 
 	 /* get the images */
-	 in_image_filename = get_standard_folder("image") + "\\" + in_image;
-	 out_image_filename = get_standard_folder("image") + "\\" + out_image;
+	 in_image_filename = join_path(get_standard_folder("image"), in_image);
+	 out_image_filename = join_path(get_standard_folder("image"), out_image);
 
 	 /* get the app_pcs to track files */
-	 app_pc_filename = filter_folder + "\\filter_" + exec + "_app_pc.log";
+	 app_pc_filename = join_path(filter_folder, "filter_" + exec + "_app_pc.log");
 	 app_pc_file.open(app_pc_filename, ifstream::in);
 
 	 /* get the image mem config files - these have common configs for a given image processing program like Photoshop (hardcoded)  */
-	 config_filename = filter_folder + "\\config_" + config + ".log";
+	 config_filename = join_path(filter_folder, "config_" + config + ".log");
 	 config_file.open(config_filename, ifstream::in);
 
-	 /* outputs */
-	 ofstream halide_file;
-
 	 /*check whether process name has .exe or not*/
 	 size_t find = process_name.find(".exe");
 	 if (find != string::npos){
 		 process_name = process_name.substr(0, find);
 	 }
 
-	 string file_substr("\\" + process_name + "_" + exec);
+	 string file_substr(PATH_SEPARATOR + process_name + "_" + exec);
 
 	 if (debug){
 		 /* get the log file */
 		 log_file.open(get_standard_folder("log") + file_substr + ".log", ofstream::out);
 	 }
 
-	 halide_file.open(get_standard_folder("halide") + file_substr + "_halide.cpp", ofstream::out);
-
 	 /* debugging printfs */
 
 	 DEBUG_PRINT(("instrace file - %s\n", instrace_filename.c_str()), 3);
@@ -379,6 +733,7 @@
 	 */
 
 	 DEBUG_PRINT(("****************start mem info stage******************\n"), 2);
+	 METRIC_STAGE(mem_info_stage, "mem_info_stage");
 
 	 ULONG_PTR token = initialize_image_subsystem();
 
@@ -390,7 +745,7 @@
 	 if (dump){
 		 dump_regions = get_image_regions_from_dump(memdump_files, in_image_filename, out_image_filename);
 		 LOG(log_file, "*************** dump regions ***********" << endl);
-		 print_mem_regions(log_file, dump_regions);
+		 if (debug) print_mem_regions(log_file, dump_regions);
 	 }
 	 
 
@@ -412,14 +767,22 @@
 	 }
 
 	 sort_mem_info(mem_info);
-	 link_mem_regions_greedy_dim(mem_info, 0);
+	 if (link == DYNAMIC_PROG){
+		 link_mem_regions_dp_dim(mem_info, 0);
+	 }
+	 else{
+		 link_mem_regions_greedy_dim(mem_info, 0);
+	 }
 	 //link_mem_regions(pc_mem_info, GREEDY);
 	 
-	 DEBUG_PRINT(("printing pc mems and mem info to log file\n"), 2);
-	 LOG(log_file, "*********** pc_mem_info *************" << endl);
-	 print_mem_layout(log_file, pc_mem_info);
-	 LOG(log_file, "*********** mem_info *************" << endl);
-	 print_mem_layout(log_file, mem_info);
+	 /* the layouts are large; only walk them when they actually go to the log */
+	 if (debug){
+		 DEBUG_PRINT(("printing pc mems and mem info to log file\n"), 2);
+		 LOG(log_file, "*********** pc_mem_info *************" << endl);
+		 print_mem_layout(log_file, pc_mem_info);
+		 LOG(log_file, "*********** mem_info *************" << endl);
+		 print_mem_layout(log_file, mem_info);
+	 }
 	 
 	 vector<vector<mem_info_t *> > mergable = get_merge_opportunities(mem_info, pc_mem_info);
 	 merge_mem_regions_pc(mergable, mem_info);
@@ -440,14 +803,16 @@
 
 	 DEBUG_PRINT(("*******************end of mem info stage*********************\n"), 2);
 
-	 vector<mem_info_t *> mems_temp = mem_info;
-	 sort(mems_temp.begin(), mems_temp.end(), [](mem_info_t * first, mem_info_t * second)->bool{
-		 return (first->end - first->start) > (second->end - second->start);
-	 });
-	 log_file << "******************new*******************************" << endl;
-	 print_mem_layout(log_file, mems_temp);
-
+	 if (debug){
+		 vector<mem_info_t *> mems_temp = mem_info;
+		 sort(mems_temp.begin(), mems_temp.end(), [](mem_info_t * first, mem_info_t * second)->bool{
+			 return (first->end - first->start) > (second->end - second->start);
+		 });
+		 log_file << "******************new*******************************" << endl;
+		 print_mem_layout(log_file, mems_temp);
+	 }
 
+	 mem_info_stage.end();
 
 	 if (mode == MEM_INFO_STAGE){
 		 exit(0);
@@ -457,11 +822,12 @@
 	 /******************************gathering instruction trace********************************/
 
 	 DEBUG_PRINT(("*******************instruction gathering/preprocessing stage*********************\n"), 2);
+	 METRIC_STAGE(instr_stage, "instruction_gathering_stage");
 
 	 /* disassembly of instructions acquired */
 	 vector<Static_Info *> static_info;
 	 Static_Info * first = parse_debug_disasm(static_info, disasm_file);
-	 print_disasm(static_info);
+	 if (debug) print_disasm(static_info);
 
 	 if (start_pcs.size() == 0){
 		 DEBUG_PRINT(("Estimating start and end locations of the function\n"), 2);
@@ -480,6 +846,9 @@
 	 vec_cinstr instrs_forward = filter_instr_trace(start_pcs, end_pcs, instrs_forward_unfiltered);
 
 
+	 /*preprocessing - registers to mem ranges and x87 stack slots in a single walk, before the backward copy is made*/
+	 update_floating_point_regs(instrs_forward, start_pcs, end_pcs);
+
 	 /* make a copy for the backwards analysis */
 	 vec_cinstr instrs_backward;
 	 for (int i = instrs_forward.size() - 1; i >= 0; i--){
@@ -489,20 +858,14 @@
 	 }
 	 DEBUG_PRINT(("number of dynamic instructions : %d\n", instrs_backward.size()), 2);
 
-	 /*preprocessing*/
-	 DEBUG_PRINT(("for both forward and backward instr traces\n"), 2);
-	 update_regs_to_mem_range(instrs_backward);
-	 update_regs_to_mem_range(instrs_forward);
-
-	 update_floating_point_regs(instrs_backward, BACKWARD_ANALYSIS, static_info, start_pcs);
-	 update_floating_point_regs(instrs_forward, FORWARD_ANALYSIS, static_info, start_pcs);
-
+	 instr_stage.end();
 	 DEBUG_PRINT(("*******************end of instruction gathering/preprocessing stage*********************\n"), 2);
 
 	 /*******************************************more memory and input/output selection********************************************************/
 	 
 
 	 DEBUG_PRINT(("******************memory input and output selection********************************\n"), 2);
+	 METRIC_STAGE(mem_select_stage, "memory_selection_stage");
 
 	 vector<uint32_t> candidate_ins;
 	 vector<uint32_t> start_points_mem;
@@ -534,7 +897,7 @@
 		 }
 		 input_regions = get_input_regions(total_mem_regions, pc_mem_info, start_points_mem, instrs_forward);
 		 LOG(log_file," input regions " << endl);
-		 print_mem_regions(log_file, input_regions);
+		 if (debug) print_mem_regions(log_file, input_regions);
 		 LOG(log_file,"input done " << endl);
 	 }
 	 else{
@@ -549,16 +912,20 @@
 	 DEBUG_PRINT(("-------output -----\n"), 2);
 	 print_mem_regions(cout,output_mem_region);
 
-	 LOG(log_file, "image regions ----->" << endl);
-	 print_mem_regions(log_file,image_regions);
-	 LOG(log_file, "total memory regions ----->" << endl);
-	 print_mem_regions(log_file,total_mem_regions);
+	 if (debug){
+		 LOG(log_file, "image regions ----->" << endl);
+		 print_mem_regions(log_file, image_regions);
+		 LOG(log_file, "total memory regions ----->" << endl);
+		 print_mem_regions(log_file, total_mem_regions);
+	 }
 
+	 mem_select_stage.end();
 	 DEBUG_PRINT(("******************memory input and output selection done********************************\n"), 2);
 
 	 /**************************** forward analysis for conditionals, indirection *************************************************************/
 	 
 	 DEBUG_PRINT(("******************forward analysis********************************\n"), 2);
+	 METRIC_STAGE(forward_stage, "forward_analysis_stage");
 
 
 	 vector<uint32_t> app_pc;
@@ -650,6 +1017,7 @@
 	 vector<Func_Info_t *> func_replacements;
 	 populate_standard_funcs(func_replacements);
 
+	 forward_stage.end();
 	 DEBUG_PRINT(("******************forward analysis done********************************\n"), 2);
 
 
@@ -659,226 +1027,87 @@
 
 
 
-	 /********************************* tree construction *******************************************************************/
-
-	 DEBUG_PRINT(("******************tree building********************************\n"), 2);
-
-	 vector<Conc_Tree *> conc_trees;
-	 vector< vector< Conc_Tree *> > clustered_trees;
-
-	 /* capture the function start points if the end trace is not given specifically */
-	 vector<uint32_t> start_points;
-	 vector<uint32_t> start_points_forward;
-	 if (end_trace == FILE_ENDING){
-		 start_points = get_instrace_startpoints(instrs_backward, start_pcs);
-		 start_points_forward = get_instrace_startpoints(instrs_forward, start_pcs);
-		 DEBUG_PRINT(("no of funcs captured - %d\n start points : \n", start_points.size()), 1);
-		 for (int i = 0; i < start_points.size(); i++){
-			 DEBUG_PRINT(("%d-", start_points[i]), 1);
-		 }
-		 DEBUG_PRINT(("\n"), 1);
-	 }
-
-
-	 if (tree_build == BUILD_RANDOM){
-
-		 uint64_t farthest = get_farthest_mem_access_point(total_mem_regions);
-
-		 if (start_trace == FILE_BEGINNING){
-			 mem_regions_t * random_mem_region = get_random_output_region(image_regions);
-			 uint64 mem_location = get_random_mem_location(random_mem_region, seed);
-			 DEBUG_PRINT(("random mem location we got - %llx\n", mem_location), 1);
-			 dest = mem_location;
-			 stride = random_mem_region->bytes_per_pixel;
-		 }
-		 else{
-			 /* else I assume that the stride and the dest are set properly */
-			 ASSERT_MSG((stride != 0 && dest != 0), ("ERROR: if the starting point is given please specify the dest and stride\n"));
-		 }
-		 DEBUG_PRINT(("func pc entry - %x\n", start_pc), 1);
-
-		 //Node * node = create_tree_for_dest(dest, stride, instrace_file, start_points, start_trace, end_trace, disasm)->get_head();
-		 Conc_Tree * tree = new Conc_Tree();
-		 Conc_Tree * initial = build_conc_tree(dest, stride, start_points, start_trace, end_trace, tree, instrs_backward, farthest, total_mem_regions, func_replacements);
-		 tree->print_conditionals();
-		 DEBUG_PRINT(("creating conditional trees\n"), 2);
-		 build_conc_trees_for_conditionals(start_points, tree, instrs_backward, farthest, total_mem_regions, func_replacements);
-		 for (int i = 0; i < tree->conditionals.size(); i++){
-			 conc_trees.push_back(tree->conditionals[i]->tree);
-		 }
-		 conc_trees.push_back(tree);
-		 if (initial != NULL){
-			 build_conc_trees_for_conditionals(start_points, initial, instrs_backward, farthest, total_mem_regions, func_replacements);
-			 conc_trees.push_back(initial);
-		 }
+	 /********************************* lifting - all the functions at once or each on its own ******************************/
+
+	 lift_config_t lift_config;
+	 lift_config.tree_build = tree_build;
+	 lift_config.mode = mode;
+	 lift_config.start_trace = start_trace;
+	 lift_config.end_trace = end_trace;
+	 lift_config.dest = dest;
+	 lift_config.stride = stride;
+	 lift_config.seed = seed;
+	 lift_config.skip = skip;
+	 lift_config.no_trees = no_trees;
+	 lift_config.confidence = confidence;
+	 lift_config.schedule = schedule;
+	 lift_config.pc_mem_info = &pc_mem_info;
+	 lift_config.func_replacements = &func_replacements;
+	 lift_config.instrs_unfiltered = &instrs_forward_unfiltered;
+	 lift_config.memdump_files = memdump_files;
+
+	 if (threads == 0 || start_pcs.size() <= 1){
+
+		 lift_job_t job;
+		 job.start_pcs = start_pcs;
+		 job.instrs_forward = instrs_forward;
+		 job.instrs_backward = instrs_backward;
+		 job.image_regions = image_regions;
+		 job.total_mem_regions = total_mem_regions;
+		 job.dot_folder = output_folder;
+		 job.dot_prefix = output_folder + file_substr;
+		 job.halide_prefix = get_standard_folder("halide") + file_substr;
+		 job.dump_folder = get_standard_folder("output");
+		 lift_function(&job, &lift_config);
 
 	 }
-	 else if (tree_build == BUILD_RANDOM_SET){
-
-		 uint64_t farthest = get_farthest_mem_access_point(total_mem_regions);
-		 /*ok we need find a set of random locations */
-		 vector<uint64_t> nbd_locations = get_nbd_of_random_points(image_regions, seed, &stride);
+	 else{
 
-		 /* ok now build trees for the set of locations */
-		 for (int i = 0; i < nbd_locations.size(); i++){
+		 /* the trace is split once; each function gets its slices, an output region of its own and its own folders */
+		 vector< vector<uint32_t> > lines = split_instr_trace(start_pcs, end_pcs, instrs_forward);
+		 vector<lift_job_t *> jobs;
 
-			 Conc_Tree * tree = new Conc_Tree();
-			 Conc_Tree * initial = build_conc_tree(nbd_locations[i], stride, start_points, FILE_BEGINNING, end_trace, tree, instrs_backward, farthest, total_mem_regions, func_replacements);
-			 build_conc_trees_for_conditionals(start_points, tree, instrs_backward,farthest, total_mem_regions, func_replacements);
+		 for (int i = 0; i < start_pcs.size(); i++){
 
-			 conc_trees.push_back(tree);
-			 if (initial != NULL){
-				 build_conc_trees_for_conditionals(start_points, initial, instrs_backward, farthest, total_mem_regions, func_replacements);
-				 conc_trees.push_back(initial);
+			 if (lines[i].size() == 0){
+				 DEBUG_PRINT(("WARNING: function %x is not in the trace; skipped\n", start_pcs[i]), 1);
+				 continue;
 			 }
-		 }
-
-		 /* checking similarity of the trees and if not repeat?? */
-		 vector<vector<Conc_Tree *> > clustered_conc_trees = categorize_trees(conc_trees);
-		 ASSERT_MSG((clustered_conc_trees.size() == 1), ("ERROR: The trees should be similar\n"));
 
-	 }
-	 else if (tree_build == BUILD_SIMILAR){
-		 uint64_t farthest = get_farthest_mem_access_point(total_mem_regions);
-		 conc_trees = get_similar_trees(image_regions, total_mem_regions, seed, &stride, start_points, start_trace, end_trace, farthest, instrs_backward, func_replacements);
-	 }
-	 else if (tree_build == BUILD_CLUSTERS){
-		 uint64_t farthest = get_farthest_mem_access_point(total_mem_regions);
-		 clustered_trees = cluster_trees(image_regions, total_mem_regions, start_points, instrs_backward, farthest, output_folder + file_substr, func_replacements);
-	 }
-
-
-	 /* number the trees - for all the conc trees built */
-	 if (tree_build == BUILD_CLUSTERS){
-		 for (int i = 0; i < clustered_trees.size(); i++){
-			 for (int j = 0; j < clustered_trees[i].size(); j++){
-				 clustered_trees[i][j]->number_tree_nodes();
+			 lift_job_t * job = new lift_job_t();
+			 job->start_pcs.push_back(start_pcs[i]);
+			 for (int j = 0; j < lines[i].size(); j++){
+				 job->instrs_forward.push_back(instrs_forward[lines[i][j]]);
+			 }
+			 for (int j = lines[i].size() - 1; j >= 0; j--){
+				 job->instrs_backward.push_back(instrs_backward[instrs_forward.size() - 1 - lines[i][j]]);
 			 }
-		 }
-		 DEBUG_PRINT(("numbering done\n"),2);
-
-	 }
-	 else{
-		 for (int i = 0; i < conc_trees.size(); i++){
-			 conc_trees[i]->number_tree_nodes();
-			 DEBUG_PRINT(("number of nodes : %d\n",conc_trees[i]->num_nodes),2);
-		 }
-	 }
-
-
 
-	 /* debug printing - need to change the branches */
-	 if (clustered_trees.size() > 0){
-		 for (int i = 0; i < clustered_trees.size(); i++){
-			 DEBUG_PRINT(("cluster - %d, size - %d\n",i, clustered_trees[i].size()), 2);
-			 DEBUG_PRINT(("printing to dot file...\n"), 2);
-			 ofstream conc_file(output_folder + file_substr + "_conctree_" + to_string(i) + ".dot", ofstream::out);
-			 clustered_trees[i][0]->print_dot(conc_file, "conc", i);
-			 DEBUG_PRINT(("conditionals: %d\n", clustered_trees[i][0]->conditionals.size()),2);
-		 }
-	 }
-	 else{
-		 for (int i = 0; i < conc_trees.size(); i++){
+			 mem_regions_t * function_output = get_function_output_region(total_mem_regions, job->instrs_forward, output_mem_region);
+			 for (int j = 0; j < total_mem_regions.size(); j++){
+				 job->total_mem_regions.push_back(new mem_regions_t(*total_mem_regions[j]));
+				 if (total_mem_regions[j] == function_output) job->image_regions.push_back(job->total_mem_regions[j]);
+			 }
+			 ASSERT_MSG((job->image_regions.size() == 1), ("ERROR: output region of function %x not found\n", start_pcs[i]));
 
-			 /* Expression printing */
-			 DEBUG_PRINT(("printing out the expression\n"), 2);
-			 ofstream expression_file(output_folder + file_substr + "_expression_" + to_string(i) + ".txt", ofstream::out);
+			 string function_substr = file_substr + "_" + to_string(start_pcs[i]);
+			 string function_folder = output_folder + function_substr;
+			 string halide_folder = get_standard_folder("halide") + function_substr;
+			 ASSERT_MSG((create_folder(function_folder) && create_folder(halide_folder)), ("ERROR: cannot create the output folders of function %x\n", start_pcs[i]));
 
-			 DEBUG_PRINT(("printing to dot file...\n"), 2);
-			 ofstream conc_file(output_folder + file_substr + "_conctree_" + to_string(i) + ".dot", ofstream::out);
-			 conc_trees[i]->print_dot(conc_file, "conc", i);
+			 job->dot_folder = function_folder;
+			 job->dot_prefix = function_folder + file_substr;
+			 job->halide_prefix = halide_folder + file_substr;
+			 job->dump_folder = function_folder;
+			 job->log_filename = get_standard_folder("log") + function_substr + ".log";
+			 jobs.push_back(job);
 
 		 }
-	 }
-
-	 if (mode == TREE_BUILD_STAGE){
-		 exit(0);
-	 }
-
-
-	 /***************************************ABSTRACTION*********************************************************/
-
-	 vector<Abs_Tree_Charac *> abs_trees;
-	 Abs_Tree * final_abs_tree;
-
-
-	 if (clustered_trees.size() > 0){
-		 abs_trees = build_abs_trees(clustered_trees, output_folder, no_trees, total_mem_regions, skip, pc_mem_info);
-		 DEBUG_PRINT(("building abstract trees done"), 2);
-	 }
-	 else if (conc_trees.size() > 0){
-		vector<Abs_Tree *> abs_trees;
-		for (int i = 0; i < conc_trees.size(); i++){
-			Abs_Tree * abs_tree = new Abs_Tree();
-			abs_tree->build_abs_tree_unrolled(conc_trees[i], total_mem_regions);
-			abs_tree->number_tree_nodes();
-			abs_trees.push_back(abs_tree);
-		}
-
 
-		/* debug printing */
-		for (int i = 0; i < abs_trees.size(); i++){
-			ofstream abs_file(output_folder + file_substr + "_abstree_" + to_string(i) + ".dot", ofstream::out);
-			abs_trees[i]->print_dot(abs_file, "abs", i);
-		}
-
-		Comp_Abs_Tree * comp_tree = new Comp_Abs_Tree();
-		comp_tree->build_compound_tree_unrolled(abs_trees);
-		comp_tree->number_tree_nodes();
-		ofstream comp_file(output_folder + file_substr + "_comp_tree.dot", ofstream::out);
-		comp_tree->print_dot(comp_file, "comp", 0);
-		comp_tree->abstract_buffer_indexes();
-		final_abs_tree = comp_tree->compound_to_abs_tree();
-
-		ofstream alg_file(output_folder + file_substr + "_algebraic.dot", ofstream::out);
-		uint32_t max_dimensions = final_abs_tree->get_maximum_dimensions();
-		final_abs_tree->print_dot_algebraic(alg_file, "alg", 0, get_vars("x", max_dimensions));
-
-	}
-	 
-
-	 DEBUG_PRINT(("******************tree building done********************************\n"), 2);
-
-	 if (mode == ABSTRACTION_STAGE){
-		 exit(0);
-	 }
-
-
-	 /**************************************HALIDE OUTPUT + ALGEBRIC FILTERS********************************************************/
-
-	 DEBUG_PRINT(("******************Halide population********************************\n"), 2);
-
-	 Halide_Program * halide = new Halide_Program(); 
+		 DEBUG_PRINT(("lifting %d functions on %d threads\n", jobs.size(), threads), 1);
+		 run_workers(threads, jobs.size(), [&](uint32_t i){ lift_function(jobs[i], &lift_config); });
 
-	 if (abs_trees.size() == 0){
-		 halide->populate_pure_funcs(final_abs_tree);
 	 }
-	 else{
-		 DEBUG_PRINT(("halide population...\n"), 2);
-		 for (int i = 0; i < abs_trees.size(); i++){
-			 if (abs_trees[i]->is_recursive){
-				 DEBUG_PRINT(("red func populated\n"), 2);
-				 halide->populate_red_funcs(abs_trees[i]->tree, abs_trees[i]->extents, abs_trees[i]->red_node);
-			 }
-			 else{
-				 DEBUG_PRINT(("pure func populated\n"), 2);
-				 halide->populate_pure_funcs(abs_trees[i]->tree); 
-			 }
-		 }
-	 }
-
-	 halide->resolve_conditionals();
-	 halide->populate_vars(4);
-	 halide->populate_input_params();
-	 halide->populate_params();
-
-	 vector<string> red_variables;
-	 halide->print_halide_program(halide_file, red_variables);
-
-	 DEBUG_PRINT(("******************Halide population done********************************\n"), 2);
-
-	 /* dumping memory values to files for debugging lifted halide filters - should be done separately */
-	 halide->get_memory_regions(memdump_files);
 
 	 shutdown_image_subsystem(token);
 	 return 0;
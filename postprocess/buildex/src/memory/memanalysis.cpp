@@ -276,10 +276,10 @@ void  mark_regions_type(vector<mem_regions_t *> regions, vector<mem_regions_t *>
 		if (i % 10000 == 0) DEBUG_PRINT(("."),2);
 
 		cinstr_t * instr = instrs[i].first;
-		rinstr_t * rinstr;
-		string para = instrs[i].second->disassembly;
+		rinstr_t rinstr[MAX_RINSTRS];
+		const string &para = instrs[i].second->disassembly;
 
-		rinstr = cinstr_to_rinstrs_eflags(instr, amount, para, i + 1);
+		cinstr_to_rinstrs_eflags(instr, rinstr, amount, para, i + 1);
 
 		vector<mem_regions_t *> regions = maps[instr->pc];
 
@@ -489,4 +489,39 @@ vector<mem_regions_t *> get_input_regions(vector<mem_regions_t *> total_regions,
 
 }
 
+mem_regions_t * get_function_output_region(vector<mem_regions_t *> &total_regions, vec_cinstr &instrs, mem_regions_t * output){
 
+	vector<uint32_t> writes(total_regions.size(), 0);
+
+	for (int i = 0; i < instrs.size(); i++){
+		cinstr_t * instr = instrs[i].first;
+		for (int j = 0; j < instr->num_dsts; j++){
+			if (instr->dsts[j].type != MEM_HEAP_TYPE) continue;
+			for (int k = 0; k < total_regions.size(); k++){
+				if (is_within_mem_region(total_regions[k], instr->dsts[j].value)){
+					writes[k]++;
+					break;
+				}
+			}
+		}
+	}
+
+	/* the output found for all the functions wins if this function writes it */
+	mem_regions_t * best = NULL;
+	uint32_t best_writes = 0;
+	for (int i = 0; i < total_regions.size(); i++){
+		if (total_regions[i] == output && writes[i] > 0) return output;
+		if ((total_regions[i]->type & (OUTPUT_BUFFER | INTERMEDIATE_BUFFER)) == 0) continue;
+		if (writes[i] > best_writes){
+			best = total_regions[i];
+			best_writes = writes[i];
+		}
+	}
+
+	if (best == NULL){
+		DEBUG_PRINT(("no output region written by the function; using the output region\n"), 2);
+		return output;
+	}
+	return best;
+
+}
@@ -1,4 +1,4 @@
-#include <sys\stat.h>
+#include <sys/stat.h>
 #include <iostream>
 #include <string>
 #include <stdlib.h>
@@ -379,8 +379,9 @@ vector<mem_regions_t *> get_image_regions_from_dump(vector<string> filenames, st
 	DEBUG_PRINT(("analyzing mem dumps....\n"), 1);
 	DEBUG_PRINT(("get_image_regions_from_dump....\n"), 2);
 
-	image_t * in_image = populate_imageinfo(open_image(in_image_filename.c_str()));
-	image_t * out_image = populate_imageinfo(open_image(out_image_filename.c_str()));
+	image_t * in_image = load_image(in_image_filename.c_str());
+	image_t * out_image = load_image(out_image_filename.c_str());
+	ASSERT_MSG(in_image != NULL && out_image != NULL, ("ERROR: cannot load %s or %s\n", in_image_filename.c_str(), out_image_filename.c_str()));
 	vector<mem_regions_t *> regions;
 
 	bool similar = true;
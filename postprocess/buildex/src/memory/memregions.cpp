@@ -1,6 +1,7 @@
 
 #include <iostream>
 #include <string>
+#include <cmath>
 
 #include "memory/memregions.h"
 #include "analysis/x86_analysis.h"
@@ -8,7 +9,7 @@
 
 #include "meminfo.h"
 #include "utilities.h"
-#include "utility\defines.h"
+#include "utility/defines.h"
 
 using namespace std;
 
@@ -144,6 +145,89 @@ vector<uint64_t> get_nbd_of_random_points_2(vector<mem_regions_t *> image_region
 }
 
 
+/* stratified sampling of locations in a region - each call returns the next level of a coarse-to-fine grid over the region
+   (with the border bands of width 'border' included in every level) which has not been returned before. Level 0 has the
+   corners, borders and the center; level l has a grid with a spacing of max_extent/2^l. Locations within a level are shuffled
+   so that any prefix of the sequence covers the region roughly uniformly. Returns an empty list when all locations are visited.
+   visited should be sized get_region_size(mem) and is updated by this routine */
+vector< vector<int32_t> > get_stratified_index_list(mem_regions_t * mem, uint32_t * level, vector<bool> &visited, uint32_t border){
+
+	vector< vector<int32_t> > ret;
+
+	uint32_t max_extent = 1;
+	for (int i = 0; i < mem->dimensions; i++){
+		if (mem->extents[i] > max_extent) max_extent = mem->extents[i];
+	}
+
+	while (ret.empty()){
+
+		uint32_t step = (*level >= 32) ? 1 : max_extent >> *level;
+		if (step == 0) step = 1;
+		if (step == 1 && *level > 0 && (max_extent >> (*level - 1)) <= 1){
+			break; /* the previous level already was the full grid */
+		}
+
+		/* coordinates taken in each dimension for this level */
+		vector< vector<int32_t> > coords;
+		for (int i = 0; i < mem->dimensions; i++){
+			vector<int32_t> dim_coords;
+			int32_t extent = mem->extents[i];
+			for (int32_t j = 0; j < extent; j++){
+				bool in_border = (j < border) || (j >= extent - (int32_t)border);
+				bool on_grid = (*level == 0) ? (j == extent / 2) : (j % step == 0);
+				if (in_border || on_grid) dim_coords.push_back(j);
+			}
+			coords.push_back(dim_coords);
+		}
+
+		/* cartesian product of the coordinates; dimension 0 is the fastest varying as in get_index_list */
+		vector<uint32_t> digit(mem->dimensions, 0);
+		bool finished = false;
+		while (!finished){
+
+			vector<int32_t> index;
+			uint64_t linear = 0;
+			uint64_t scale = 1;
+			for (int i = 0; i < mem->dimensions; i++){
+				index.push_back(coords[i][digit[i]]);
+				linear += coords[i][digit[i]] * scale;
+				scale *= mem->extents[i];
+			}
+
+			if (!visited[linear]){
+				visited[linear] = true;
+				ret.push_back(index);
+			}
+
+			finished = true;
+			for (int i = 0; i < mem->dimensions; i++){
+				if (digit[i] < coords[i].size() - 1){
+					digit[i]++;
+					for (int j = 0; j < i; j++){
+						digit[j] = 0;
+					}
+					finished = false;
+					break;
+				}
+			}
+		}
+
+		(*level)++;
+		if (step == 1) break;
+
+	}
+
+	/* shuffle within the level */
+	for (int i = ret.size() - 1; i > 0; i--){
+		int j = rand() % (i + 1);
+		swap(ret[i], ret[j]);
+	}
+
+	return ret;
+
+}
+
+
 uint32_t get_region_size(mem_regions_t * region){
 
 	uint32_t size = 1;
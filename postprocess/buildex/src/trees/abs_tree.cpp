@@ -2,10 +2,10 @@
 #include <fstream>
 #include <iostream>
 
-#include "utility\defines.h"
-#include "analysis\x86_analysis.h"
-#include "trees\trees.h"
-#include "utility\print_helper.h"
+#include "utility/defines.h"
+#include "analysis/x86_analysis.h"
+#include "trees/trees.h"
+#include "utility/print_helper.h"
 
 
 Abs_Tree::Abs_Tree() : Tree()
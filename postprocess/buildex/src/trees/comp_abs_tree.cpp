@@ -175,7 +175,7 @@ int32_t is_indirect_access(Comp_Abs_Node * node){
 
 }
 
-void remove_same_values(bool * deleted_index, vector < vector< double> > &A){
+void remove_same_values(bool * deleted_index, vector < vector< int64_t> > &A){
 
 	deleted_index[A[0].size() - 1] = false;
 	uint32_t temp_count = 0;
@@ -184,9 +184,9 @@ void remove_same_values(bool * deleted_index, vector < vector< double> > &A){
 	for (int j = 0; j < A[0].size() - 1; j++){
 
 		bool same = true;
-		double value = A[0][j];
+		int64_t value = A[0][j];
 		for (int i = 1; i < A.size(); i++){
-			if (abs(value - A[i][j]) > 1e-6){
+			if (value != A[i][j]){
 				same = false; break;
 			}
 		}
@@ -204,126 +204,92 @@ void remove_same_values(bool * deleted_index, vector < vector< double> > &A){
 
 }
 
+/* writes the solved coefficients back, putting zeros for the head dimensions which were constant */
+static void fill_indexes(int * indexes, vector<int64_t> &results, bool * deleted_index, uint32_t head_dimensions){
 
-void abstract_buffer_indexes_traversal(Comp_Abs_Node * head, Comp_Abs_Node * node){
+	uint32_t tcount = 0;
+	for (int i = 0; i < head_dimensions + 1; i++){
+		if (deleted_index[i] == false){
+			indexes[i] = (int)results[tcount++];
+		}
+		else{
+			indexes[i] = 0;
+		}
+	}
+
+}
+
+/* the coefficient matrix only depends on the head positions; it is factored once per compound tree and all the
+   buffer index systems are solved against it */
+uint32_t abstract_buffer_indexes_traversal(Comp_Abs_Node * head, Comp_Abs_Node * node, linear_solver_t * solver, bool * deleted_index){
 
 	Abs_Node * first = node->nodes[0];
+	uint32_t failed = 0;
 
 	if (node->visited){
-		return;
+		return 0;
 	}
 	else{
 		node->visited = true;
 	}
 
 	bool indirect = (is_indirect_access(node) != -1);
+	uint32_t head_dimensions = head->nodes[0]->mem_info.dimensions;
 
 	if ( ((first->type == Abs_Node::INPUT_NODE) || (first->type == Abs_Node::INTERMEDIATE_NODE) || (first->type == Abs_Node::OUTPUT_NODE)) && !indirect ){
-		/*make a system of linear equations and solve them*/
-
-		vector<vector<double> > A;
-		//for (int i = 0; i < head->nodes.size(); i++){
-		for (int i = 0; i < node->nodes.size(); i++){
-			vector<double> coeff;
-			for (int j = 0; j < head->nodes[i]->mem_info.dimensions; j++){
-				coeff.push_back((double)head->nodes[i]->mem_info.pos[j]);
-			}
-			coeff.push_back(1.0);
-			A.push_back(coeff);
-		}
-
-		printout_matrices(A);
-		bool  * deleted_index = new bool[A[0].size()];
-		remove_same_values(deleted_index, A);
-		cout << endl;
-		printout_matrices(A);
-
-
+		/* one right hand side per buffer dimension */
+		vector<vector<int64_t> > b(first->mem_info.dimensions);
 		for (int dim = 0; dim < first->mem_info.dimensions; dim++){
-			vector<double> b;
-			//for (int i = 0; i < node->nodes.size(); i++){
 			for (int i = 0; i < node->nodes.size(); i++){
-				b.push_back((double)node->nodes[i]->mem_info.pos[dim]);
-			}
-
-			printout_vector(b);
-			vector<double> results = solve_linear_eq(A, b);
-
-			uint32_t head_dimensions = head->nodes[0]->mem_info.dimensions;
-			//ASSERT_MSG((results.size() == (first->mem_info.dimensions + 1)), ("ERROR: the result vector is inconsistent\n"));
-			uint32_t tcount = 0;
-			for (int i = 0; i < head_dimensions + 1; i++){
-				if (deleted_index[i] == false){
-					first->mem_info.indexes[dim][i] = double_to_int(results[tcount++]);
-				}
-				else{
-					first->mem_info.indexes[dim][i] = 0;
-				}
+				b[dim].push_back((int64_t)node->nodes[i]->mem_info.pos[dim]);
 			}
 		}
 
-	}
-	else if (first->type == Abs_Node::IMMEDIATE_INT){
+		vector<vector<int64_t> > results;
+		failed = solve_linear_system_batch(solver, b, results);
 
-		vector<vector<double> > A;
-		//for (int i = 0; i < head->nodes.size(); i++){
-		for (int i = 0; i < node->nodes.size(); i++){
-			vector<double> coeff;
-			for (int j = 0; j < head->nodes[i]->mem_info.dimensions; j++){
-				coeff.push_back((double)head->nodes[i]->mem_info.pos[j]);
-			}
-			coeff.push_back(1.0);
-			A.push_back(coeff);
+		for (int dim = 0; dim < first->mem_info.dimensions && failed == 0; dim++){
+			fill_indexes(first->mem_info.indexes[dim], results[dim], deleted_index, head_dimensions);
 		}
 
+	}
+	else if (first->type == Abs_Node::IMMEDIATE_INT){
 
-		//cout << "imm" << endl;
-		//printout_matrices(A);
-
-		bool  * deleted_index = new bool[A[0].size()];
-		remove_same_values(deleted_index, A);
-
-		vector<double> b;
+		vector<int64_t> b;
+		vector<int64_t> results;
 
 		first->mem_info.indexes = new int * [1];
-		first->mem_info.indexes[0] = new int[head->nodes[0]->mem_info.dimensions + 1];
+		first->mem_info.indexes[0] = new int[head_dimensions + 1];
 		first->mem_info.dimensions = 1;
-		first->mem_info.head_dimensions = head->nodes[0]->mem_info.dimensions;
+		first->mem_info.head_dimensions = head_dimensions;
 
 		for (int i = 0; i < node->nodes.size(); i++){
-			b.push_back((long long)node->nodes[i]->symbol->value);
+			b.push_back((int64_t)node->nodes[i]->symbol->value);
 		}
 
-		//printout_vector(b);
-
-		vector<double> results = solve_linear_eq(A, b);
-
-		uint32_t head_dimensions = head->nodes[0]->mem_info.dimensions;
-		//ASSERT_MSG((results.size() == (first->mem_info.dimensions + 1)), ("ERROR: the result vector is inconsistent\n"));
-		uint32_t tcount = 0;
-		for (int i = 0; i < head_dimensions + 1; i++){
-			if (deleted_index[i] ==  false){
-				first->mem_info.indexes[0][i] = double_to_int(results[tcount++]);
-			}
-			else{
-				first->mem_info.indexes[0][i] = 0;
-			}
+		if (solve_linear_system(solver, b, results)){
+			fill_indexes(first->mem_info.indexes[0], results, deleted_index, head_dimensions);
+		}
+		else{
+			failed = 1;
 		}
 
 	}
 	else if ((first->type == Abs_Node::SUBTREE_BOUNDARY)){
-		return;
+		return 0;
 	}
 
 	for (int i = 0; i < node->srcs.size(); i++){
-		abstract_buffer_indexes_traversal(head, static_cast<Comp_Abs_Node *>(node->srcs[i]));
+		failed += abstract_buffer_indexes_traversal(head, static_cast<Comp_Abs_Node *>(node->srcs[i]), solver, deleted_index);
 	}
 
+	return failed;
+
 }
 
 
 
-void Comp_Abs_Tree::abstract_buffer_indexes()
+bool Comp_Abs_Tree::abstract_buffer_indexes()
 {
 	Comp_Abs_Node * act_head = static_cast<Comp_Abs_Node *>(get_head());
 
@@ -334,12 +300,42 @@ void Comp_Abs_Tree::abstract_buffer_indexes()
 		DEBUG_PRINT(("indirect head node access\n"), 2);
 	}
 
+	/* coefficient matrix from the head positions (affine - last column is the constant) */
+	vector<vector<int64_t> > A;
+	for (int i = 0; i < act_head->nodes.size(); i++){
+		vector<int64_t> coeff;
+		for (int j = 0; j < act_head->nodes[i]->mem_info.dimensions; j++){
+			coeff.push_back((int64_t)act_head->nodes[i]->mem_info.pos[j]);
+		}
+		coeff.push_back(1);
+		A.push_back(coeff);
+	}
+
+	bool * deleted_index = new bool[A[0].size()];
+	remove_same_values(deleted_index, A);
+
+	linear_solver_t solver;
+	if (!factor_linear_system(&solver, A)){
+		DEBUG_PRINT(("WARNING: head positions do not determine the buffer indexes; abstraction failed\n"), 2);
+		delete[] deleted_index;
+		return false;
+	}
+
 	/* assert that the comp node is an input or an intermediate node */
+	uint32_t failed = 0;
 	for (int i = 0; i < head->srcs.size(); i++){
-		abstract_buffer_indexes_traversal(act_head, static_cast<Comp_Abs_Node*>(head->srcs[i]));
+		failed += abstract_buffer_indexes_traversal(act_head, static_cast<Comp_Abs_Node*>(head->srcs[i]), &solver, deleted_index);
 	}
 
 	cleanup_visit();
+	delete[] deleted_index;
+
+	if (failed > 0){
+		DEBUG_PRINT(("WARNING: %d buffer index systems could not be solved exactly\n", failed), 2);
+		return false;
+	}
+
+	return true;
 }
 
 Abs_Tree * Comp_Abs_Tree::compound_to_abs_tree()
@@ -2,11 +2,13 @@
 #include <assert.h>
 #include <fstream>
 #include <iostream>
+#include <algorithm>
 
-#include "utility\defines.h"
-#include "trees\trees.h"
-#include "analysis\x86_analysis.h"
-#include "utility\print_helper.h"
+#include "utility/defines.h"
+#include "trees/trees.h"
+#include "analysis/x86_analysis.h"
+#include "utility/print_helper.h"
+#include "utility/metrics.h"
 
 #include "utilities.h"
 
@@ -23,6 +25,7 @@ Conc_Tree::Conc_Tree() : Tree()
 
 	dummy_tree = false;
 	func_inside = false;
+	frontier_size = 0;
 	frontier = new frontier_t[MAX_FRONTIERS];
 
 	for (int i = 0; i < MAX_FRONTIERS; i++){
@@ -75,6 +78,8 @@ void Conc_Tree::add_to_frontier(int hash, Node * node)
 
 	ASSERT_MSG((frontier[hash].amount < SIZE_PER_FRONTIER), ("ERROR: bucket size is full\n"));
 	frontier[hash].bucket[frontier[hash].amount++] = node;
+	frontier_size++;
+	METRIC_MAX(METRIC_FRONTIER_PEAK, frontier_size);
 
 	/*if this a memory operand we should memoize it*/
 	if (node->symbol->type != REG_TYPE){
@@ -138,6 +143,7 @@ void Conc_Tree::remove_from_frontier(operand_t * opnd)
 		ASSERT_MSG((frontier[hash].amount > 0), ("ERROR: at least one element should have been deleted\n"));
 
 		int amount = --frontier[hash].amount;
+		frontier_size--;
 		/* update memoization structure for memory operands */
 		if (amount == 0 && (opnd->type != REG_TYPE)){
 			for (int i = 0; i < mem_in_frontier.size(); i++){
@@ -460,6 +466,8 @@ bool Conc_Tree::update_depandancy_backward(rinstr_t * instr, cinstr_t * cinstr,
 			int amount = frontier[hash].amount;
 			frontier[hash].bucket[amount] = head;
 			frontier[hash].amount++;
+			frontier_size++;
+			METRIC_MAX(METRIC_FRONTIER_PEAK, frontier_size);
 		}
 
 #ifdef INDIRECTION
@@ -963,6 +971,31 @@ void Conc_Tree::number_parameters(vector<mem_regions_t *> regions){
 
 }
 
+/* structural fingerprint of the tree; trees that are similar (are_trees_similar) always get the same hash
+   so it can be used to bucket trees before the full similarity check */
+uint64_t Conc_Tree::get_structural_hash(Node * node){
+
+	uint64_t hash = 14695981039346656037ULL; /* FNV-1a */
+
+	uint64_t key = (node->srcs.size() > 0) ? node->operation : (0x100 + node->symbol->type);
+	hash = (hash ^ key) * 1099511628211ULL;
+	hash = (hash ^ node->srcs.size()) * 1099511628211ULL;
+
+	for (int i = 0; i < node->srcs.size(); i++){
+		hash = (hash ^ get_structural_hash(node->srcs[i])) * 1099511628211ULL;
+	}
+
+	return hash;
+
+}
+
+uint64_t Conc_Tree::get_structural_hash(){
+
+	if (head == NULL) return 0;
+	return get_structural_hash(head);
+
+}
+
 
 /* to be implemented */
 
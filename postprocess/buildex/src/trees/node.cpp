@@ -8,22 +8,26 @@ using namespace std;
 #include "analysis/x86_analysis.h"
 #include "common_defines.h"
 #include "utility/defines.h"
+#include "utility/metrics.h"
 
 
 /* this implements the abstract class - Node */
 
 /* constructors */
 Node::Node(){
+	minus = false;
 	para_num = -1;
 	is_para = false;
 	order_num = -1;
 	visited = false;
+	METRIC_ADD(METRIC_NODES_ALLOCATED, 1);
 }
 
 /* copy constructor */
 Node::Node(const Node& node) :
 operation(node.operation),
 sign(node.sign),
+minus(node.minus),
 symbol(node.symbol),
 pc(node.pc),
 is_para(node.is_para),
@@ -32,7 +36,7 @@ para_num(node.para_num),
 visited(false),
 order_num(-1)
 {
-
+	METRIC_ADD(METRIC_NODES_ALLOCATED, 1);
 }
 
 Node::~Node(){
@@ -9,6 +9,7 @@ using namespace std;
 #include "common_defines.h"
 #include "utility/defines.h"
 #include "utility/print_helper.h"
+#include "utility/metrics.h"
 
 #include "utilities.h"
 
@@ -73,24 +74,24 @@ void Tree::canonicalize_tree()
 	uint32_t changed_g = 1;
 	/* first congregate the tree and then order the nodes */
 	while (changed_g){
-		changed_g = (uint32_t)traverse_tree(head, this,
+		changed_g = (uint32_t)(uintptr_t)traverse_tree(head, this,
 			[](Node * node, void * value)->void* {
 
 			Tree * tree = static_cast<Tree *>(value);
 			uint32_t changed = node->congregate_node(tree->get_head());
-			return (void *)changed;
+			return (void *)(uintptr_t)changed;
 
 		}, [](void * node_value, std::vector<void *> traverse_value, void * value)->void*{
 
-			uint32_t changed = (uint32_t)node_value;
-			if (changed) return (void *)changed;
+			uint32_t changed = (uint32_t)(uintptr_t)node_value;
+			if (changed) return (void *)(uintptr_t)changed;
 
 			for (int i = 0; i < traverse_value.size(); i++){
-				changed = (uint32_t)traverse_value[i];
-				if (changed) return (void *)changed;
+				changed = (uint32_t)(uintptr_t)traverse_value[i];
+				if (changed) return (void *)(uintptr_t)changed;
 			}
 
-			return (void *)changed;
+			return (void *)(uintptr_t)changed;
 
 		});
 	}
@@ -105,9 +106,542 @@ void Tree::canonicalize_tree()
 
 }
 
-void Tree::simplify_tree() /* simplification routines are not written at the moment */
+/************************************************************************/
+/*  native algebraic simplification                                     */
+/************************************************************************/
+
+/* these work on concrete trees - folded results are written in place to the node symbols (as in remove_or_minus_1) */
+
+static bool is_int_immediate(Node * node){
+	return (node->srcs.size() == 0) && (node->symbol->type == IMM_INT_TYPE) && !node->minus;
+}
+
+static bool is_term_leaf(Node * node){
+	return (node->srcs.size() == 0) && (node->symbol->type != IMM_INT_TYPE) && (node->symbol->type != IMM_FLOAT_TYPE) && !node->minus;
+}
+
+static uint64_t width_mask(uint32_t width){
+	if (width == 0 || width >= 8) return ~0ULL;
+	return (1ULL << (width * 8)) - 1;
+}
+
+static int64_t to_signed(uint64_t value, uint32_t width){
+	uint64_t mask = width_mask(width);
+	value &= mask;
+	if ((mask != ~0ULL) && (value & ((mask >> 1) + 1))){
+		value |= ~mask;
+	}
+	return (int64_t)value;
+}
+
+static bool fold_operation(uint32_t operation, vector<int64_t> &values, bool sign, uint32_t width, int64_t * result){
+
+	if (values.size() == 0) return false;
+	int64_t value = values[0];
+
+	switch (operation){
+	case op_add:
+		for (int i = 1; i < values.size(); i++) value += values[i];
+		break;
+	case op_mul:
+		for (int i = 1; i < values.size(); i++) value *= values[i];
+		break;
+	case op_and:
+		for (int i = 1; i < values.size(); i++) value &= values[i];
+		break;
+	case op_or:
+		for (int i = 1; i < values.size(); i++) value |= values[i];
+		break;
+	case op_xor:
+		for (int i = 1; i < values.size(); i++) value ^= values[i];
+		break;
+	case op_not:
+		if (values.size() != 1) return false;
+		value = ~value;
+		break;
+	case op_sub:
+		if (values.size() != 2) return false;
+		value = values[0] - values[1];
+		break;
+	case op_lsh:
+		if (values.size() != 2 || values[1] < 0 || values[1] >= 64) return false;
+		value = values[0] << values[1];
+		break;
+	case op_rsh:
+		if (values.size() != 2 || values[1] < 0 || values[1] >= 64) return false;
+		if (sign) value = values[0] >> values[1];
+		else value = (int64_t)(((uint64_t)values[0] & width_mask(width)) >> values[1]);
+		break;
+	case op_div:
+		if (values.size() != 2 || values[1] == 0) return false;
+		value = values[0] / values[1];
+		break;
+	case op_mod:
+		if (values.size() != 2 || values[1] == 0) return false;
+		value = values[0] % values[1];
+		break;
+	default:
+		return false;
+	}
+
+	*result = value;
+	return true;
+
+}
+
+/* (parents -> node -> src) => (parents -> src) */
+static void splice_node(Node * node, Node * src){
+
+	vector<Node *> parents = node->prev;
+	for (int i = 0; i < parents.size(); i++){
+		node->change_ref(parents[i], src); /* replaces all the references from this parent */
+	}
+	node->prev.clear();
+	node->pos.clear();
+	node->remove_forward_ref(src);
+
+}
+
+/* node with only immediate sources becomes an immediate leaf */
+static void make_int_immediate(Node * node, int64_t value){
+
+	while (node->srcs.size() > 0){
+		node->remove_forward_ref(node->srcs[0]);
+	}
+	node->operation = -1;
+	node->symbol->type = IMM_INT_TYPE;
+	node->symbol->value = (uint64_t)value & width_mask(node->symbol->width);
+
+}
+
+/* c1 * x + c2 * x + x => (c1 + c2 + 1) * x ; reuses an existing multiplication node, so plain x + x is left untouched
+   (remove_multiplication produces that form on purpose). a minus product -(c * x) counts as -c and, if it is the one
+   reused, keeps its minus with the negated sum */
+static void collect_linear_terms(Node * node){
+
+	struct term_t {
+		Node * leaf;
+		int64_t coefficient;
+		vector<Node *> appearances;
+		Node * mul_node;
+	};
+
+	vector<term_t> terms;
+
+	for (int i = 0; i < node->srcs.size(); i++){
+
+		Node * src = node->srcs[i];
+		Node * leaf = NULL;
+		int64_t coefficient = 0;
+		bool is_mul = false;
+
+		if (is_term_leaf(src)){
+			leaf = src;
+			coefficient = 1;
+		}
+		else if (src->operation == op_mul && src->srcs.size() == 2 && src->prev.size() == 1 &&
+			is_int_immediate(src->srcs[0]) && src->srcs[0]->prev.size() == 1 && is_term_leaf(src->srcs[1])){
+			leaf = src->srcs[1];
+			coefficient = to_signed(src->srcs[0]->symbol->value, src->srcs[0]->symbol->width);
+			if (src->minus) coefficient = -coefficient;
+			is_mul = true;
+		}
+		else{
+			continue;
+		}
+
+		int index = -1;
+		for (int j = 0; j < terms.size(); j++){
+			operand_t * first = terms[j].leaf->symbol;
+			if (first->type == leaf->symbol->type && first->value == leaf->symbol->value && first->width == leaf->symbol->width){
+				index = j;
+				break;
+			}
+		}
+
+		if (index == -1){
+			term_t term;
+			term.leaf = leaf;
+			term.coefficient = 0;
+			term.mul_node = NULL;
+			terms.push_back(term);
+			index = terms.size() - 1;
+		}
+
+		terms[index].coefficient += coefficient;
+		terms[index].appearances.push_back(src);
+		if (is_mul && terms[index].mul_node == NULL){
+			terms[index].mul_node = src;
+		}
+	}
+
+	for (int i = 0; i < terms.size(); i++){
+
+		term_t &term = terms[i];
+		if (term.appearances.size() < 2 || term.mul_node == NULL) continue;
+
+		Node * imm = term.mul_node->srcs[0];
+		int64_t coefficient = term.mul_node->minus ? -term.coefficient : term.coefficient;
+		imm->symbol->value = (uint64_t)coefficient & width_mask(imm->symbol->width);
+
+		for (int j = 0; j < term.appearances.size(); j++){
+			if (term.appearances[j] != term.mul_node){
+				node->remove_forward_ref_single(term.appearances[j]);
+			}
+		}
+
+		if (term.coefficient == 0 && node->srcs.size() > 1){
+			node->remove_forward_ref_single(term.mul_node);
+		}
+	}
+
+}
+
+static void simplify_node(Node * node, Node * head){
+
+	if (node->visited) return;
+	node->visited = true;
+
+	vector<Node *> srcs = node->srcs;
+	for (int i = 0; i < srcs.size(); i++){
+		simplify_node(srcs[i], head);
+	}
+
+	if (node->srcs.size() == 0) return;
+
+	uint32_t width = node->symbol->width;
+	bool nary = (node->operation == op_add || node->operation == op_mul);
+
+	/* flatten unshared associative chains bottom-up ; done here rather than through congregate_node so that
+	   no node is freed while a traversal still holds it */
+	if (nary){
+		for (int i = 0; i < node->srcs.size(); i++){
+			Node * src = node->srcs[i];
+			if (src->operation != node->operation || src->prev.size() != 1 || src->srcs.size() == 0 || src->minus) continue;
+			node->remove_forward_ref_single(src);
+			for (int j = 0; j < src->srcs.size(); j++){
+				node->add_forward_ref(src->srcs[j]);
+			}
+			src->safely_delete(head);
+			i--;
+		}
+	}
+
+	if (node->operation == op_add){
+		collect_linear_terms(node);
+	}
+
+	/* constant folding */
+	vector<uint32_t> imm_index;
+	vector<int64_t> values;
+	for (int i = 0; i < node->srcs.size(); i++){
+		if (is_int_immediate(node->srcs[i])){
+			imm_index.push_back(i);
+			values.push_back(to_signed(node->srcs[i]->symbol->value, node->srcs[i]->symbol->width));
+		}
+	}
+
+	bool all_imm = (imm_index.size() == node->srcs.size());
+	int64_t result;
+
+	if ((all_imm || (nary && imm_index.size() > 1)) && fold_operation(node->operation, values, node->sign, width, &result)){
+
+		if (all_imm && node != head){
+			make_int_immediate(node, result);
+			return;
+		}
+
+		/* keep the first unshared immediate for the result and drop the others */
+		int keep = -1;
+		for (int i = 0; i < imm_index.size(); i++){
+			if (node->srcs[imm_index[i]]->prev.size() == 1){
+				keep = imm_index[i];
+				break;
+			}
+		}
+
+		if (keep != -1 && (nary || all_imm)){
+			Node * imm = node->srcs[keep];
+			imm->symbol->width = width;
+			imm->symbol->value = (uint64_t)result & width_mask(width);
+
+			vector<Node *> removed;
+			for (int i = 0; i < imm_index.size(); i++){
+				if (imm_index[i] != keep) removed.push_back(node->srcs[imm_index[i]]);
+			}
+			for (int i = 0; i < removed.size(); i++){
+				node->remove_forward_ref_single(removed[i]);
+			}
+
+			if (all_imm){ /* head node keeps its destination */
+				node->operation = op_assign;
+			}
+		}
+	}
+
+	/* identity removal */
+	uint64_t mask = width_mask(width);
+
+	switch (node->operation){
+
+	case op_add:
+	case op_or:
+	case op_xor:
+	case op_mul:
+	case op_and:
+		for (int i = 0; i < node->srcs.size() && node->srcs.size() > 1; i++){
+			Node * src = node->srcs[i];
+			if (!is_int_immediate(src)) continue;
+			uint64_t value = src->symbol->value & mask;
+			bool identity = false;
+			if (node->operation == op_mul){
+				if (value == 0 && node != head){
+					make_int_immediate(node, 0);
+					return;
+				}
+				identity = (value == 1);
+			}
+			else if (node->operation == op_and){
+				if (value == 0 && node != head){
+					make_int_immediate(node, 0);
+					return;
+				}
+				identity = (value == mask);
+			}
+			else{
+				identity = (value == 0);
+			}
+
+			if (identity){
+				node->remove_forward_ref_single(src);
+				i--;
+			}
+		}
+		break;
+
+	case op_sub:
+	case op_lsh:
+	case op_rsh:
+	case op_div:
+		if (node->srcs.size() == 2 && is_int_immediate(node->srcs[1])){
+			uint64_t value = node->srcs[1]->symbol->value & mask;
+			if ((node->operation == op_div && value == 1) || (node->operation != op_div && value == 0)){
+				node->remove_forward_ref_single(node->srcs[1]);
+			}
+		}
+		break;
+
+	}
+
+	/* single source operations are just the source */
+	if (node->srcs.size() == 1 && node->operation != op_assign && node->operation != op_not &&
+		(nary || node->operation == op_and || node->operation == op_or || node->operation == op_xor ||
+		node->operation == op_sub || node->operation == op_lsh || node->operation == op_rsh || node->operation == op_div)){
+
+		if (node != head){
+			splice_node(node, node->srcs[0]);
+		}
+		else{
+			node->operation = op_assign;
+		}
+	}
+
+}
+
+/* constant folding, flattening of associative operations, linear term collection and identity removal */
+void Tree::simplify_tree()
+{
+
+	cleanup_visit();
+	simplify_node(head, head);
+	cleanup_visit();
+
+	/* the chains are flat after the pass; only the ordering of canonicalize_tree is left */
+	traverse_tree(head, NULL,
+		[](Node * node, void * value)->void* {
+
+		node->order_node();
+		return NULL;
+	}, empty_ret_mutator);
+
+}
+
+
+/************************************************************************/
+/*  fused normalization                                                 */
+/************************************************************************/
+
+/* rules of remove_assign_nodes, remove_multiplication and remove_po_nodes - the node is replaced in its parents, which
+   are normalized after it */
+static void normalize_replace_node(Node * node, Node * head){
+
+	vector<Node *> parents = node->prev;
+
+	if (node->operation == op_assign && node != head && node->srcs.size() == 1){
+		Node * src = node->srcs[0];
+		for (int i = 0; i < parents.size(); i++){
+			node->change_ref(parents[i], src);
+		}
+	}
+	else if (node->operation == op_mul){
+
+		int index = -1;
+		int imm_value = 0;
+		for (int i = 0; i < node->srcs.size(); i++){
+			if (node->srcs[i]->symbol->type == IMM_INT_TYPE){
+				imm_value = node->srcs[i]->symbol->value;
+				index = i;
+				break;
+			}
+		}
+
+		/* the sources are added into the parents; a parent copying the product (the head after simplify_tree) becomes
+		   the sum, any other parent keeps the product */
+		bool expandable = true;
+		for (int i = 0; i < parents.size(); i++){
+			if (parents[i]->operation != op_add && !(parents[i]->operation == op_assign && parents[i]->srcs.size() == 1)){
+				expandable = false;
+			}
+		}
+
+		/* a product with 0 has nothing to expand into; it is left for simplify_tree */
+		if (index != -1 && imm_value < 10 && imm_value > 0 && expandable){
+			/* one entry per reference, so a parent using the product twice gets the sources twice */
+			for (int i = 0; i < parents.size(); i++){
+				parents[i]->operation = op_add;
+				for (int j = 0; j < node->srcs.size(); j++){
+					if (j == index) continue;
+					for (int k = 0; k < imm_value; k++){
+						parents[i]->add_forward_ref(node->srcs[j]);
+					}
+				}
+				parents[i]->remove_forward_ref_single(node);
+			}
+			vector<Node *> srcs = node->srcs;
+			for (int i = 0; i < srcs.size(); i++){
+				node->remove_forward_ref(srcs[i]);
+			}
+			/* the moved sources were replaced against the product's width; the new parents may match theirs */
+			for (int i = 0; i < srcs.size(); i++){
+				if (srcs[i]->operation == op_partial_overlap){
+					normalize_replace_node(srcs[i], head);
+				}
+			}
+		}
+	}
+	else if (node->operation == op_partial_overlap){
+		for (int i = 0; i < parents.size(); i++){
+			if (parents[i]->symbol->width != node->symbol->width) continue;
+			for (int j = 0; j < node->srcs.size(); j++){
+				node->change_ref(parents[i], node->srcs[j]);
+			}
+		}
+	}
+
+}
+
+/* rules of canonicalize_tree, simplify_immediates, remove_or_minus_1 and remove_identities on a node whose sources are
+   normalized already */
+static void normalize_node(Node * node, Node * head, uint32_t rules){
+
+	/* a source with the same associative operation is already flat - lifting its sources once is enough */
+	if (node->operation == op_add || node->operation == op_mul){
+		for (int i = 0; i < node->srcs.size(); i++){
+			Node * src = node->srcs[i];
+			if (src->operation != node->operation || src == head) continue;
+			if (node->remove_forward_ref_single(src)){
+				for (int j = 0; j < src->srcs.size(); j++){
+					node->add_forward_ref(src->srcs[j]);
+				}
+				src->safely_delete(head);
+				i--;
+			}
+		}
+	}
+
+	node->order_node();
+
+	/* immediates are ordered first; they are summed into the first */
+	if ((node->operation == op_mul || node->operation == op_add) && node->srcs.size() > 0 && node->srcs[0]->symbol->type == IMM_INT_TYPE){
+		int32_t value = 0;
+		vector<Node *> removed;
+		for (int i = 0; i < node->srcs.size(); i++){
+			if (node->srcs[i]->symbol->type != IMM_INT_TYPE) continue;
+			value += node->srcs[i]->symbol->value;
+			if (i > 0) removed.push_back(node->srcs[i]);
+		}
+		node->srcs[0]->symbol->value = value;
+		for (int i = 0; i < removed.size(); i++){
+			node->remove_forward_ref_single(removed[i]);
+		}
+	}
+
+	if ((rules & NORMALIZE_OR_MINUS_1) && node->operation == op_or){
+		for (int i = 0; i < node->srcs.size(); i++){
+			if (node->srcs[i]->symbol->type == IMM_INT_TYPE && (int32_t)node->srcs[i]->symbol->value == -1){
+				node->srcs.clear();
+				node->symbol->type = IMM_INT_TYPE;
+				node->symbol->value = 255;
+				break;
+			}
+		}
+	}
+
+	if ((rules & NORMALIZE_IDENTITIES) && node->operation == op_add){
+		for (int i = 0; i < node->srcs.size(); i++){
+			if (node->srcs[i]->symbol->type == IMM_INT_TYPE && node->srcs[i]->symbol->value == 0){
+				node->remove_forward_ref_single(node->srcs[i]);
+				i--;
+			}
+		}
+	}
+
+}
+
+/* remove_assign_nodes, remove_multiplication, remove_po_nodes, canonicalize_tree and simplify_immediates (plus
+   remove_or_minus_1 and remove_identities when asked) in one bottom-up pass. every node is normalized once, after
+   all its sources; the rules only ever change the node's own sources or replace the node in its parents, which
+   come later in the pass. an explicit stack keeps deep trees off the call stack */
+void Tree::normalize_tree(uint32_t rules)
 {
 
+	METRIC_SCOPE("normalize_tree");
+
+	struct frame_t {
+		Node * node;
+		vector<Node *> srcs; /* the sources when the node was entered; the rules may change node->srcs */
+		uint32_t next;
+	};
+
+	cleanup_visit();
+
+	vector<frame_t> stack;
+	frame_t first = { head, head->srcs, 0 };
+	head->visited = true;
+	stack.push_back(first);
+
+	while (!stack.empty()){
+
+		if (stack.back().next < stack.back().srcs.size()){
+			Node * src = stack.back().srcs[stack.back().next++];
+			if (!src->visited){
+				src->visited = true;
+				frame_t frame = { src, src->srcs, 0 };
+				stack.push_back(frame);
+			}
+			continue;
+		}
+
+		Node * node = stack.back().node;
+		stack.pop_back();
+
+		normalize_node(node, head, rules);
+		normalize_replace_node(node, head);
+
+	}
+
+	cleanup_visit();
+
 }
 
 
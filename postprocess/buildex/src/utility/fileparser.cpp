@@ -10,9 +10,10 @@
 #include <stdint.h>
 #include <algorithm>
 
-#include "utility\fileparser.h"
-#include "utility\defines.h"
-#include "analysis\staticinfo.h"
+#include "utility/fileparser.h"
+#include "utility/defines.h"
+#include "utility/metrics.h"
+#include "analysis/staticinfo.h"
 
 #include "utilities.h"
 #include "common_defines.h"
@@ -80,6 +81,7 @@ cinstr_t * get_next_from_ascii_file(ifstream &file, uint32_t version){
 	file.getline(string_ins, MAX_STRING_LENGTH);
 
 	string string_cpp(string_ins);
+	METRIC_ADD(METRIC_BYTES_READ, file.gcount());
 
 #ifdef DEBUG
 #if DEBUG_LEVEL >= 5
@@ -93,6 +95,7 @@ cinstr_t * get_next_from_ascii_file(ifstream &file, uint32_t version){
 	if (string_cpp.size() > 0){
 
 		instr = new cinstr_t;
+		METRIC_ADD(METRIC_INSTRS_PARSED, 1);
 
 		vector<string> tokens;
 		tokens = split(string_cpp, ',');
@@ -182,6 +185,7 @@ bool compare_static_info(Static_Info * first, Static_Info * second){
 Static_Info * parse_debug_disasm(vector<Static_Info *> &static_info, ifstream &file){
 
 	DEBUG_PRINT(("getting disassembly trace\n"), 2);
+	METRIC_SCOPE("parse_debug_disasm");
 
 	while (!file.eof()){
 
@@ -189,9 +193,11 @@ Static_Info * parse_debug_disasm(vector<Static_Info *> &static_info, ifstream &f
 		//we need to parse the file here - forward parsing and backward traversal
 		file.getline(string_ins, MAX_STRING_LENGTH);
 		string string_cpp(string_ins);
+		METRIC_ADD(METRIC_BYTES_READ, file.gcount());
 
 		if (string_cpp.size() > 0){
 
+			METRIC_ADD(METRIC_DISASM_PARSED, 1);
 			uint32_t module_no;
 			uint32_t app_pc;
 
@@ -384,14 +390,13 @@ uint32_t go_to_line_dest(ifstream &file, uint64_t dest, uint32_t stride, uint32_
 void walk_instructions(ifstream &file, uint32_t version){
 
 	cinstr_t * instr;
-	rinstr_t * rinstr;
+	rinstr_t rinstr[MAX_RINSTRS];
 	int no_rinstrs;
 
 	while (!file.eof()){
 		instr = get_next_from_ascii_file(file, version);
 		if (instr != NULL){
-			rinstr = cinstr_to_rinstrs(instr, no_rinstrs, "", 0);
-			delete[] rinstr;
+			cinstr_to_rinstrs(instr, rinstr, no_rinstrs, "", 0);
 		}
 		delete instr;
 	}
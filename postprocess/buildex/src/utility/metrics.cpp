@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <mutex>
+
+#include "utility/metrics.h"
+#include "utility/defines.h"
+
+using namespace std;
+
+bool metrics_enabled = false;
+std::atomic<uint64_t> metric_counters[METRIC_NUM_COUNTERS];
+
+static const char * counter_names[METRIC_NUM_COUNTERS] = {
+	"bytes_read",
+	"instrs_parsed",
+	"disasm_parsed",
+	"rinstrs_decoded",
+	"trees_built",
+	"clusters",
+	"nodes_allocated",
+	"frontier_peak",
+	"conditionals_built",
+	"conditionals_shared"
+};
+
+static const char * series_names[METRIC_NUM_SERIES] = {
+	"trees_per_cluster"
+};
+
+#define MAX_METRIC_TIMERS	64
+
+static metric_timer_t timers[MAX_METRIC_TIMERS];
+static uint32_t num_timers = 0;
+static vector<uint64_t> series[METRIC_NUM_SERIES];
+static std::mutex metrics_lock;
+static char * report_filename = NULL;
+static chrono::steady_clock::time_point metrics_start;
+
+void init_metrics(const char * report_file){
+
+	if (metrics_enabled) return;
+
+	for (int i = 0; i < METRIC_NUM_COUNTERS; i++){
+		metric_counters[i] = 0;
+	}
+	report_filename = strdup(report_file);
+	metrics_start = chrono::steady_clock::now();
+	metrics_enabled = true;
+
+	/* buildex leaves from many places with exit(); the report has to be written from there */
+	atexit(write_metrics_report);
+
+}
+
+metric_timer_t * get_metric_timer(const char * name){
+
+	lock_guard<mutex> guard(metrics_lock);
+
+	for (uint32_t i = 0; i < num_timers; i++){
+		if (strcmp(timers[i].name, name) == 0) return &timers[i];
+	}
+
+	ASSERT_MSG((num_timers < MAX_METRIC_TIMERS), ("ERROR: too many metric timers\n"));
+	metric_timer_t * timer = &timers[num_timers++];
+	timer->name = name;
+	timer->calls = 0;
+	timer->total_ns = 0;
+	timer->max_ns = 0;
+	return timer;
+
+}
+
+void metric_max(metric_counter_id_t counter, uint64_t value){
+
+	uint64_t current = metric_counters[counter];
+	while (value > current && !metric_counters[counter].compare_exchange_weak(current, value));
+
+}
+
+void metric_series_add(metric_series_id_t id, uint64_t value){
+
+	lock_guard<mutex> guard(metrics_lock);
+	series[id].push_back(value);
+
+}
+
+Metric_Scope::Metric_Scope(std::atomic<metric_timer_t *> * timer, const char * name){
+
+	this->timer = NULL;
+	if (!metrics_enabled) return;
+
+	this->timer = timer->load();
+	if (this->timer == NULL){
+		this->timer = get_metric_timer(name);
+		timer->store(this->timer);
+	}
+	start = chrono::steady_clock::now();
+
+}
+
+Metric_Scope::~Metric_Scope(){
+	end();
+}
+
+void Metric_Scope::end(){
+
+	if (timer == NULL) return;
+
+	uint64_t elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+	timer->calls++;
+	timer->total_ns += elapsed;
+	uint64_t current = timer->max_ns;
+	while (elapsed > current && !timer->max_ns.compare_exchange_weak(current, elapsed));
+	timer = NULL;
+
+}
+
+static void print_json_string(FILE * file, const char * value){
+
+	fputc('"', file);
+	for (const char * c = value; *c != '\0'; c++){
+		if (*c == '"' || *c == '\\') fputc('\\', file);
+		fputc(*c, file);
+	}
+	fputc('"', file);
+
+}
+
+/* the report is written once; later calls (e.g. the atexit handler after an explicit call) do nothing */
+void write_metrics_report(){
+
+	if (!metrics_enabled || report_filename == NULL) return;
+
+	lock_guard<mutex> guard(metrics_lock);
+
+	FILE * file = fopen(report_filename, "w");
+	if (file == NULL){
+		printf("WARNING: cannot open metrics report %s\n", report_filename);
+		return;
+	}
+
+	double wall_ms = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - metrics_start).count() / 1000.0;
+
+	fprintf(file, "{\n\t\"tool\": \"buildex\",\n\t\"wall_ms\": %.3f,\n", wall_ms);
+
+	fprintf(file, "\t\"counters\": {");
+	for (int i = 0; i < METRIC_NUM_COUNTERS; i++){
+		fprintf(file, "%s\n\t\t\"%s\": %llu", i == 0 ? "" : ",", counter_names[i], (unsigned long long)metric_counters[i].load());
+	}
+	fprintf(file, "\n\t},\n");
+
+	fprintf(file, "\t\"series\": {");
+	for (int i = 0; i < METRIC_NUM_SERIES; i++){
+		fprintf(file, "%s\n\t\t\"%s\": [", i == 0 ? "" : ",", series_names[i]);
+		for (uint32_t j = 0; j < series[i].size(); j++){
+			fprintf(file, "%s%llu", j == 0 ? "" : ", ", (unsigned long long)series[i][j]);
+		}
+		fprintf(file, "]");
+	}
+	fprintf(file, "\n\t},\n");
+
+	fprintf(file, "\t\"timers\": [");
+	for (uint32_t i = 0; i < num_timers; i++){
+		fprintf(file, "%s\n\t\t{ \"name\": ", i == 0 ? "" : ",");
+		print_json_string(file, timers[i].name);
+		fprintf(file, ", \"calls\": %llu, \"total_ms\": %.3f, \"max_ms\": %.3f }",
+			(unsigned long long)timers[i].calls.load(), timers[i].total_ns / 1e6, timers[i].max_ns / 1e6);
+	}
+	fprintf(file, "\n\t]\n}\n");
+
+	fclose(file);
+	free(report_filename);
+	report_filename = NULL;
+
+}
@@ -59,6 +59,7 @@ string operation_to_string(uint operation){
 	case op_or: return "|";
 	case op_concat: return ",";
 	case op_signex: return "SE";
+	case op_convert: return "CVT";
 	case op_full_overlap: return "FO";
 	case op_partial_overlap: return "PO";
 	case op_split_l: return "SL";
@@ -0,0 +1,31 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "utility/workers.h"
+
+using namespace std;
+
+static void worker_loop(atomic<uint32_t> * next, uint32_t jobs, function<void(uint32_t)> * work){
+
+	for (uint32_t job = (*next)++; job < jobs; job = (*next)++){
+		(*work)(job);
+	}
+
+}
+
+void run_workers(uint32_t threads, uint32_t jobs, function<void(uint32_t)> work){
+
+	atomic<uint32_t> next(0);
+
+	if (threads > jobs) threads = jobs;
+
+	vector<thread> pool;
+	for (uint32_t i = 0; i < threads; i++){
+		pool.push_back(thread(worker_loop, &next, jobs, &work));
+	}
+	for (uint32_t i = 0; i < pool.size(); i++){
+		pool[i].join();
+	}
+
+}
@@ -0,0 +1,65 @@
+#include <string>
+#include <iostream>
+
+#include "analysis/tree_analysis.h"
+#include "gtest/gtest.h"
+
+/* number_sampled_trees on trees numbered by raster position; only tree_num matters */
+
+static Conc_Tree * numbered_tree(int32_t tree_num){
+	Conc_Tree * tree = new Conc_Tree();
+	tree->tree_num = tree_num;
+	return tree;
+}
+
+static std::vector<int32_t> get_tree_nums(std::vector<Conc_Tree *> &trees){
+	std::vector<int32_t> nums;
+	for (int i = 0; i < trees.size(); i++) nums.push_back(trees[i]->tree_num);
+	return nums;
+}
+
+/* the sampling stride is not a gap, a sample of another cluster is */
+TEST(cluster_test, gaps_only_between_runs)
+{
+	std::vector< std::vector<Conc_Tree *> > clusters(2);
+	clusters[0].push_back(numbered_tree(0));
+	clusters[0].push_back(numbered_tree(20));
+	clusters[0].push_back(numbered_tree(40));
+	clusters[0].push_back(numbered_tree(-1)); /* initial definition */
+	clusters[1].push_back(numbered_tree(30));
+
+	/* 10 was sampled for cluster 0 but not kept */
+	std::vector< std::pair<int32_t, int32_t> > samples;
+	samples.push_back(std::make_pair(40, 0));
+	samples.push_back(std::make_pair(0, 0));
+	samples.push_back(std::make_pair(10, 0));
+	samples.push_back(std::make_pair(30, 1));
+	samples.push_back(std::make_pair(20, 0));
+
+	number_sampled_trees(clusters, samples);
+
+	std::vector<int32_t> expected;
+	expected.push_back(1);
+	expected.push_back(2);
+	expected.push_back(4);
+	expected.push_back(-1);
+	EXPECT_EQ(get_tree_nums(clusters[0]), expected);
+	EXPECT_EQ(clusters[1][0]->tree_num, 1);
+}
+
+TEST(cluster_test, contiguous_cluster_has_consecutive_numbers)
+{
+	std::vector< std::vector<Conc_Tree *> > clusters(2);
+	for (int i = 0; i < 4; i++) clusters[0].push_back(numbered_tree(i * 8));
+	clusters[1].push_back(numbered_tree(40));
+
+	std::vector< std::pair<int32_t, int32_t> > samples;
+	for (int i = 0; i < 5; i++) samples.push_back(std::make_pair(i * 8, 0));
+	samples.push_back(std::make_pair(40, 1));
+	samples.push_back(std::make_pair(48, 1));
+
+	number_sampled_trees(clusters, samples);
+
+	for (int i = 0; i < 4; i++) EXPECT_EQ(clusters[0][i]->tree_num, i + 1);
+	EXPECT_EQ(clusters[1][0]->tree_num, 1);
+}
@@ -0,0 +1,174 @@
+#include <sstream>
+
+#include "utility/defines.h"
+#include "trees/trees.h"
+#include "halide/halide.h"
+#include "halide/reduction.h"
+#include "gtest/gtest.h"
+
+/* Halide_Program printing of hand built funcs; buffers are one dimensional and one byte wide */
+
+static mem_regions_t * region(std::string name, uint32_t direction, std::vector<uint32_t> extents){
+	mem_regions_t * mem = new mem_regions_t();
+	mem->name = name;
+	mem->bytes_per_pixel = 1;
+	mem->dimensions = extents.size();
+	uint32_t stride = 1;
+	for (int i = 0; i < extents.size(); i++){
+		mem->extents[i] = extents[i];
+		mem->strides[i] = stride;
+		mem->min[i] = 0;
+		stride *= extents[i];
+	}
+	mem->trees_direction = direction;
+	mem->start = 0;
+	mem->end = stride;
+	return mem;
+}
+
+static Abs_Node * node(uint32_t type, uint32_t operation, uint64_t value){
+	Abs_Node * node = new Abs_Node();
+	node->type = type;
+	node->operation = operation;
+	node->symbol = new operand_t();
+	node->symbol->type = (type == Abs_Node::IMMEDIATE_INT) ? IMM_INT_TYPE : MEM_HEAP_TYPE;
+	node->symbol->width = 1;
+	node->symbol->value = value;
+	node->sign = false;
+	node->is_double = false;
+	node->mem_info.associated_mem = NULL;
+	return node;
+}
+
+/* immediates are affine in the variables - a constant has only the last coefficient */
+static Abs_Node * immediate(int value){
+	Abs_Node * imm = node(Abs_Node::IMMEDIATE_INT, op_assign, value);
+	imm->mem_info.head_dimensions = 1;
+	imm->mem_info.indexes = new int *[1];
+	imm->mem_info.indexes[0] = new int[2];
+	imm->mem_info.indexes[0][0] = 0;
+	imm->mem_info.indexes[0][1] = value;
+	return imm;
+}
+
+/* buffer access at (x_0, x_1, ..) */
+static Abs_Node * buffer(uint32_t type, mem_regions_t * mem){
+	uint32_t dims = mem->dimensions;
+	Abs_Node * buf = node(type, op_assign, 0);
+	buf->mem_info.associated_mem = mem;
+	buf->mem_info.dimensions = dims;
+	buf->mem_info.head_dimensions = dims;
+	buf->mem_info.indexes = new int *[dims];
+	buf->mem_info.pos = new int[dims];
+	for (int i = 0; i < dims; i++){
+		buf->mem_info.indexes[i] = new int[dims + 1];
+		for (int j = 0; j <= dims; j++) buf->mem_info.indexes[i][j] = (i == j);
+		buf->mem_info.pos[i] = 0;
+	}
+	return buf;
+}
+
+static std::string print_program(Halide_Program &program){
+	std::ostringstream stream;
+	std::vector<std::string> red_variables;
+	program.print_halide_program(stream, red_variables);
+	return stream.str();
+}
+
+static std::string get_line(std::string program, std::string prefix){
+	size_t start = program.find(prefix);
+	if (start == std::string::npos) return "";
+	return program.substr(start, program.find('\n', start) - start);
+}
+
+/* out(x) = 0; out(r.x) = out(r.x) + in(r.x) */
+static std::string print_sum_program(){
+
+	mem_regions_t * out = region("output_1", MEM_OUTPUT, std::vector<uint32_t>(1, 64));
+	mem_regions_t * in = region("input_1", MEM_INPUT, std::vector<uint32_t>(1, 64));
+
+	Abs_Tree * pure = new Abs_Tree();
+	Abs_Node * pure_head = buffer(Abs_Node::OUTPUT_NODE, out);
+	pure_head->add_forward_ref(immediate(0));
+	pure->set_head(pure_head);
+
+	Abs_Tree * update = new Abs_Tree();
+	Abs_Node * head = buffer(Abs_Node::OUTPUT_NODE, out);
+	head->operation = op_add;
+	head->add_forward_ref(buffer(Abs_Node::OUTPUT_NODE, out));
+	Abs_Node * input = buffer(Abs_Node::INPUT_NODE, in);
+	head->add_forward_ref(input);
+	update->set_head(head);
+
+	Halide_Program::RDom * rdom = new Halide_Program::RDom();
+	rdom->type = Halide_Program::EXTENTS;
+	rdom->red_node = head;
+	rdom->extents.push_back(std::make_pair(0, 63));
+	rdom->update = RED_NONE;
+
+	Halide_Program::Func * func = new Halide_Program::Func();
+	func->pure_trees.push_back(pure);
+	func->reduction_trees.push_back(std::make_pair(rdom, std::vector<Abs_Tree *>(1, update)));
+
+	Halide_Program program;
+	program.schedule = SCHEDULE_NONE;
+	program.populate_vars(1);
+	program.funcs.push_back(func);
+	program.inputs.push_back(input);
+	program.output.push_back(pure_head);
+
+	return print_program(program);
+
+}
+
+/* rfactor has to see old + e - the update is not saturated, the initial definition still is */
+TEST(halide_test, sum_update_is_not_saturated)
+{
+	std::string program = print_sum_program();
+	std::string update = get_line(program, "output_1(r_0.x) =");
+
+	EXPECT_NE(program.find("/* sum update (associative) */"), std::string::npos) << program;
+	EXPECT_EQ(update.find("clamp("), std::string::npos) << update;
+	EXPECT_EQ(update, "output_1(r_0.x) = cast<uint8_t>((output_1_buf_in(r_0.x) + input_1(r_0.x)));");
+	EXPECT_NE(get_line(program, "output_1(x_0) =").find("clamp("), std::string::npos) << program;
+}
+
+/* out(c, x, y) = in(c, x, y) over 3 channels */
+static std::string print_copy_program(uint32_t schedule){
+
+	std::vector<uint32_t> extents;
+	extents.push_back(3);
+	extents.push_back(64);
+	extents.push_back(32);
+	mem_regions_t * out = region("output_1", MEM_OUTPUT, extents);
+	mem_regions_t * in = region("input_1", MEM_INPUT, extents);
+
+	Abs_Tree * tree = new Abs_Tree();
+	Abs_Node * head = buffer(Abs_Node::OUTPUT_NODE, out);
+	Abs_Node * input = buffer(Abs_Node::INPUT_NODE, in);
+	head->add_forward_ref(input);
+	tree->set_head(head);
+
+	Halide_Program::Func * func = new Halide_Program::Func();
+	func->pure_trees.push_back(tree);
+
+	Halide_Program program;
+	program.schedule = schedule;
+	program.populate_vars(3);
+	program.funcs.push_back(func);
+	program.inputs.push_back(input);
+	program.output.push_back(head);
+
+	return print_program(program);
+
+}
+
+/* the colour dimension is unrolled - Halide needs its extent to be constant */
+TEST(halide_test, channels_are_bounded_before_unroll)
+{
+	uint32_t schedules[] = { SCHEDULE_PARALLEL, SCHEDULE_TILED, SCHEDULE_TUNABLE };
+	for (int i = 0; i < 3; i++){
+		std::string program = print_copy_program(schedules[i]);
+		EXPECT_NE(program.find(".reorder(x_1,x_0,x_2).bound(x_0,0,3).unroll(x_0)"), std::string::npos) << program;
+	}
+}
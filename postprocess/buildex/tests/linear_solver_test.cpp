@@ -0,0 +1,137 @@
+#include "utilities.h"
+#include "gtest/gtest.h"
+
+/* exact solver used for the buffer index abstraction; systems are affine - the last column is the constant */
+
+typedef std::vector<std::vector<int64_t> > system_t;
+
+static system_t make_system(int64_t * values, uint32_t rows, uint32_t cols){
+	system_t A(rows);
+	for (int i = 0; i < rows; i++){
+		A[i].assign(values + i * cols, values + (i + 1) * cols);
+	}
+	return A;
+}
+
+/* positions x = 0, 1, 2, 3 of a one dimensional head */
+static system_t line_system(){
+	int64_t values[] = { 0, 1, 1, 1, 2, 1, 3, 1 };
+	return make_system(values, 4, 2);
+}
+
+static std::vector<int64_t> make_rhs(int64_t a, int64_t b, int64_t c, int64_t d){
+	int64_t values[] = { a, b, c, d };
+	return std::vector<int64_t>(values, values + 4);
+}
+
+TEST(linear_solver_test, solves_affine_system)
+{
+	system_t A = line_system();
+	linear_solver_t solver;
+	ASSERT_TRUE(factor_linear_system(&solver, A));
+	EXPECT_EQ(solver.rank, 2);
+
+	/* b = 2x + 5 */
+	std::vector<int64_t> b = make_rhs(5, 7, 9, 11);
+	std::vector<int64_t> x;
+	ASSERT_TRUE(solve_linear_system(&solver, b, x));
+	ASSERT_EQ(x.size(), 2);
+	EXPECT_EQ(x[0], 2);
+	EXPECT_EQ(x[1], 5);
+}
+
+TEST(linear_solver_test, singular)
+{
+	/* the same position repeated - the constant and the coefficient cannot be told apart */
+	int64_t values[] = { 1, 1, 1, 1, 1, 1 };
+	system_t A = make_system(values, 3, 2);
+	linear_solver_t solver;
+	EXPECT_FALSE(factor_linear_system(&solver, A));
+	EXPECT_EQ(solver.rank, 1);
+
+	std::vector<int64_t> b(3, 4);
+	std::vector<int64_t> x;
+	EXPECT_FALSE(solve_linear_system(&solver, b, x));
+}
+
+TEST(linear_solver_test, inconsistent)
+{
+	system_t A = line_system();
+	linear_solver_t solver;
+	ASSERT_TRUE(factor_linear_system(&solver, A));
+
+	/* the basis rows give b = x, the last equation does not */
+	std::vector<int64_t> b = make_rhs(0, 1, 2, 4);
+	std::vector<int64_t> x;
+	EXPECT_FALSE(solve_linear_system(&solver, b, x));
+	EXPECT_TRUE(x.empty());
+}
+
+TEST(linear_solver_test, non_integral)
+{
+	/* b = x / 2 is consistent, but not a buffer index */
+	int64_t values[] = { 0, 1, 2, 1 };
+	system_t A = make_system(values, 2, 2);
+	linear_solver_t solver;
+	ASSERT_TRUE(factor_linear_system(&solver, A));
+
+	std::vector<int64_t> b(2);
+	b[0] = 0;
+	b[1] = 1;
+	std::vector<int64_t> x;
+	EXPECT_FALSE(solve_linear_system(&solver, b, x));
+	EXPECT_TRUE(x.empty());
+}
+
+TEST(linear_solver_test, batched)
+{
+	system_t A = line_system();
+	linear_solver_t solver;
+	ASSERT_TRUE(factor_linear_system(&solver, A));
+
+	system_t b;
+	b.push_back(make_rhs(3, 3, 3, 3));      /* 0x + 3 */
+	b.push_back(make_rhs(0, 1, 2, 4));      /* inconsistent */
+	b.push_back(make_rhs(9, 6, 3, 0));      /* -3x + 9 */
+	b.push_back(std::vector<int64_t>(3, 0)); /* one equation short */
+
+	system_t x;
+	EXPECT_EQ(solve_linear_system_batch(&solver, b, x), 2);
+	ASSERT_EQ(x.size(), 4);
+	ASSERT_EQ(x[0].size(), 2);
+	EXPECT_EQ(x[0][0], 0);
+	EXPECT_EQ(x[0][1], 3);
+	EXPECT_TRUE(x[1].empty());
+	ASSERT_EQ(x[2].size(), 2);
+	EXPECT_EQ(x[2][0], -3);
+	EXPECT_EQ(x[2][1], 9);
+	EXPECT_TRUE(x[3].empty());
+}
+
+TEST(linear_solver_test, overflow_in_factorization)
+{
+	/* eliminating the second row needs 2^62 - 2^-62, which has no 64 bit numerator */
+	int64_t big = (int64_t)1 << 62;
+	int64_t values[] = { big, 1, 1, big };
+	system_t A = make_system(values, 2, 2);
+	linear_solver_t solver;
+	EXPECT_FALSE(factor_linear_system(&solver, A));
+}
+
+TEST(linear_solver_test, overflow_in_solution)
+{
+	/* 4 * 2^62 wraps to 0, which would make the second equation look satisfied */
+	int64_t values[] = { 1, 4 };
+	system_t A = make_system(values, 2, 1);
+	linear_solver_t solver;
+	ASSERT_TRUE(factor_linear_system(&solver, A));
+
+	std::vector<int64_t> b(2);
+	b[0] = (int64_t)1 << 62;
+	b[1] = 0;
+	std::vector<int64_t> x;
+	EXPECT_FALSE(solve_linear_system(&solver, b, x));
+
+	b[0] = INT64_MIN;
+	EXPECT_FALSE(solve_linear_system(&solver, b, x));
+}
@@ -0,0 +1,84 @@
+#include <string>
+#include <iostream>
+
+#include "meminfo.h"
+#include "common_defines.h"
+#include "gtest/gtest.h"
+
+/* linking of the memory regions of a pc into higher dimensional regions, greedy and dp */
+
+static mem_info_t * row(uint64_t start, uint64_t end, uint32_t accesses){
+	mem_info_t * mem = new mem_info_t();
+	mem->type = MEM_HEAP_TYPE;
+	mem->direction = MEM_INPUT;
+	mem->start = start;
+	mem->end = end;
+	mem->prob_stride = 4;
+	mem->stride_freqs.push_back(std::make_pair(4u, accesses));
+	mem->padding_merge = false;
+	mem->order = 0;
+	return mem;
+}
+
+/* rows of 64 bytes with a pitch of 100 whose first row is cut by padding, an unrelated region and a small buffer */
+static std::vector<mem_info_t *> padded_layout(){
+	std::vector<mem_info_t *> mem;
+	mem.push_back(row(1000, 1040, 10));
+	for (int r = 1; r < 6; r++) mem.push_back(row(1000 + r * 100, 1000 + r * 100 + 64, 16));
+	mem.push_back(row(5000, 5016, 4));
+	for (int r = 0; r < 4; r++) mem.push_back(row(8000 + r * 32, 8000 + r * 32 + 16, 4));
+	return mem;
+}
+
+TEST(meminfo_test, greedy_leaves_the_cut_row)
+{
+	std::vector<mem_info_t *> mem = padded_layout();
+	link_mem_regions_greedy_dim(mem, 0);
+
+	ASSERT_EQ(mem.size(), 4);
+	EXPECT_EQ(mem[1]->start, 1100);
+	EXPECT_EQ(mem[1]->end, 1600);
+	EXPECT_EQ(mem[1]->mem_infos.size(), 5);
+}
+
+TEST(meminfo_test, dp_links_the_cut_row)
+{
+	std::vector<mem_info_t *> mem = padded_layout();
+	link_mem_regions_dp_dim(mem, 0);
+
+	ASSERT_EQ(mem.size(), 3);
+	EXPECT_EQ(mem[0]->start, 1000);
+	EXPECT_EQ(mem[0]->end, 1600);
+	ASSERT_EQ(mem[0]->mem_infos.size(), 6);
+	EXPECT_EQ(get_number_dimensions(mem[0]), 2);
+	EXPECT_TRUE(mem[0]->padding_merge);
+	for (int i = 0; i < 6; i++){
+		EXPECT_EQ(mem[0]->mem_infos[i]->end - mem[0]->mem_infos[i]->start, 64);
+	}
+
+	EXPECT_EQ(mem[1]->start, 5000);
+	EXPECT_EQ(mem[1]->end, 5016);
+	EXPECT_EQ(mem[2]->mem_infos.size(), 4);
+}
+
+/* a larger row is neither an interior nor an edge row - it splits the run and is not cut to the others */
+TEST(meminfo_test, dp_keeps_the_row_sizes)
+{
+	std::vector<mem_info_t *> mem;
+	for (int r = 0; r < 8; r++){
+		uint64_t size = (r == 3) ? 72 : (r == 7) ? 80 : 64;
+		mem.push_back(row(1000 + r * 100, 1000 + r * 100 + size, 16));
+	}
+
+	link_mem_regions_dp_dim(mem, 0);
+
+	ASSERT_EQ(mem.size(), 4);
+	EXPECT_EQ(mem[0]->mem_infos.size(), 3);
+	EXPECT_EQ(mem[1]->end - mem[1]->start, 72);
+	EXPECT_EQ(mem[2]->mem_infos.size(), 3);
+	EXPECT_EQ(mem[3]->end - mem[3]->start, 80);
+	for (int i = 0; i < 3; i++){
+		EXPECT_EQ(mem[0]->mem_infos[i]->end - mem[0]->mem_infos[i]->start, 64);
+		EXPECT_EQ(mem[2]->mem_infos[i]->end - mem[2]->mem_infos[i]->start, 64);
+	}
+}
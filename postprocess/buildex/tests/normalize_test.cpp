@@ -0,0 +1,241 @@
+#include <random>
+#include <map>
+#include <sstream>
+#include <cstring>
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+#include "utility/defines.h"
+#include "trees/trees.h"
+#include "gtest/gtest.h"
+
+/* Tree::normalize_tree against the separate passes it replaced, on generated concrete trees; every variant has to
+   evaluate to the value of the tree it started from. the trees only use shapes the rules rewrite soundly - products
+   are k * e with 0 < k < 10 and only appear as operands of a sum (the product is expanded into the parent), no
+   product has a second immediate (the immediates of a product are summed) and there is no or with -1 (a byte
+   approximation). the old passes free nodes while walking them (canonicalize_tree), so they run in a child process
+   and their crashes are only counted */
+
+#define NORMALIZE_TREES		500
+#define NORMALIZE_SAMPLES	4
+#define NORMALIZE_LEAVES	6
+
+static Node * leaf(uint32_t type, uint64_t value, uint32_t width = 4){
+	Node * node = new Conc_Node(type, value, width, 0);
+	node->sign = false;
+	return node;
+}
+
+static Node * op(int operation, uint32_t width = 4){
+	Node * node = leaf(REG_TYPE, DR_REG_VIRTUAL_1, width);
+	node->operation = operation;
+	return node;
+}
+
+struct generator_t {
+	std::mt19937 rng;
+	bool products;
+};
+
+static Node * generate_operand(generator_t &gen, uint32_t depth, bool under_add);
+
+static Node * generate_add(generator_t &gen, uint32_t depth){
+	Node * node = op(op_add);
+	uint32_t srcs = 1 + gen.rng() % 3;
+	for (int i = 0; i < srcs; i++){
+		node->add_forward_ref(generate_operand(gen, depth + 1, true));
+	}
+	return node;
+}
+
+static Node * generate_value(generator_t &gen, uint32_t depth){
+	if (depth < 4 && gen.rng() % 2 == 0) return generate_add(gen, depth);
+	return leaf(MEM_HEAP_TYPE, 100 + 4 * (gen.rng() % NORMALIZE_LEAVES));
+}
+
+static Node * generate_operand(generator_t &gen, uint32_t depth, bool under_add){
+
+	std::mt19937 &rng = gen.rng;
+	uint32_t choice = rng() % 8;
+	if (depth >= 4) choice = (choice < 5) ? 0 : 1;
+
+	switch (choice){
+	case 0: return leaf(MEM_HEAP_TYPE, 100 + 4 * (rng() % NORMALIZE_LEAVES));
+	case 1: return leaf(IMM_INT_TYPE, rng() % 4);
+	case 2: return generate_add(gen, depth);
+	case 3:
+	case 4:
+		if (under_add && gen.products){
+			Node * node = op(op_mul);
+			node->add_forward_ref(leaf(IMM_INT_TYPE, 1 + rng() % 9));
+			node->add_forward_ref(generate_value(gen, depth + 1));
+			return node;
+		}
+		return generate_add(gen, depth);
+	case 5:{
+		Node * node = op(op_assign);
+		node->add_forward_ref(generate_value(gen, depth + 1));
+		return node;
+	}
+	default:{
+		/* a partial overlap of the parent's width is dropped, of another width kept */
+		Node * node = op(op_partial_overlap, (rng() % 2) ? 4 : 2);
+		node->add_forward_ref(generate_value(gen, depth + 1));
+		return node;
+	}
+	}
+
+}
+
+static Node * generate_tree(uint32_t seed, bool products){
+	generator_t gen = { std::mt19937(seed), products };
+	Node * head = (gen.rng() % 2) ? op(op_assign) : generate_add(gen, 0);
+	if (head->operation == op_assign) head->add_forward_ref(generate_operand(gen, 0, false));
+	return head;
+}
+
+static uint32_t evaluate(Node * node, std::map<uint64_t, uint32_t> &values){
+
+	uint32_t value = 0;
+
+	if (node->srcs.size() == 0){
+		if (node->symbol->type == IMM_INT_TYPE) value = node->symbol->value;
+		else value = values[node->symbol->value];
+	}
+	else{
+		switch (node->operation){
+		case op_add:
+			for (int i = 0; i < node->srcs.size(); i++) value += evaluate(node->srcs[i], values);
+			break;
+		case op_sub:
+			value = evaluate(node->srcs[0], values);
+			for (int i = 1; i < node->srcs.size(); i++) value -= evaluate(node->srcs[i], values);
+			break;
+		case op_mul:
+			value = 1;
+			for (int i = 0; i < node->srcs.size(); i++) value *= evaluate(node->srcs[i], values);
+			break;
+		case op_assign:
+		case op_partial_overlap:
+			EXPECT_EQ(node->srcs.size(), 1);
+			value = evaluate(node->srcs[0], values);
+			break;
+		default:
+			ADD_FAILURE() << "unexpected operation " << node->operation;
+		}
+	}
+
+	return node->minus ? -value : value;
+
+}
+
+static void old_passes(Tree * tree){
+	tree->remove_assign_nodes();
+	tree->remove_multiplication();
+	tree->remove_po_nodes();
+	tree->canonicalize_tree();
+	tree->simplify_immediates();
+	tree->remove_identities();
+}
+
+typedef std::vector<std::map<uint64_t, uint32_t> > samples_t;
+
+static std::string tree_string(Tree * tree){
+	std::ostringstream stream;
+	tree->print_tree(stream);
+	return stream.str();
+}
+
+/* false if the old passes crashed; otherwise their values on the samples and the tree they produced */
+static bool run_old_passes(uint32_t seed, samples_t &samples, std::vector<uint32_t> &values, std::string &printed){
+
+#ifdef _WIN32
+	return false;
+#else
+	int fds[2];
+	if (pipe(fds) != 0) return false;
+
+	pid_t pid = fork();
+	if (pid == 0){
+		close(fds[0]);
+		Conc_Tree old;
+		old.set_head(generate_tree(seed, true));
+		old_passes(&old);
+		std::string output;
+		for (int i = 0; i < samples.size(); i++){
+			uint32_t value = evaluate(old.get_head(), samples[i]);
+			output.append((char *)&value, sizeof(value));
+		}
+		output += tree_string(&old);
+		if (write(fds[1], output.data(), output.size()) != output.size()) _exit(1);
+		_exit(0);
+	}
+	close(fds[1]);
+
+	std::string output;
+	char buffer[4096];
+	ssize_t amount;
+	while ((amount = read(fds[0], buffer, sizeof(buffer))) > 0) output.append(buffer, amount);
+	close(fds[0]);
+
+	int status;
+	waitpid(pid, &status, 0);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) return false;
+	if (output.size() < samples.size() * sizeof(uint32_t)) return false;
+
+	values.resize(samples.size());
+	for (int i = 0; i < samples.size(); i++){
+		memcpy(&values[i], output.data() + i * sizeof(uint32_t), sizeof(uint32_t));
+	}
+	printed = output.substr(samples.size() * sizeof(uint32_t));
+	return true;
+#endif
+
+}
+
+/* build_conc_tree folds with simplify_tree before normalizing; both orders have to keep the value */
+TEST(normalize_test, equivalent_to_separate_passes)
+{
+
+	std::mt19937 rng(1);
+	uint32_t crashed = 0, wrong = 0, same = 0;
+
+	for (uint32_t seed = 0; seed < NORMALIZE_TREES; seed++){
+
+		Conc_Tree original, fused, folded;
+		original.set_head(generate_tree(seed, true));
+		fused.set_head(generate_tree(seed, true));
+		folded.set_head(generate_tree(seed, true));
+
+		fused.normalize_tree(NORMALIZE_IDENTITIES);
+		folded.simplify_tree();
+		folded.normalize_tree(NORMALIZE_IDENTITIES);
+
+		samples_t samples(NORMALIZE_SAMPLES);
+		std::vector<uint32_t> expected;
+		for (int i = 0; i < NORMALIZE_SAMPLES; i++){
+			for (int j = 0; j < NORMALIZE_LEAVES; j++) samples[i][100 + 4 * j] = rng();
+
+			expected.push_back(evaluate(original.get_head(), samples[i]));
+			ASSERT_EQ(evaluate(fused.get_head(), samples[i]), expected[i]) << "normalize_tree, tree " << seed;
+			ASSERT_EQ(evaluate(folded.get_head(), samples[i]), expected[i]) << "simplify_tree + normalize_tree, tree " << seed;
+		}
+
+		std::vector<uint32_t> values;
+		std::string printed;
+		if (!run_old_passes(seed, samples, values, printed)) crashed++;
+		else if (values != expected) wrong++;
+		else if (printed == tree_string(&fused)) same++;
+
+	}
+
+	std::cout << NORMALIZE_TREES << " trees: the old passes crashed on " << crashed << ", changed the value of " << wrong
+		<< " and gave the normalize_tree result on " << same << std::endl;
+
+	/* where the old passes survive they reach the same tree, up to the order of operands they flattened late */
+	EXPECT_EQ(wrong, 0);
+	EXPECT_GE(same, (NORMALIZE_TREES - crashed) * 9 / 10);
+
+}
@@ -0,0 +1,56 @@
+#include "utility/defines.h"
+#include "trees/trees.h"
+#include "halide/reduction.h"
+#include "gtest/gtest.h"
+
+/* classify_reduction on one dimensional update definitions over out(r.x) */
+
+static mem_regions_t out_region;
+static mem_regions_t in_region;
+
+/* buffer read / write at index x + offset */
+static Abs_Node * buffer(uint32_t type, mem_regions_t * mem, int offset){
+	Abs_Node * node = new Abs_Node();
+	node->type = type;
+	node->operation = op_assign;
+	node->mem_info.associated_mem = mem;
+	node->mem_info.dimensions = 1;
+	node->mem_info.head_dimensions = 1;
+	node->mem_info.indexes = new int *[1];
+	node->mem_info.indexes[0] = new int[2];
+	node->mem_info.indexes[0][0] = 1;
+	node->mem_info.indexes[0][1] = offset;
+	return node;
+}
+
+/* out(x) = out(x + offset) + in(x) */
+static Abs_Tree * accumulate(int offset){
+	Abs_Tree * tree = new Abs_Tree();
+	Abs_Node * head = buffer(Abs_Node::OUTPUT_NODE, &out_region, 0);
+	head->operation = op_add;
+	head->add_forward_ref(buffer(Abs_Node::OUTPUT_NODE, &out_region, offset));
+	head->add_forward_ref(buffer(Abs_Node::INPUT_NODE, &in_region, 0));
+	tree->set_head(head);
+	return tree;
+}
+
+TEST(reduction_test, sum)
+{
+	Abs_Tree * tree = accumulate(0);
+	std::vector<Abs_Tree *> trees(1, tree);
+
+	EXPECT_TRUE(find_self_read(tree) != NULL);
+	EXPECT_EQ(classify_reduction(trees), RED_SUM);
+	delete tree;
+}
+
+TEST(reduction_test, prefix_sum_is_ordered)
+{
+	Abs_Tree * tree = accumulate(-1);
+	std::vector<Abs_Tree *> trees(1, tree);
+
+	/* self dependent, but through out(x - 1) - cannot be split with rfactor */
+	EXPECT_TRUE(find_self_read(tree) != NULL);
+	EXPECT_EQ(classify_reduction(trees), RED_NONE);
+	delete tree;
+}
@@ -0,0 +1,153 @@
+#include "utility/defines.h"
+#include "trees/trees.h"
+#include "gtest/gtest.h"
+
+/* Tree::simplify_tree on small concrete trees; the head is a register destination */
+
+static Node * leaf(uint32_t type, uint64_t value){
+	Node * node = new Conc_Node(type, value, 4, 0);
+	node->sign = false;
+	return node;
+}
+
+static Node * op(int operation, Node * first, Node * second = NULL){
+	Node * node = leaf(REG_TYPE, DR_REG_VIRTUAL_1);
+	node->operation = operation;
+	node->add_forward_ref(first);
+	if (second != NULL) node->add_forward_ref(second);
+	return node;
+}
+
+static Node * find_src(Node * node, uint32_t type, uint64_t value){
+	for (int i = 0; i < node->srcs.size(); i++){
+		if (node->srcs[i]->symbol->type == type && node->srcs[i]->symbol->value == value) return node->srcs[i];
+	}
+	return NULL;
+}
+
+static Node * find_op(Node * node, int operation){
+	for (int i = 0; i < node->srcs.size(); i++){
+		if (node->srcs[i]->operation == operation) return node->srcs[i];
+	}
+	return NULL;
+}
+
+TEST(simplify_test, constant_folding)
+{
+	Conc_Tree tree;
+	Node * x = leaf(MEM_HEAP_TYPE, 100);
+	tree.set_head(op(op_add, op(op_mul, leaf(IMM_INT_TYPE, 2), leaf(IMM_INT_TYPE, 3)), x));
+
+	tree.simplify_tree();
+
+	Node * head = tree.get_head();
+	EXPECT_EQ(head->operation, op_add);
+	ASSERT_EQ(head->srcs.size(), 2);
+	EXPECT_TRUE(find_src(head, IMM_INT_TYPE, 6) != NULL);
+	EXPECT_TRUE(find_src(head, MEM_HEAP_TYPE, 100) != NULL);
+}
+
+TEST(simplify_test, fold_negative_and_identities)
+{
+	Conc_Tree tree;
+	Node * x = leaf(MEM_HEAP_TYPE, 100);
+	/* x + (2 - 5) + 3 => x ; the head keeps its destination */
+	tree.set_head(op(op_add, op(op_add, x, op(op_sub, leaf(IMM_INT_TYPE, 2), leaf(IMM_INT_TYPE, 5))), leaf(IMM_INT_TYPE, 3)));
+
+	tree.simplify_tree();
+
+	Node * head = tree.get_head();
+	EXPECT_EQ(head->operation, op_assign);
+	ASSERT_EQ(head->srcs.size(), 1);
+	EXPECT_EQ(head->srcs[0], x);
+}
+
+TEST(simplify_test, flattening)
+{
+	Conc_Tree tree;
+	Node * x = leaf(MEM_HEAP_TYPE, 100);
+	Node * y = leaf(MEM_HEAP_TYPE, 104);
+	Node * z = leaf(MEM_HEAP_TYPE, 108);
+	tree.set_head(op(op_add, x, op(op_add, y, op(op_add, z, leaf(REG_TYPE, DR_REG_VIRTUAL_2)))));
+
+	tree.simplify_tree();
+
+	Node * head = tree.get_head();
+	EXPECT_EQ(head->operation, op_add);
+	EXPECT_EQ(head->srcs.size(), 4);
+	EXPECT_TRUE(find_op(head, op_add) == NULL);
+}
+
+TEST(simplify_test, minus_chain_is_not_flattened)
+{
+	Conc_Tree tree;
+	Node * x = leaf(MEM_HEAP_TYPE, 100);
+	Node * inner = op(op_add, leaf(MEM_HEAP_TYPE, 104), leaf(MEM_HEAP_TYPE, 108));
+	inner->minus = true;
+	tree.set_head(op(op_add, x, inner));
+
+	tree.simplify_tree();
+
+	Node * head = tree.get_head();
+	EXPECT_EQ(head->srcs.size(), 2);
+	EXPECT_EQ(find_op(head, op_add), inner);
+}
+
+TEST(simplify_test, linear_terms)
+{
+	Conc_Tree tree;
+	Node * x = leaf(MEM_HEAP_TYPE, 100);
+	Node * y = leaf(MEM_HEAP_TYPE, 104);
+	/* 3 * x + x + y => 4 * x + y */
+	tree.set_head(op(op_add, op(op_add, op(op_mul, leaf(IMM_INT_TYPE, 3), x), x), y));
+
+	tree.simplify_tree();
+
+	Node * head = tree.get_head();
+	ASSERT_EQ(head->srcs.size(), 2);
+	Node * mul = find_op(head, op_mul);
+	ASSERT_TRUE(mul != NULL);
+	EXPECT_FALSE(mul->minus);
+	EXPECT_TRUE(find_src(mul, IMM_INT_TYPE, 4) != NULL);
+	EXPECT_TRUE(find_src(mul, MEM_HEAP_TYPE, 100) != NULL);
+}
+
+TEST(simplify_test, linear_terms_minus_product)
+{
+	Conc_Tree tree;
+	Node * x = leaf(MEM_HEAP_TYPE, 100);
+	Node * y = leaf(MEM_HEAP_TYPE, 104);
+	/* x + -(3 * x) + y => -(2 * x) + y, not 4 * x */
+	Node * mul = op(op_mul, leaf(IMM_INT_TYPE, 3), x);
+	mul->minus = true;
+	tree.set_head(op(op_add, op(op_add, x, mul), y));
+
+	tree.simplify_tree();
+
+	Node * head = tree.get_head();
+	ASSERT_EQ(head->srcs.size(), 2);
+	ASSERT_EQ(find_op(head, op_mul), mul);
+	EXPECT_TRUE(mul->minus);
+	EXPECT_TRUE(find_src(mul, IMM_INT_TYPE, 2) != NULL);
+}
+
+TEST(simplify_test, linear_terms_minus_product_reuses_plain_product)
+{
+	Conc_Tree tree;
+	Node * x = leaf(MEM_HEAP_TYPE, 100);
+	Node * y = leaf(MEM_HEAP_TYPE, 104);
+	/* 5 * x + -(3 * x) + y => 2 * x + y */
+	Node * plain = op(op_mul, leaf(IMM_INT_TYPE, 5), x);
+	Node * negated = op(op_mul, leaf(IMM_INT_TYPE, 3), x);
+	negated->minus = true;
+	tree.set_head(op(op_add, op(op_add, plain, negated), y));
+
+	tree.simplify_tree();
+
+	Node * head = tree.get_head();
+	ASSERT_EQ(head->srcs.size(), 2);
+	Node * mul = find_op(head, op_mul);
+	ASSERT_TRUE(mul != NULL);
+	EXPECT_FALSE(mul->minus);
+	EXPECT_TRUE(find_src(mul, IMM_INT_TYPE, 2) != NULL);
+}
@@ -1,4 +1,3 @@
-#include <Windows.h>
 #include <stdio.h>
 #include <iostream>
 #include <vector>
@@ -10,13 +9,13 @@
 #include <sys/types.h>
 #include <assert.h>
 
-#include  "..\..\..\dr_clients\include\output.h"
-#include "utility\fileparser.h"
-#include "utility\defines.h"
+#include  "../../../dr_clients/include/output.h"
+#include "utility/fileparser.h"
+#include "utility/defines.h"
 
-#include "analysis\staticinfo.h"
-#include "analysis\preprocess.h"
-#include "analysis\tree_analysis.h"
+#include "analysis/staticinfo.h"
+#include "analysis/preprocess.h"
+#include "analysis/tree_analysis.h"
 
 
 #include "utilities.h"
@@ -30,9 +29,9 @@ using namespace std;
 
 bool debug = false;
 uint32_t debug_level = 0;
-ofstream log_file;
+thread_local ofstream log_file;
 
-uint32_t Tree::num_paras = 0;
+thread_local uint32_t Tree::num_paras = 0;
 
 
 void print_usage(){
@@ -157,16 +156,15 @@ int main(int argc, char ** argv){
 
 
 	/* get the instrace file with the largest size */
-	struct _stat buf;
 	int64_t max_size = -1;
 	/* get the instrace files for this exec */
 	for (int i = 0; i < files.size(); i++){
 		if (is_prefix(files[i], "instrace_" + exec + "_" + in_image + "_instr")){
 			/*open the file*/
-			string file = output_folder + "\\" + files[i];
-			_stat(file.c_str(), &buf);
-			if (max_size < buf.st_size){
-				max_size = buf.st_size;
+			string file = join_path(output_folder, files[i]);
+			int64_t size = get_file_size(file);
+			if (max_size < size){
+				max_size = size;
 				instrace_filename = file;
 			}
 
@@ -183,10 +181,10 @@ int main(int argc, char ** argv){
 	for (int i = 0; i < files.size(); i++){
 		if (is_prefix(files[i], "instrace_" + exec + "_" + in_image + "_asm_instr")){
 			/*open the file*/
-			string file = output_folder + "\\" + files[i];
-			_stat(file.c_str(), &buf);
-			if (max_size < buf.st_size){
-				max_size = buf.st_size;
+			string file = join_path(output_folder, files[i]);
+			int64_t size = get_file_size(file);
+			if (max_size < size){
+				max_size = size;
 				disasm_filename = file;
 			}
 
@@ -218,6 +216,15 @@ int main(int argc, char ** argv){
 	/* need to filter unwanted instrs from the file we got */
 	vec_cinstr instrs_forward = filter_instr_trace(start_pc, end_pc, instrs_forward_unfiltered);
 
+	/*preprocessing*/
+	vector<uint32_t> start_pcs;
+	vector<uint32_t> end_pcs;
+	start_pcs.push_back(start_pc);
+	end_pcs.push_back(end_pc);
+
+	update_floating_point_regs(instrs_forward, start_pcs, end_pcs);
+	DEBUG_PRINT(("updated forward instr's floating point regs\n"), 2);
+
 	/* make a copy for the backwards analysis */
 	vec_cinstr instrs_backward;
 	for (int i = instrs_forward.size() - 1; i >= 0; i--){
@@ -228,21 +235,6 @@ int main(int argc, char ** argv){
 
 	DEBUG_PRINT(("number of dynamic instructions : %d\n", instrs_backward.size()), 2);
 
-	/*preprocessing*/
-	update_regs_to_mem_range(instrs_backward);
-	update_regs_to_mem_range(instrs_forward);
-
-	
-
-	vector<uint32_t> start_pcs;
-	vector<uint32_t> end_pcs;
-	start_pcs.push_back(start_pc);
-
-	update_floating_point_regs(instrs_backward, BACKWARD_ANALYSIS, static_info, start_pcs);
-	DEBUG_PRINT(("updated backward instr's floating point regs\n"), 2);
-	update_floating_point_regs(instrs_forward, FORWARD_ANALYSIS, static_info, start_pcs);
-	DEBUG_PRINT(("updated forward instr's floating point regs\n"), 2);
-
 
 	/************************************************************************/
 	/*        reducing instructions				                            */
@@ -251,8 +243,8 @@ int main(int argc, char ** argv){
 	
 	for (int i = 0; i < instrs_forward.size(); i++){
 		int amount = 0;
-		rinstr_t *  rinstr = cinstr_to_rinstrs(instrs_forward[i].first, amount, instrs_forward[i].second->disassembly, i);
-		delete rinstr;
+		rinstr_t rinstr[MAX_RINSTRS];
+		cinstr_to_rinstrs(instrs_forward[i].first, rinstr, amount, instrs_forward[i].second->disassembly, i);
 	}
 
 
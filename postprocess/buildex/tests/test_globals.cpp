@@ -0,0 +1,18 @@
+#include <fstream>
+#include <stdint.h>
+
+#include "trees/trees.h"
+#include "common_defines.h"
+
+/* globals the buildex core expects from its executable */
+
+bool debug = false;
+uint32_t debug_level = 0;
+thread_local std::ofstream log_file;
+
+thread_local uint32_t Tree::num_paras = 0;
+
+bool conctree_opt = true;
+bool abstree_opt = false;
+bool debug_tree = false;
+uint32_t fraction = 1;
@@ -0,0 +1,347 @@
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "analysis/x86_analysis.h"
+#include "analysis/x86_semantics.h"
+#include "utility/defines.h"
+#include "utility/print_helper.h"
+#include "gtest/gtest.h"
+
+/* cinstr_to_rinstrs driven by the semantics table */
+
+static operand_t opnd(uint32_t type, uint32_t width, uint64_t value){
+	operand_t operand = { type, width, value, NULL };
+	return operand;
+}
+
+static cinstr_t make_cinstr(uint32_t opcode, operand_t dst, operand_t src){
+	cinstr_t cinstr;
+	memset(&cinstr, 0, sizeof(cinstr));
+	cinstr.opcode = opcode;
+	cinstr.num_dsts = 1;
+	cinstr.num_srcs = 1;
+	cinstr.dsts[0] = dst;
+	cinstr.srcs[0] = src;
+	return cinstr;
+}
+
+/* movss xmm, m32 - low 32 bits loaded, bits 127:32 zeroed */
+TEST(x86_semantics_test, movss_load_zeroes_upper_bits)
+{
+	cinstr_t cinstr = make_cinstr(OP_movss, opnd(REG_TYPE, 16, 64), opnd(MEM_HEAP_TYPE, 4, 1000));
+	rinstr_t rinstr[MAX_RINSTRS];
+	int amount;
+
+	ASSERT_TRUE(cinstr_to_rinstrs(&cinstr, rinstr, amount, "", 0) != NULL);
+	ASSERT_EQ(amount, 2);
+	EXPECT_EQ(rinstr[0].dst.type, REG_TYPE);
+	EXPECT_EQ(rinstr[0].dst.width, 4);
+	EXPECT_EQ(rinstr[0].dst.value, 64 + 12);
+	EXPECT_EQ(rinstr[0].srcs[0].value, 1000);
+	EXPECT_EQ(rinstr[1].dst.width, 12);
+	EXPECT_EQ(rinstr[1].dst.value, 64);
+	EXPECT_EQ(rinstr[1].srcs[0].type, IMM_INT_TYPE);
+	EXPECT_EQ(rinstr[1].srcs[0].value, 0);
+}
+
+/* movss xmm, xmm and movss m32, xmm - only the low 32 bits are written */
+TEST(x86_semantics_test, movss_keeps_upper_bits)
+{
+	cinstr_t forms[2] = {
+		make_cinstr(OP_movss, opnd(REG_TYPE, 16, 64), opnd(REG_TYPE, 16, 96)),
+		make_cinstr(OP_movss, opnd(MEM_STACK_TYPE, 4, 2000), opnd(REG_TYPE, 16, 96))
+	};
+
+	for (int i = 0; i < 2; i++){
+		rinstr_t rinstr[MAX_RINSTRS];
+		int amount;
+		ASSERT_TRUE(cinstr_to_rinstrs(&forms[i], rinstr, amount, "", 0) != NULL);
+		EXPECT_EQ(amount, 1);
+		EXPECT_EQ(rinstr[0].dst.width, 4);
+		EXPECT_EQ(rinstr[0].srcs[0].width, 4);
+	}
+}
+
+/* movsd xmm, m64 - low 64 bits loaded, bits 127:64 zeroed */
+TEST(x86_semantics_test, movsd_load_zeroes_upper_bits)
+{
+	cinstr_t cinstr = make_cinstr(OP_movsd, opnd(REG_TYPE, 16, 64), opnd(MEM_HEAP_TYPE, 8, 1000));
+	rinstr_t rinstr[MAX_RINSTRS];
+	int amount;
+
+	ASSERT_TRUE(cinstr_to_rinstrs(&cinstr, rinstr, amount, "", 0) != NULL);
+	ASSERT_EQ(amount, 2);
+	EXPECT_EQ(rinstr[0].dst.width, 8);
+	EXPECT_EQ(rinstr[0].dst.value, 64 + 8);
+	EXPECT_EQ(rinstr[0].srcs[0].value, 1000);
+	EXPECT_EQ(rinstr[0].srcs[0].width, 8);
+	EXPECT_EQ(rinstr[1].dst.width, 8);
+	EXPECT_EQ(rinstr[1].dst.value, 64);
+	EXPECT_EQ(rinstr[1].srcs[0].type, IMM_INT_TYPE);
+	EXPECT_EQ(rinstr[1].srcs[0].value, 0);
+}
+
+/* movsd xmm, xmm and movsd m64, xmm - only the low 64 bits are written */
+TEST(x86_semantics_test, movsd_keeps_upper_bits)
+{
+	cinstr_t forms[2] = {
+		make_cinstr(OP_movsd, opnd(REG_TYPE, 16, 64), opnd(REG_TYPE, 16, 96)),
+		make_cinstr(OP_movsd, opnd(MEM_STACK_TYPE, 8, 2000), opnd(REG_TYPE, 16, 96))
+	};
+	uint64_t low[2] = { 64 + 8, 2000 };
+
+	for (int i = 0; i < 2; i++){
+		rinstr_t rinstr[MAX_RINSTRS];
+		int amount;
+		ASSERT_TRUE(cinstr_to_rinstrs(&forms[i], rinstr, amount, "", 0) != NULL);
+		ASSERT_EQ(amount, 1);
+		EXPECT_EQ(rinstr[0].dst.width, 8);
+		EXPECT_EQ(rinstr[0].dst.value, low[i]);
+		EXPECT_EQ(rinstr[0].srcs[0].width, 8);
+		EXPECT_EQ(rinstr[0].srcs[0].value, 96 + 8);
+	}
+}
+
+/* cvtsi2sd xmm, r32 and cvttss2si r32, xmm - a conversion of the low lane */
+TEST(x86_semantics_test, cvt_converts_low_lane)
+{
+	cinstr_t to_double = make_cinstr(OP_cvtsi2sd, opnd(REG_TYPE, 16, 64), opnd(REG_TYPE, 4, 4));
+	cinstr_t to_int = make_cinstr(OP_cvttss2si, opnd(REG_TYPE, 4, 4), opnd(REG_TYPE, 16, 96));
+	rinstr_t rinstr[MAX_RINSTRS];
+	int amount;
+
+	ASSERT_TRUE(cinstr_to_rinstrs(&to_double, rinstr, amount, "", 0) != NULL);
+	ASSERT_EQ(amount, 1);
+	EXPECT_EQ(rinstr[0].operation, op_convert);
+	EXPECT_EQ(rinstr[0].dst.width, 8);
+	EXPECT_EQ(rinstr[0].dst.value, 64 + 8);
+	EXPECT_EQ(rinstr[0].srcs[0].width, 4);
+	EXPECT_EQ(rinstr[0].srcs[0].value, 4);
+
+	ASSERT_TRUE(cinstr_to_rinstrs(&to_int, rinstr, amount, "", 0) != NULL);
+	ASSERT_EQ(amount, 1);
+	EXPECT_EQ(rinstr[0].operation, op_convert);
+	EXPECT_EQ(rinstr[0].dst.width, 4);
+	EXPECT_EQ(rinstr[0].dst.value, 4);
+	EXPECT_EQ(rinstr[0].srcs[0].width, 4);
+	EXPECT_EQ(rinstr[0].srcs[0].value, 96 + 12);
+}
+
+/* vcvtsi2ss xmm, xmm, r32 - bits 127:32 from the first source, the low lane converted from the second */
+TEST(x86_semantics_test, vcvt_merges_upper_bits)
+{
+	cinstr_t cinstr = make_cinstr(OP_vcvtsi2ss, opnd(REG_TYPE, 16, 64), opnd(REG_TYPE, 16, 128));
+	cinstr.num_srcs = 2;
+	cinstr.srcs[1] = opnd(REG_TYPE, 4, 4);
+	rinstr_t rinstr[MAX_RINSTRS];
+	int amount;
+
+	ASSERT_TRUE(cinstr_to_rinstrs(&cinstr, rinstr, amount, "", 0) != NULL);
+	ASSERT_EQ(amount, 2);
+	EXPECT_EQ(rinstr[0].operation, op_assign);
+	EXPECT_EQ(rinstr[0].dst.width, 12);
+	EXPECT_EQ(rinstr[0].dst.value, 64);
+	EXPECT_EQ(rinstr[0].srcs[0].width, 12);
+	EXPECT_EQ(rinstr[0].srcs[0].value, 128);
+	EXPECT_EQ(rinstr[1].operation, op_convert);
+	EXPECT_EQ(rinstr[1].dst.width, 4);
+	EXPECT_EQ(rinstr[1].dst.value, 64 + 12);
+	EXPECT_EQ(rinstr[1].srcs[0].value, 4);
+}
+
+/* the table against the opcode switch it replaced. the switch decoded generated operands (every count of dsts and
+   srcs, repeated sources, exchanged operands, random eflags) of each opcode it handled; its output on the counts it
+   handled for every operand is kept as a checksum. opcodes whose reduction was fixed with the table (movss, pmuldq,
+   setnz, cmovnle, vaddsd, vmulsd, fsubr, the cvt conversions) and xchg / fxch, handled only for some operands, are
+   not compared */
+
+struct reference_t {
+	uint32_t opcode;
+	uint32_t forms;			/* bit num_dsts * 5 + num_srcs - handled by the switch */
+	uint64_t checksum;		/* fnv-1a of the reductions, cinstr_to_rinstrs then cinstr_to_rinstrs_eflags */
+};
+
+static const reference_t reference[] = {
+	{ OP_push_imm, 0x1000, 0x6fa08016ffa3ca7dull },
+	{ OP_push, 0x1000, 0xd1074929c76f4e4dull },
+	{ OP_pop, 0x1000, 0x91e15901655b6d3full },
+	{ OP_mov_st, 0x00c0, 0x5f9e2c28b4fb8fc1ull },
+	{ OP_mov_ld, 0x00c0, 0xafb2bc3f2eedb41dull },
+	{ OP_mov_imm, 0x00c0, 0xdece0d50baa24bb5ull },
+	{ OP_movzx, 0x00c0, 0x6309a7071b1f80c3ull },
+	{ OP_movsx, 0x00c0, 0xcfeb55856ede30f5ull },
+	{ OP_movq, 0x00c0, 0x5032aec6a2c2a3c7ull },
+	{ OP_movd, 0x00c0, 0xd6c3200f433fbe4dull },
+	{ OP_movapd, 0x00c0, 0x7f5e5dbb870a620bull },
+	{ OP_movdqa, 0x00c0, 0x5e58c2af4b20c075ull },
+	{ OP_mov_seg, 0x00c0, 0x30b8b03d0c1d3de5ull },
+	{ OP_movaps, 0x00c0, 0xf2ddb75eb5cb1a65ull },
+	{ OP_vmovss, 0x00c0, 0x0dd7696867861127ull },
+	{ OP_vmovsd, 0x00c0, 0x39f38cb9bf68c15dull },
+	{ OP_vmulss, 0x0080, 0xc3e5d6547d8af331ull },
+	{ OP_imul, 0x1080, 0xda25d5fec47b67c5ull },
+	{ OP_mul, 0x1000, 0x2d2f6f129129a26full },
+	{ OP_idiv, 0x2000, 0x497544ad8355f89dull },
+	{ OP_cdq, 0x0040, 0xcc60d4106a3fa7b1ull },
+	{ OP_cwde, 0x0040, 0xedc3bab46948235full },
+	{ OP_xorps, 0x0080, 0xe8ca40b168c53c47ull },
+	{ OP_xor, 0x0080, 0xfa3005de7c7dd661ull },
+	{ OP_sub, 0x0080, 0xe3a3b348ff648d27ull },
+	{ OP_pxor, 0x0080, 0xfa71a01113491973ull },
+	{ OP_psubd, 0x0080, 0x2ad8a8bd8850e573ull },
+	{ OP_add, 0x0080, 0x793287d1c498a3d3ull },
+	{ OP_and, 0x0080, 0xdca0ff250443a36bull },
+	{ OP_or, 0x0080, 0x224e926ad1df9771ull },
+	{ OP_andpd, 0x0080, 0x7fcfe160f4ce4975ull },
+	{ OP_neg, 0x0040, 0x7ffe56c34ae62245ull },
+	{ OP_dec, 0x0040, 0x890b5195e744e105ull },
+	{ OP_inc, 0x0040, 0xe352fa1c91c27395ull },
+	{ OP_sar, 0x0080, 0xd801e3dc799f1afbull },
+	{ OP_shr, 0x0080, 0x8d294fbd31e74053ull },
+	{ OP_psrlq, 0x0080, 0xe1bd4dd0cfbbcdbdull },
+	{ OP_shl, 0x0080, 0x815535fe391f545dull },
+	{ OP_psllq, 0x0080, 0xdf25c81fab577797ull },
+	{ OP_not, 0x0040, 0x47b2075fb0aa5e35ull },
+	{ OP_lea, 0x0200, 0x64383e9544ef7f51ull },
+	{ OP_sbb, 0x0080, 0xc00008c931805ab5ull },
+	{ OP_adc, 0x0080, 0x507841df5c313b57ull },
+	{ OP_cmovle, 0x0080, 0xabf8250f525078e3ull },
+	{ OP_cmovl, 0x0080, 0x71e3531d6cd25315ull },
+	{ OP_cmovnl, 0x0080, 0x2deb2cc16b46523dull },
+	{ OP_cmovz, 0x0080, 0x4d9dd9c857b8b077ull },
+	{ OP_cmovns, 0x0080, 0x580a1a42f82b20c5ull },
+	{ OP_cmovnz, 0x0080, 0x2c346c0c81f7e77dull },
+	{ OP_setz, 0x0020, 0xd8590701c8f192c5ull },
+	{ OP_sets, 0x0020, 0xf6f3a7d226efd265ull },
+	{ OP_setns, 0x0020, 0x951476b8595bf9e3ull },
+	{ OP_setb, 0x0020, 0xf7a08c371484f5c5ull },
+	{ OP_xadd, 0x1000, 0xbc748202209ead33ull },
+	{ OP_fld, 0x0040, 0xc3520dd1ae5b2109ull },
+	{ OP_fld1, 0x0040, 0x06f09e07bd741f2dull },
+	{ OP_fild, 0x0040, 0xdebee055a94330ddull },
+	{ OP_fldz, 0x0040, 0x97a0a4ad75361cc5ull },
+	{ OP_fst, 0x0040, 0x078f8f038b30859dull },
+	{ OP_fstp, 0x0040, 0xb9adb5c59cd62393ull },
+	{ OP_fistp, 0x0040, 0x1490147d49b8e885ull },
+	{ OP_fmul, 0x0080, 0x7a20cf32bab05bddull },
+	{ OP_fmulp, 0x0080, 0x32508790077d442full },
+	{ OP_faddp, 0x0080, 0xab7a203a6774ecbdull },
+	{ OP_fadd, 0x0080, 0xcb26f22a076306c5ull },
+	{ OP_fsubp, 0x0080, 0x006386bc0a7acccbull },
+	{ OP_fsub, 0x0080, 0x7ec32e774a269c15ull },
+	{ OP_fdivp, 0x0080, 0xb440c62634e758ffull },
+	{ OP_fdiv, 0x0080, 0xa406a54194dc0455ull },
+	{ OP_btr, 0x7fff, 0xac8ee0ade89c8b65ull },
+	{ OP_cmpxchg, 0x7fff, 0xac8ee0ade89c8b65ull },
+	{ OP_rep_stos, 0x7fff, 0xac8ee0ade89c8b65ull },
+	{ OP_cld, 0x7fff, 0xac8ee0ade89c8b65ull },
+	{ OP_jbe, 0x7fff, 0xac8ee0ade89c8b65ull },
+	{ OP_fcom, 0x7fff, 0xac8ee0ade89c8b65ull },
+	{ OP_fcomp, 0x7fff, 0xac8ee0ade89c8b65ull },
+	{ OP_jmp, 0x7fff, 0xac8ee0ade89c8b65ull },
+	{ OP_jz, 0x7fff, 0xac8ee0ade89c8b65ull },
+	{ OP_jnz_short, 0x7fff, 0xac8ee0ade89c8b65ull },
+	{ OP_cmp, 0x0004, 0x665860f39fa9df71ull },
+	{ OP_test, 0x0004, 0x0665b93118e71495ull },
+	{ OP_call, 0x7fff, 0xac8ee0ade89c8b65ull },
+	{ OP_ret, 0x7fff, 0xac8ee0ade89c8b65ull },
+	{ OP_enter, 0x7fff, 0xac8ee0ade89c8b65ull },
+	{ OP_leave, 0x7fff, 0xac8ee0ade89c8b65ull },
+	{ OP_fldcw, 0x7fff, 0xac8ee0ade89c8b65ull },
+	{ OP_fnstsw, 0x7fff, 0xac8ee0ade89c8b65ull },
+	{ OP_nop, 0x7fff, 0xac8ee0ade89c8b65ull },
+	{ OP_nop_modrm, 0x7fff, 0xac8ee0ade89c8b65ull },
+	{ OP_fwait, 0x7fff, 0xac8ee0ade89c8b65ull },
+	{ OP_stmxcsr, 0x7fff, 0xac8ee0ade89c8b65ull },
+};
+
+static operand_t random_opnd(std::mt19937 &rng){
+	static const uint32_t widths[] = { 1, 2, 4, 8, 16 };
+	operand_t operand;
+	uint32_t type = rng() % 4;
+	operand.type = (type == 0) ? REG_TYPE : (type == 1) ? MEM_HEAP_TYPE : (type == 2) ? IMM_INT_TYPE : MEM_STACK_TYPE;
+	operand.width = widths[rng() % 5];
+	operand.value = (rng() % 3 == 0) ? 0 : 64 + rng() % 8 * 16;
+	operand.addr = NULL;
+	return operand;
+}
+
+static std::string operand_string(const operand_t &operand){
+	return "(" + std::to_string(operand.type) + "," + std::to_string(operand.width) + "," + std::to_string(operand.value) + ")";
+}
+
+static std::string reduce_string(uint32_t index, uint32_t opcode, uint32_t num_dsts, uint32_t num_srcs, uint32_t rep, bool eflags){
+
+	std::mt19937 rng(index * 1000 + num_dsts * 100 + num_srcs * 10 + rep);
+	cinstr_t cinstr;
+	memset(&cinstr, 0, sizeof(cinstr));
+	cinstr.opcode = opcode;
+	cinstr.num_dsts = num_dsts;
+	cinstr.num_srcs = num_srcs;
+	for (int i = 0; i < 4; i++){
+		cinstr.dsts[i] = random_opnd(rng);
+		cinstr.srcs[i] = random_opnd(rng);
+	}
+	if (rep >= 3 && num_srcs >= 2) cinstr.srcs[1] = cinstr.srcs[0];
+	if (rep == 4 && num_dsts >= 2 && num_srcs >= 2){ cinstr.dsts[0] = cinstr.srcs[0]; cinstr.dsts[1] = cinstr.srcs[1]; }
+	if (rep == 5 && num_srcs >= 3) cinstr.srcs[2].value = 0;
+	cinstr.eflags = rng() & 0xffff;
+
+	rinstr_t storage[MAX_RINSTRS];
+	int amount = 0;
+	rinstr_t * rinstr = eflags ? cinstr_to_rinstrs_eflags(&cinstr, storage, amount, "", 0) : cinstr_to_rinstrs(&cinstr, storage, amount, "", 0);
+
+	std::string ret = std::string(rinstr ? "R" : "N") + " amount " + std::to_string(amount);
+	for (int i = 0; rinstr && i < amount; i++){
+		ret += " [" + std::to_string(rinstr[i].operation) + " " + operand_string(rinstr[i].dst);
+		for (int j = 0; j < rinstr[i].num_srcs; j++) ret += operand_string(rinstr[i].srcs[j]);
+		ret += " " + std::to_string(rinstr[i].sign) + " " + std::to_string(rinstr[i].is_floating) + "]";
+	}
+	return ret + "\n";
+
+}
+
+/* operands are seeded by the position of the opcode in the decoder comparison, fixed opcodes included */
+static const uint32_t compared_opcodes[] = { OP_movss, OP_pmuldq, OP_push_imm, OP_push, OP_pop, OP_mov_st, OP_mov_ld,
+	OP_mov_imm, OP_movzx, OP_movsx, OP_movq, OP_movd, OP_movapd, OP_movdqa, OP_mov_seg, OP_movaps, OP_vmovss, OP_vmovsd,
+	OP_vcvtsi2ss, OP_vcvtsi2sd, OP_vcvttss2si, OP_vcvttsd2si, OP_cvttsd2si, OP_vmulss, OP_vmulsd, OP_vaddsd, OP_imul,
+	OP_mul, OP_idiv, OP_cdq, OP_cwde, OP_xchg, OP_xorps, OP_xor, OP_sub, OP_pxor, OP_psubd, OP_add, OP_and, OP_or,
+	OP_andpd, OP_neg, OP_dec, OP_inc, OP_sar, OP_shr, OP_psrlq, OP_shl, OP_psllq, OP_not, OP_lea, OP_sbb, OP_adc,
+	OP_cmovle, OP_cmovnle, OP_cmovl, OP_cmovnl, OP_cmovz, OP_cmovns, OP_cmovnz, OP_setz, OP_sets, OP_setns, OP_setnz,
+	OP_setb, OP_xadd, OP_fld, OP_fld1, OP_fild, OP_fldz, OP_fst, OP_fstp, OP_fistp, OP_fmul, OP_fmulp, OP_fxch,
+	OP_faddp, OP_fadd, OP_fsubp, OP_fsub, OP_fdivp, OP_fdiv, OP_fsubr, OP_btr, OP_cmpxchg, OP_rep_stos, OP_cld, OP_jbe,
+	OP_fcom, OP_fcomp, OP_jmp, OP_jz, OP_jnz_short, OP_cmp, OP_test, OP_call, OP_ret, OP_enter, OP_leave, OP_fldcw,
+	OP_fnstsw, OP_nop, OP_nop_modrm, OP_fwait, OP_stmxcsr };
+
+TEST(x86_semantics_test, matches_opcode_switch)
+{
+
+	uint32_t num_opcodes = sizeof(compared_opcodes) / sizeof(compared_opcodes[0]);
+
+	for (int i = 0; i < sizeof(reference) / sizeof(reference[0]); i++){
+
+		uint32_t index = std::find(compared_opcodes, compared_opcodes + num_opcodes, reference[i].opcode) - compared_opcodes;
+		ASSERT_LT(index, num_opcodes);
+
+		uint64_t checksum = 0xcbf29ce484222325ull;
+		for (int eflags = 0; eflags < 2; eflags++){
+			for (uint32_t num_dsts = 0; num_dsts <= 2; num_dsts++){
+				for (uint32_t num_srcs = 0; num_srcs <= 4; num_srcs++){
+					if (!(reference[i].forms & (1u << (num_dsts * 5 + num_srcs)))) continue;
+					for (uint32_t rep = 0; rep < 6; rep++){
+						std::string reduced = reduce_string(index, reference[i].opcode, num_dsts, num_srcs, rep, eflags);
+						for (int j = 0; j < reduced.size(); j++){
+							checksum = (checksum ^ (uint8_t)reduced[j]) * 0x100000001b3ull;
+						}
+					}
+				}
+			}
+		}
+
+		EXPECT_EQ(checksum, reference[i].checksum) << dr_operation_to_string(reference[i].opcode);
+
+	}
+
+}
@@ -7,6 +7,8 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "utilities.h"
 #include "common_defines.h"
@@ -21,6 +23,20 @@ typedef unsigned int uint32;
 bool debug;
 unsigned int debug_level;
 
+/* coverage diffing
+
+   every drcov file is streamed once; module names are interned into global module ids and every basic block
+   becomes a 64 bit key (module id, start offset) so that matching is a hash lookup instead of name comparisons and
+   linear address scans. the diff is N-way set algebra
+
+	result = (intersection of the "filter applied" runs) - (union of the "filter not applied" runs)
+
+   the candidate set starts as the blocks of the first applied run, is intersected with every other applied run and
+   then every not applied run removes its blocks while it is being read. -first/-second is the two run special case */
+
+#define MODULE_SHIFT		48
+#define MAX_BB_OFFSET		((1ULL << MODULE_SHIFT) - 1)
+
 struct modules_t {
   string name;
   uint64 mount;
@@ -35,151 +51,30 @@ struct returnParse_t {
   uint64 *locateOriginals;
 };
 
-//get the number of basic blocks - disparity due to 65535 
-void checkStructure(returnParse_t* first){
-
-	uint64 noOfBBs = 0;
-	for(int i=0;i<first->noOfModules;i++){
-		noOfBBs += first->module[i].addresses.size();
-	}
-	
-	cout << first->noOfBasicBlocks << " " << noOfBBs << endl;
-	
-}
+/* global module table shared by all the coverage files */
+struct moduleTable_t {
+  vector<string> names;
+  unordered_map<string, uint32> ids;
+};
 
-//checks for unique modules in first file (compared with the second file)
-void checkModules (returnParse_t* first,returnParse_t* second){
-	
-	for(int i=0;i<first->noOfModules;i++){
-		string firstName = first->module[i].name;
-		bool found = 0;
-		for(int j=0;j<second->noOfModules;j++){
-			string secondName = second->module[j].name;
-			if(secondName.compare(firstName) == 0){
-				found = 1;
-				break;
-			}
-		}
-		if(!found){
-			cout << firstName << endl;
-		}
-	}
+typedef unordered_set<uint64> bbSet_t;
 
-}
+static uint32 internModule(moduleTable_t* table, const string &name){
 
-//checks for duplicate names
-void checkDuplicates(returnParse_t* first){
-	int dups = 0;
-	for(int i=0;i<first->noOfModules;i++){
-		string firstName = first->module[i].name;
-		bool found = 0;
-		for(int j=0;j<first->noOfModules;j++){
-			if(i==j) continue;
-			string secondName = first->module[j].name;
-			if(secondName.compare(firstName) == 0){
-				found = 1;
-				dups++;
-				break;
-			}
-		}
-		if(found){
-			cout << firstName << endl;
-		}
+	unordered_map<string, uint32>::iterator it = table->ids.find(name);
+	if (it != table->ids.end()){
+		return it->second;
 	}
-	cout << dups << endl;
+	uint32 id = table->names.size();
+	table->names.push_back(name);
+	table->ids[name] = id;
+	return id;
 
 }
 
-
-void searchAndReport(returnParse_t* first, returnParse_t* second, returnParse_t* report, string exec){
-  
-  uint64 matched = 0;
-  uint64 notMatched = 0;
-  uint64 notInModule = 0;
-  
-  modules_t* reportModule = report->module;
-  unsigned int currentModule = 0;
-  
-  
-  //get the number of modules that match
-
-  //things in first and not in second
-  for(int i=0;i<first->noOfModules;i++){
-  
-	unsigned int printName = 1;
-
-	//check if this is a duplicate
-	if(first->locateOriginals[i] != -1){  //duplicate - accounted for all in the original
-		continue;
-	}
-  
-    string firstName = first->module[i].name;
-    int secondIndex = -1;
-    
-	//filter out modules that are not part of the exec
-    if(firstName.find(exec) == string::npos){
-      continue;
-    }
-
-
-    for(int j=0;j<second->noOfModules;j++){
-      string secondName = second->module[j].name;
-      if(secondName.compare(firstName) == 0){
-		secondIndex = j;  //get the first index of the match guaranteed to the original
-		break;
-      }
-    }
-	
-	if(secondIndex == -1){
-		notInModule++;
-		cout << "not matched -> " <<  firstName << endl;
-	}
-
-    if(secondIndex != -1){
-
-	  vector<uint64> firstAdd = first->module[i].addresses;
-	  vector<uint64> secondAdd = second->module[secondIndex].addresses;
-
-	  if(first->module[i].name.compare(second->module[secondIndex].name)!=0){
-		cout << "assert failed" << endl;
-	  }
-
-		for(int j=0;j<firstAdd.size();j++){
-			if(find(secondAdd.begin(),secondAdd.end(),firstAdd[j])==secondAdd.end()){
-				notMatched++;
-				if(printName){
-					printName = 0;
-					currentModule++;
-					reportModule[currentModule-1].name = firstName;
-				}		
-				reportModule[currentModule-1].addresses.push_back(firstAdd[j]);
-			}
-			else{
-			  matched++;
-			}  
-		}
-	}
-    else{
-		notMatched += first->module[i].addresses.size();
-		if(printName == 1){
-			printName = 0;
-			currentModule++;
-			reportModule[currentModule-1].name = firstName;
-		}
-		vector<uint64> firstAdd = first->module[i].addresses;
-		for(int j=0;j<firstAdd.size();j++){
-			reportModule[currentModule-1].addresses.push_back(firstAdd[j]);
-		}
-    }
-
-  }
-  
-  report->noOfModules = currentModule;
-
-  cout << "summary : " << endl;
-  cout << matched << " " << notMatched << endl; 
-  cout << notInModule << endl;
-  
+static uint64 makeKey(uint32 module, uint64 address){
+	ASSERT_MSG(address <= MAX_BB_OFFSET, ("ERROR: bb offset %llx does not fit the key\n", address));
+	return ((uint64)module << MODULE_SHIFT) | address;
 }
 
 string getModule (const char*  line){
@@ -190,122 +85,135 @@ string getModule (const char*  line){
   return str;
 }
 
-unsigned int fillBBdata (returnParse_t* returnVal,const char* line,int maxModules){
-  
-  unsigned int moduleNumber,size;
-  uint64 startAddress;
-  modules_t* modules = returnVal->module;
-  
-  if(sscanf(line,"module[%u]: %llx,%u",&moduleNumber,&startAddress,&size)!=3){
-	cout << "assert failed" << endl;
-  }
-  if(moduleNumber >= maxModules){ 
-    return moduleNumber;
-  }
-  
-  uint64 place;
-  if(find(returnVal->duplicateIndexes.begin(),returnVal->duplicateIndexes.end(),moduleNumber) == returnVal->duplicateIndexes.end()){ //not duplicate
-	place = moduleNumber;
-  }
-  else{  //duplicates
-	place = returnVal->locateOriginals[moduleNumber];
-  }
-  
-  modules[place].addresses.push_back(startAddress);
-
-  return place;
-  
-} 
-
-//remove duplicate entries
-void removeDuplicates(returnParse_t* first){
+/* streams a drcov file and calls visit(key) for every bb of a module of interest (a module whose name contains exec);
+   dynamically generated code (module ids outside the table) is skipped */
+template <typename Visitor>
+static uint64 streamCoverage(string filename, moduleTable_t* table, string exec, Visitor visit){
 
-	for(int i=0;i<first->noOfModules;i++){
-		sort(first->module[i].addresses.begin(),first->module[i].addresses.end());
-		first->module[i].addresses.erase(
-			unique(first->module[i].addresses.begin(),first->module[i].addresses.end()),
-			first->module[i].addresses.end());
-	}
-
-}
+  ifstream file(filename.c_str());
+  ASSERT_MSG(file.good(), ("ERROR: cannot open coverage file %s\n", filename.c_str()));
 
-
-//need a function to parse the a file and return a data structure 
-returnParse_t* parseFiles(ifstream &file){
-  
   string line;
 
   //DRCOV first line
   getline(file,line);
- 
+
   //need to get the number of modules
   getline(file,line,' ');
   getline(file,line,' ');
   getline(file,line);
 
   uint64 noOfModules = atoi(line.c_str());
-  cout << "modules : " << noOfModules << endl;
- 
-  modules_t* modules = new modules_t[noOfModules + 1]; //noOfModules + space for dynamically generated code (later)
-  
-  returnParse_t* returnVal = new returnParse_t;
-  returnVal->noOfModules = noOfModules;
-  returnVal->module = modules;
-  returnVal->locateOriginals = new uint64[noOfModules + 1];
-  
-  //initialize locate originals to -1
-  for(int i=0;i<noOfModules + 1;i++){
-	returnVal->locateOriginals[i] = -1;
-  }
-  
+
+  /* local module number -> global module id; -1 for modules not of interest */
+  vector<int64_t> localToGlobal(noOfModules, -1);
   for(uint64 i=0; i<noOfModules; i++){
     getline(file,line);
     string moduleName = getModule(line.c_str());
-	(&modules[i])->name=moduleName;
-	for(uint64 j=0;j<i;j++){
-		string previousNames = modules[j].name;
-		if(previousNames.compare(moduleName) == 0){ // we have a duplicate
-			returnVal->duplicateIndexes.push_back(i);
-			returnVal->locateOriginals[i] = j;
-			break;
-		}
-	}
+    if(moduleName.find(exec) != string::npos){
+      localToGlobal[i] = internModule(table, moduleName);
+    }
   }
-  
-  cout << "duplicate modules: " << returnVal->duplicateIndexes.size() << endl;
 
   //get the bb count
   getline(file,line,' ');
   getline(file,line,' ');
   getline(file,line,' ');
-  
-  uint64 noOfBasicBlocks = atoi(line.c_str()); 
-  cout << "basicblocks : " << noOfBasicBlocks << endl;
-  
-  returnVal->noOfBasicBlocks = noOfBasicBlocks;
+
+  uint64 noOfBasicBlocks = atoi(line.c_str());
 
   getline(file,line);
   getline(file,line);
-  
-  //for counting invalid modules
-  uint64 invalidModules = 0;
-
-  for(uint64 i=0;i<noOfBasicBlocks;i++){
-    
-	unsigned int number;
-	
-	getline(file,line);
-    number = fillBBdata(returnVal,line.c_str(),noOfModules);
-	if(number>=noOfModules){
-		invalidModules++;
-	}
+
+  uint64 visited = 0;
+  uint64 invalid = 0;
+
+  for(uint64 i=0;i<noOfBasicBlocks && getline(file,line);i++){
+
+    unsigned int moduleNumber,size;
+    uint64 startAddress;
+
+    if(sscanf(line.c_str(),"module[%u]: %llx,%u",&moduleNumber,&startAddress,&size)!=3){
+      cout << "assert failed" << endl;
+      continue;
+    }
+    if(moduleNumber >= noOfModules){
+      invalid++;
+      continue;
+    }
+    if(localToGlobal[moduleNumber] == -1){
+      continue;
+    }
+
+    visit(makeKey(localToGlobal[moduleNumber], startAddress));
+    visited++;
   }
-  
-  cout << "invalid bbs : " << invalidModules << endl;
-  cout << "valid bbs :" << noOfBasicBlocks - invalidModules << endl;
-  
 
-  return returnVal;
+  cout << filename << " - modules : " << noOfModules << " basicblocks : " << noOfBasicBlocks
+	  << " invalid bbs : " << invalid << " bbs of interest : " << visited << endl;
+
+  return visited;
+
+}
+
+/* (intersection of applied) - (union of not applied) */
+bbSet_t diffCoverage(vector<string> &applied, vector<string> &notApplied, moduleTable_t* table, string exec){
+
+	bbSet_t candidates;
+
+	ASSERT_MSG(applied.size() > 0, ("ERROR: at least one coverage file with the filter applied is needed\n"));
+
+	streamCoverage(applied[0], table, exec, [&](uint64 key){
+		candidates.insert(key);
+	});
+	cout << "candidates after " << applied[0] << " : " << candidates.size() << endl;
+
+	for (int i = 1; i < applied.size(); i++){
+		bbSet_t present;
+		streamCoverage(applied[i], table, exec, [&](uint64 key){
+			if (candidates.find(key) != candidates.end()){
+				present.insert(key);
+			}
+		});
+		candidates.swap(present);
+		cout << "candidates after " << applied[i] << " : " << candidates.size() << endl;
+	}
+
+	for (int i = 0; i < notApplied.size(); i++){
+		streamCoverage(notApplied[i], table, exec, [&](uint64 key){
+			candidates.erase(key);
+		});
+		cout << "candidates after removing " << notApplied[i] << " : " << candidates.size() << endl;
+	}
+
+	return candidates;
+
+}
+
+/* groups the surviving keys back into modules with sorted addresses */
+returnParse_t* reportCoverage(bbSet_t &bbs, moduleTable_t* table){
+
+	vector<vector<uint64> > perModule(table->names.size());
+	for (bbSet_t::iterator it = bbs.begin(); it != bbs.end(); it++){
+		perModule[*it >> MODULE_SHIFT].push_back(*it & MAX_BB_OFFSET);
+	}
+
+	returnParse_t* report = new returnParse_t;
+	report->module = new modules_t[table->names.size() + 1];
+	report->noOfModules = 0;
+	report->noOfBasicBlocks = bbs.size();
+	report->locateOriginals = NULL;
+
+	for (int i = 0; i < perModule.size(); i++){
+		if (perModule[i].size() == 0) continue;
+		modules_t* module = &report->module[report->noOfModules++];
+		module->name = table->names[i];
+		module->mount = 0;
+		module->addresses = perModule[i];
+		sort(module->addresses.begin(), module->addresses.end());
+	}
+
+	return report;
 
 }
 
@@ -325,8 +233,10 @@ void printToFile(ofstream &out, returnParse_t* data){
 }
 
 void print_usage(){
-	printf("\t-first the first code coverage file\n ");
-	printf("\t-second the second code coverage file\n ");
+	printf("\t-first the first code coverage file (filter applied)\n ");
+	printf("\t-second the second code coverage file (filter not applied)\n ");
+	printf("\t-applied a code coverage file with the filter applied (repeatable)\n ");
+	printf("\t-not_applied a code coverage file without the filter applied (repeatable)\n ");
 	printf("\t-output output file which the diff is written to\n ");
 	printf("\t-exec the executable which the \n ");
 }
@@ -334,8 +244,8 @@ void print_usage(){
 
 int main(int argc, char ** argv){
 
-	string first_filename;
-	string second_filename;
+	vector<string> applied;
+	vector<string> notApplied;
 	string output_filename;
 	string exec;
 
@@ -348,11 +258,11 @@ int main(int argc, char ** argv){
 
 	for (int i = 0; i < args.size(); i++){
 		cout << args[i]->name << " " << args[i]->value << endl;
-		if (args[i]->name.compare("-first") == 0){
-			first_filename = args[i]->value;
+		if (args[i]->name.compare("-first") == 0 || args[i]->name.compare("-applied") == 0){
+			applied.push_back(args[i]->value);
 		}
-		else if (args[i]->name.compare("-second") == 0){
-			second_filename = args[i]->value;
+		else if (args[i]->name.compare("-second") == 0 || args[i]->name.compare("-not_applied") == 0){
+			notApplied.push_back(args[i]->value);
 		}
 		else if (args[i]->name.compare("-output") == 0){
 			output_filename = args[i]->value;
@@ -365,43 +275,19 @@ int main(int argc, char ** argv){
 		}
 	}
 
-  //first should be the one having more bbs - (first - second)
-  ifstream first_file, second_file;
-  
-  first_file.open(first_filename.c_str());
-  second_file.open(second_filename.c_str());
-  
-  returnParse_t* first_data = parseFiles(first_file);
-  returnParse_t* second_data = parseFiles(second_file);
-  
-  cout << "before duplicate bb removal :" << endl;
-  checkStructure(first_data);
-  checkStructure(second_data);
-  
-  removeDuplicates(first_data);
-  removeDuplicates(second_data);
-  
-  cout << "after duplicate bb removal :" << endl;
-  checkStructure(first_data);
-  checkStructure(second_data);
-
-  //if possible use the file with the highest bbs first
-  //search and if there is a difference, then dump it
-  
+  moduleTable_t table;
+  bbSet_t diff = diffCoverage(applied, notApplied, &table, exec);
+
+  returnParse_t* dataReported = reportCoverage(diff, &table);
+
+  cout << "summary : " << endl;
+  cout << applied.size() << " applied runs, " << notApplied.size() << " not applied runs" << endl;
+  cout << dataReported->noOfBasicBlocks << " bbs in " << dataReported->noOfModules << " modules" << endl;
+
   ofstream outFile;
   outFile.open(output_filename.c_str());
-  
-  
-  returnParse_t* dataReported = new returnParse_t;
-  dataReported->module = new modules_t[first_data->noOfModules];
-
-  searchAndReport(first_data,second_data,dataReported,exec);
-  
   printToFile(outFile,dataReported);
-
   outFile.close();
-  first_file.close();
-  second_file.close();
 
   return 0;
 
@@ -0,0 +1,45 @@
+#ifndef _EXALGO_LOCALIZE_H
+#define _EXALGO_LOCALIZE_H
+
+#include <vector>
+#include <fstream>
+#include <string>
+
+#include "moduleinfo.h"
+#include "meminfo.h"
+#include "imageinfo.h"
+
+/* a function which encloses candidate instructions (pcs with significant memory regions) */
+struct candidate_func_t {
+
+	std::string name;	/* module name */
+	uint32_t addr;
+	uint32_t freq;		/* number of candidate instructions found */
+	double weight;		/* ranking weight; equals freq for a single image */
+	uint32_t exec_freq; /* highest execution count of a bb holding a candidate instruction */
+
+	std::vector<uint32_t> candidate_instructions;
+	std::vector<uint32_t> bb_start;
+
+};
+
+/* per image localization input */
+struct localize_image_t {
+
+	std::ifstream * profile;
+	std::vector<std::ifstream *> * memtrace;
+	image_t * in_image;
+	image_t * out_image;
+
+};
+
+std::vector<funcinfo_t *> get_all_valid_functions(moduleinfo_t * module);
+std::vector<mem_info_t *> get_function_pc_mem_regions(funcinfo_t * func, std::vector<pc_mem_region_t *> &regions);
+
+/* groups the pc_mems by their probable enclosing function; sorted with the most candidate instructions first */
+std::vector<candidate_func_t *> get_candidate_funcs(moduleinfo_t * head, std::vector<pc_mem_region_t *> &pc_mems);
+
+/* localizes every image concurrently and intersects the candidates across images */
+std::vector<candidate_func_t *> localize_multi_image(std::vector<localize_image_t> &images, uint32_t total_size, uint32_t threshold);
+
+#endif
@@ -16,6 +16,8 @@ struct func_composition_t {
 
 };
 
+/* parses the memtrace files once (in parallel) into both the per pc regions and the total regions */
+void get_mem_from_memtrace(std::vector<std::ifstream *> &memtrace, moduleinfo_t * head, std::vector<pc_mem_region_t *> &pc_mems, std::vector<mem_info_t *> &mem_info);
 std::vector<pc_mem_region_t *> get_mem_regions_from_memtrace(std::vector<std::ifstream *> &memtrace, moduleinfo_t * head);
 std::vector<mem_info_t *> get_mem_info_from_memtrace(std::vector<std::ifstream *> &memtrace, moduleinfo_t * head);
 
@@ -6,6 +6,7 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <unordered_map>
 
 #include "common_defines.h"
 
@@ -56,6 +57,27 @@ struct funcinfo_t {
 
 };
 
+/* indexed control flow graph of a module - built once after the profile is parsed (index_moduleinfo)
+   edges are stored as compressed adjacency arrays; edge i of bb j is edges[start[j] + i] and holds the
+   position of the target in bbs or -1 if the target is outside the module */
+struct cfginfo_t{
+
+	std::vector<bbinfo_t *> bbs;				/* all the bbs of the module sorted by start_addr */
+	std::vector<funcinfo_t *> owners;			/* func which holds bbs[i] */
+	std::vector<uint32_t> ranks;				/* position of bbs[i] when walking the funcs' bbs in order */
+	std::vector<uint64_t> reach;				/* largest end of bbs[0 .. i] - bounds the search for overlapping bbs */
+
+	std::vector<uint32_t> from_start;
+	std::vector<int32_t> from_edges;
+	std::vector<uint32_t> to_start;
+	std::vector<int32_t> to_edges;
+	std::vector<uint32_t> caller_start;
+	std::vector<int32_t> caller_edges;
+
+	std::unordered_map<uint32_t, funcinfo_t *> funcs;	/* func start_addr -> func */
+
+};
+
 struct moduleinfo_t{
 
 	moduleinfo_t * next; /* next module information */
@@ -64,6 +86,8 @@ struct moduleinfo_t{
 	uint64_t start_addr;
 	std::vector<funcinfo_t *> funcs;
 
+	cfginfo_t cfg;
+
 	moduleinfo_t(){
 		next = NULL;
 	}
@@ -74,6 +98,9 @@ struct moduleinfo_t{
 /* parsing file into the strucuture */
 moduleinfo_t * populate_moduleinfo(std::ifstream &file);
 
+/* builds the indexed cfg of every module; needed after the funcs or bbs of a module change */
+void index_moduleinfo(moduleinfo_t * head);
+
 /* information retrieval */
 moduleinfo_t * find_module(moduleinfo_t * head, uint64_t start_addr);
 moduleinfo_t * find_module(moduleinfo_t * head, std::string name);
@@ -81,6 +108,8 @@ funcinfo_t * find_func(moduleinfo_t * module, uint32_t start_addr);
 funcinfo_t * find_func_app_pc(moduleinfo_t * module, uint32_t app_pc);
 bbinfo_t * find_bb(funcinfo_t * func, uint32_t addr);
 bbinfo_t * find_bb(moduleinfo_t * module, uint32_t addr);
+bbinfo_t * find_bb_exact(moduleinfo_t * module, uint32_t addr);
+bbinfo_t * find_bb(moduleinfo_t * head, moduleinfo_t * current, uint32_t addr, moduleinfo_t ** from_module);
 bool is_funcs_present(moduleinfo_t * head);
 uint32_t get_probable_func(moduleinfo_t * head, moduleinfo_t * current, uint32_t start_addr);
 moduleinfo_t * get_probable_call_targets(moduleinfo_t * head);
@@ -11,6 +11,7 @@ void filter_based_on_freq(moduleinfo_t * head, image_t * image, uint32_t min_thr
 
 	uint32_t size = image->height * image->width;
 	uint32_t min_size = ( (double)size * ((double)min_threshold / 100.0) );
+	moduleinfo_t * modules = head;
 
 	while (head != NULL){
 
@@ -34,6 +35,8 @@ void filter_based_on_freq(moduleinfo_t * head, image_t * image, uint32_t min_thr
 		head = head->next;
 	}
 
+	index_moduleinfo(modules);
+
 
 }
 
@@ -41,7 +44,7 @@ void filter_bbs_based_on_freq(moduleinfo_t * head, image_t * image, uint32_t min
 
 	uint32_t size = image->height * image->width;
 	uint32_t min_size = ((double)size * ((double)min_threshold / 100.0));
-
+	moduleinfo_t * modules = head;
 
 	while (head != NULL){
 
@@ -61,11 +64,15 @@ void filter_bbs_based_on_freq(moduleinfo_t * head, image_t * image, uint32_t min
 		head = head->next;
 	}
 
+	index_moduleinfo(modules);
+
 
 }
 
 void filter_based_on_composition(moduleinfo_t * module){
 
+	moduleinfo_t * modules = module;
+
 	while (module != NULL){
 
 		vector<uint32_t> removable;
@@ -101,6 +108,8 @@ void filter_based_on_composition(moduleinfo_t * module){
 		module = module->next;
 	}
 
+	index_moduleinfo(modules);
+
 }
 
 
@@ -1,6 +1,11 @@
 #include "localize.h"
 #include "moduleinfo.h"
 #include "meminfo.h"
+#include "memlayout.h"
+#include "filter_logic.h"
+#include "utilities.h"
+#include <algorithm>
+#include <thread>
 
 using namespace std;
 
@@ -52,4 +57,202 @@ void get_mem_dependant_functions(vector<funcinfo_t *> &funcs, funcinfo_t * src_f
 
 
 
-}
\ No newline at end of file
+}
+
+
+
+/* candidate functions - the probable functions enclosing the pcs which survived region filtering */
+
+static candidate_func_t * find_candidate_func(vector<candidate_func_t *> &funcs, string name, uint32_t addr){
+
+	for (int i = 0; i < funcs.size(); i++){
+		if (funcs[i]->addr == addr && funcs[i]->name == name){
+			return funcs[i];
+		}
+	}
+	return NULL;
+
+}
+
+vector<candidate_func_t *> get_candidate_funcs(moduleinfo_t * head, vector<pc_mem_region_t *> &pc_mems){
+
+	vector<candidate_func_t *> funcs;
+
+	for (int i = 0; i < pc_mems.size(); i++){
+
+		moduleinfo_t * md = find_module(head, pc_mems[i]->module);
+		ASSERT_MSG(md != NULL, ("ERROR: the module should be present\n"));
+		bbinfo_t * bbinfo = find_bb(md, pc_mems[i]->pc);
+		ASSERT_MSG(bbinfo != NULL, ("ERROR: bbinfo should be present\n"));
+		DEBUG_PRINT(("finding func start for %x in bb %x\n", pc_mems[i]->pc, bbinfo->start_addr), 1);
+		uint32_t func_start = get_probable_func(head, md, bbinfo->start_addr);
+		if (func_start == 0) continue;
+		DEBUG_PRINT(("module - %s, start - %x\n", pc_mems[i]->module.c_str(), func_start), 1);
+
+		candidate_func_t * func = find_candidate_func(funcs, md->name, func_start);
+		if (func == NULL){
+			func = new candidate_func_t;
+			func->name = md->name;
+			func->addr = func_start;
+			func->freq = 0;
+			func->exec_freq = 0;
+			funcs.push_back(func);
+		}
+
+		func->freq++;
+		if (find(func->candidate_instructions.begin(), func->candidate_instructions.end(), pc_mems[i]->pc) == func->candidate_instructions.end()){
+			func->candidate_instructions.push_back(pc_mems[i]->pc);
+			func->bb_start.push_back(bbinfo->start_addr);
+		}
+		func->exec_freq = max(func->exec_freq, bbinfo->freq);
+
+	}
+
+	for (int i = 0; i < funcs.size(); i++){
+		funcs[i]->weight = funcs[i]->freq;
+	}
+
+	stable_sort(funcs.begin(), funcs.end(), [](candidate_func_t * first, candidate_func_t * second)->bool{
+		return first->weight > second->weight;
+	});
+
+	return funcs;
+
+}
+
+
+/* multi image localization
+
+   each image is localized independently (profile -> module information, memtrace -> filtered pc_mem_regions ->
+   candidate functions) on its own thread; the images only meet when the candidates are intersected. a filter
+   executes its hot blocks a number of times proportional to the image size, therefore the execution count of a
+   true candidate normalized by the number of output pixels stays (roughly) the same for every image whereas set up
+   and book keeping code does not scale. the agreement of these normalized counts weighs the intersected candidates
+   so that small images of different sizes give the same ranking a single large image would */
+
+struct localize_job_t {
+
+	localize_image_t * image;
+	uint32_t total_size;
+	uint32_t threshold;
+
+	moduleinfo_t * head;
+	vector<candidate_func_t *> funcs;
+
+};
+
+static void localize_image(localize_job_t * job){
+
+	job->head = populate_moduleinfo(*job->image->profile);
+
+	vector<pc_mem_region_t *> pc_mems;
+	vector<mem_info_t *> mem_info;
+	get_mem_from_memtrace(*job->image->memtrace, job->head, pc_mems, mem_info);
+	link_mem_regions(pc_mems, GREEDY);
+
+	if (job->total_size == 0){
+		filter_mem_regions(pc_mems, job->image->in_image, job->image->out_image, job->threshold);
+	}
+	else{
+		filter_mem_regions_total(pc_mems, job->total_size, job->threshold);
+	}
+
+	job->funcs = get_candidate_funcs(job->head, pc_mems);
+
+}
+
+static uint64_t get_image_pixels(image_t * image){
+	return (uint64_t)image->width * image->height;
+}
+
+vector<candidate_func_t *> localize_multi_image(vector<localize_image_t> &images, uint32_t total_size, uint32_t threshold){
+
+	vector<candidate_func_t *> funcs;
+	if (images.size() == 0) return funcs;
+
+	/* total_size describes the buffer of the first image; the others are scaled by their pixel count */
+	vector<localize_job_t> jobs(images.size());
+	for (int i = 0; i < images.size(); i++){
+		jobs[i].image = &images[i];
+		jobs[i].threshold = threshold;
+		jobs[i].total_size = (uint32_t)((double)total_size * get_image_pixels(images[i].out_image) / get_image_pixels(images[0].out_image));
+		jobs[i].head = NULL;
+	}
+
+	DEBUG_PRINT(("localizing %d images concurrently\n", images.size()), 1);
+
+	vector<thread> threads;
+	for (int i = 0; i < jobs.size(); i++){
+		threads.push_back(thread(localize_image, &jobs[i]));
+	}
+	for (int i = 0; i < threads.size(); i++){
+		threads[i].join();
+	}
+
+	/* intersect the candidates with the first image as the reference */
+	for (int i = 0; i < jobs[0].funcs.size(); i++){
+
+		candidate_func_t * ref = jobs[0].funcs[i];
+		vector<candidate_func_t *> matches;
+		matches.push_back(ref);
+
+		for (int j = 1; j < jobs.size(); j++){
+			candidate_func_t * match = find_candidate_func(jobs[j].funcs, ref->name, ref->addr);
+			if (match == NULL) break;
+			matches.push_back(match);
+		}
+
+		if (matches.size() != jobs.size()){
+			DEBUG_PRINT(("func %s:%x is not a candidate in every image\n", ref->name.c_str(), ref->addr), 2);
+			continue;
+		}
+
+		candidate_func_t * func = new candidate_func_t;
+		func->name = ref->name;
+		func->addr = ref->addr;
+		func->exec_freq = ref->exec_freq;
+
+		for (int j = 0; j < ref->candidate_instructions.size(); j++){
+			bool common = true;
+			for (int k = 1; k < matches.size(); k++){
+				vector<uint32_t> &instrs = matches[k]->candidate_instructions;
+				if (find(instrs.begin(), instrs.end(), ref->candidate_instructions[j]) == instrs.end()){
+					common = false;
+					break;
+				}
+			}
+			if (common){
+				func->candidate_instructions.push_back(ref->candidate_instructions[j]);
+				func->bb_start.push_back(ref->bb_start[j]);
+			}
+		}
+		func->freq = func->candidate_instructions.size();
+		if (func->freq == 0){
+			delete func;
+			continue;
+		}
+
+		/* agreement of the size normalized execution counts - 1 when the function scales perfectly with the image */
+		double min_rate = 0;
+		double max_rate = 0;
+		for (int j = 0; j < matches.size(); j++){
+			double rate = (double)matches[j]->exec_freq / get_image_pixels(images[j].out_image);
+			if (j == 0 || rate < min_rate) min_rate = rate;
+			if (j == 0 || rate > max_rate) max_rate = rate;
+		}
+		double agreement = (max_rate > 0) ? min_rate / max_rate : 0;
+
+		func->weight = func->freq * agreement;
+		DEBUG_PRINT(("func %s:%x - %d common candidates, agreement %f\n", func->name.c_str(), func->addr, func->freq, agreement), 2);
+
+		funcs.push_back(func);
+
+	}
+
+	stable_sort(funcs.begin(), funcs.end(), [](candidate_func_t * first, candidate_func_t * second)->bool{
+		return first->weight > second->weight;
+	});
+
+	return funcs;
+
+}
@@ -6,6 +6,7 @@
 #include "filter_logic.h"
 #include "common_defines.h"
 #include "memlayout.h"
+#include "localize.h"
 #include <algorithm>
 
 using namespace std;
@@ -13,10 +14,11 @@ using namespace std;
 #define DIFF_MODE		1
 #define TWO_IMAGE_MODE  2
 #define ONE_IMAGE_MODE	3
+#define MULTI_IMAGE_MODE 4
 
 bool debug = false;
 uint32_t debug_level = 0;
-ofstream log_file;
+thread_local ofstream log_file;
 
 
 void print_usage(){
@@ -26,11 +28,26 @@ void print_usage(){
 	printf("\t out_image - the out_image filename with ext \n");
 	printf("\t debug - 1,0 which turns debug mode on/off \n");
 	printf("\t debug_level - the level of debugging (higher means more debug info) \n");
-	printf("\t mode - mode of filtering \n");
+	printf("\t mode - mode of filtering (1 - diff, 4 - multi image; repeat in_image/out_image for each image) \n");
 	printf("\t total_size - size of the buffer\n");
 	printf("\t threshold - continuous chunck % of image\n");
 }
 
+void print_candidate_funcs(vector<candidate_func_t *> &func_info){
+
+	for (int i = 0; i < func_info.size(); i++){
+		cout << i + 1 << " - function" << endl;
+		cout << " func addr - " << func_info[i]->addr << endl;
+		cout << " module name - " << func_info[i]->name << endl;
+		cout << " amount of candidate instructions - " << func_info[i]->freq << endl;
+		cout << " weight - " << func_info[i]->weight << endl;
+		cout << " candidate instructions - " << endl;
+		for (int j = 0; j < func_info[i]->candidate_instructions.size(); j++){
+			cout << "\t" << func_info[i]->candidate_instructions[j] << " - " << func_info[i]->bb_start[j] << endl;
+		}
+	}
+
+}
 
 int main(int argc, char **argv){
 
@@ -176,10 +193,9 @@ int main(int argc, char **argv){
 		DEBUG_PRINT( ("modules populated with profile information\n"), 1);
 
 		/* get the image information */
-		Gdiplus::Bitmap * in_image_bitmap = open_image(in_image_filenames[0].c_str());
-		Gdiplus::Bitmap * out_image_bitmap = open_image(out_image_filenames[0].c_str());
-		image_t * in_image = populate_imageinfo(in_image_bitmap);
-		image_t * out_image = populate_imageinfo(out_image_bitmap);
+		image_t * in_image = load_image(in_image_filenames[0].c_str());
+		image_t * out_image = load_image(out_image_filenames[0].c_str());
+		ASSERT_MSG(in_image != NULL && out_image != NULL, ("ERROR: cannot load the input / output images\n"));
 
 		/* get the highest executed basic block */
 		DEBUG_PRINT(("getting the highest executed basic block\n"), 1);
@@ -236,14 +252,15 @@ int main(int argc, char **argv){
 
 		/* get the memory region information -> link them together -> filter them */
 		DEBUG_PRINT(("getting memory region information... \n"), 5);
-		vector<pc_mem_region_t *> pc_mems = get_mem_regions_from_memtrace(memtrace_files[0], module);
+		vector<pc_mem_region_t *> pc_mems;
+		vector<mem_info_t *> total_mem_info;
+		get_mem_from_memtrace(memtrace_files[0], module, pc_mems, total_mem_info);
 		DEBUG_PRINT(("linking memory regions together... \n"), 5);
 		link_mem_regions(pc_mems, GREEDY);  /* shouldn't this return the linking information? */
 		DEBUG_PRINT(("filtering out insignificant regions... \n"), 5);
 		
 		/* all memory related information */
 		vector<pc_mem_region_t *> total_mem_region = pc_mems;
-		vector<mem_info_t *> total_mem_info = get_mem_info_from_memtrace(memtrace_files[0], module);
 		link_mem_regions_greedy_dim(total_mem_info, 0);
 
 		//print_mem_layout(log_file, pc_mems);
@@ -261,72 +278,8 @@ int main(int argc, char **argv){
 		log_file << "********************extracted mems************************" << endl;
 		print_mem_layout(log_file, mems);
 
-		struct internal_func_info_t{
-			string name;
-			uint32_t addr;
-			uint32_t freq;
-			std::vector<uint32_t> candidate_instructions;
-			std::vector<uint32_t> bb_start;
-
-		};
-
-		vector<internal_func_info_t *> func_info;
-		
 		/* get the pc_mems and there functional info as well as filter the pc_mems which are not in the func */
-		for (int i = 0; i < pc_mems.size(); i++){
-			DEBUG_PRINT(("entered finding funcs\n"), 1);
-			moduleinfo_t * md = find_module(module, pc_mems[i]->module);
-			ASSERT_MSG(md != NULL, ("ERROR: the module should be present\n"));
-			bbinfo_t * bbinfo = find_bb(md, pc_mems[i]->pc);
-			ASSERT_MSG(bbinfo != NULL, ("ERROR: bbinfo should be present\n"));
-			DEBUG_PRINT(("finding func start for %x in bb %x\n", pc_mems[i]->pc, bbinfo->start_addr), 1);
-			uint32_t func_start = get_probable_func(module, md, bbinfo->start_addr);
-			if (func_start == 0) continue;
-			DEBUG_PRINT(("module - %s, start - %x\n", pc_mems[i]->module.c_str(), func_start), 1);
-			bool is_there = false;
-			uint32_t index = 0;
-			for (int j = 0; j < func_info.size(); j++){
-				if (func_info[j]->addr == func_start && func_info[j]->name == md->name){
-					is_there = true;
-					index = j;
-					break;
-				}
-			}
-
-			if (!is_there){
-				internal_func_info_t * new_func = new  internal_func_info_t;
-				new_func->name = md->name;
-				new_func->addr = func_start;
-				new_func->freq = 1;
-				new_func->candidate_instructions.push_back(pc_mems[i]->pc);
-				new_func->bb_start.push_back(bbinfo->start_addr);
-				func_info.push_back(new_func);
-			}
-			else{
-				func_info[index]->freq++;
-				bool found = false;
-				for (int j = 0; j < func_info[index]->candidate_instructions.size(); j++){
-					if (pc_mems[i]->pc == func_info[index]->candidate_instructions[j]){
-						found = true;
-						break;
-					}
-				}
-				if (!found){
-					func_info[index]->candidate_instructions.push_back(pc_mems[i]->pc);
-					func_info[index]->bb_start.push_back(bbinfo->start_addr);
-				}
-			}
-		}
-
-		/* sort the probable function locations */
-		sort(func_info.rbegin(), func_info.rend(), 
-			[](internal_func_info_t * first, internal_func_info_t * second)->bool{
-
-			return first->freq < second->freq;
-
-		});
-
-
+		vector<candidate_func_t *> func_info = get_candidate_funcs(module, pc_mems);
 
 		/* print out the output files - heristic we are taking the function with the most amount of candidate instructions */
 		print_app_pc_file(app_pc_file, func_info[0]->candidate_instructions, func_info[0]->name);
@@ -343,17 +296,7 @@ int main(int argc, char **argv){
 		cout << " enclosed function - " << max_func << endl;
 
 		cout << "2. functions accessing candidate instructions " << endl;
-		/*print out the function with the most number of candidate instructions */
-		for (int i = 0; i < func_info.size(); i++){
-			cout << i + 1 << " - function" << endl;
-			cout << " func addr - " << func_info[i]->addr << endl;
-			cout << " module name - " << func_info[i]->name << endl;
-			cout << " amount of candidate instructions - " << func_info[i]->freq << endl;
-			cout << " candidate instructions - " << endl;
-			for (int j = 0; j < func_info[i]->candidate_instructions.size(); j++){
-				cout << "\t" << func_info[i]->candidate_instructions[j] << " - " << func_info[i]->bb_start[j] << endl;
-			}
-		}
+		print_candidate_funcs(func_info);
 		
 		//populate_function_addr(module);
 		//moduleinfo_t * func_module = move_to_function_composition(module);
@@ -364,6 +307,32 @@ int main(int argc, char **argv){
 
 
 		
+	}
+	else if (mode == MULTI_IMAGE_MODE){
+
+		/* every image contributes a profile and a memtrace set; they are localized concurrently and only the
+		   candidates common to all images survive */
+		ASSERT_MSG(profile_files.size() == in_images.size(), ("ERROR: expected one profile per image - %d profiles for %d images\n", profile_files.size(), in_images.size()));
+
+		vector<localize_image_t> images(in_images.size());
+		for (int i = 0; i < in_images.size(); i++){
+			images[i].profile = profile_files[i];
+			images[i].memtrace = &memtrace_files[i];
+			images[i].in_image = load_image(in_image_filenames[i].c_str());
+			images[i].out_image = load_image(out_image_filenames[i].c_str());
+			ASSERT_MSG(images[i].in_image != NULL && images[i].out_image != NULL, ("ERROR: cannot load images of run %d\n", i));
+		}
+
+		vector<candidate_func_t *> func_info = localize_multi_image(images, total_size, threshold);
+		ASSERT_MSG(func_info.size() > 0, ("ERROR: no function is a candidate in every image\n"));
+
+		print_app_pc_file(app_pc_file, func_info[0]->candidate_instructions, func_info[0]->name);
+		print_funcs_filter_file(filter_file, func_info[0]->name, func_info[0]->addr);
+
+		cout << "**********************Summary of localization**************************************" << endl;
+		cout << "functions accessing candidate instructions common to " << in_images.size() << " images" << endl;
+		print_candidate_funcs(func_info);
+
 	}
 	else if(mode == TWO_IMAGE_MODE){
 
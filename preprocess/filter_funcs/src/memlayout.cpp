@@ -2,6 +2,11 @@
 #include "moduleinfo.h"
 #include <fstream>
 #include <vector>
+#include <string>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
 #include "utilities.h"
 #include "memlayout.h"
 
@@ -49,106 +54,243 @@ vector<mem_input_t *> get_memtrace(vector<ifstream *> &memtrace, moduleinfo_t *
 
 }
 
-vector<mem_info_t *> get_mem_info_from_memtrace(vector<ifstream *> &memtrace, moduleinfo_t * head){
+/* memtrace ingestion - every memtrace file (one per thread of the application; raw accesses and / or the region
+   summaries of the memtrace client) is parsed exactly once by a worker thread into its own pc_mem_region_t and
+   mem_info_t builders; the builders are then merged in file order so the result does not depend on the scheduling
+   of the workers */
+
+struct memtrace_builder_t {
 
+	vector<pc_mem_region_t *> pc_mems;
 	vector<mem_info_t *> mem_info;
+	uint64_t lines;
+	uint64_t dropped;
 
-	for (int i = 0; i < memtrace.size(); i++){
-		uint32_t count = 0;
-		while (!(*memtrace[i]).eof()){
+};
 
-			string line;
-			getline((*memtrace[i]), line);
+typedef unordered_map<uint32_t, pc_mem_region_t *> pc_region_map_t;
 
-			if (!line.empty()){
-				vector<string> tokens = split(line, ',');
+/* parses a line module_start,pc,write,stride,mem_addr in place; returns false for malformed lines */
+static bool parse_memtrace_line(const char * line, uint64_t * module_start, mem_input_t * input){
 
-				mem_input_t * input = new mem_input_t;
+	char * end;
 
-				moduleinfo_t * module = find_module(head, strtoull(tokens[0].c_str(), NULL, 16));
+	*module_start = strtoull(line, &end, 16);
+	if (*end != ',') return false;
+	input->pc = strtoul(end + 1, &end, 16);
+	if (*end != ',') return false;
+	input->write = (end[1] - '0') != 0;
+	end = strchr(end + 1, ',');
+	if (end == NULL) return false;
+	input->stride = strtoul(end + 1, &end, 10);
+	if (*end != ',') return false;
+	input->mem_addr = strtoull(end + 1, &end, 16);
 
-				if (module != NULL){
-					input->module = module->name;
-					input->pc = strtoul(tokens[1].c_str(), NULL, 16);
-					input->write = tokens[2][0] - '0';
-					input->stride = atoi(tokens[3].c_str());
-					input->type = MEM_HEAP_TYPE;
-					input->mem_addr = strtoull(tokens[4].c_str(), NULL, 16);
+	return true;
 
-					update_mem_regions(mem_info, input);
-				}
-				else{
-					DEBUG_PRINT(("WARNING: cannot find a module for %s address", tokens[0].c_str()), 1);
-				}
+}
 
-				delete input;
-			}
-			print_progress(&count, 100000);
-		}
+/* parses a region summary written by the memtrace client in summary mode
+   s,module_start,pc,direction,start,end,n,stride,freq,... */
+static bool parse_memtrace_summary_line(const char * line, uint64_t * module_start, uint32_t * pc, mem_info_t * info){
+
+	char * end;
+
+	if (line[0] != 's' || line[1] != ',') return false;
+	*module_start = strtoull(line + 2, &end, 16);
+	if (*end != ',') return false;
+	*pc = strtoul(end + 1, &end, 16);
+	if (*end != ',') return false;
+	info->direction = strtoul(end + 1, &end, 10);
+	if (*end != ',') return false;
+	info->start = strtoull(end + 1, &end, 16);
+	if (*end != ',') return false;
+	info->end = strtoull(end + 1, &end, 16);
+	if (*end != ',') return false;
+	uint32_t strides = strtoul(end + 1, &end, 10);
+	for (int i = 0; i < strides; i++){
+		if (*end != ',') return false;
+		uint32_t stride = strtoul(end + 1, &end, 10);
+		if (*end != ',') return false;
+		uint32_t freq = strtoul(end + 1, &end, 10);
+		info->stride_freqs.push_back(make_pair(stride, freq));
+	}
+	info->type = MEM_HEAP_TYPE;
+	info->prob_stride = 0;
 
-		DEBUG_PRINT(("files %d/%d is read\n", i + 1, memtrace.size()), 5);
+	return true;
 
-	}
+}
 
-	DEBUG_PRINT(("defragmenting and updating strides....\n"), 5);
+static void ingest_memtrace_file(ifstream * file, moduleinfo_t * head, memtrace_builder_t * builder){
 
-	postprocess_mem_regions(mem_info);
+	/* both lookups are per builder - no sharing between the workers */
+	unordered_map<uint64_t, moduleinfo_t *> modules;
+	unordered_map<moduleinfo_t *, pc_region_map_t> regions;
 
-	DEBUG_PRINT(("defragmenting and updating strides done\n"), 5);
+	mem_input_t input;
+	input.type = MEM_HEAP_TYPE;
 
-	return mem_info;
+	uint32_t count = 0;
+	string line;
 
+	while (getline(*file, line)){
 
+		if (line.empty()) continue;
 
-}
+		uint64_t module_start;
+		mem_info_t * summary = NULL;
 
-vector<pc_mem_region_t *> get_mem_regions_from_memtrace(vector<ifstream *> &memtrace, moduleinfo_t * head){
+		if (line[0] == 's'){
+			summary = new mem_info_t;
+			if (!parse_memtrace_summary_line(line.c_str(), &module_start, &input.pc, summary)){
+				DEBUG_PRINT(("WARNING: malformed memtrace summary line %s\n", line.c_str()), 1);
+				delete summary;
+				builder->dropped++;
+				continue;
+			}
+		}
+		else if (!parse_memtrace_line(line.c_str(), &module_start, &input)){
+			DEBUG_PRINT(("WARNING: malformed memtrace line %s\n", line.c_str()), 1);
+			builder->dropped++;
+			continue;
+		}
 
-	vector<pc_mem_region_t *> pc_mems;
+		moduleinfo_t * module;
+		unordered_map<uint64_t, moduleinfo_t *>::iterator cached = modules.find(module_start);
+		if (cached != modules.end()){
+			module = cached->second;
+		}
+		else{
+			module = find_module(head, module_start);
+			modules[module_start] = module;
+			if (module == NULL){
+				DEBUG_PRINT(("WARNING: cannot find a module for %llx address\n", module_start), 1);
+			}
+		}
 
-	for (int i = 0; i < memtrace.size(); i++){
-		uint32_t count = 0;
-		while (!(*memtrace[i]).eof()){
+		if (module == NULL){
+			delete summary;
+			builder->dropped++;
+			continue;
+		}
 
-			string line;
-			getline((*memtrace[i]), line);
+		pc_region_map_t &pcs = regions[module];
+		pc_region_map_t::iterator it = pcs.find(input.pc);
+		pc_mem_region_t * mem_region;
+		if (it != pcs.end()){
+			mem_region = it->second;
+		}
+		else{
+			mem_region = new pc_mem_region_t;
+			mem_region->pc = input.pc;
+			mem_region->module = module->name;
+			pcs[input.pc] = mem_region;
+			builder->pc_mems.push_back(mem_region);
+		}
 
-			if (!line.empty()){
-				vector<string> tokens = split(line, ',');
+		if (summary != NULL){
+			/* already a region - overlaps with the other regions are folded by the defragmentation */
+			mem_region->regions.push_back(summary);
+			builder->mem_info.push_back(new mem_info_t(*summary));
+		}
+		else{
+			update_mem_regions(mem_region->regions, &input);
+			update_mem_regions(builder->mem_info, &input);
+		}
+		builder->lines++;
 
-				mem_input_t * input = new mem_input_t;
+		print_progress(&count, 100000);
 
-				moduleinfo_t * module = find_module(head, strtoull(tokens[0].c_str(), NULL, 16));
+	}
 
-				if (module != NULL){
-					input->module = module->name;
-					input->pc = strtoul(tokens[1].c_str(), NULL, 16);
-					input->write = tokens[2][0] - '0';
-					input->stride = atoi(tokens[3].c_str());
-					input->type = MEM_HEAP_TYPE;
-					input->mem_addr = strtoull(tokens[4].c_str(), NULL, 16);
+}
 
-					update_mem_regions(pc_mems, input);
-				}
-				else{
-					DEBUG_PRINT(("WARNING: cannot find a module for %s address", tokens[0].c_str()), 1);
-				}
+void get_mem_from_memtrace(vector<ifstream *> &memtrace, moduleinfo_t * head, vector<pc_mem_region_t *> &pc_mems, vector<mem_info_t *> &mem_info){
+
+	vector<memtrace_builder_t> builders(memtrace.size());
+	for (int i = 0; i < builders.size(); i++){
+		builders[i].lines = 0;
+		builders[i].dropped = 0;
+	}
+
+	uint32_t workers = thread::hardware_concurrency();
+	if (workers == 0) workers = 1;
+	if (workers > memtrace.size()) workers = memtrace.size();
 
-				delete input;
+	DEBUG_PRINT(("ingesting %d memtrace files with %d threads\n", memtrace.size(), workers), 2);
+
+	atomic<uint32_t> next(0);
+	vector<thread> threads;
+	for (int i = 0; i < workers; i++){
+		threads.push_back(thread([&](){
+			uint32_t index;
+			while ((index = next++) < memtrace.size()){
+				ingest_memtrace_file(memtrace[index], head, &builders[index]);
+				DEBUG_PRINT(("file %d/%d is read\n", index + 1, memtrace.size()), 5);
+			}
+		}));
+	}
+	for (int i = 0; i < threads.size(); i++){
+		threads[i].join();
+	}
+
+	/* merge in file order - a pc keeps the position of its first appearance; mem regions of the same pc coming
+	   from different files are concatenated and defragmentation folds the overlapping / adjacent ones exactly as
+	   update_mem_regions would have on a sequential read */
+	unordered_map<string, pc_region_map_t> merged;
+	for (int i = 0; i < pc_mems.size(); i++){
+		merged[pc_mems[i]->module][pc_mems[i]->pc] = pc_mems[i];
+	}
+
+	for (int i = 0; i < builders.size(); i++){
+
+		DEBUG_PRINT(("file %d - %llu accesses, %llu dropped, %d pcs\n", i + 1, builders[i].lines, builders[i].dropped,
+			builders[i].pc_mems.size()), 3);
+
+		for (int j = 0; j < builders[i].pc_mems.size(); j++){
+			pc_mem_region_t * region = builders[i].pc_mems[j];
+			pc_region_map_t &pcs = merged[region->module];
+			pc_region_map_t::iterator it = pcs.find(region->pc);
+			if (it != pcs.end()){
+				it->second->regions.insert(it->second->regions.end(), region->regions.begin(), region->regions.end());
+				delete region;
+			}
+			else{
+				pcs[region->pc] = region;
+				pc_mems.push_back(region);
 			}
-			print_progress(&count, 100000);
 		}
-		
-		DEBUG_PRINT(("files %d/%d is read\n", i + 1, memtrace.size()), 5);
+
+		mem_info.insert(mem_info.end(), builders[i].mem_info.begin(), builders[i].mem_info.end());
 
 	}
 
 	DEBUG_PRINT(("defragmenting and updating strides....\n"), 5);
 
 	postprocess_mem_regions(pc_mems);
+	postprocess_mem_regions(mem_info);
 
 	DEBUG_PRINT(("defragmenting and updating strides done\n"), 5);
 
+}
+
+vector<mem_info_t *> get_mem_info_from_memtrace(vector<ifstream *> &memtrace, moduleinfo_t * head){
+
+	vector<pc_mem_region_t *> pc_mems;
+	vector<mem_info_t *> mem_info;
+
+	get_mem_from_memtrace(memtrace, head, pc_mems, mem_info);
+	return mem_info;
+
+}
+
+vector<pc_mem_region_t *> get_mem_regions_from_memtrace(vector<ifstream *> &memtrace, moduleinfo_t * head){
+
+	vector<pc_mem_region_t *> pc_mems;
+	vector<mem_info_t *> mem_info;
+
+	get_mem_from_memtrace(memtrace, head, pc_mems, mem_info);
 	return pc_mems;
 
 }
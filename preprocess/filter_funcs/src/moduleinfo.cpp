@@ -9,6 +9,8 @@
 #include <map>
 #include "utilities.h"
 #include <queue>
+#include <algorithm>
+#include <unordered_set>
 
 using namespace std;
 
@@ -42,6 +44,113 @@ void populate_func_freq(moduleinfo_t * head){
 
 }
 
+/* indexed cfg construction */
+
+/* position of the bb starting at addr in the sorted bbs or -1 */
+static int32_t get_bb_position(moduleinfo_t * module, uint32_t addr){
+
+	vector<bbinfo_t *> &bbs = module->cfg.bbs;
+	uint32_t low = 0;
+	uint32_t high = bbs.size();
+
+	while (low < high){
+		uint32_t mid = low + (high - low) / 2;
+		if (bbs[mid]->start_addr < addr) low = mid + 1;
+		else high = mid;
+	}
+
+	if (low < bbs.size() && bbs[low]->start_addr == addr) return low;
+	return -1;
+
+}
+
+/* position of the bb containing addr or -1. bbs may overlap; of the ones containing addr the first in the funcs' order
+   is taken, as a linear walk over the funcs would. the walk back stops at the first bb no earlier bb reaches past */
+static int32_t get_bb_position_containing(moduleinfo_t * module, uint32_t addr){
+
+	cfginfo_t * cfg = &module->cfg;
+	vector<bbinfo_t *> &bbs = cfg->bbs;
+	uint32_t low = 0;
+	uint32_t high = bbs.size();
+
+	while (low < high){
+		uint32_t mid = low + (high - low) / 2;
+		if (bbs[mid]->start_addr <= addr) low = mid + 1;
+		else high = mid;
+	}
+
+	int32_t pos = -1;
+	for (int32_t i = (int32_t)low - 1; i >= 0 && cfg->reach[i] > addr; i--){
+		if (addr < (uint64_t)bbs[i]->start_addr + bbs[i]->size && (pos == -1 || cfg->ranks[i] < cfg->ranks[pos])){
+			pos = i;
+		}
+	}
+	return pos;
+
+}
+
+static void index_edges(moduleinfo_t * module, vector<targetinfo_t *> &targets, vector<uint32_t> &start, vector<int32_t> &edges){
+
+	start.push_back(edges.size());
+	for (int i = 0; i < targets.size(); i++){
+		edges.push_back(get_bb_position(module, targets[i]->target));
+	}
+
+}
+
+static void index_module(moduleinfo_t * module){
+
+	cfginfo_t * cfg = &module->cfg;
+	*cfg = cfginfo_t();
+
+	vector<pair<bbinfo_t *, funcinfo_t *> > bbs;
+	for (int i = 0; i < module->funcs.size(); i++){
+		funcinfo_t * func = module->funcs[i];
+		if (cfg->funcs.find(func->start_addr) == cfg->funcs.end()){
+			cfg->funcs[func->start_addr] = func;
+		}
+		for (int j = 0; j < func->bbs.size(); j++){
+			bbs.push_back(make_pair(func->bbs[j], func));
+		}
+	}
+
+	/* stable - a bb present under two funcs keeps the first owner first */
+	vector<uint32_t> order(bbs.size());
+	for (int i = 0; i < order.size(); i++) order[i] = i;
+	stable_sort(order.begin(), order.end(), [&bbs](uint32_t first, uint32_t second)->bool{
+		return bbs[first].first->start_addr < bbs[second].first->start_addr;
+	});
+
+	uint64_t reach = 0;
+	for (int i = 0; i < order.size(); i++){
+		bbinfo_t * bb = bbs[order[i]].first;
+		reach = max(reach, (uint64_t)bb->start_addr + bb->size);
+		cfg->bbs.push_back(bb);
+		cfg->owners.push_back(bbs[order[i]].second);
+		cfg->ranks.push_back(order[i]);
+		cfg->reach.push_back(reach);
+	}
+
+	for (int i = 0; i < cfg->bbs.size(); i++){
+		index_edges(module, cfg->bbs[i]->from_bbs, cfg->from_start, cfg->from_edges);
+		index_edges(module, cfg->bbs[i]->to_bbs, cfg->to_start, cfg->to_edges);
+		index_edges(module, cfg->bbs[i]->callers, cfg->caller_start, cfg->caller_edges);
+	}
+	cfg->from_start.push_back(cfg->from_edges.size());
+	cfg->to_start.push_back(cfg->to_edges.size());
+	cfg->caller_start.push_back(cfg->caller_edges.size());
+
+}
+
+void index_moduleinfo(moduleinfo_t * head){
+
+	while (head != NULL){
+		index_module(head);
+		head = head->next;
+	}
+
+}
+
 /* parsing information from a file into the moduleinfo structure */
 moduleinfo_t * populate_moduleinfo(ifstream &file){
 
@@ -98,10 +207,11 @@ moduleinfo_t * populate_moduleinfo(ifstream &file){
 			uint32_t func_start = strtoul(tokens[index++].c_str(), NULL, 16);
 
 
-			funcinfo_t * func = find_func(current_module, func_start);
+			funcinfo_t * func = current_module->cfg.funcs[func_start];
 			if (func == NULL){
 				func = new funcinfo_t();
 				current_module->funcs.push_back(func);
+				current_module->cfg.funcs[func_start] = func;
 			}
 
 			func->start_addr = func_start;
@@ -157,6 +267,7 @@ moduleinfo_t * populate_moduleinfo(ifstream &file){
 	}
 
 	populate_func_freq(head);
+	index_moduleinfo(head);
 
 	return head;
 
@@ -184,19 +295,17 @@ moduleinfo_t * find_module(moduleinfo_t * head, string name){
 }
 
 funcinfo_t * find_func(moduleinfo_t * module,uint32_t start_addr){
-	for (int i = 0; i < module->funcs.size(); i++){
-		if (start_addr == module->funcs[i]->start_addr){
-			return module->funcs[i];
-		}
+	unordered_map<uint32_t, funcinfo_t *>::iterator it = module->cfg.funcs.find(start_addr);
+	if (it != module->cfg.funcs.end()){
+		return it->second;
 	}
 	return NULL;
 }
 
 funcinfo_t * find_func_app_pc(moduleinfo_t * module, uint32_t app_pc){
-	for (int i = 0; i < module->funcs.size(); i++){
-		if (find_bb(module->funcs[i], app_pc) != NULL){
-			return module->funcs[i];
-		}
+	int32_t pos = get_bb_position_containing(module, app_pc);
+	if (pos != -1){
+		return module->cfg.owners[pos];
 	}
 	return NULL;
 }
@@ -207,7 +316,7 @@ funcinfo_t * find_func_app_pc(moduleinfo_t * module, uint32_t app_pc){
 bbinfo_t * find_bb(funcinfo_t * func, uint32_t addr){
 
 	for (int i = 0; i < func->bbs.size(); i++){
-		if ((func->bbs[i]->start_addr >= addr) && (addr < func->bbs[i]->start_addr + func->bbs[i]->size)){
+		if ((func->bbs[i]->start_addr <= addr) && (addr < func->bbs[i]->start_addr + func->bbs[i]->size)){
 			return func->bbs[i];
 		}
 	}
@@ -220,14 +329,9 @@ bbinfo_t * find_bb(funcinfo_t * func, uint32_t addr){
 */
 bbinfo_t * find_bb(moduleinfo_t * module, uint32_t addr){
 
-	for (int i = 0; i < module->funcs.size(); i++){
-		funcinfo_t * func = module->funcs[i];
-		for (int j = 0; j < func->bbs.size(); j++){
-			if ((func->bbs[j]->start_addr <= addr) && (addr < (func->bbs[j]->start_addr + func->bbs[j]->size))){
-				return func->bbs[j];
-			}
-			
-		}
+	int32_t pos = get_bb_position_containing(module, addr);
+	if (pos != -1){
+		return module->cfg.bbs[pos];
 	}
 	return NULL;
 
@@ -235,14 +339,9 @@ bbinfo_t * find_bb(moduleinfo_t * module, uint32_t addr){
 
 bbinfo_t * find_bb_exact(moduleinfo_t * module, uint32_t addr){
 
-	for (int i = 0; i < module->funcs.size(); i++){
-		funcinfo_t * func = module->funcs[i];
-		for (int j = 0; j < func->bbs.size(); j++){
-			if (func->bbs[j]->start_addr == addr){
-				return func->bbs[j];
-			}
-
-		}
+	int32_t pos = get_bb_position(module, addr);
+	if (pos != -1){
+		return module->cfg.bbs[pos];
 	}
 	return NULL;
 
@@ -254,27 +353,19 @@ bbinfo_t * find_bb_exact(moduleinfo_t * module, uint32_t addr){
 bbinfo_t * find_bb(moduleinfo_t * head, moduleinfo_t * current, uint32_t addr, moduleinfo_t ** from_module){
 
 	/* find in the current module */
-	for (int i = 0; i < current->funcs.size(); i++){
-		funcinfo_t * func = current->funcs[i];
-		for (int j = 0; j < func->bbs.size(); j++){
-			if (func->bbs[j]->start_addr == addr){
-				*from_module = current;
-				return func->bbs[j];
-			}
-		}
+	bbinfo_t * bb = find_bb_exact(current, addr);
+	if (bb != NULL){
+		*from_module = current;
+		return bb;
 	}
 
-	*from_module = false;
+	*from_module = NULL;
 	/* if not try to find from all the modules */
 	while (head != NULL){
-		for (int i = 0; i < head->funcs.size(); i++){
-			funcinfo_t * func = head->funcs[i];
-			for (int j= 0; j < func->bbs.size(); j++){
-				if (func->bbs[j]->start_addr == addr){
-					*from_module = head;
-					return func->bbs[j];
-				}
-			}
+		bb = find_bb_exact(head, addr);
+		if (bb != NULL){
+			*from_module = head;
+			return bb;
 		}
 		head = head->next;
 	}
@@ -328,6 +419,7 @@ moduleinfo_t * get_call_targets(moduleinfo_t * head){
 		head = head->next;
 	}
 
+	index_moduleinfo(new_head);
 	return new_head;
 
 
@@ -368,6 +460,7 @@ moduleinfo_t * get_probable_call_targets(moduleinfo_t * head){
 		head = head->next;
 	}
 
+	index_moduleinfo(new_head);
 	return new_head;
 
 }
@@ -406,6 +499,7 @@ moduleinfo_t * get_probable_callers(moduleinfo_t * head){
 		head = head->next;
 	}
 
+	index_moduleinfo(new_head);
 	return new_head;
 
 }
@@ -440,49 +534,59 @@ struct rec_struct{
 
 	uint32_t addr;
 	int ret;
+	int32_t pos;	/* position in the module cfg or -1 if the bb is not in the module */
 
 };
 
-#define MAX_RECURSE 200
+/* the search visits at most this many bbs - keeps the entry points found identical to the earlier recursive search */
+#define MAX_VISITS 200
 
-/* assuming same module has the function entry point */
-uint32_t get_probable_func_entrypoint(moduleinfo_t * current, queue<rec_struct> &bb_start, vector<uint32_t> &processed, uint32_t max_recurse){
+/* assuming same module has the function entry point; backward bfs over the from edges counting call/ret nesting */
+uint32_t get_probable_func_entrypoint(moduleinfo_t * current, uint32_t start_addr){
 
-	if (max_recurse > MAX_RECURSE){
-		DEBUG_PRINT(("WARNING: max recursion limit reached\n"), 2);
-		return 0;
-	}
+	cfginfo_t * cfg = &current->cfg;
+	queue<rec_struct> bb_start;
+	unordered_set<uint32_t> processed;
 
-	if (bb_start.empty()) return 0;
+	rec_struct rec = { start_addr, 0, get_bb_position(current, start_addr) };
+	bb_start.push(rec);
 
-	uint32_t addr = bb_start.front().addr;
-	int ret = bb_start.front().ret;
-	bb_start.pop();
-	processed.push_back(addr);
+	for (uint32_t visits = 0; !bb_start.empty(); visits++){
 
-	bbinfo_t * bbinfo = find_bb_exact(current, addr);
-	if (bbinfo == NULL){
-		return get_probable_func_entrypoint(current, bb_start, processed, max_recurse + 1);
-	}
+		if (visits > MAX_VISITS){
+			DEBUG_PRINT(("WARNING: max visit limit reached\n"), 2);
+			return 0;
+		}
 
-	
-	if (bbinfo->is_call_target) ret--;
-	if (ret < 0){
-		return bbinfo->start_addr;
-	}
-	if (bbinfo->is_ret && max_recurse > 0) ret++; 
+		rec = bb_start.front();
+		bb_start.pop();
+		processed.insert(rec.addr);
 
-	DEBUG_PRINT(("%x, %d, %d\n", addr, ret, bbinfo->freq), 15);
+		if (rec.pos == -1) continue;
+		bbinfo_t * bbinfo = cfg->bbs[rec.pos];
 
-	for (int i = 0; i < bbinfo->from_bbs.size(); i++){
-		DEBUG_PRINT(("bbs all - %x\n", bbinfo->from_bbs[i]->target), 20);
-		if (find(processed.begin(), processed.end(), bbinfo->from_bbs[i]->target) == processed.end()){
-			DEBUG_PRINT(("bbs - %x\n", bbinfo->from_bbs[i]->target), 20);
-			bb_start.push({ bbinfo->from_bbs[i]->target, ret });
+		int ret = rec.ret;
+		if (bbinfo->is_call_target) ret--;
+		if (ret < 0){
+			return bbinfo->start_addr;
+		}
+		if (bbinfo->is_ret && visits > 0) ret++;
+
+		DEBUG_PRINT(("%x, %d, %d\n", rec.addr, ret, bbinfo->freq), 15);
+
+		uint32_t edge_start = cfg->from_start[rec.pos];
+		for (int i = 0; i < bbinfo->from_bbs.size(); i++){
+			uint32_t target = bbinfo->from_bbs[i]->target;
+			DEBUG_PRINT(("bbs all - %x\n", target), 20);
+			if (processed.find(target) == processed.end()){
+				DEBUG_PRINT(("bbs - %x\n", target), 20);
+				rec_struct next = { target, ret, cfg->from_edges[edge_start + i] };
+				bb_start.push(next);
+			}
 		}
 	}
 
-	return get_probable_func_entrypoint(current, bb_start, processed, max_recurse + 1);
+	return 0;
 
 }
 
@@ -490,13 +594,7 @@ uint32_t get_probable_func(moduleinfo_t * head, moduleinfo_t * current, uint32_t
 
 	bbinfo_t * bb = find_bb(current, start_addr);
 	if (bb != NULL){
-		rec_struct rec = { bb->start_addr, 0 };
-		queue<rec_struct> queue;
-		queue.push(rec);
-
-		vector<uint32_t> processed;
-
-		return get_probable_func_entrypoint(current, queue, processed, 0);
+		return get_probable_func_entrypoint(current, bb->start_addr);
 	}
 	else{
 		return 0;
@@ -753,6 +851,8 @@ moduleinfo_t * move_to_function_composition(moduleinfo_t * pre){
 
 	}
 
+	index_moduleinfo(post);
+
 	return post;
 
 
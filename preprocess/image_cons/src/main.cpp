@@ -14,7 +14,7 @@ using namespace std;
 
 bool debug = false;
 uint32_t debug_level = 0;
-ofstream log_file;
+thread_local ofstream log_file;
 
 void create_arith_image(uint32_t width, uint32_t height, const char * name);
 void create_row_image(uint32_t width, uint32_t height, const char * name);
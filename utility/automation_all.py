@@ -3,6 +3,7 @@ import localize
 import extract
 import common
 import os,shutil
+import time
 
 
 def parse_arguments():
@@ -30,6 +31,7 @@ def parse_arguments():
         optional.add_argument('--args' ,'-a', help='arguments for the executable')
         optional.add_argument('--debug_level','-dl', default='2', help='specifies the debug level')
         optional.add_argument('--buildex_args','-ba', help='specifies overriding optional arguments to buildex in double quotes')
+        optional.add_argument('--halide','-hd', help='Halide distribution folder; the lifted programs are validated against the memory dumps (buildex stage)')
        
         args = parser.parse_args()
         print args
@@ -102,10 +104,21 @@ def main():
         if args.stage == 'all' or args.stage == 'extract' or args.stage == 'buildex':
                 
                 #2. run buildex for expression extraction
+                started = time.time()
                 if buildex_opts != '':
                         extract.run_buildex(exec_name, args.in_image, args.out_image, args.debug, args.debug_level, dump, buildex_opts)
                 else:
                         extract.run_buildex(exec_name, args.in_image, args.out_image, args.debug, args.debug_level, dump, '')
+
+                #3. validate the lifted programs against the memory dumps - needs a Halide distribution to build them
+                if args.halide == None:
+                        print 'validation skipped - no PASS/FAIL verdict without --halide (or run utility/validate.py on each program)'
+                else:
+                        verdicts = extract.run_validation(args.halide, started)
+                        if len(verdicts) == 0:
+                                print 'validation FAIL - no lifted program found'
+                        for program, verdict in verdicts:
+                                print 'validation ' + verdict + ' ' + program
    
         
 if __name__ == '__main__':
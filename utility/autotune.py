@@ -0,0 +1,160 @@
+import argparse
+import itertools
+import os
+import re
+import subprocess
+
+'''
+schedule autotuner for buildex emitted Halide programs
+
+the program should be emitted with buildex -schedule 3 (tunable); its schedule knobs are read from
+EXALGO_SCHED_* environment variables and, when EXALGO_TUNE_INPUTS is set, it JIT compiles itself on the
+recovered input images (with the scalar Params set from EXALGO_TUNE_PARAMS) and prints "tune_time_ms <value>". the program is built once and run for every
+candidate schedule on the cpu. the fastest candidate is written next to the program as
+<name>_schedule.txt and <name>_tuned.cpp (the same program with the tuned knobs as defaults)
+'''
+
+knobs = ['EXALGO_SCHED_VECTOR', 'EXALGO_SCHED_TILE_X', 'EXALGO_SCHED_TILE_Y',
+         'EXALGO_SCHED_PARALLEL', 'EXALGO_SCHED_PRODUCERS']
+
+def parse_arguments():
+
+        parser = argparse.ArgumentParser(description="Helium Halide schedule autotuner")
+        required = parser.add_argument_group('required', 'mandatory arguments')
+        required.add_argument('--program', '-p', required=True, help='buildex emitted *_halide.cpp (emitted with -schedule 3)')
+        required.add_argument('--inputs', '-i', required=True, nargs='+', help='recovered input images (8 bit ppm), one per ImageParam')
+        required.add_argument('--halide', '-hd', required=True, help='Halide distribution folder (include and lib)')
+
+        optional = parser.add_argument_group('optional', 'tuning and build options')
+        optional.add_argument('--params', default=None, help='comma separated values of the scalar Params p_0, p_1, ... (as recovered for validate.py)')
+        optional.add_argument('--cxx', default='c++', help='host compiler')
+        optional.add_argument('--cxxflags', default='-std=c++11 -O2', help='host compiler flags')
+        optional.add_argument('--libs', default='-lHalide -lpthread -ldl -lz', help='libraries for linking against Halide')
+        optional.add_argument('--iterations', '-n', default='5', help='timed realizations per candidate (best is taken)')
+        optional.add_argument('--timeout', '-t', default=120, type=int, help='seconds before a candidate is abandoned')
+
+        return parser.parse_args()
+
+'''
+candidate schedules - vector widths up to 256 bit for 8 bit data, square-ish tiles and the three
+placements of producers (compute_root, compute_at the consumer tile, inline)
+'''
+def get_candidates():
+
+        candidates = []
+        vectors = [1, 4, 8, 16, 32]
+        tiles = [(0, 0), (32, 8), (64, 16), (64, 32), (128, 32), (256, 64)]
+        for vector, tile, parallel, producers in itertools.product(vectors, tiles, [0, 1], [0, 1, 2]):
+                if tile[0] != 0 and tile[0] < vector:
+                        continue
+                if tile[0] == 0 and producers == 1:
+                        continue  # compute_at needs the tile loops of the consumer
+                candidates.append([vector, tile[0], tile[1], parallel, producers])
+        return candidates
+
+def build_program(args, program, binary):
+
+        halide_include = os.path.join(args.halide, 'include')
+        halide_lib = os.path.join(args.halide, 'lib')
+        command = [args.cxx] + args.cxxflags.split() + [program, '-I', halide_include, '-I', args.halide,
+                   '-L', halide_lib, '-L', args.halide, '-o', binary] + args.libs.split()
+        print(' '.join(command))
+        p = subprocess.Popen(command)
+        p.communicate()
+        return p.returncode == 0
+
+def run_candidate(args, binary, candidate):
+
+        env = dict(os.environ)
+        for i in range(len(knobs)):
+                env[knobs[i]] = str(candidate[i])
+        env['EXALGO_TUNE_INPUTS'] = ','.join(args.inputs)
+        env['EXALGO_TUNE_ITERATIONS'] = args.iterations
+        if args.params is not None:
+                env['EXALGO_TUNE_PARAMS'] = args.params
+
+        p = subprocess.Popen([binary], env=env, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+        try:
+                output = p.communicate(timeout=args.timeout)[0]
+        except TypeError:  # python 2 - no timeout support
+                output = p.communicate()[0]
+        except subprocess.TimeoutExpired:
+                p.kill()
+                p.communicate()
+                return None
+
+        if p.returncode != 0:
+                return None
+
+        match = re.search(r'tune_time_ms\s+([0-9.eE+-]+)', output.decode('utf-8', 'replace'))
+        if match is None:
+                return None
+        return float(match.group(1))
+
+'''
+writes the tuned knobs as the defaults of the knob() calls so the program uses them without the environment
+'''
+def write_tuned_program(program, tuned_program, candidate):
+
+        with open(program) as f:
+                source = f.read()
+        for i in range(len(knobs)):
+                source = re.sub(r'knob\("' + knobs[i] + r'",\s*-?[0-9]+\)',
+                                'knob("' + knobs[i] + '",' + str(candidate[i]) + ')', source)
+        with open(tuned_program, 'w') as f:
+                f.write(source)
+
+def main():
+
+        args = parse_arguments()
+
+        with open(args.program) as f:
+                source = f.read()
+        if '/* schedule begin */' not in source:
+                print('ERROR: ' + args.program + ' has no tunable schedule; emit it with buildex -schedule 3')
+                return 1
+
+        # the program refuses to time candidates without a value for every Param
+        params = len(re.findall(r'\bParam<[^>]*>\s+p_[0-9]+\(', source))
+        given = 0 if args.params is None else len(args.params.split(','))
+        if given < params:
+                print('ERROR: ' + args.program + ' has ' + str(params) + ' scalar Params; give their values with --params')
+                return 1
+
+        name = os.path.abspath(os.path.splitext(args.program)[0])
+        binary = name + '_tune'
+        if not build_program(args, args.program, binary):
+                print('ERROR: building ' + args.program + ' failed')
+                return 1
+
+        best = None
+        best_time = None
+        results = []
+        candidates = get_candidates()
+        for i in range(len(candidates)):
+                time = run_candidate(args, binary, candidates[i])
+                results.append((candidates[i], time))
+                status = 'failed' if time is None else str(time) + ' ms'
+                print('[' + str(i + 1) + '/' + str(len(candidates)) + '] ' + str(candidates[i]) + ' ' + status)
+                if time is not None and (best_time is None or time < best_time):
+                        best = candidates[i]
+                        best_time = time
+
+        if best is None:
+                print('ERROR: no candidate schedule ran successfully')
+                return 1
+
+        with open(name + '_schedule.txt', 'w') as f:
+                f.write('best ' + str(best_time) + ' ms\n')
+                for i in range(len(knobs)):
+                        f.write(knobs[i] + '=' + str(best[i]) + '\n')
+                f.write('\n# all candidates (' + ' '.join(knobs) + ' time_ms)\n')
+                for candidate, time in results:
+                        f.write(' '.join([str(v) for v in candidate]) + ' ' + ('failed' if time is None else str(time)) + '\n')
+
+        write_tuned_program(args.program, name + '_tuned.cpp', best)
+        print('best schedule ' + str(best) + ' ' + str(best_time) + ' ms')
+        return 0
+
+if __name__ == '__main__':
+        exit(main())
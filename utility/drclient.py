@@ -34,6 +34,7 @@ def create_client_args(clients,executable,
         output_folder = os.environ.get('EXALGO_OUTPUT_FOLDER')
         log_folder = os.environ.get('EXALGO_LOG_FOLDER')
         filter_folder = os.environ.get('EXALGO_FILTER_FOLDER')
+        halide_folder = os.environ.get('EXALGO_HALIDE_FOLDER')
 
         md_app_pc_file = filter_folder + '\\filter_' + executable + '_app_pc.log'
 
@@ -60,9 +61,14 @@ def create_client_args(clients,executable,
                 if client == 'memdump':
                         client_args += ' -memdump ' +  filter_string + ' ' + md_app_pc_file + ' ' + output_folder
                 if client == 'funcreplace':
-                        client_args += ' -funcreplace ' + filter_string
+                        binding_file = os.path.join(halide_folder, 'buildex_' + executable + '_binding.txt')
+                        client_args += ' -funcreplace ' + binding_file + ' 1'
                 if client == 'misc':
                         client_args += ' -misc ' + filter_string
+                if client == 'hotregion':
+                        client_args += ' -hotregion ' + filter_string + ' ' + filter_folder + ' ' + executable + ' 80'
+                if client == 'reusedist':
+                        client_args += ' -reusedist ' + filter_string + ' ' + output_folder + ' ' + in_image
 
         return client_args
                         
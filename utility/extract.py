@@ -1,5 +1,6 @@
 import os
 import subprocess
+import sys
 import drclient
 import common
 
@@ -32,6 +33,28 @@ def run_buildex(executable, in_image, out_image, debug, debug_level, dump, opts)
         print command
         p = subprocess.Popen(command)
         p.communicate()
+
+'''
+this function validates the Halide programs buildex emitted since 'since' (every lift writes <prefix>_dumps.txt
+next to <prefix>_halide.cpp) against the memory dumps; returns the (program, verdict) pairs
+'''
+def run_validation(halide, since):
+        halide_folder = os.environ.get('EXALGO_HALIDE_FOLDER')
+        validate = os.path.join(parent_folder, 'utility', 'validate.py')
+        verdicts = []
+        for root, dirs, files in os.walk(halide_folder):
+                for name in files:
+                        if not name.endswith('_dumps.txt'):
+                                continue
+                        program = os.path.join(root, name[:-len('_dumps.txt')] + '_halide.cpp')
+                        if not os.path.isfile(program) or os.path.getmtime(program) < since:
+                                continue
+                        command = [sys.executable, validate, '--program', program, '--halide', halide]
+                        print ' '.join(command)
+                        p = subprocess.Popen(command)
+                        p.communicate()
+                        verdicts.append((program, 'PASS' if p.returncode == 0 else 'FAIL'))
+        return verdicts
                  
                  
         
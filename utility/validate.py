@@ -0,0 +1,135 @@
+import argparse
+import os
+import re
+import subprocess
+
+from autotune import build_program
+
+'''
+differential validation of a buildex emitted Halide program against the original filter
+
+buildex writes the buffers of the profiled run next to dump.h: <region>_in.raw for what the original read and
+<region>_out.raw for what it wrote. the folder is named in <prefix>_dumps.txt next to <prefix>_halide.cpp. every
+emitted program runs its own pipeline on the *_in.raw buffers when EXALGO_VALIDATE_DIR is set and reports per
+output mismatches, the max absolute error, the first mismatching coordinates and its throughput. this script
+builds the program, runs it and compares the time with the original function as timed by the funcreplace client
+(timing only, i.e. replace 0). the verdict is written next to the program as <name>_validation.txt; the exit code
+is 0 on PASS. automation_all.py --halide runs it on every program of a lift
+'''
+
+def parse_arguments():
+
+        parser = argparse.ArgumentParser(description="Helium lifted vs original validation")
+        required = parser.add_argument_group('required', 'mandatory arguments')
+        required.add_argument('--program', '-p', required=True, help='buildex emitted *_halide.cpp')
+        required.add_argument('--halide', '-hd', required=True, help='Halide distribution folder (include and lib)')
+
+        optional = parser.add_argument_group('optional', 'validation and build options')
+        optional.add_argument('--dumps', '-d', default=None, help='folder with the raw buffers (default from <prefix>_dumps.txt, else EXALGO_OUTPUT_FOLDER)')
+        optional.add_argument('--params', default=None, help='comma separated values of the scalar Params p_0, p_1, ...')
+        optional.add_argument('--tolerance', default='0', help='absolute error allowed per element')
+        optional.add_argument('--report', default='10', help='mismatching coordinates printed per output')
+        optional.add_argument('--iterations', '-n', default='5', help='timed realizations (best is taken)')
+        optional.add_argument('--original', '-o', default=None, help='funcreplace log of the original function (timing only run)')
+        optional.add_argument('--cxx', default='c++', help='host compiler')
+        optional.add_argument('--cxxflags', default='-std=c++11 -O2', help='host compiler flags')
+        optional.add_argument('--libs', default='-lHalide -lpthread -ldl -lz', help='libraries for linking against Halide')
+        optional.add_argument('--timeout', '-t', default=600, type=int, help='seconds before the run is abandoned')
+
+        return parser.parse_args()
+
+def run_validation(args, binary):
+
+        env = dict(os.environ)
+        env['EXALGO_VALIDATE_DIR'] = args.dumps
+        env['EXALGO_VALIDATE_TOLERANCE'] = args.tolerance
+        env['EXALGO_VALIDATE_REPORT'] = args.report
+        env['EXALGO_VALIDATE_ITERATIONS'] = args.iterations
+        if args.params is not None:
+                env['EXALGO_VALIDATE_PARAMS'] = args.params
+
+        p = subprocess.Popen([binary], env=env, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+        try:
+                output = p.communicate(timeout=args.timeout)[0]
+        except TypeError:  # python 2 - no timeout support
+                output = p.communicate()[0]
+        except subprocess.TimeoutExpired:
+                p.kill()
+                p.communicate()
+                return None
+        return output.decode('utf-8', 'replace')
+
+'''
+per call time of the original in ms from the funcreplace log (average_us line)
+'''
+def read_original_time(log):
+
+        with open(log) as f:
+                match = re.search(r'average_us\s+([0-9]+)', f.read())
+        if match is None:
+                return None
+        return float(match.group(1)) / 1000.0
+
+'''
+folder of the raw buffers buildex named next to the program (<prefix>_halide.cpp, <prefix>_dumps.txt)
+'''
+def read_dump_folder(program):
+
+        manifest = re.sub(r'_halide\.cpp$', '', program) + '_dumps.txt'
+        if not os.path.isfile(manifest):
+                return os.environ.get('EXALGO_OUTPUT_FOLDER')
+        with open(manifest) as f:
+                return f.read().strip()
+
+def main():
+
+        args = parse_arguments()
+
+        if args.dumps is None:
+                args.dumps = read_dump_folder(args.program)
+        if args.dumps is None or not os.path.isdir(args.dumps):
+                print('ERROR: no dump folder; give --dumps or set EXALGO_OUTPUT_FOLDER')
+                return 1
+
+        name = os.path.abspath(os.path.splitext(args.program)[0])
+        binary = name + '_validate'
+        if not build_program(args, args.program, binary):
+                print('ERROR: building ' + args.program + ' failed')
+                return 1
+
+        output = run_validation(args, binary)
+        if output is None:
+                print('ERROR: validation timed out')
+                return 1
+        print(output)
+
+        verdict = re.search(r'validate_verdict\s+(\w+)', output)
+        lifted = re.search(r'validate_time_ms\s+([0-9.eE+-]+)', output)
+        verdict = 'FAIL' if verdict is None else verdict.group(1)
+        lifted = None if lifted is None else float(lifted.group(1))
+        original = None if args.original is None else read_original_time(args.original)
+
+        with open(name + '_validation.txt', 'w') as f:
+                f.write('verdict ' + verdict + '\n')
+                for line in output.splitlines():
+                        if line.startswith('validate_output') or line.startswith('validate_mismatch'):
+                                f.write(line + '\n')
+                if lifted is not None:
+                        f.write('lifted_ms ' + str(lifted) + '\n')
+                if original is not None:
+                        f.write('original_ms ' + str(original) + '\n')
+                if lifted is not None and original is not None and lifted > 0:
+                        f.write('speedup ' + str(original / lifted) + '\n')
+
+        summary = 'verdict ' + verdict
+        if lifted is not None:
+                summary += ', lifted ' + str(lifted) + ' ms'
+        if original is not None:
+                summary += ', original ' + str(original) + ' ms'
+        if lifted is not None and original is not None and lifted > 0:
+                summary += ', speedup ' + str(round(original / lifted, 2)) + 'x'
+        print(summary)
+        return 0 if verdict == 'PASS' else 1
+
+if __name__ == '__main__':
+        exit(main())